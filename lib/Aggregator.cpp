@@ -0,0 +1,123 @@
+//
+// Created by Ilya Nyrkov on 21.09.25.
+//
+
+#include "memoria/Aggregator.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace memoria {
+
+static const RowValue kNull{"NULL"};
+
+// index of column in slots, appended if new
+static std::size_t slotFor(std::vector<std::size_t>& slots, std::size_t column) {
+    const auto it = std::find(slots.begin(), slots.end(), column);
+    if (it != slots.end())
+        return static_cast<std::size_t>(it - slots.begin());
+    slots.push_back(column);
+    return slots.size() - 1;
+}
+
+Aggregator::Aggregator(std::vector<Aggregate> aggregates, const Schema& schema)
+    : aggregates_(std::move(aggregates)) {
+    targets_.reserve(aggregates_.size());
+    for (const auto& agg : aggregates_) {
+        const auto col = agg.column ? schema.require_index(*agg.column) : std::size_t{0};
+        if (agg.func == AggregateFunc::Count) {
+            // no NULLs, so COUNT(c) is COUNT(*)
+            targets_.push_back({Target::Kind::Count, 0});
+        } else if (schema.columns().at(col).type == ColumnType::Int) {
+            targets_.push_back({Target::Kind::Int, slotFor(intColumns_, col)});
+        } else if (agg.func == AggregateFunc::Min || agg.func == AggregateFunc::Max) {
+            targets_.push_back({Target::Kind::Str, slotFor(strColumns_, col)});
+        } else {
+            throw std::invalid_argument(aggregateName(agg) + " needs an int column");
+        }
+    }
+}
+
+bool Aggregator::countsOnly() const noexcept {
+    return intColumns_.empty() && strColumns_.empty();
+}
+
+Aggregator::State Aggregator::state() const {
+    State st;
+    st.ints.resize(intColumns_.size());
+    st.strs.resize(strColumns_.size());
+    return st;
+}
+
+void Aggregator::add(State& st, const RowGroup& group, const uint32_t* sel,
+                     std::size_t n) const {
+    st.count += n;
+    const auto& columns = group.columns();
+    const auto aggregate = simdKernels().aggregate;
+    for (std::size_t s = 0; s < intColumns_.size(); ++s)
+        aggregate(std::get<IntColumn>(columns[intColumns_[s]]).data(), sel, n, st.ints[s]);
+
+    for (std::size_t s = 0; s < strColumns_.size(); ++s) {
+        for (std::size_t k = 0; k < n; ++k)
+            st.strs[s].add(group.row(sel ? sel[k] : k).strAt(strColumns_[s]));
+    }
+}
+
+void Aggregator::merge(State& into, const State& from) const {
+    into.count += from.count;
+    for (std::size_t s = 0; s < into.ints.size(); ++s)
+        into.ints[s].merge(from.ints[s]);
+    for (std::size_t s = 0; s < into.strs.size(); ++s)
+        into.strs[s].merge(from.strs[s]);
+}
+
+void Aggregator::StrRange::merge(const StrRange& other) noexcept {
+    if (!other.any)
+        return;
+    if (!any) {
+        *this = other;
+        return;
+    }
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+std::vector<RowValue> Aggregator::result(const State& st) const {
+    std::vector<RowValue> out;
+    out.reserve(aggregates_.size());
+    appendResult(st.count, st.ints.data(), st.strs.data(), out);
+    return out;
+}
+
+void Aggregator::appendResult(uint64_t count, const IntAccumulator* ints, const StrRange* strs,
+                              std::vector<RowValue>& out) const {
+    for (std::size_t a = 0; a < aggregates_.size(); ++a) {
+        const Aggregate& agg = aggregates_[a];
+        const Target& target = targets_[a];
+        if (target.kind == Target::Kind::Count) {
+            out.emplace_back(static_cast<int64_t>(count));
+        } else if (target.kind == Target::Kind::Str) {
+            const StrRange& range = strs[target.slot];
+            if (!range.any)
+                out.push_back(kNull);
+            else
+                out.emplace_back(agg.func == AggregateFunc::Min ? range.min : range.max);
+        } else if (agg.func == AggregateFunc::Sum) {
+            const auto sum = ints[target.slot].sum();
+            if (!sum)
+                throw std::overflow_error(aggregateName(agg) + " does not fit an int");
+            out.emplace_back(*sum);
+        } else if (count == 0) {
+            out.push_back(kNull);
+        } else if (agg.func == AggregateFunc::Min) {
+            out.emplace_back(ints[target.slot].min);
+        } else if (agg.func == AggregateFunc::Max) {
+            out.emplace_back(ints[target.slot].max);
+        } else {
+            out.emplace_back(ints[target.slot].average(count));
+        }
+    }
+}
+
+} // namespace memoria
@@ -0,0 +1,265 @@
+//
+// Created by Ilya Nyrkov on 11.09.25.
+//
+
+#include "memoria/BTreeIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace memoria {
+
+// entries are ordered by (key, RowId), so duplicate keys still give every entry a unique slot
+static bool before(int64_t ak, RowId aid, int64_t bk, RowId bid) noexcept {
+    return ak < bk || (ak == bk && aid < bid);
+}
+
+// number of entries in [0, n) ordered strictly before (key, id)
+static std::size_t lowerBound(const int64_t* keys, const RowId* ids, std::size_t n, int64_t key,
+                              RowId id) noexcept {
+    std::size_t lo = 0, hi = n;
+    while (lo < hi) {
+        const std::size_t mid = (lo + hi) / 2;
+        if (before(keys[mid], ids[mid], key, id))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// number of entries in [0, n) ordered at or before (key, id)
+static std::size_t upperBound(const int64_t* keys, const RowId* ids, std::size_t n, int64_t key,
+                              RowId id) noexcept {
+    std::size_t lo = 0, hi = n;
+    while (lo < hi) {
+        const std::size_t mid = (lo + hi) / 2;
+        if (before(key, id, keys[mid], ids[mid]))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+BTreeIndex::BTreeIndex(std::string name, std::size_t column)
+    : name_(std::move(name)), column_(column) {
+    clear();
+}
+
+void BTreeIndex::clear() {
+    leaves_.assign(1, Leaf{});
+    inners_.clear();
+    root_ = 0;
+    height_ = 0;
+    size_ = 0;
+}
+
+uint32_t BTreeIndex::findLeaf(int64_t key, RowId id) const {
+    uint32_t node = root_;
+    for (unsigned level = height_; level > 0; --level) {
+        const Inner& inner = inners_[node];
+        node = inner.children[upperBound(inner.keys, inner.ids, inner.count, key, id)];
+    }
+    return node;
+}
+
+void BTreeIndex::insert(const RowValue& key, RowId id) {
+    insertKey(key.asInt(), id);
+}
+
+void BTreeIndex::insertKey(int64_t key, RowId id) {
+    Split split{};
+    if (insertInto(root_, height_, key, id, split)) {
+        // the root split: grow the tree by one level
+        Inner root;
+        root.count = 1;
+        root.keys[0] = split.key;
+        root.ids[0] = split.id;
+        root.children[0] = root_;
+        root.children[1] = split.node;
+        root_ = static_cast<uint32_t>(inners_.size());
+        inners_.push_back(root);
+        ++height_;
+    }
+    ++size_;
+}
+
+static void insertIntoLeaf(int64_t* keys, RowId* ids, uint32_t& count, int64_t key, RowId id) {
+    const std::size_t pos = lowerBound(keys, ids, count, key, id);
+    std::copy_backward(keys + pos, keys + count, keys + count + 1);
+    std::copy_backward(ids + pos, ids + count, ids + count + 1);
+    keys[pos] = key;
+    ids[pos] = id;
+    ++count;
+}
+
+bool BTreeIndex::insertInto(uint32_t node, unsigned level, int64_t key, RowId id, Split& split) {
+    if (level == 0) {
+        if (leaves_[node].count < kLeafSlots) {
+            Leaf& leaf = leaves_[node];
+            insertIntoLeaf(leaf.keys, leaf.ids, leaf.count, key, id);
+            return false;
+        }
+        // full leaf: move the upper half into a new right sibling
+        const auto right = static_cast<uint32_t>(leaves_.size());
+        leaves_.emplace_back();
+        Leaf& l = leaves_[node];
+        Leaf& r = leaves_[right];
+        constexpr std::size_t half = kLeafSlots / 2;
+        std::copy(l.keys + half, l.keys + kLeafSlots, r.keys);
+        std::copy(l.ids + half, l.ids + kLeafSlots, r.ids);
+        r.count = kLeafSlots - half;
+        l.count = half;
+        r.next = l.next;
+        l.next = right;
+
+        Leaf& target = before(key, id, r.keys[0], r.ids[0]) ? l : r;
+        insertIntoLeaf(target.keys, target.ids, target.count, key, id);
+        split = Split{r.keys[0], r.ids[0], right};
+        return true;
+    }
+
+    const std::size_t pos = upperBound(inners_[node].keys, inners_[node].ids,
+                                       inners_[node].count, key, id);
+    Split child{};
+    if (!insertInto(inners_[node].children[pos], level - 1, key, id, child))
+        return false;
+
+    // the child at pos split: its new sibling goes right after it
+    auto place = [](Inner& n, std::size_t at, const Split& s) {
+        std::copy_backward(n.keys + at, n.keys + n.count, n.keys + n.count + 1);
+        std::copy_backward(n.ids + at, n.ids + n.count, n.ids + n.count + 1);
+        std::copy_backward(n.children + at + 1, n.children + n.count + 1,
+                           n.children + n.count + 2);
+        n.keys[at] = s.key;
+        n.ids[at] = s.id;
+        n.children[at + 1] = s.node;
+        ++n.count;
+    };
+    if (inners_[node].count < kInnerSlots) {
+        place(inners_[node], pos, child);
+        return false;
+    }
+
+    // full inner node: separator `mid` moves up, everything right of it goes to a new sibling
+    const auto right = static_cast<uint32_t>(inners_.size());
+    inners_.emplace_back();
+    Inner& l = inners_[node];
+    Inner& r = inners_[right];
+    constexpr std::size_t mid = kInnerSlots / 2;
+    std::copy(l.keys + mid + 1, l.keys + kInnerSlots, r.keys);
+    std::copy(l.ids + mid + 1, l.ids + kInnerSlots, r.ids);
+    std::copy(l.children + mid + 1, l.children + kInnerSlots + 1, r.children);
+    r.count = kInnerSlots - mid - 1;
+    l.count = mid;
+    split = Split{l.keys[mid], l.ids[mid], right};
+
+    if (pos <= mid)
+        place(l, pos, child);
+    else
+        place(r, pos - mid - 1, child);
+    return true;
+}
+
+void BTreeIndex::erase(int64_t key, RowId id) {
+    Leaf& leaf = leaves_[findLeaf(key, id)];
+    const std::size_t pos = lowerBound(leaf.keys, leaf.ids, leaf.count, key, id);
+    if (pos == leaf.count || leaf.keys[pos] != key || leaf.ids[pos] != id)
+        return;
+    std::copy(leaf.keys + pos + 1, leaf.keys + leaf.count, leaf.keys + pos);
+    std::copy(leaf.ids + pos + 1, leaf.ids + leaf.count, leaf.ids + pos);
+    --leaf.count;
+    --size_;
+
+    if (leaves_.size() > 1 && size_ * 4 < leaves_.size() * kLeafSlots)
+        rebuild();
+}
+
+bool BTreeIndex::range(int64_t lo, int64_t hi, std::vector<RowId>& out, std::size_t limit) const {
+    if (lo > hi)
+        return true;
+    uint32_t node = findLeaf(lo, 0);
+    std::size_t pos = lowerBound(leaves_[node].keys, leaves_[node].ids, leaves_[node].count, lo, 0);
+    std::size_t added = 0;
+    for (; node != kNone; node = leaves_[node].next, pos = 0) {
+        const Leaf& leaf = leaves_[node];
+        for (; pos < leaf.count; ++pos) {
+            if (leaf.keys[pos] > hi)
+                return true;
+            if (++added > limit)
+                return false;
+            out.push_back(leaf.ids[pos]);
+        }
+    }
+    return true;
+}
+
+void BTreeIndex::addGroup(const RowGroup& group, std::size_t g) {
+    const auto& col = std::get<IntColumn>(group.columns().at(column_));
+    for (std::size_t i = 0, n = group.size(); i < n; ++i)
+        insertKey(col.at(i), makeRowId(g, i));
+}
+
+void BTreeIndex::removeGroup(const RowGroup& group, std::size_t g) {
+    const auto& col = std::get<IntColumn>(group.columns().at(column_));
+    for (std::size_t i = 0, n = group.size(); i < n; ++i)
+        erase(col.at(i), makeRowId(g, i));
+}
+
+void BTreeIndex::rebuild() {
+    // gather the entries in order along the leaf chain
+    std::vector<int64_t> keys;
+    std::vector<RowId> ids;
+    keys.reserve(size_);
+    ids.reserve(size_);
+    for (uint32_t node = findLeaf(std::numeric_limits<int64_t>::min(), 0); node != kNone;
+         node = leaves_[node].next) {
+        const Leaf& leaf = leaves_[node];
+        keys.insert(keys.end(), leaf.keys, leaf.keys + leaf.count);
+        ids.insert(ids.end(), leaf.ids, leaf.ids + leaf.count);
+    }
+
+    // bulk load: full leaves left to right, then each inner level over the one below
+    clear();
+    leaves_.clear();
+    std::vector<uint32_t> level;
+    std::vector<std::pair<int64_t, RowId>> firsts; // smallest entry under each node of `level`
+    for (std::size_t i = 0; i < keys.size() || leaves_.empty(); i += kLeafSlots) {
+        const std::size_t end = std::min(keys.size(), i + kLeafSlots);
+        const auto idx = static_cast<uint32_t>(leaves_.size());
+        Leaf& leaf = leaves_.emplace_back();
+        std::copy(keys.begin() + i, keys.begin() + end, leaf.keys);
+        std::copy(ids.begin() + i, ids.begin() + end, leaf.ids);
+        leaf.count = static_cast<uint32_t>(end - i);
+        if (idx > 0)
+            leaves_[idx - 1].next = idx;
+        level.push_back(idx);
+        firsts.emplace_back(leaf.count ? keys[i] : 0, leaf.count ? ids[i] : 0);
+    }
+    while (level.size() > 1) {
+        std::vector<uint32_t> up;
+        std::vector<std::pair<int64_t, RowId>> upFirsts;
+        for (std::size_t i = 0; i < level.size(); i += kInnerSlots + 1) {
+            const std::size_t end = std::min(level.size(), i + kInnerSlots + 1);
+            Inner inner;
+            inner.children[0] = level[i];
+            for (std::size_t j = i + 1; j < end; ++j) {
+                inner.keys[j - i - 1] = firsts[j].first;
+                inner.ids[j - i - 1] = firsts[j].second;
+                inner.children[j - i] = level[j];
+            }
+            inner.count = static_cast<uint32_t>(end - i - 1);
+            up.push_back(static_cast<uint32_t>(inners_.size()));
+            upFirsts.push_back(firsts[i]);
+            inners_.push_back(inner);
+        }
+        level = std::move(up);
+        firsts = std::move(upFirsts);
+        ++height_;
+    }
+    root_ = level.front();
+    size_ = keys.size();
+}
+
+} // namespace memoria
@@ -0,0 +1,78 @@
+//
+// Created by Ilya Nyrkov on 29.09.25.
+//
+
+#include "memoria/BulkInsert.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace memoria {
+
+BulkInsert::BulkInsert(const StatementExecutor& exec, std::size_t maxQueued)
+    : exec_(exec), maxQueued_(std::max<std::size_t>(1, maxQueued)) {}
+
+BulkInsert::~BulkInsert() {
+    stop();
+}
+
+void BulkInsert::add(Insert&& batch) {
+    std::unique_lock lock{m_};
+    changed_.wait(lock, [&] { return queue_.size() < maxQueued_ || error_; });
+    if (error_)
+        std::rethrow_exception(error_);
+    queue_.push_back(std::move(batch));
+    if (!writer_.joinable())
+        writer_ = std::thread{[this] { run(); }};
+    changed_.notify_all();
+}
+
+std::size_t BulkInsert::finish() {
+    stop();
+    std::lock_guard lock{m_};
+    if (error_)
+        std::rethrow_exception(error_);
+    return rows_;
+}
+
+void BulkInsert::stop() {
+    {
+        std::lock_guard lock{m_};
+        closing_ = true;
+    }
+    changed_.notify_all();
+    if (writer_.joinable())
+        writer_.join();
+}
+
+void BulkInsert::run() {
+    std::unique_lock lock{m_};
+    while (true) {
+        changed_.wait(lock, [&] { return !queue_.empty() || closing_; });
+        if (queue_.empty())
+            return;
+        Insert batch = std::move(queue_.front());
+        queue_.pop_front();
+        changed_.notify_all(); // room for the next batch
+        const std::size_t rows = batch.rows.size();
+
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            exec_.execInsert(std::move(batch));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        if (error) {
+            error_ = error;
+            queue_.clear();
+            changed_.notify_all();
+            return;
+        }
+        rows_ += rows;
+    }
+}
+
+} // namespace memoria
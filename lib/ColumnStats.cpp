@@ -0,0 +1,218 @@
+//
+// Created by Ilya Nyrkov on 27.09.25.
+//
+
+#include "memoria/ColumnStats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace memoria {
+
+// ----------------------- HyperLogLog -----------------------
+
+void HyperLogLog::add(uint64_t hash) noexcept {
+    const std::size_t reg = hash >> (64 - kBits);
+    const uint64_t rest = hash << kBits;
+    const auto rank = static_cast<uint8_t>(rest == 0 ? 64 - kBits + 1 : std::countl_zero(rest) + 1);
+    registers_[reg] = std::max(registers_[reg], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) noexcept {
+    for (std::size_t r = 0; r < registers_.size(); ++r)
+        registers_[r] = std::max(registers_[r], other.registers_[r]);
+}
+
+uint64_t HyperLogLog::estimate() const noexcept {
+    const auto m = static_cast<double>(registers_.size());
+    double sum = 0;
+    std::size_t zeros = 0;
+    for (const uint8_t r : registers_) {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+    double e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    // small cardinalities: count the registers never hit instead (linear counting)
+    if (e <= 2.5 * m && zeros != 0)
+        e = m * std::log(m / static_cast<double>(zeros));
+    return static_cast<uint64_t>(std::llround(e));
+}
+
+static inline uint64_t mixHash(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t statsHash(int64_t v) noexcept {
+    return mixHash(static_cast<uint64_t>(v));
+}
+
+uint64_t statsHash(std::string_view v) noexcept {
+    return mixHash(std::hash<std::string_view>{}(v));
+}
+
+// ----------------------- Histogram -----------------------
+
+Histogram::Histogram(std::vector<int64_t> values, std::size_t buckets) : rows_(values.size()) {
+    if (values.empty() || buckets == 0)
+        return;
+    std::sort(values.begin(), values.end());
+    const std::size_t depth = (values.size() + buckets - 1) / buckets;
+    for (std::size_t begin = 0; begin < values.size();) {
+        std::size_t end = std::min(values.size(), begin + depth);
+        // keep a run of equal values in one bucket
+        while (end < values.size() && values[end] == values[end - 1])
+            ++end;
+        buckets_.push_back({values[begin], values[end - 1], end - begin});
+        begin = end;
+    }
+}
+
+double Histogram::fractionAtMost(int64_t v) const noexcept {
+    if (rows_ == 0)
+        return 0;
+    double rows = 0;
+    for (const Bucket& b : buckets_) {
+        if (b.hi <= v) {
+            rows += static_cast<double>(b.rows);
+        } else if (b.lo <= v) {
+            // long double: hi - lo may not fit in int64_t
+            const long double width = static_cast<long double>(b.hi) - b.lo + 1;
+            const long double below = static_cast<long double>(v) - b.lo + 1;
+            rows += static_cast<double>(b.rows * below / width);
+        } else {
+            break;
+        }
+    }
+    return rows / static_cast<double>(rows_);
+}
+
+// ----------------------- ColumnStats -----------------------
+
+static bool lessThan(const RowValue& a, const RowValue& b) {
+    return a.isInt() ? a.asInt() < b.asInt() : a.asStr() < b.asStr();
+}
+
+void ColumnStats::add(const RowValue& v) {
+    if (!min || lessThan(v, *min))
+        min = v;
+    if (!max || lessThan(*max, v))
+        max = v;
+    distinct.add(v.isInt() ? statsHash(v.asInt()) : statsHash(v.asStr()));
+}
+
+void ColumnStats::add(int64_t v) {
+    if (!min || v < min->asInt())
+        min = RowValue{v};
+    if (!max || v > max->asInt())
+        max = RowValue{v};
+    distinct.add(statsHash(v));
+}
+
+void ColumnStats::add(std::string_view v) {
+    if (!min || v < min->asStr())
+        min = RowValue{v};
+    if (!max || v > max->asStr())
+        max = RowValue{v};
+    distinct.add(statsHash(v));
+}
+
+uint64_t ColumnStats::distinctCount(uint64_t rows) const noexcept {
+    return std::min(distinct.estimate(), rows);
+}
+
+double ColumnStats::fractionAtMost(int64_t v) const {
+    if (!min)
+        return 0;
+    const int64_t lo = min->asInt(), hi = max->asInt();
+    if (v < lo)
+        return 0;
+    if (v >= hi)
+        return 1;
+    if (histogram.rows() != 0)
+        return histogram.fractionAtMost(v);
+    // no histogram yet (the table was empty at ANALYZE): assume an even spread over [min, max]
+    return static_cast<double>((static_cast<long double>(v) - lo + 1) /
+                               (static_cast<long double>(hi) - lo + 1));
+}
+
+double ColumnStats::fractionBetween(int64_t lo, int64_t hi) const {
+    if (lo > hi)
+        return 0;
+    const double below = lo == std::numeric_limits<int64_t>::min() ? 0 : fractionAtMost(lo - 1);
+    return std::clamp(fractionAtMost(hi) - below, 0.0, 1.0);
+}
+
+double ColumnStats::selectivity(CompareOp op, const RowValue& literal, uint64_t rows) const {
+    if (!min || rows == 0)
+        return 0;
+    const double eq = 1.0 / static_cast<double>(std::max<uint64_t>(1, distinctCount(rows)));
+    if (type == ColumnType::Str) {
+        const bool outside = literal.asStr() < min->asStr() || max->asStr() < literal.asStr();
+        const double match = outside ? 0 : eq;
+        return op == CompareOp::Neq ? 1 - match : match;
+    }
+
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+    const int64_t v = literal.asInt();
+    const bool outside = v < min->asInt() || v > max->asInt();
+    switch (op) {
+    case CompareOp::Eq:
+        return outside ? 0 : eq;
+    case CompareOp::Neq:
+        return outside ? 1 : 1 - eq;
+    case CompareOp::Lt:
+        return v == kMin ? 0 : fractionBetween(kMin, v - 1);
+    case CompareOp::Le:
+        return fractionBetween(kMin, v);
+    case CompareOp::Gt:
+        return v == kMax ? 0 : fractionBetween(v + 1, kMax);
+    case CompareOp::Ge:
+        return fractionBetween(v, kMax);
+    }
+    return 1;
+}
+
+// ----------------------- TableStats -----------------------
+
+TableStats::TableStats(const Schema& schema) {
+    columns.reserve(schema.size());
+    for (const auto& c : schema.columns())
+        columns.emplace_back(c.type);
+}
+
+void TableStats::add(const Row& row) {
+    ++rows;
+    for (std::size_t c = 0; c < columns.size(); ++c)
+        columns[c].add(row.at(c));
+}
+
+double TableStats::selectivity(const WhereExpr& expr, const Schema& schema) const {
+    if (const auto* c = std::get_if<Comparison>(&expr)) {
+        const ColumnStats& column = columns.at(schema.require_index(c->column));
+        if (!c->param)
+            return column.selectivity(c->op, c->literal, rows);
+        // a ? parameter: = / != as for a typical value, a range takes a third of the rows
+        const uint64_t distinct = std::max<uint64_t>(1, column.distinctCount(rows));
+        const double eq = rows == 0 ? 0 : 1.0 / static_cast<double>(distinct);
+        if (c->op == CompareOp::Eq)
+            return eq;
+        return c->op == CompareOp::Neq ? 1 - eq : 1.0 / 3;
+    }
+    if (const auto* a = std::get_if<And>(&expr))
+        return selectivity(*a->lhs, schema) * selectivity(*a->rhs, schema);
+    const auto& o = std::get<Or>(expr);
+    const double l = selectivity(*o.lhs, schema);
+    const double r = selectivity(*o.rhs, schema);
+    return l + r - l * r;
+}
+
+} // namespace memoria
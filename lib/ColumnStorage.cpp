@@ -0,0 +1,155 @@
+//
+// Created by Ilya Nyrkov on 02.09.25.
+//
+
+#include "memoria/ColumnStorage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace memoria {
+
+// -------------------- IntColumn --------------------
+
+void IntColumn::clear() noexcept {
+    values_.clear();
+}
+
+void IntColumn::compact(const std::vector<uint8_t>& keep) {
+    std::size_t w = 0;
+    for (std::size_t r = 0; r < values_.size(); ++r) {
+        if (keep[r])
+            values_[w++] = values_[r];
+    }
+    values_.resize(w);
+}
+
+// -------------------- StrColumn --------------------
+
+// -------------------- StringArena --------------------
+
+std::string_view StringArena::store(std::string_view v) {
+    if (v.size() > blockCapacity_ - blockUsed_) {
+        // oversized strings get a block of their own
+        blockCapacity_ = std::max(kBlockSize, v.size());
+        blocks_.push_back(std::make_unique<char[]>(blockCapacity_));
+        blockUsed_ = 0;
+    }
+    char* dst = blocks_.back().get() + blockUsed_;
+    std::memcpy(dst, v.data(), v.size());
+    blockUsed_ += v.size();
+    bytesUsed_ += v.size();
+    return {dst, v.size()};
+}
+
+void StringArena::clear() noexcept {
+    blocks_.clear();
+    blockUsed_ = blockCapacity_ = bytesUsed_ = 0;
+}
+
+// -------------------- StrColumn --------------------
+
+void StrColumn::clear() noexcept {
+    refs_.clear();
+    arena_.clear();
+}
+
+void StrColumn::compact(const std::vector<uint8_t>& keep) {
+    std::size_t w = 0;
+    for (std::size_t r = 0; r < refs_.size(); ++r) {
+        if (keep[r])
+            refs_[w++] = refs_[r];
+    }
+    refs_.resize(w);
+    collectArena();
+}
+
+void StrColumn::assign(const std::vector<uint8_t>& mask, std::string_view v) {
+    const StringRef ref = makeRef(v);
+    for (std::size_t r = 0; r < refs_.size(); ++r) {
+        if (mask[r])
+            refs_[r] = ref;
+    }
+    collectArena();
+}
+
+void StrColumn::collectArena() {
+    std::size_t live = 0;
+    for (const auto& ref : refs_) {
+        if (!ref.isInline())
+            live += ref.size();
+    }
+    if (arena_.bytesUsed() <= 2 * live + StringArena::kBlockSize)
+        return;
+
+    StringArena fresh;
+    for (auto& ref : refs_) {
+        if (!ref.isInline())
+            ref = StringRef{fresh.store(ref.view())};
+    }
+    arena_ = std::move(fresh);
+}
+
+// -------------------- StrDictionary / DictColumn --------------------
+
+uint32_t StrDictionary::intern(std::string_view v) {
+    if (auto it = codes_.find(v); it != codes_.end())
+        return it->second;
+    const auto code = static_cast<uint32_t>(values_.size());
+    auto [it, inserted] = codes_.emplace(std::string{v}, code);
+    values_.push_back(&it->first);
+    return code;
+}
+
+std::optional<uint32_t> StrDictionary::find(std::string_view v) const {
+    if (auto it = codes_.find(v); it != codes_.end())
+        return it->second;
+    return std::nullopt;
+}
+
+void DictColumn::clear() noexcept {
+    codes_.clear();
+}
+
+void DictColumn::compact(const std::vector<uint8_t>& keep) {
+    std::size_t w = 0;
+    for (std::size_t r = 0; r < codes_.size(); ++r) {
+        if (keep[r])
+            codes_[w++] = codes_[r];
+    }
+    codes_.resize(w);
+}
+
+void DictColumn::assign(const std::vector<uint8_t>& mask, std::string_view v) {
+    const uint32_t code = dict_->intern(v);
+    for (std::size_t r = 0; r < codes_.size(); ++r) {
+        if (mask[r])
+            codes_[r] = code;
+    }
+}
+
+// -------------------- helpers --------------------
+
+ColumnStorage makeColumnStorage(const Column& column, std::shared_ptr<StrDictionary> dict) {
+    switch (column.type) {
+    case ColumnType::Int:
+        return ColumnStorage{std::in_place_type<IntColumn>};
+    case ColumnType::Str:
+        if (column.encoding == ColumnEncoding::Dictionary)
+            return ColumnStorage{std::in_place_type<DictColumn>, std::move(dict)};
+        return ColumnStorage{std::in_place_type<StrColumn>};
+    default:
+        throw std::invalid_argument("unknown column type");
+    }
+}
+
+RowValue cellAt(const ColumnStorage& column, std::size_t row) {
+    if (const auto* ints = std::get_if<IntColumn>(&column))
+        return RowValue{ints->at(row)};
+    if (const auto* dict = std::get_if<DictColumn>(&column))
+        return RowValue{dict->at(row)};
+    return RowValue{std::get<StrColumn>(column).at(row)};
+}
+
+} // namespace memoria
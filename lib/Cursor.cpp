@@ -0,0 +1,215 @@
+//
+// Created by Ilya Nyrkov on 18.09.25.
+//
+
+#include "memoria/Cursor.h"
+
+#include "memoria/TopK.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace memoria {
+
+Cursor::Cursor(const Table& table, std::vector<std::string> header, FilterProgram filter,
+               std::optional<std::vector<std::size_t>> projection,
+               std::optional<std::vector<RowId>> candidates, std::shared_ptr<ThreadPool> pool)
+    : table_(&table), header_(std::move(header)), filter_(std::move(filter)),
+      projection_(std::move(projection)), candidates_(std::move(candidates)),
+      pool_(std::move(pool)), version_(table.version()) {
+    if (projection_) {
+        for (auto idx : *projection_) {
+            if (idx >= table.getSchema().size())
+                throw std::out_of_range("Projection index out of range");
+        }
+    }
+}
+
+void Cursor::orderBy(SortKey key) {
+    if (started_)
+        throw std::logic_error("ORDER BY must be set before the first row is pulled");
+    if (key.column >= table_->getSchema().size())
+        throw std::out_of_range("ORDER BY column index out of range");
+    order_ = key;
+}
+
+void Cursor::limit(std::size_t count, std::size_t offset) {
+    if (started_)
+        throw std::logic_error("LIMIT must be set before the first row is pulled");
+    remaining_ = count;
+    skip_ = offset;
+}
+
+bool Cursor::advance() {
+    while (true) {
+        if (wavePos_ == wave_.size()) {
+            if (group_ >= table_->rowGroupCount())
+                return false;
+            fillWave();
+        }
+        currentGroup_ = waveBase_ + wavePos_;
+        sel_.swap(wave_[wavePos_++]);
+        selPos_ = 0;
+        if (!sel_.empty())
+            return true;
+    }
+}
+
+void Cursor::fillWave() {
+    const uint64_t start = readTicks();
+    const std::size_t width = pool_ ? pool_->size() : 1;
+    const std::size_t count = table_->rowGroupCount();
+    const std::size_t n = group_ < count ? std::min(width, count - group_) : 0;
+    wave_.resize(n);
+    waveBase_ = group_;
+    wavePos_ = 0;
+    group_ += n;
+    if (n == 1) {
+        profile_.scanned += selectGroup(waveBase_, wave_[0]);
+    } else {
+        std::vector<std::size_t> looked(n);
+        pool_->parallelFor(
+            n, [&](std::size_t k) { looked[k] = selectGroup(waveBase_ + k, wave_[k]); });
+        for (const std::size_t l : looked)
+            profile_.scanned += l;
+    }
+    for (const auto& sel : wave_)
+        profile_.matched += sel.size();
+    profile_.groups += n;
+    profile_.filterTicks += readTicks() - start;
+}
+
+std::size_t Cursor::selectGroup(std::size_t g, std::vector<uint32_t>& sel) const {
+    sel.clear();
+    const RowGroup& group = table_->rowGroup(g);
+    if (!candidates_) {
+        filter_.bind(group).select(sel);
+        return group.size();
+    }
+    const auto& ids = *candidates_;
+    auto it = std::lower_bound(ids.begin(), ids.end(), makeRowId(g, 0));
+    for (; it != ids.end() && rowIdGroup(*it) == g; ++it) {
+        const std::size_t i = rowIdOffset(*it);
+        if (i < group.size())
+            sel.push_back(static_cast<uint32_t>(i));
+    }
+    const std::size_t looked = sel.size();
+    if (!sel.empty())
+        filter_.bind(group).refine(sel);
+    return looked;
+}
+
+template <class Key, class KeyAt>
+void Cursor::sortBy(const KeyAt& keyAt) {
+    using Entry = std::pair<Key, RowId>;
+    const bool descending = order_->descending;
+    // ties in storage order whatever the direction
+    const auto before = [descending](const Entry& a, const Entry& b) {
+        if (a.first != b.first)
+            return descending ? b.first < a.first : a.first < b.first;
+        return a.second < b.second;
+    };
+    const std::size_t keep = remaining_ > kNoLimit - skip_ ? kNoLimit : skip_ + remaining_;
+    TopK<Entry, decltype(before)> top{keep, before};
+    while (advance()) {
+        const RowGroup& group = table_->rowGroup(currentGroup_);
+        for (const uint32_t i : sel_)
+            top.push({keyAt(group, i), makeRowId(currentGroup_, i)});
+        selPos_ = sel_.size();
+    }
+
+    std::vector<Entry> entries = top.take();
+    const std::size_t skipped = std::min(skip_, entries.size());
+    sorted_.emplace();
+    sorted_->reserve(entries.size() - skipped);
+    for (std::size_t k = skip_; k < entries.size(); ++k)
+        sorted_->push_back(entries[k].second);
+    skip_ = 0;
+    profile_.skipped += skipped;
+    profile_.sortBytes += entries.capacity() * sizeof(Entry) + sorted_->capacity() * sizeof(RowId);
+}
+
+void Cursor::sortAll() {
+    const uint64_t start = readTicks();
+    const std::size_t col = order_->column;
+    if (table_->getSchema().columns()[col].type == ColumnType::Int) {
+        sortBy<int64_t>([col](const RowGroup& group, uint32_t i) {
+            return std::get<IntColumn>(group.columns()[col]).at(i);
+        });
+    } else {
+        // views into the table, which does not change while the cursor is in use
+        sortBy<std::string_view>(
+            [col](const RowGroup& group, uint32_t i) { return group.row(i).strAt(col); });
+    }
+    profile_.sortTicks += readTicks() - start;
+}
+
+template <class Fn>
+std::size_t Cursor::pull(std::size_t maxRows, const Fn& fn) {
+    if (table_->version() != version_)
+        throw std::logic_error("Table was modified while the cursor was open");
+    const uint64_t start = readTicks();
+    started_ = true;
+    if (order_ && !sorted_)
+        sortAll();
+    std::size_t pulled = 0;
+    while (pulled < maxRows && remaining_ > 0) {
+        std::size_t take = 0;
+        if (sorted_) {
+            take = std::min({maxRows - pulled, remaining_, sorted_->size() - sortedPos_});
+            if (take == 0)
+                break;
+            for (std::size_t k = 0; k < take; ++k) {
+                const RowId id = (*sorted_)[sortedPos_++];
+                fn(rowIdGroup(id), rowIdOffset(id));
+            }
+        } else {
+            // stops filtering groups once the limit is reached
+            if (selPos_ == sel_.size() && !advance())
+                break;
+            if (skip_ > 0) {
+                const std::size_t skipped = std::min(skip_, sel_.size() - selPos_);
+                selPos_ += skipped;
+                skip_ -= skipped;
+                profile_.skipped += skipped;
+                continue;
+            }
+            take = std::min({maxRows - pulled, remaining_, sel_.size() - selPos_});
+            for (std::size_t k = 0; k < take; ++k)
+                fn(currentGroup_, sel_[selPos_++]);
+        }
+        pulled += take;
+        if (remaining_ != kNoLimit)
+            remaining_ -= take;
+    }
+    profile_.pulled += pulled;
+    profile_.pulls += pulled > 0;
+    profile_.pullTicks += readTicks() - start;
+    return pulled;
+}
+
+Row Cursor::emit(std::size_t group, std::size_t offset) const {
+    const RowGroup& rows = table_->rowGroup(group);
+    return projection_ ? rows.projectRow(offset, *projection_) : rows.materializeRow(offset);
+}
+
+std::optional<Row> Cursor::next() {
+    std::optional<Row> row;
+    pull(1, [&](std::size_t g, std::size_t i) { row = emit(g, i); });
+    return row;
+}
+
+bool Cursor::nextBatch(std::vector<Row>& out, std::size_t maxRows) {
+    out.clear();
+    pull(maxRows, [&](std::size_t g, std::size_t i) { out.push_back(emit(g, i)); });
+    return !out.empty();
+}
+
+RowRefs Cursor::nextRefs(std::size_t maxRows) {
+    std::vector<RowId> ids;
+    pull(maxRows, [&](std::size_t g, std::size_t i) { ids.push_back(makeRowId(g, i)); });
+    return RowRefs{*table_, version_, std::move(ids), projection_};
+}
+
+} // namespace memoria
@@ -32,4 +32,9 @@ const Table& Database::getTable(std::string tableName) const {
 bool Database::hasTable(std::string tableName) const noexcept {
     return tables_.contains(tableName);
 }
+
+void Database::setThreads(std::size_t threads) {
+    if (threads != pool_->size())
+        pool_ = std::make_shared<ThreadPool>(threads);
+}
 } // namespace memoria
@@ -0,0 +1,398 @@
+//
+// Created by Ilya Nyrkov on 28.09.25.
+//
+
+#include "memoria/FilterCompiler.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace memoria {
+
+namespace {
+
+// A WHERE lowered for the FilterProgram: comparisons resolved to typed column tests, every
+// AND / OR chain flattened into one node.
+struct Term {
+    enum class Kind : uint8_t { Test, And, Or, Accept, Reject };
+    Kind kind = Kind::Test;
+
+    // Test
+    FilterOp op = FilterOp::IntEq;
+    std::size_t column = 0;
+    int64_t operand = 0; // int literal or dictionary code; IntBetween: lower bound
+    int64_t hi = 0;      // IntBetween: upper bound
+    RowValue literal;    // the literal as written (Str* tests and estimates)
+    std::optional<std::size_t> param; // ? parameter setting operand / literal, see bindFilter
+
+    std::vector<Term> operands; // And / Or
+
+    // tests run per row that reaches the term, and the share of those rows it accepts
+    double cost = 1;
+    double selectivity = 1;
+};
+
+} // namespace
+
+static Term constant(bool accept) {
+    Term t;
+    t.kind = accept ? Term::Kind::Accept : Term::Kind::Reject;
+    return t;
+}
+
+static Term test(FilterOp op, std::size_t column, int64_t operand, RowValue literal) {
+    Term t;
+    t.op = op;
+    t.column = column;
+    t.operand = operand;
+    t.literal = std::move(literal);
+    return t;
+}
+
+// operand of a Code* test for a string not in the dictionary: no row has it
+static constexpr int64_t kNoCode = std::numeric_limits<uint32_t>::max();
+
+// a test on a ? parameter: the type was checked when the value was bound, and the operand is
+// only known then
+static Term parameterTest(const Comparison& c, std::size_t idx, const Table& table) {
+    Term t;
+    if (table.getSchema().columns()[idx].type == ColumnType::Int) {
+        t = test(static_cast<FilterOp>(static_cast<int>(FilterOp::IntEq) +
+                                       static_cast<int>(c.op)),
+                 idx, 0, c.literal);
+    } else {
+        if (c.op != CompareOp::Eq && c.op != CompareOp::Neq)
+            throw std::invalid_argument("String WHERE supports only = / !=");
+        const bool eq = c.op == CompareOp::Eq;
+        if (table.dictionary(idx))
+            t = test(eq ? FilterOp::CodeEq : FilterOp::CodeNe, idx, kNoCode, c.literal);
+        else
+            t = test(eq ? FilterOp::StrEq : FilterOp::StrNe, idx, 0, c.literal);
+    }
+    t.param = c.param;
+    return t;
+}
+
+static Term lowerComparison(const Comparison& c, const Table& table) {
+    const Schema& schema = table.getSchema();
+    const std::size_t idx = schema.require_index(c.column);
+    const ColumnType t = schema.columns().at(idx).type;
+    if (c.param)
+        return parameterTest(c, idx, table);
+
+    if (t == ColumnType::Int) {
+        if (!c.literal.isInt())
+            throw std::invalid_argument("WHERE type mismatch: expected int literal");
+        // FilterOp's int comparisons are in CompareOp order
+        return test(static_cast<FilterOp>(static_cast<int>(FilterOp::IntEq) +
+                                          static_cast<int>(c.op)),
+                    idx, c.literal.asInt(), c.literal);
+    }
+
+    if (!c.literal.isStr())
+        throw std::invalid_argument("WHERE type mismatch: expected string literal");
+    if (c.op != CompareOp::Eq && c.op != CompareOp::Neq)
+        throw std::invalid_argument("String WHERE supports only = / !=");
+    const bool eq = c.op == CompareOp::Eq;
+
+    if (const StrDictionary* dict = table.dictionary(idx)) {
+        // dictionary column: compare codes; a literal not in the dictionary matches no row (=)
+        // or every row (!=)
+        const auto code = dict->find(c.literal.asStr());
+        if (!code)
+            return constant(!eq);
+        return test(eq ? FilterOp::CodeEq : FilterOp::CodeNe, idx, *code, c.literal);
+    }
+    // plain column: StringRef equality rejects most rows on length + inline prefix
+    return test(eq ? FilterOp::StrEq : FilterOp::StrNe, idx, 0, c.literal);
+}
+
+// a test that bounds an int column from one or both sides with a known literal
+static bool isIntBound(const Term& t) {
+    return t.kind == Term::Kind::Test && t.op <= FilterOp::IntBetween && t.op != FilterOp::IntNe &&
+           !t.param;
+}
+
+// the test for an int column in [lo, hi]
+static Term rangeTest(std::size_t column, int64_t lo, int64_t hi) {
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+    if (lo > hi)
+        return constant(false);
+    if (lo == hi)
+        return test(FilterOp::IntEq, column, lo, RowValue{lo});
+    if (lo == kMin && hi == kMax)
+        return constant(true);
+    if (lo == kMin)
+        return test(FilterOp::IntLe, column, hi, RowValue{hi});
+    if (hi == kMax)
+        return test(FilterOp::IntGe, column, lo, RowValue{lo});
+    Term t = test(FilterOp::IntBetween, column, lo, RowValue{lo});
+    t.hi = hi;
+    return t;
+}
+
+// Replaces two or more bounds on one int column among the operands of an AND by a single range
+// test, in place of the first of them.
+static void foldRanges(std::vector<Term>& operands) {
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+    for (std::size_t i = 0; i < operands.size(); ++i) {
+        if (!isIntBound(operands[i]))
+            continue;
+        const std::size_t column = operands[i].column;
+        const auto sameColumn = [&](const Term& t) { return isIntBound(t) && t.column == column; };
+        if (std::count_if(operands.begin() + i, operands.end(), sameColumn) < 2)
+            continue;
+
+        int64_t lo = kMin, hi = kMax;
+        bool empty = false;
+        for (std::size_t j = i; j < operands.size(); ++j) {
+            if (!sameColumn(operands[j]))
+                continue;
+            const int64_t v = operands[j].operand;
+            switch (operands[j].op) {
+            case FilterOp::IntEq:
+                lo = std::max(lo, v);
+                hi = std::min(hi, v);
+                break;
+            case FilterOp::IntLt:
+                empty |= v == kMin;
+                hi = std::min(hi, v - (v != kMin));
+                break;
+            case FilterOp::IntLe:
+                hi = std::min(hi, v);
+                break;
+            case FilterOp::IntGt:
+                empty |= v == kMax;
+                lo = std::max(lo, v + (v != kMax));
+                break;
+            case FilterOp::IntBetween: // folded from a nested AND
+                lo = std::max(lo, v);
+                hi = std::min(hi, operands[j].hi);
+                break;
+            default: // IntGe
+                lo = std::max(lo, v);
+                break;
+            }
+        }
+        operands[i] = empty ? constant(false) : rangeTest(column, lo, hi);
+        operands.erase(std::remove_if(operands.begin() + i + 1, operands.end(), sameColumn),
+                       operands.end());
+    }
+}
+
+// Lowers expr, flattening chains and folding constants and ranges on the way up.
+static Term lower(const WhereExpr& expr, const Table& table) {
+    if (const auto* c = std::get_if<Comparison>(&expr))
+        return lowerComparison(*c, table);
+
+    const bool isAnd = std::holds_alternative<And>(expr);
+    const Term::Kind kind = isAnd ? Term::Kind::And : Term::Kind::Or;
+    // AND: a false operand decides, a true one drops out; OR the other way round
+    const Term::Kind decides = isAnd ? Term::Kind::Reject : Term::Kind::Accept;
+    const Term::Kind neutral = isAnd ? Term::Kind::Accept : Term::Kind::Reject;
+
+    Term chain;
+    chain.kind = kind;
+    const auto add = [&](const WhereExpr& side) {
+        Term t = lower(side, table);
+        if (t.kind == kind) {
+            for (auto& operand : t.operands)
+                chain.operands.push_back(std::move(operand));
+        } else if (t.kind != neutral) {
+            chain.operands.push_back(std::move(t));
+        }
+    };
+    if (isAnd) {
+        add(*std::get<And>(expr).lhs);
+        add(*std::get<And>(expr).rhs);
+        foldRanges(chain.operands);
+    } else {
+        add(*std::get<Or>(expr).lhs);
+        add(*std::get<Or>(expr).rhs);
+    }
+
+    if (std::any_of(chain.operands.begin(), chain.operands.end(),
+                    [&](const Term& t) { return t.kind == decides; }))
+        return constant(!isAnd);
+    if (chain.operands.empty())
+        return constant(isAnd);
+    if (chain.operands.size() == 1)
+        return std::move(chain.operands.front());
+    return chain;
+}
+
+static uint32_t emitTerm(const Term& t, FilterProgram& program, uint32_t onTrue,
+                         uint32_t onFalse) {
+    switch (t.kind) {
+    case Term::Kind::Accept:
+        return onTrue;
+    case Term::Kind::Reject:
+        return onFalse;
+    case Term::Kind::And: {
+        // emitted last operand first, so each one can jump to the next
+        uint32_t next = onTrue;
+        for (auto it = t.operands.rbegin(); it != t.operands.rend(); ++it)
+            next = emitTerm(*it, program, next, onFalse);
+        return next;
+    }
+    case Term::Kind::Or: {
+        uint32_t next = onFalse;
+        for (auto it = t.operands.rbegin(); it != t.operands.rend(); ++it)
+            next = emitTerm(*it, program, onTrue, next);
+        return next;
+    }
+    case Term::Kind::Test:
+        break;
+    }
+    uint32_t pc = 0;
+    if (t.op == FilterOp::StrEq || t.op == FilterOp::StrNe)
+        pc = program.emitStr(t.op, t.column, t.literal, onTrue, onFalse);
+    else if (t.op == FilterOp::IntBetween)
+        pc = program.emitRange(t.column, t.operand, t.hi, onTrue, onFalse);
+    else
+        pc = program.emit(t.op, t.column, t.operand, onTrue, onFalse);
+    if (t.param)
+        program.markParam(pc, *t.param);
+    return pc;
+}
+
+namespace {
+
+// What selectivities are estimated from: the first batch of rows and the table statistics.
+struct Estimator {
+    const Table& table;
+    const TableStats* stats;
+    std::vector<uint32_t> sample; // offsets of the first batch of row group 0
+
+    // share of rows t accepts; a test on a ? parameter gets the rough guess below, whatever
+    // value it is later bound to
+    [[nodiscard]] double selectivity(const Term& t) const {
+        std::optional<double> measured, estimated;
+        if (!sample.empty() && !t.param) {
+            FilterProgram program;
+            program.finish(emitTerm(t, program, FilterProgram::kAccept, FilterProgram::kReject));
+            std::vector<uint32_t> sel = sample;
+            program.bind(table.rowGroup(0)).refine(sel);
+            measured = static_cast<double>(sel.size()) / static_cast<double>(sample.size());
+        }
+        if (stats && stats->rows != 0 && !t.param) {
+            const ColumnStats& column = stats->columns[t.column];
+            if (t.op == FilterOp::IntBetween) {
+                estimated = column.fractionBetween(t.operand, t.hi);
+            } else {
+                const bool neq = t.op == FilterOp::IntNe || t.op == FilterOp::CodeNe ||
+                                 t.op == FilterOp::StrNe;
+                const CompareOp op =
+                    t.op <= FilterOp::IntGe
+                        ? static_cast<CompareOp>(static_cast<int>(t.op))
+                        : (neq ? CompareOp::Neq : CompareOp::Eq);
+                estimated = column.selectivity(op, t.literal, stats->rows);
+            }
+        }
+        if (measured && estimated)
+            return (*measured + *estimated) / 2;
+        if (measured || estimated)
+            return measured ? *measured : *estimated;
+        // an empty table or a parameter: rough guesses
+        switch (t.op) {
+        case FilterOp::IntEq:
+        case FilterOp::CodeEq:
+        case FilterOp::StrEq:
+        case FilterOp::IntBetween:
+            return 0.1;
+        case FilterOp::IntNe:
+        case FilterOp::CodeNe:
+        case FilterOp::StrNe:
+            return 0.9;
+        default:
+            return 1.0 / 3;
+        }
+    }
+};
+
+} // namespace
+
+// relative price of one test per row: strings compare length and inline prefix, and may follow
+// a pointer into the arena; int and code tests are one vectorized compare
+static double testCost(FilterOp op) {
+    return op == FilterOp::StrEq || op == FilterOp::StrNe ? 4 : 1;
+}
+
+// Fills in cost and selectivity bottom up and orders the operands of every chain.
+static void order(Term& t, const Estimator& estimator) {
+    if (t.kind == Term::Kind::Test) {
+        t.cost = testCost(t.op);
+        t.selectivity = estimator.selectivity(t);
+        return;
+    }
+    if (t.kind != Term::Kind::And && t.kind != Term::Kind::Or)
+        return;
+
+    const bool isAnd = t.kind == Term::Kind::And;
+    for (auto& operand : t.operands)
+        order(operand, estimator);
+    // expected cost per row decided: an AND operand decides the rows it rejects, an OR operand
+    // the rows it accepts
+    const auto rank = [isAnd](const Term& x) {
+        const double decided = isAnd ? 1 - x.selectivity : x.selectivity;
+        return decided <= 0 ? std::numeric_limits<double>::infinity() : x.cost / decided;
+    };
+    std::stable_sort(t.operands.begin(), t.operands.end(),
+                     [&](const Term& a, const Term& b) { return rank(a) < rank(b); });
+
+    // rows reaching each operand: those the earlier ones left undecided
+    double reach = 1;
+    t.cost = 0;
+    for (const auto& operand : t.operands) {
+        t.cost += reach * operand.cost;
+        reach *= isAnd ? operand.selectivity : 1 - operand.selectivity;
+    }
+    t.selectivity = isAnd ? reach : 1 - reach;
+}
+
+FilterProgram compileFilter(const WhereExpr& expr, const Table& table) {
+    Term root = lower(expr, table);
+    if (root.kind == Term::Kind::And || root.kind == Term::Kind::Or) {
+        Estimator estimator{table, table.stats(), {}};
+        if (table.rowGroupCount() != 0) {
+            estimator.sample.resize(
+                std::min(table.rowGroup(0).size(), FilterProgram::kBatchRows));
+            std::iota(estimator.sample.begin(), estimator.sample.end(), uint32_t{0});
+        }
+        order(root, estimator);
+    }
+    FilterProgram program;
+    program.finish(emitTerm(root, program, FilterProgram::kAccept, FilterProgram::kReject));
+    return program;
+}
+
+void bindFilter(FilterProgram& program, const std::vector<RowValue>& values, const Table& table) {
+    for (const FilterParam& p : program.params()) {
+        const FilterInstr& in = program.instructions()[p.instr];
+        const RowValue& v = values.at(p.param);
+        switch (in.op) {
+        case FilterOp::CodeEq:
+        case FilterOp::CodeNe: {
+            const auto code = table.dictionary(in.column)->find(v.asStr());
+            program.bindOperand(p, code ? int64_t{*code} : kNoCode);
+            break;
+        }
+        case FilterOp::StrEq:
+        case FilterOp::StrNe:
+            program.bindString(p, v);
+            break;
+        default:
+            program.bindOperand(p, v.asInt());
+            break;
+        }
+    }
+}
+
+} // namespace memoria
@@ -0,0 +1,271 @@
+//
+// Created by Ilya Nyrkov on 13.09.25.
+//
+
+#include "memoria/FilterProgram.h"
+#include "memoria/SimdKernels.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+namespace memoria {
+
+// ----------------------- building -----------------------
+
+uint32_t FilterProgram::emit(FilterOp op, std::size_t column, int64_t operand, uint32_t onTrue,
+                             uint32_t onFalse) {
+    instrs_.push_back(
+        FilterInstr{op, static_cast<uint32_t>(column), onTrue, onFalse, operand});
+    return static_cast<uint32_t>(instrs_.size() - 1);
+}
+
+uint32_t FilterProgram::emitStr(FilterOp op, std::size_t column, RowValue literal,
+                                uint32_t onTrue, uint32_t onFalse) {
+    strings_.push_back(std::move(literal));
+    return emit(op, column, static_cast<int64_t>(strings_.size() - 1), onTrue, onFalse);
+}
+
+uint32_t FilterProgram::emitRange(std::size_t column, int64_t lo, int64_t hi, uint32_t onTrue,
+                                  uint32_t onFalse) {
+    if (lo > hi)
+        throw std::invalid_argument("Empty IntBetween range");
+    ranges_.push_back({lo, static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo)});
+    return emit(FilterOp::IntBetween, column, static_cast<int64_t>(ranges_.size() - 1), onTrue,
+                onFalse);
+}
+
+void FilterProgram::markParam(uint32_t pc, std::size_t param) {
+    params_.push_back({pc, param});
+}
+
+void FilterProgram::finish(uint32_t entry) {
+    if (entry >= kAccept) {
+        instrs_.clear();
+        strings_.clear();
+        ranges_.clear();
+        params_.clear();
+        entry_ = entry;
+        return;
+    }
+
+    // instructions were emitted targets-first; reverse them so the entry comes first and every
+    // jump points forward
+    const auto n = static_cast<uint32_t>(instrs_.size());
+    auto remap = [n](uint32_t pc) { return pc >= kAccept ? pc : n - 1 - pc; };
+    std::reverse(instrs_.begin(), instrs_.end());
+    for (auto& in : instrs_) {
+        in.onTrue = remap(in.onTrue);
+        in.onFalse = remap(in.onFalse);
+    }
+    for (auto& p : params_)
+        p.instr = remap(p.instr);
+    entry_ = remap(entry);
+}
+
+// ----------------------- evaluation -----------------------
+
+static_assert(static_cast<int>(FilterOp::IntGe) == static_cast<int>(IntCompare::Ge) &&
+                  static_cast<int>(FilterOp::IntLt) == static_cast<int>(IntCompare::Lt),
+              "Int FilterOps index the SIMD kernel table");
+
+static const void* columnData(const ColumnStorage& column) {
+    return std::visit([](const auto& c) -> const void* { return c.data(); }, column);
+}
+
+// v in [r.lo, r.lo + r.span]: v - lo wraps around to a large value below lo
+struct InRange {
+    bool operator()(int64_t v, const IntRange& r) const noexcept {
+        return static_cast<uint64_t>(v) - static_cast<uint64_t>(r.lo) <= r.span;
+    }
+};
+
+// calls f(cells, rhs, cmp) with instruction in's typed column array, literal and comparison, so
+// each kernel below is instantiated per op
+template <class F>
+static decltype(auto) withTest(const FilterInstr& in, const void* column,
+                               const std::vector<RowValue>& strings,
+                               const std::vector<IntRange>& ranges, F&& f) {
+    const auto* ints = static_cast<const int64_t*>(column);
+    const auto* codes = static_cast<const uint32_t*>(column);
+    const auto* strs = static_cast<const StringRef*>(column);
+    const auto code = static_cast<uint32_t>(in.operand);
+    switch (in.op) {
+    case FilterOp::IntEq:
+        return f(ints, in.operand, std::equal_to<>{});
+    case FilterOp::IntNe:
+        return f(ints, in.operand, std::not_equal_to<>{});
+    case FilterOp::IntLt:
+        return f(ints, in.operand, std::less<>{});
+    case FilterOp::IntGt:
+        return f(ints, in.operand, std::greater<>{});
+    case FilterOp::IntLe:
+        return f(ints, in.operand, std::less_equal<>{});
+    case FilterOp::IntGe:
+        return f(ints, in.operand, std::greater_equal<>{});
+    case FilterOp::IntBetween:
+        return f(ints, ranges[in.operand], InRange{});
+    case FilterOp::CodeEq:
+        return f(codes, code, std::equal_to<>{});
+    case FilterOp::CodeNe:
+        return f(codes, code, std::not_equal_to<>{});
+    case FilterOp::StrEq:
+        return f(strs, strings[in.operand].strRef(), std::equal_to<>{});
+    case FilterOp::StrNe:
+        return f(strs, strings[in.operand].strRef(), std::not_equal_to<>{});
+    }
+    throw std::logic_error("Unhandled FilterOp");
+}
+
+template <class ColumnFor>
+bool FilterProgram::run(ColumnFor columnFor, std::size_t row) const {
+    uint32_t pc = entry_;
+    while (pc < kAccept) {
+        const FilterInstr& in = instrs_[pc];
+        const bool pass = withTest(in, columnFor(pc), strings_, ranges_,
+                                   [row](const auto* cells, const auto& rhs, auto cmp) {
+                                       return static_cast<bool>(cmp(cells[row], rhs));
+                                   });
+        pc = pass ? in.onTrue : in.onFalse;
+    }
+    return pc == kAccept;
+}
+
+bool FilterProgram::operator()(const RowView& row) const {
+    const auto& columns = row.columns();
+    return run([&](uint32_t pc) { return columnData(columns[instrs_[pc].column]); },
+               row.index());
+}
+
+FilterProgram::Bound::Bound(const FilterProgram& program, const RowGroup& group)
+    : program_(&program), rows_(group.size()) {
+    columns_.reserve(program.instrs_.size());
+    for (const auto& in : program.instrs_)
+        columns_.push_back(columnData(group.columns()[in.column]));
+}
+
+bool FilterProgram::Bound::operator()(std::size_t row) const {
+    return program_->run([this](uint32_t pc) { return columns_[pc]; }, row);
+}
+
+// packs 64 bytes of 0/1 into one word, byte j -> bit j
+static uint64_t packBits(const uint8_t* bytes) {
+    uint64_t word = 0;
+    for (std::size_t k = 0; k < 8; ++k) {
+        uint64_t x;
+        std::memcpy(&x, bytes + 8 * k, 8);
+        // gathers the low bit of each byte into the top byte, in order
+        word |= ((x * 0x0102040810204080ULL) >> 56) << (8 * k);
+    }
+    return word;
+}
+
+// out[w] = bit j set iff row 64 * w + j of cells passes, for the words where reach is non-zero
+// (the others are left 0); rows past `rows` never pass. Full words compare into a byte array in
+// a fixed-length branch-free loop the compiler vectorizes, then pack.
+template <class T, class V, class Cmp>
+static void compareWords(const T* cells, const V& rhs, Cmp cmp, std::size_t rows,
+                         const uint64_t* reach, uint64_t* out, std::size_t words) {
+    uint8_t bytes[64];
+    for (std::size_t w = 0; w < words; ++w) {
+        out[w] = 0;
+        if (reach[w] == 0)
+            continue;
+        const T* c = cells + w * 64;
+        const std::size_t n = std::min<std::size_t>(64, rows - w * 64);
+        if (n == 64) {
+            for (std::size_t j = 0; j < 64; ++j)
+                bytes[j] = static_cast<uint8_t>(static_cast<bool>(cmp(c[j], rhs)));
+            out[w] = packBits(bytes);
+        } else {
+            for (std::size_t j = 0; j < n; ++j)
+                out[w] |= static_cast<uint64_t>(static_cast<bool>(cmp(c[j], rhs))) << j;
+        }
+    }
+}
+
+void FilterProgram::Bound::select(std::vector<uint32_t>& sel) const {
+    sel.clear();
+    evaluate(nullptr, sel);
+}
+
+void FilterProgram::Bound::refine(std::vector<uint32_t>& sel) const {
+    std::vector<uint64_t> seed((rows_ + 63) / 64, 0);
+    for (const uint32_t row : sel)
+        seed[row / 64] |= uint64_t{1} << (row % 64);
+    sel.clear();
+    evaluate(seed.data(), sel);
+}
+
+void FilterProgram::Bound::evaluate(const uint64_t* seed, std::vector<uint32_t>& sel) const {
+    const FilterProgram& p = *program_;
+    const std::size_t n = p.instrs_.size();
+    if (n == 0 && p.entry_ == kReject)
+        return;
+
+    // Per batch, reach[pc] is the bitmask of rows whose evaluation arrives at instruction pc;
+    // slot n collects accepted rows. Each instruction splits its rows by the test's bitmask and
+    // ORs the halves into its targets; jumps only go forward, so one pass in program order
+    // settles every row. AND and OR therefore cost a few word operations per 64 rows.
+    constexpr std::size_t W = kBatchRows / 64;
+    const SimdKernels& kernels = simdKernels();
+    std::vector<uint64_t> reach((n + 1) * W);
+    uint64_t mask[W];
+    for (std::size_t start = 0; start < rows_; start += kBatchRows) {
+        const std::size_t rows = std::min(kBatchRows, rows_ - start);
+        const std::size_t words = (rows + 63) / 64;
+        std::fill(reach.begin(), reach.end(), 0);
+
+        uint64_t* entry = &reach[(p.entry_ == kAccept ? n : p.entry_) * W];
+        uint64_t any = 0;
+        for (std::size_t w = 0; w < words; ++w) {
+            const std::size_t left = rows - w * 64;
+            const uint64_t all = left >= 64 ? ~uint64_t{0} : (uint64_t{1} << left) - 1;
+            entry[w] = seed ? seed[start / 64 + w] & all : all;
+            any |= entry[w];
+        }
+        if (any == 0)
+            continue;
+
+        for (std::size_t pc = 0; pc < n; ++pc) {
+            const uint64_t* here = &reach[pc * W];
+            if (std::all_of(here, here + words, [](uint64_t w) { return w == 0; }))
+                continue;
+            const FilterInstr& in = p.instrs_[pc];
+            if (in.op <= FilterOp::IntGe) {
+                // int comparisons, the hot case, use the hand-written SIMD kernels; a range is a
+                // single unsigned compare in compareWords' byte loop
+                const auto* ints = static_cast<const int64_t*>(columns_[pc]);
+                kernels.compare[static_cast<std::size_t>(in.op)](ints + start, rows, in.operand,
+                                                                 here, mask);
+            } else {
+                withTest(in, columns_[pc], p.strings_, p.ranges_,
+                         [&](const auto* cells, const auto& rhs, auto cmp) {
+                             compareWords(cells + start, rhs, cmp, rows, here, mask, words);
+                         });
+            }
+            auto slot = [&](uint32_t target) -> uint64_t* {
+                if (target == kReject)
+                    return nullptr;
+                return &reach[(target == kAccept ? n : target) * W];
+            };
+            if (uint64_t* t = slot(in.onTrue)) {
+                for (std::size_t w = 0; w < words; ++w)
+                    t[w] |= here[w] & mask[w];
+            }
+            if (uint64_t* f = slot(in.onFalse)) {
+                for (std::size_t w = 0; w < words; ++w)
+                    f[w] |= here[w] & ~mask[w];
+            }
+        }
+
+        const uint64_t* accepted = &reach[n * W];
+        const std::size_t before = sel.size();
+        sel.resize(before + countBits(accepted, words));
+        kernels.compress(accepted, words, static_cast<uint32_t>(start), sel.data() + before);
+    }
+}
+
+} // namespace memoria
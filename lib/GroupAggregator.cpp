@@ -0,0 +1,216 @@
+//
+// Created by Ilya Nyrkov on 22.09.25.
+//
+
+#include "memoria/GroupAggregator.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace memoria {
+
+static constexpr uint64_t kHashSeed = 0x9E3779B97F4A7C15ull;
+static constexpr std::size_t kMinSlots = 16;
+
+// one key column folded into the running hash of a row
+static inline uint64_t hashCombine(uint64_t h, uint64_t v) noexcept {
+    return (((h << 5) | (h >> 59)) ^ v) * kHashSeed;
+}
+
+// spreads the combined hash over all bits: the top ones pick the partition, the low ones the slot
+static inline uint64_t hashFinish(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline std::string_view unpackStr(const uint64_t* words) noexcept {
+    return {reinterpret_cast<const char*>(static_cast<uintptr_t>(words[0])),
+            static_cast<std::size_t>(words[1])};
+}
+
+GroupAggregator::GroupAggregator(const Table& table, std::vector<std::size_t> keys,
+                                 const Aggregator& aggregator)
+    : aggregator_(&aggregator) {
+    if (keys.empty())
+        throw std::invalid_argument("GROUP BY needs at least one column");
+    const auto& columns = table.getSchema().columns();
+    for (const std::size_t col : keys) {
+        Key key{Key::Kind::Int, col, keyWords_, table.dictionary(col)};
+        if (key.dict) {
+            key.kind = Key::Kind::Code;
+        } else if (columns.at(col).type != ColumnType::Int) {
+            key.kind = Key::Kind::Str;
+            bitwiseKeys_ = false;
+        }
+        keyWords_ += key.kind == Key::Kind::Str ? 2 : 1;
+        keys_.push_back(key);
+    }
+}
+
+bool GroupAggregator::keysEqual(const uint64_t* a, const uint64_t* b) const noexcept {
+    if (bitwiseKeys_)
+        return std::equal(a, a + keyWords_, b);
+    for (const Key& key : keys_) {
+        if (key.kind == Key::Kind::Str) {
+            if (unpackStr(a + key.word) != unpackStr(b + key.word))
+                return false;
+        } else if (a[key.word] != b[key.word]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GroupAggregator::grow(Partition& part) {
+    part.slots_.assign(std::max(kMinSlots, part.slots_.size() * 2), 0);
+    const std::size_t mask = part.slots_.size() - 1;
+    for (std::size_t g = 0; g < part.hashes_.size(); ++g) {
+        std::size_t s = part.hashes_[g] & mask;
+        while (part.slots_[s] != 0)
+            s = (s + 1) & mask;
+        part.slots_[s] = static_cast<uint32_t>(g + 1);
+    }
+}
+
+uint32_t GroupAggregator::findOrInsert(Partition& part, uint64_t hash, const uint64_t* key) const {
+    // at most half full, so probes stay short
+    if (2 * (part.hashes_.size() + 1) > part.slots_.size())
+        grow(part);
+    const std::size_t mask = part.slots_.size() - 1;
+    for (std::size_t s = hash & mask;; s = (s + 1) & mask) {
+        const uint32_t slot = part.slots_[s];
+        if (slot == 0) {
+            const auto g = static_cast<uint32_t>(part.hashes_.size());
+            part.slots_[s] = g + 1;
+            part.hashes_.push_back(hash);
+            part.keys_.insert(part.keys_.end(), key, key + keyWords_);
+            part.counts_.push_back(0);
+            part.ints_.resize(part.ints_.size() + aggregator_->intColumns().size());
+            part.strs_.resize(part.strs_.size() + aggregator_->strColumns().size());
+            return g;
+        }
+        const uint32_t g = slot - 1;
+        if (part.hashes_[g] == hash && keysEqual(part.keys_.data() + g * keyWords_, key))
+            return g;
+    }
+}
+
+void GroupAggregator::add(Partial& partial, const RowGroup& group, const uint32_t* sel,
+                          std::size_t n) const {
+    const auto& columns = group.columns();
+    const auto row = [sel](std::size_t k) { return sel ? sel[k] : k; };
+
+    // pack and hash the keys a column at a time
+    std::vector<uint64_t> words(n * keyWords_);
+    std::vector<uint64_t> hashes(n, kHashSeed);
+    for (const Key& key : keys_) {
+        uint64_t* out = words.data() + key.word;
+        if (key.kind == Key::Kind::Int) {
+            const int64_t* data = std::get<IntColumn>(columns[key.column]).data();
+            for (std::size_t k = 0; k < n; ++k, out += keyWords_) {
+                *out = static_cast<uint64_t>(data[row(k)]);
+                hashes[k] = hashCombine(hashes[k], *out);
+            }
+        } else if (key.kind == Key::Kind::Code) {
+            const uint32_t* data = std::get<DictColumn>(columns[key.column]).data();
+            for (std::size_t k = 0; k < n; ++k, out += keyWords_) {
+                *out = data[row(k)];
+                hashes[k] = hashCombine(hashes[k], *out);
+            }
+        } else {
+            const auto& column = std::get<StrColumn>(columns[key.column]);
+            for (std::size_t k = 0; k < n; ++k, out += keyWords_) {
+                const std::string_view v = column.at(row(k));
+                out[0] = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(v.data()));
+                out[1] = v.size();
+                hashes[k] = hashCombine(hashes[k], std::hash<std::string_view>{}(v));
+            }
+        }
+    }
+
+    // the group of every row
+    std::vector<uint8_t> parts(n);
+    std::vector<uint32_t> groups(n);
+    for (std::size_t k = 0; k < n; ++k) {
+        const uint64_t h = hashFinish(hashes[k]);
+        parts[k] = static_cast<uint8_t>(h >> (64 - kPartitionBits));
+        Partition& part = partial[parts[k]];
+        groups[k] = findOrInsert(part, h, words.data() + k * keyWords_);
+        ++part.counts_[groups[k]];
+    }
+
+    // aggregate inputs a column at a time
+    const auto& intColumns = aggregator_->intColumns();
+    for (std::size_t s = 0; s < intColumns.size(); ++s) {
+        const int64_t* data = std::get<IntColumn>(columns[intColumns[s]]).data();
+        for (std::size_t k = 0; k < n; ++k)
+            partial[parts[k]].ints_[groups[k] * intColumns.size() + s].add(data[row(k)]);
+    }
+    const auto& strColumns = aggregator_->strColumns();
+    for (std::size_t s = 0; s < strColumns.size(); ++s) {
+        for (std::size_t k = 0; k < n; ++k)
+            partial[parts[k]].strs_[groups[k] * strColumns.size() + s].add(
+                group.row(row(k)).strAt(strColumns[s]));
+    }
+}
+
+std::vector<Row> GroupAggregator::finish(const std::vector<Partial>& partials,
+                                         ThreadPool& pool) const {
+    const std::size_t nInt = aggregator_->intColumns().size();
+    const std::size_t nStr = aggregator_->strColumns().size();
+    std::array<std::vector<Row>, kPartitions> outs;
+    pool.parallelFor(kPartitions, [&](std::size_t p) {
+        // partials in morsel order, so the group order does not depend on the thread count
+        Partition merged;
+        for (const Partial& partial : partials) {
+            const Partition& from = partial[p];
+            for (uint32_t g = 0; g < from.groups(); ++g) {
+                const uint32_t to =
+                    findOrInsert(merged, from.hashes_[g], from.keys_.data() + g * keyWords_);
+                merged.counts_[to] += from.counts_[g];
+                for (std::size_t s = 0; s < nInt; ++s)
+                    merged.ints_[to * nInt + s].merge(from.ints_[g * nInt + s]);
+                for (std::size_t s = 0; s < nStr; ++s)
+                    merged.strs_[to * nStr + s].merge(from.strs_[g * nStr + s]);
+            }
+        }
+
+        auto& out = outs[p];
+        out.reserve(merged.groups());
+        for (std::size_t g = 0; g < merged.groups(); ++g) {
+            std::vector<RowValue> cells;
+            cells.reserve(keys_.size() + aggregator_->aggregates().size());
+            const uint64_t* key = merged.keys_.data() + g * keyWords_;
+            for (const Key& k : keys_) {
+                if (k.kind == Key::Kind::Int)
+                    cells.emplace_back(static_cast<int64_t>(key[k.word]));
+                else if (k.kind == Key::Kind::Code)
+                    cells.emplace_back(k.dict->at(static_cast<uint32_t>(key[k.word])));
+                else
+                    cells.emplace_back(unpackStr(key + k.word));
+            }
+            aggregator_->appendResult(merged.counts_[g], merged.ints_.data() + g * nInt,
+                                      merged.strs_.data() + g * nStr, cells);
+            out.emplace_back(std::move(cells));
+        }
+    });
+
+    std::vector<Row> rows;
+    std::size_t total = 0;
+    for (const auto& out : outs)
+        total += out.size();
+    rows.reserve(total);
+    for (auto& out : outs)
+        std::move(out.begin(), out.end(), std::back_inserter(rows));
+    return rows;
+}
+
+} // namespace memoria
@@ -0,0 +1,77 @@
+//
+// Created by Ilya Nyrkov on 09.09.25.
+//
+
+#include "memoria/HashIndex.h"
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace memoria {
+
+std::size_t RowValueHash::operator()(const RowValue& v) const noexcept {
+    if (v.isInt())
+        return std::hash<int64_t>{}(v.asInt());
+    return std::hash<std::string_view>{}(v.asStr());
+}
+
+void HashIndex::insert(const RowValue& key, RowId id) {
+    auto& ids = map_[key];
+    if (ids.empty() || ids.back() < id)
+        ids.push_back(id);
+    else
+        ids.insert(std::upper_bound(ids.begin(), ids.end(), id), id);
+}
+
+const std::vector<RowId>* HashIndex::find(const RowValue& key) const {
+    auto it = map_.find(key);
+    return it == map_.end() ? nullptr : &it->second;
+}
+
+void HashIndex::addGroup(const RowGroup& group, std::size_t g) {
+    // ids past the end of their key's list are appended; those of a group re-added in the middle
+    // are gathered per key and inserted in one go
+    const ColumnStorage& col = group.columns().at(column_);
+    std::unordered_map<RowValue, std::vector<RowId>, RowValueHash> inner;
+    for (std::size_t i = 0, n = group.size(); i < n; ++i) {
+        RowValue key = cellAt(col, i);
+        const RowId id = makeRowId(g, i);
+        auto& ids = map_[key];
+        if (ids.empty() || ids.back() < id)
+            ids.push_back(id);
+        else
+            inner[std::move(key)].push_back(id);
+    }
+    for (const auto& [key, added] : inner) {
+        auto& ids = map_[key];
+        ids.insert(std::lower_bound(ids.begin(), ids.end(), added.front()), added.begin(),
+                   added.end());
+    }
+}
+
+void HashIndex::removeGroup(const RowGroup& group, std::size_t g) {
+    // visit each distinct key once; its ids of group g are one run of its sorted list
+    const ColumnStorage& col = group.columns().at(column_);
+    std::unordered_set<RowValue, RowValueHash> keys;
+    for (std::size_t i = 0, n = group.size(); i < n; ++i)
+        keys.insert(cellAt(col, i));
+
+    for (const auto& key : keys) {
+        auto it = map_.find(key);
+        if (it == map_.end())
+            continue;
+        auto& ids = it->second;
+        const auto first = std::lower_bound(ids.begin(), ids.end(), makeRowId(g, 0));
+        ids.erase(first, std::lower_bound(first, ids.end(), makeRowId(g + 1, 0)));
+        if (ids.empty())
+            map_.erase(it);
+    }
+}
+
+void HashIndex::clear() noexcept {
+    map_.clear();
+}
+
+} // namespace memoria
@@ -0,0 +1,214 @@
+//
+// Created by Ilya Nyrkov on 24.09.25.
+//
+
+#include "memoria/HashJoin.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <unistd.h>
+
+namespace memoria {
+
+static constexpr std::size_t kDefaultL2Bytes = std::size_t{1} << 20;
+static constexpr std::size_t kMaxPartitionBits = 10;
+static constexpr std::size_t kMorselRows = 16384;
+
+std::size_t l2CacheBytes() noexcept {
+    static const std::size_t bytes = [] {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (l2 > 0)
+            return static_cast<std::size_t>(l2);
+#endif
+        return kDefaultL2Bytes;
+    }();
+    return bytes;
+}
+
+// the top bits pick the partition, the low bits the bucket
+static inline uint64_t mixHash(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t hashKey(int64_t key) noexcept {
+    return mixHash(static_cast<uint64_t>(key));
+}
+
+static inline uint64_t hashKey(std::string_view key) noexcept {
+    return mixHash(std::hash<std::string_view>{}(key));
+}
+
+namespace {
+
+template <class Key>
+struct Entry {
+    uint64_t hash;
+    Key key; // Str keys point into the table
+    RowId id;
+};
+
+// one partition's build rows, chained by bucket; indices are 1-based, 0 ends a chain
+struct Buckets {
+    std::vector<uint32_t> heads;
+    std::vector<uint32_t> next;
+};
+
+// probe rows [begin, end) of one partition
+struct ProbeMorsel {
+    std::size_t partition;
+    std::size_t begin, end;
+};
+
+} // namespace
+
+template <class Key, class KeyAt>
+static std::vector<Entry<Key>> makeEntries(const JoinInput& in, const KeyAt& keyAt,
+                                           ThreadPool& pool) {
+    std::vector<Entry<Key>> out(in.rows.size());
+    const std::size_t morsels = (out.size() + kMorselRows - 1) / kMorselRows;
+    pool.parallelFor(morsels, [&](std::size_t m) {
+        const std::size_t end = std::min(out.size(), (m + 1) * kMorselRows);
+        for (std::size_t k = m * kMorselRows; k < end; ++k) {
+            const RowId id = in.rows[k];
+            const Key key = keyAt(in, in.table->rowGroup(rowIdGroup(id)), rowIdOffset(id));
+            out[k] = {hashKey(key), key, id};
+        }
+    });
+    return out;
+}
+
+// Stable scatter of entries by the top bits of their hash; returns the partition bounds.
+template <class Key>
+static std::vector<std::size_t> radixPartition(std::vector<Entry<Key>>& entries,
+                                               std::size_t bits) {
+    if (bits == 0)
+        return {0, entries.size()};
+    const std::size_t shift = 64 - bits;
+    std::vector<std::size_t> bounds((std::size_t{1} << bits) + 1, 0);
+    for (const auto& e : entries)
+        ++bounds[(e.hash >> shift) + 1];
+    for (std::size_t p = 1; p < bounds.size(); ++p)
+        bounds[p] += bounds[p - 1];
+
+    std::vector<std::size_t> pos(bounds.begin(), bounds.end() - 1);
+    std::vector<Entry<Key>> out(entries.size());
+    for (const auto& e : entries)
+        out[pos[e.hash >> shift]++] = e;
+    entries.swap(out);
+    return bounds;
+}
+
+template <class Key>
+static Buckets buildBuckets(const Entry<Key>* rows, std::size_t n) {
+    Buckets b;
+    if (n == 0)
+        return b;
+    std::size_t size = 1;
+    while (size < 2 * n)
+        size <<= 1;
+    b.heads.assign(size, 0);
+    b.next.resize(n);
+    // inserted back to front, so every chain lists its rows in storage order
+    for (std::size_t k = n; k-- > 0;) {
+        uint32_t& head = b.heads[rows[k].hash & (size - 1)];
+        b.next[k] = head;
+        head = static_cast<uint32_t>(k + 1);
+    }
+    return b;
+}
+
+template <class Key, class KeyAt>
+static std::vector<JoinPair> joinOn(const JoinInput& left, const JoinInput& right,
+                                    const KeyAt& keyAt, ThreadPool& pool,
+                                    std::size_t cacheBytes, JoinBuild side) {
+    const bool buildLeft = side == JoinBuild::Smaller ? left.rows.size() < right.rows.size()
+                                                      : side == JoinBuild::Left;
+    const JoinInput& buildIn = buildLeft ? left : right;
+    const JoinInput& probeIn = buildLeft ? right : left;
+    std::vector<Entry<Key>> build = makeEntries<Key>(buildIn, keyAt, pool);
+    std::vector<Entry<Key>> probe = makeEntries<Key>(probeIn, keyAt, pool);
+
+    // enough partitions for each one's hash table to stay in cache
+    const std::size_t tableBytes = build.size() * (sizeof(Entry<Key>) + 2 * sizeof(uint32_t));
+    std::size_t bits = 0;
+    while (bits < kMaxPartitionBits && (tableBytes >> bits) > cacheBytes)
+        ++bits;
+    const std::vector<std::size_t> buildBounds = radixPartition(build, bits);
+    const std::vector<std::size_t> probeBounds = radixPartition(probe, bits);
+    const std::size_t partitions = buildBounds.size() - 1;
+
+    std::vector<Buckets> buckets(partitions);
+    pool.parallelFor(partitions, [&](std::size_t p) {
+        buckets[p] =
+            buildBuckets(build.data() + buildBounds[p], buildBounds[p + 1] - buildBounds[p]);
+    });
+
+    std::vector<ProbeMorsel> morsels;
+    for (std::size_t p = 0; p < partitions; ++p) {
+        if (buckets[p].heads.empty())
+            continue;
+        for (std::size_t b = probeBounds[p]; b < probeBounds[p + 1]; b += kMorselRows)
+            morsels.push_back({p, b, std::min(b + kMorselRows, probeBounds[p + 1])});
+    }
+    std::vector<std::vector<JoinPair>> found(morsels.size());
+    pool.parallelFor(morsels.size(), [&](std::size_t m) {
+        const ProbeMorsel& morsel = morsels[m];
+        const Buckets& b = buckets[morsel.partition];
+        const Entry<Key>* rows = build.data() + buildBounds[morsel.partition];
+        const std::size_t mask = b.heads.size() - 1;
+        auto& out = found[m];
+        for (std::size_t k = morsel.begin; k < morsel.end; ++k) {
+            const Entry<Key>& e = probe[k];
+            for (uint32_t j = b.heads[e.hash & mask]; j != 0; j = b.next[j - 1]) {
+                const Entry<Key>& match = rows[j - 1];
+                if (match.hash != e.hash || match.key != e.key)
+                    continue;
+                out.emplace_back(buildLeft ? JoinPair{match.id, e.id} : JoinPair{e.id, match.id});
+            }
+        }
+    });
+
+    std::size_t total = 0;
+    for (const auto& f : found)
+        total += f.size();
+    std::vector<JoinPair> pairs;
+    pairs.reserve(total);
+    for (const auto& f : found)
+        pairs.insert(pairs.end(), f.begin(), f.end());
+    return pairs;
+}
+
+std::vector<JoinPair> hashJoin(const JoinInput& left, const JoinInput& right, ThreadPool& pool,
+                               std::size_t cacheBytes, JoinBuild build) {
+    const ColumnType lt = left.table->getSchema().columns().at(left.column).type;
+    const ColumnType rt = right.table->getSchema().columns().at(right.column).type;
+    if (lt != rt)
+        throw std::invalid_argument("JOIN columns must have the same type");
+    if (left.rows.empty() || right.rows.empty())
+        return {};
+
+    if (lt == ColumnType::Int) {
+        return joinOn<int64_t>(
+            left, right,
+            [](const JoinInput& in, const RowGroup& group, std::size_t i) {
+                return std::get<IntColumn>(group.columns()[in.column]).at(i);
+            },
+            pool, cacheBytes, build);
+    }
+    return joinOn<std::string_view>(
+        left, right,
+        [](const JoinInput& in, const RowGroup& group, std::size_t i) {
+            return group.row(i).strAt(in.column);
+        },
+        pool, cacheBytes, build);
+}
+
+} // namespace memoria
@@ -0,0 +1,179 @@
+//
+// Created by Ilya Nyrkov on 30.09.25.
+//
+
+#include "memoria/Lexer.h"
+
+#include "memoria/Parser.h"
+
+#include <array>
+#include <string>
+
+namespace memoria {
+
+namespace {
+
+constexpr std::array<std::string_view, 42> kKeywordTexts{
+    "SELECT", "FROM",  "WHERE",   "AND",     "OR",      "INSERT",  "INTO",    "VALUES",
+    "CREATE", "TABLE", "INDEX",   "ON",      "USING",   "DELETE",  "UPDATE",  "SET",
+    "JOIN",   "GROUP", "ORDER",   "BY",      "ASC",     "DESC",    "LIMIT",   "OFFSET",
+    "ANALYZE", "SHOW", "STATS",   "EXPLAIN", "PREPARE", "AS",      "EXECUTE", "DEALLOCATE",
+    "INT",    "STR",   "DICT",    "HASH",    "BTREE",   "COUNT",   "SUM",     "MIN",
+    "MAX",    "AVG",
+}; // in Keyword order, after None
+
+// ASCII letters to upper case; other characters only need to stay apart from letters
+constexpr unsigned fold(char c) noexcept {
+    return static_cast<unsigned char>(c) & 0xDFu;
+}
+
+// The constants were searched for so that no two keywords share a slot (checked below).
+constexpr std::size_t kSlots = 128;
+constexpr std::size_t slotOf(std::string_view w) noexcept {
+    return (fold(w[0]) + 2 * fold(w[1]) + fold(w.back()) + 33 * w.size()) % kSlots;
+}
+
+// slot -> Keyword, None where no keyword hashes to
+constexpr std::array<Keyword, kSlots> kSlotTable = [] {
+    std::array<Keyword, kSlots> table{};
+    for (std::size_t k = 0; k < kKeywordTexts.size(); ++k)
+        table[slotOf(kKeywordTexts[k])] = static_cast<Keyword>(k + 1);
+    return table;
+}();
+
+constexpr bool isPerfect() {
+    for (std::size_t k = 0; k < kKeywordTexts.size(); ++k) {
+        if (kSlotTable[slotOf(kKeywordTexts[k])] != static_cast<Keyword>(k + 1))
+            return false;
+    }
+    return true;
+}
+static_assert(isPerfect(), "two keywords share a hash slot: search for new constants");
+
+constexpr std::size_t kMinKeyword = 2, kMaxKeyword = 10;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+inline bool isWordStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+inline bool isWordChar(char c) {
+    return isWordStart(c) || isDigit(c);
+}
+
+} // namespace
+
+Keyword lookupKeyword(std::string_view word) noexcept {
+    if (word.size() < kMinKeyword || word.size() > kMaxKeyword)
+        return Keyword::None;
+    const Keyword kw = kSlotTable[slotOf(word)];
+    if (kw == Keyword::None)
+        return Keyword::None;
+    const std::string_view text = kKeywordTexts[static_cast<std::size_t>(kw) - 1];
+    if (text.size() != word.size())
+        return Keyword::None;
+    for (std::size_t k = 0; k < word.size(); ++k) {
+        if (fold(word[k]) != static_cast<unsigned char>(text[k]))
+            return Keyword::None;
+    }
+    return kw;
+}
+
+std::string_view keywordText(Keyword kw) noexcept {
+    return kw == Keyword::None ? std::string_view{}
+                               : kKeywordTexts[static_cast<std::size_t>(kw) - 1];
+}
+
+void tokenize(std::string_view s, std::vector<Token>& out) {
+    out.clear();
+    out.reserve(s.size() / 4 + 1);
+    std::size_t i = 0;
+    const auto push = [&](TokenKind kind, std::size_t len) {
+        out.push_back(Token{kind, Keyword::None, false, s.substr(i, len), i});
+        i += len;
+    };
+    while (true) {
+        while (i < s.size() && isSpace(s[i]))
+            ++i;
+        if (i == s.size())
+            break;
+        const char c = s[i];
+        const char n = i + 1 < s.size() ? s[i + 1] : '\0';
+
+        if (isWordStart(c)) {
+            std::size_t j = i + 1;
+            while (j < s.size() && isWordChar(s[j]))
+                ++j;
+            push(TokenKind::Word, j - i);
+            Token& t = out.back();
+            t.keyword = lookupKeyword(t.text);
+            t.upper = t.keyword != Keyword::None && t.text == keywordText(t.keyword);
+            continue;
+        }
+        if (isDigit(c) || ((c == '-' || c == '+') && isDigit(n))) {
+            std::size_t j = i + 1;
+            while (j < s.size() && isDigit(s[j]))
+                ++j;
+            push(TokenKind::Int, j - i);
+            continue;
+        }
+        if (c == '\'' || c == '"') {
+            // no escapes: the string ends at the next quote of its kind
+            const std::size_t end = s.find(c, i + 1);
+            if (end == std::string_view::npos)
+                throw ParseError("Unterminated string literal");
+            out.push_back(Token{TokenKind::String, Keyword::None, false,
+                                s.substr(i + 1, end - i - 1), i});
+            i = end + 1;
+            continue;
+        }
+        switch (c) {
+        case '?':
+            push(TokenKind::Param, 1);
+            continue;
+        case '(':
+            push(TokenKind::LParen, 1);
+            continue;
+        case ')':
+            push(TokenKind::RParen, 1);
+            continue;
+        case ',':
+            push(TokenKind::Comma, 1);
+            continue;
+        case '.':
+            push(TokenKind::Dot, 1);
+            continue;
+        case '*':
+            push(TokenKind::Star, 1);
+            continue;
+        case ';':
+            push(TokenKind::Semicolon, 1);
+            continue;
+        case '=':
+            push(TokenKind::Eq, 1);
+            continue;
+        case '<':
+            n == '=' ? push(TokenKind::Le, 2) : push(TokenKind::Lt, 1);
+            continue;
+        case '>':
+            n == '=' ? push(TokenKind::Ge, 2) : push(TokenKind::Gt, 1);
+            continue;
+        case '!':
+            if (n == '=') {
+                push(TokenKind::Neq, 2);
+                continue;
+            }
+            break;
+        default:
+            break;
+        }
+        throw ParseError("Unexpected character '" + std::string(1, c) + "'");
+    }
+    out.push_back(Token{TokenKind::End, Keyword::None, false, s.substr(i, 0), i});
+}
+
+} // namespace memoria
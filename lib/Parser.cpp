@@ -4,6 +4,10 @@
 
 #include "memoria/Parser.h"
 
+#include "memoria/Lexer.h"
+
+#include <algorithm>
+#include <cctype>
 #include <charconv>
 #include <memory>
 
@@ -27,95 +31,107 @@ static inline void skipSpaces(std::string_view s, std::size_t& i) {
         ++i;
 }
 
-static std::string parseIdent(std::string_view s, std::size_t& i) {
-    skipSpaces(s, i);
-    if (i >= s.size() || !(std::isalpha(static_cast<unsigned char>(s[i])) || s[i] == '_'))
+// -------------------- token reader --------------------
+
+namespace {
+
+// Walks the tokens of a statement (or a script) for the recursive-descent parser below. Statement
+// keywords only count in upper case; words like column types are matched in any case with
+// acceptWord. Any word is accepted as an identifier.
+class TokenReader {
+  public:
+    explicit TokenReader(const std::vector<Token>& tokens) : tokens_(tokens) {}
+
+    [[nodiscard]] const Token& peek(std::size_t ahead = 0) const {
+        return tokens_[std::min(at_ + ahead, tokens_.size() - 1)];
+    }
+    const Token& next() {
+        const Token& t = tokens_[at_];
+        if (t.kind != TokenKind::End)
+            ++at_;
+        return t;
+    }
+
+    [[nodiscard]] bool is(TokenKind kind) const {
+        return peek().kind == kind;
+    }
+    bool accept(TokenKind kind) {
+        if (!is(kind))
+            return false;
+        ++at_;
+        return true;
+    }
+    void expect(TokenKind kind, const char* error) {
+        if (!accept(kind))
+            throw ParseError(error);
+    }
+
+    [[nodiscard]] bool isKeyword(Keyword kw, std::size_t ahead = 0) const {
+        const Token& t = peek(ahead);
+        return t.keyword == kw && t.upper;
+    }
+    bool acceptKeyword(Keyword kw) {
+        if (!isKeyword(kw))
+            return false;
+        ++at_;
+        return true;
+    }
+    void expectKeyword(Keyword kw, const char* error) {
+        if (!acceptKeyword(kw))
+            throw ParseError(error);
+    }
+    // kw in any case (int / INT)
+    bool acceptWord(Keyword kw) {
+        if (peek().kind != TokenKind::Word || peek().keyword != kw)
+            return false;
+        ++at_;
+        return true;
+    }
+
+    // a statement ends at ; or at the end of the text
+    [[nodiscard]] bool atStatementEnd() const {
+        return is(TokenKind::Semicolon) || is(TokenKind::End);
+    }
+
+  private:
+    const std::vector<Token>& tokens_;
+    std::size_t at_ = 0;
+};
+
+} // namespace
+
+static std::string parseIdent(TokenReader& r) {
+    if (!r.is(TokenKind::Word))
         throw ParseError("Expected identifier");
-    std::size_t j = i + 1;
-    while (j < s.size()) {
-        char c = s[j];
-        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
-            ++j;
-            continue;
-        }
-        break;
+    return std::string{r.next().text};
+}
+
+// <ident> or <table>.<ident>
+static std::string parseColumnRef(TokenReader& r) {
+    std::string name = parseIdent(r);
+    if (r.accept(TokenKind::Dot)) {
+        name += '.';
+        name += parseIdent(r);
     }
-    std::string out(s.substr(i, j - i));
-    i = j;
-    return out;
+    return name;
 }
 
-static int64_t parseInt64(std::string_view s, std::size_t& i) {
-    skipSpaces(s, i);
-    std::size_t start = i;
-    if (i < s.size() && (s[i] == '+' || s[i] == '-'))
-        ++i;
-    if (i >= s.size() || !std::isdigit(static_cast<unsigned char>(s[i])))
+static int64_t parseInt64(TokenReader& r) {
+    if (!r.is(TokenKind::Int))
         throw ParseError("Expected integer literal");
-    while (i < s.size() && std::isdigit(static_cast<unsigned char>(s[i])))
-        ++i;
+    std::string_view digits = r.next().text;
+    if (digits.front() == '+')
+        digits.remove_prefix(1);
     int64_t v{};
-    auto sv = s.substr(start, i - start);
-    auto res = std::from_chars(sv.data(), sv.data() + sv.size(), v);
+    const auto res = std::from_chars(digits.data(), digits.data() + digits.size(), v);
     if (res.ec != std::errc{})
         throw ParseError("Invalid integer literal");
     return v;
 }
 
-static std::string parseQuoted(std::string_view s, std::size_t& i) {
-    skipSpaces(s, i);
-    if (i >= s.size() || (s[i] != '\'' && s[i] != '"'))
-        throw ParseError("Expected quoted string");
-    char quote = s[i++];
-    std::string out;
-    while (i < s.size()) {
-        char c = s[i++];
-        if (c == quote) {
-            // simple SQL-style doubling not supported; assignment spec keeps it
-            // simple
-            return out;
-        }
-        out.push_back(c);
-    }
-    throw ParseError("Unterminated string literal");
-}
-
-static bool starts_with(std::string_view s, std::string_view kw) {
-    return s.size() >= kw.size() && s.substr(0, kw.size()) == kw;
-}
-
 // -------------------- Parser private helpers --------------------
-std::string Parser::trimLeft(std::string_view s) {
-    std::size_t i = 0;
-    while (i < s.size() && is_space(s[i]))
-        ++i;
-    return std::string{s.substr(i)};
-}
-
-std::vector<std::string> Parser::splitOutsideQuotes(std::string_view script) {
-    std::vector<std::string> parts;
-    char quote = 0;
-    std::size_t start = 0;
-    for (std::size_t i = 0; i < script.size(); ++i) {
-        char c = script[i];
-        if ((c == '\'' || c == '"')) {
-            if (quote == 0)
-                quote = c;
-            else if (quote == c)
-                quote = 0;
-        } else if (c == ';' && quote == 0) {
-            // push chunk without the ';'
-            parts.emplace_back(std::string{script.substr(start, i - start)});
-            start = i + 1;
-        }
-    }
-    if (start < script.size()) {
-        parts.emplace_back(std::string{script.substr(start)});
-    }
-    return parts;
-}
 
-std::string Parser::normalizeOne(std::string_view s) {
+std::string_view Parser::normalizeOne(std::string_view s) {
     // trim left
     std::size_t i = 0;
     while (i < s.size() && is_space(s[i]))
@@ -129,492 +145,708 @@ std::string Parser::normalizeOne(std::string_view s) {
         while (j > i && is_space(s[j - 1]))
             --j;
     }
-    return std::string{s.substr(i, j - i)};
-}
-
-std::pair<std::string, std::optional<std::string>> Parser::peelWhere(std::string_view normalized) {
-    // find WHERE outside quotes
-    char quote = 0;
-    for (std::size_t i = 0; i < normalized.size(); ++i) {
-        char c = normalized[i];
-        if ((c == '\'' || c == '"')) {
-            if (quote == 0)
-                quote = c;
-            else if (quote == c)
-                quote = 0;
-        } else if (quote == 0 && c == 'W') {
-            constexpr std::string_view KW{"WHERE"};
-            if (i + KW.size() <= normalized.size() && normalized.substr(i, KW.size()) == KW) {
-                // Ensure there's whitespace before 'W' or it's not needed (start)
-                if (i > 0 && !is_space(normalized[i - 1]))
-                    continue;
-                std::size_t tail = i + KW.size();
-                // consume following spaces
-                while (tail < normalized.size() && is_space(normalized[tail]))
-                    ++tail;
-                std::string base = std::string{normalized.substr(0, i)};
-                std::string where = std::string{normalized.substr(tail)};
-                // trim base right
-                std::size_t bj = base.size();
-                while (bj > 0 && is_space(base[bj - 1]))
-                    --bj;
-                base.resize(bj);
-                return {std::move(base), where.empty()
-                                             ? std::optional<std::string>{}
-                                             : std::optional<std::string>{std::move(where)}};
-            }
-        }
-    }
-    // no WHERE
-    return {std::string{normalized}, std::nullopt};
+    return s.substr(i, j - i);
 }
 
 // -------------------- WHERE parsing (recursive descent) --------------------
 
-static CompareOp parseOp(std::string_view s, std::size_t& i) {
-    skipSpaces(s, i);
-    if (i + 2 <= s.size()) {
-        if (s[i] == '!' && s[i + 1] == '=') {
-            i += 2;
-            return CompareOp::Neq;
-        }
-        if (s[i] == '<' && s[i + 1] == '=') {
-            i += 2;
-            return CompareOp::Le;
-        }
-        if (s[i] == '>' && s[i + 1] == '=') {
-            i += 2;
-            return CompareOp::Ge;
-        }
-    }
-    if (i < s.size()) {
-        if (s[i] == '=') {
-            ++i;
-            return CompareOp::Eq;
-        }
-        if (s[i] == '<') {
-            ++i;
-            return CompareOp::Lt;
-        }
-        if (s[i] == '>') {
-            ++i;
-            return CompareOp::Gt;
-        }
+static CompareOp parseOp(TokenReader& r) {
+    switch (r.peek().kind) {
+    case TokenKind::Eq:
+        r.next();
+        return CompareOp::Eq;
+    case TokenKind::Neq:
+        r.next();
+        return CompareOp::Neq;
+    case TokenKind::Lt:
+        r.next();
+        return CompareOp::Lt;
+    case TokenKind::Le:
+        r.next();
+        return CompareOp::Le;
+    case TokenKind::Gt:
+        r.next();
+        return CompareOp::Gt;
+    case TokenKind::Ge:
+        r.next();
+        return CompareOp::Ge;
+    default:
+        throw ParseError("Expected comparison operator");
     }
-    throw ParseError("Expected comparison operator");
 }
 
-static RowValue parseLiteral(std::string_view s, std::size_t& i) {
-    skipSpaces(s, i);
-    if (i >= s.size())
-        throw ParseError("Expected literal");
-    if (s[i] == '\'' || s[i] == '"') {
-        return RowValue{parseQuoted(s, i)};
-    } else {
-        return RowValue{parseInt64(s, i)};
-    }
+static RowValue parseLiteral(TokenReader& r) {
+    if (r.is(TokenKind::String))
+        return RowValue{std::string{r.next().text}};
+    if (r.is(TokenKind::Int))
+        return RowValue{parseInt64(r)};
+    throw ParseError("Expected literal");
 }
 
-static WhereExpr parseWherePrimary(std::string_view s, std::size_t& i) {
-    skipSpaces(s, i);
-    if (i < s.size() && s[i] == '(') {
-        ++i;
-        WhereExpr inner;
-
-        // OR-level
-        auto parseOr = [&](auto&& self) -> WhereExpr {
-            // AND-level
-            auto parseAnd = [&](auto&& self2) -> WhereExpr {
-                WhereExpr left = parseWherePrimary(s, i);
-                while (true) {
-                    std::size_t save = i;
-                    skipSpaces(s, i);
-                    if (i + 3 <= s.size() && s.substr(i, 3) == "AND") {
-                        // ensure delimiter
-                        if (i + 3 < s.size() &&
-                            std::isalnum(static_cast<unsigned char>(s[i + 3]))) {
-                            i = save;
-                            break;
-                        }
-                        i += 3;
-                        WhereExpr right = parseWherePrimary(s, i);
-                        And a;
-                        a.lhs = std::make_unique<WhereExpr>(std::move(left));
-                        a.rhs = std::make_unique<WhereExpr>(std::move(right));
-                        left = WhereExpr{std::move(a)};
-                        continue;
-                    }
-                    break;
-                }
-                return left;
-            };
-
-            WhereExpr left = parseAnd(parseAnd);
-            while (true) {
-                std::size_t save = i;
-                skipSpaces(s, i);
-                if (i + 2 <= s.size() && s.substr(i, 2) == "OR") {
-                    if (i + 2 < s.size() && std::isalnum(static_cast<unsigned char>(s[i + 2]))) {
-                        i = save;
-                        break;
-                    }
-                    i += 2;
-                    WhereExpr right = parseAnd(parseAnd);
-                    Or o;
-                    o.lhs = std::make_unique<WhereExpr>(std::move(left));
-                    o.rhs = std::make_unique<WhereExpr>(std::move(right));
-                    left = WhereExpr{std::move(o)};
-                    continue;
-                }
-                break;
-            }
-            return left;
-        };
+// a literal, or nullopt for a ? placeholder (numbered once the whole statement is parsed)
+static std::optional<RowValue> parseValue(TokenReader& r) {
+    if (r.accept(TokenKind::Param))
+        return std::nullopt;
+    return parseLiteral(r);
+}
 
-        inner = parseOr(parseOr);
-        skipSpaces(s, i);
-        if (i >= s.size() || s[i] != ')')
-            throw ParseError("Expected ')'");
-        ++i;
+static WhereExpr parseWhereOr(TokenReader& r);
+
+// ( <or> ) | <column> <op> <literal or ?>
+static WhereExpr parseWherePrimary(TokenReader& r) {
+    if (r.accept(TokenKind::LParen)) {
+        WhereExpr inner = parseWhereOr(r);
+        r.expect(TokenKind::RParen, "Expected ')'");
         return inner;
     }
 
-    // comparison: <ident> <op> <literal>
-    std::string col = parseIdent(s, i);
-    CompareOp op = parseOp(s, i);
-    RowValue lit = parseLiteral(s, i);
-    return WhereExpr{Comparison{std::move(col), op, std::move(lit)}};
+    std::string col = parseColumnRef(r);
+    CompareOp op = parseOp(r);
+    std::optional<RowValue> lit = parseValue(r);
+    Comparison c{std::move(col), op, lit.value_or(RowValue{}), std::nullopt};
+    if (!lit)
+        c.param = 0;
+    return WhereExpr{std::move(c)};
 }
 
-WhereExpr Parser::parseWhere(std::string_view whereTail) {
-    std::size_t i = 0;
-
-    // OR-level
-    auto parseOr = [&](auto&& self) -> WhereExpr {
-        // AND-level
-        auto parseAnd = [&](auto&& self2) -> WhereExpr {
-            WhereExpr left = parseWherePrimary(whereTail, i);
-            while (true) {
-                std::size_t save = i;
-                skipSpaces(whereTail, i);
-                if (i + 3 <= whereTail.size() && whereTail.substr(i, 3) == "AND") {
-                    if (i + 3 < whereTail.size() &&
-                        std::isalnum(static_cast<unsigned char>(whereTail[i + 3]))) {
-                        i = save;
-                        break;
-                    }
-                    i += 3;
-                    WhereExpr right = parseWherePrimary(whereTail, i);
-                    And a;
-                    a.lhs = std::make_unique<WhereExpr>(std::move(left));
-                    a.rhs = std::make_unique<WhereExpr>(std::move(right));
-                    left = WhereExpr{std::move(a)};
-                    continue;
-                }
-                break;
-            }
-            return left;
-        };
+static WhereExpr parseWhereAnd(TokenReader& r) {
+    WhereExpr left = parseWherePrimary(r);
+    while (r.acceptKeyword(Keyword::And)) {
+        And a;
+        a.lhs = std::make_unique<WhereExpr>(std::move(left));
+        a.rhs = std::make_unique<WhereExpr>(parseWherePrimary(r));
+        left = WhereExpr{std::move(a)};
+    }
+    return left;
+}
 
-        WhereExpr left = parseAnd(parseAnd);
-        while (true) {
-            std::size_t save = i;
-            skipSpaces(whereTail, i);
-            if (i + 2 <= whereTail.size() && whereTail.substr(i, 2) == "OR") {
-                if (i + 2 < whereTail.size() &&
-                    std::isalnum(static_cast<unsigned char>(whereTail[i + 2]))) {
-                    i = save;
-                    break;
-                }
-                i += 2;
-                WhereExpr right = parseAnd(parseAnd);
-                Or o;
-                o.lhs = std::make_unique<WhereExpr>(std::move(left));
-                o.rhs = std::make_unique<WhereExpr>(std::move(right));
-                left = WhereExpr{std::move(o)};
-                continue;
-            }
-            break;
-        }
-        return left;
-    };
+static WhereExpr parseWhereOr(TokenReader& r) {
+    WhereExpr left = parseWhereAnd(r);
+    while (r.acceptKeyword(Keyword::Or)) {
+        Or o;
+        o.lhs = std::make_unique<WhereExpr>(std::move(left));
+        o.rhs = std::make_unique<WhereExpr>(parseWhereAnd(r));
+        left = WhereExpr{std::move(o)};
+    }
+    return left;
+}
 
-    WhereExpr root = parseOr(parseOr);
-    skipSpaces(whereTail, i);
-    if (i != whereTail.size())
-        throw ParseError("Trailing tokens after WHERE");
-    return root;
+// [WHERE <condition>]
+static std::optional<WhereExpr> parseOptionalWhere(TokenReader& r) {
+    if (!r.acceptKeyword(Keyword::Where))
+        return std::nullopt;
+    return parseWhereOr(r);
 }
 
-// -------------------- Base (non-WHERE) parsing --------------------
-Statement parseCreateTableStmt(std::string_view s, std::size_t& i) {
-    i += std::string_view("CREATE TABLE ").size();
-    std::string table = parseIdent(s, i);
-    skipSpaces(s, i);
-    if (i >= s.size() || s[i] != '(')
-        throw ParseError("Expected '(' after CREATE TABLE name");
-    ++i;
+// The statement must end here; what follows instead is reported the way the clause would be.
+static void expectStatementEnd(const TokenReader& r, std::string_view statement) {
+    if (r.atStatementEnd())
+        return;
+    if (r.isKeyword(Keyword::Where))
+        throw ParseError("WHERE is not allowed for this statement type");
+    const bool orderOrGroup =
+        (r.isKeyword(Keyword::Group) || r.isKeyword(Keyword::Order)) && r.isKeyword(Keyword::By, 1);
+    if (orderOrGroup || r.isKeyword(Keyword::Limit))
+        throw ParseError("GROUP BY, ORDER BY and LIMIT are only allowed for SELECT");
+    throw ParseError("Trailing tokens after " + std::string{statement});
+}
 
-    std::vector<Column> cols;
-    while (true) {
-        skipSpaces(s, i);
-        if (i < s.size() && s[i] == ')') {
-            ++i;
-            break;
-        }
+// -------------------- statements (recursive descent) --------------------
 
-        std::string cname = parseIdent(s, i);
-        skipSpaces(s, i);
+// CREATE TABLE <name> (<column> int | str [dict], ...)
+static Statement parseCreateTableStmt(TokenReader& r) {
+    std::string table = parseIdent(r);
+    r.expect(TokenKind::LParen, "Expected '(' after CREATE TABLE name");
 
-        if (i + 3 <= s.size() && s.substr(i, 3) == "int") {
-            i += 3;
+    std::vector<Column> cols;
+    while (!r.accept(TokenKind::RParen)) {
+        std::string cname = parseIdent(r);
+        if (r.acceptWord(Keyword::Int)) {
             cols.push_back(Column{std::move(cname), ColumnType::Int});
-        } else if (i + 3 <= s.size() && s.substr(i, 3) == "str") {
-            i += 3;
-            cols.push_back(Column{std::move(cname), ColumnType::Str});
+        } else if (r.acceptWord(Keyword::Str)) {
+            // optional encoding: <name> str dict
+            const ColumnEncoding enc =
+                r.acceptWord(Keyword::Dict) ? ColumnEncoding::Dictionary : ColumnEncoding::Plain;
+            cols.push_back(Column{std::move(cname), ColumnType::Str, enc});
         } else {
             throw ParseError("Expected column type int or str");
         }
 
-        skipSpaces(s, i);
-        if (i < s.size() && s[i] == ',') {
-            ++i;
+        if (r.accept(TokenKind::Comma))
             continue;
-        }
-        skipSpaces(s, i);
-        if (i < s.size() && s[i] == ')') {
-            ++i;
-            break;
-        }
+        r.expect(TokenKind::RParen, "Expected ',' or ')' in column list");
+        break;
     }
-
-    skipSpaces(s, i);
-    if (i != s.size())
-        throw ParseError("Trailing tokens after CREATE TABLE");
+    expectStatementEnd(r, "CREATE TABLE");
 
     Schema schema{std::move(cols)};
     return Statement{CreateTable{std::move(table), std::move(schema)}};
 }
 
-static Statement parseInsertStmt(std::string_view s, std::size_t& i) {
-    i += std::string_view("INSERT INTO ").size();
+// CREATE INDEX <name> ON <table>(<column>) [USING HASH | BTREE]
+static Statement parseCreateIndexStmt(TokenReader& r) {
+    std::string name = parseIdent(r);
+    r.expectKeyword(Keyword::On, "Expected ON after CREATE INDEX name");
+    std::string table = parseIdent(r);
+    r.expect(TokenKind::LParen, "Expected '(' after CREATE INDEX table");
+    std::string column = parseIdent(r);
+    r.expect(TokenKind::RParen, "Expected ')' after CREATE INDEX column");
+
+    IndexKind kind = IndexKind::Hash;
+    if (r.acceptKeyword(Keyword::Using)) {
+        if (r.acceptWord(Keyword::BTree))
+            kind = IndexKind::BTree;
+        else if (!r.acceptWord(Keyword::Hash))
+            throw ParseError("Unknown index method: " + parseIdent(r));
+    }
+
+    expectStatementEnd(r, "CREATE INDEX");
+    return Statement{CreateIndex{std::move(name), std::move(table), std::move(column), kind}};
+}
+
+// INSERT INTO <table> [(<columns>)] VALUES, rows left empty
+static Insert parseInsertHeader(TokenReader& r) {
+    if (!r.acceptKeyword(Keyword::Insert) || !r.acceptKeyword(Keyword::Into))
+        throw ParseError("Expected INSERT INTO");
 
-    std::string table = memoria::parseIdent(s, i);
-    memoria::skipSpaces(s, i);
+    Insert ins;
+    ins.tableName = parseIdent(r);
 
     // Optional column list
-    std::vector<std::string> columnNames;
-    if (i < s.size() && s[i] == '(') {
-        ++i;
+    if (r.accept(TokenKind::LParen)) {
         while (true) {
-            columnNames.push_back(memoria::parseIdent(s, i));
-            memoria::skipSpaces(s, i);
-            if (i < s.size() && s[i] == ',') {
-                ++i;
+            ins.columnNames.push_back(parseIdent(r));
+            if (r.accept(TokenKind::Comma))
                 continue;
-            }
-            if (i < s.size() && s[i] == ')') {
-                ++i;
-                break;
-            }
-            throw ParseError("Expected ',' or ')' in column list");
+            r.expect(TokenKind::RParen, "Expected ',' or ')' in column list");
+            break;
         }
-        memoria::skipSpaces(s, i);
     }
 
-    if (!memoria::starts_with(s.substr(i), "VALUES"))
-        throw ParseError("Expected VALUES");
-    i += std::string_view("VALUES").size();
-
-    // One or more parenthesized rows
-    std::vector<std::vector<RowValue>> rows;
-    while (true) {
-        memoria::skipSpaces(s, i);
-        if (i >= s.size() || s[i] != '(')
-            throw ParseError("Expected '(' to start VALUES row");
-        ++i;
+    r.expectKeyword(Keyword::Values, "Expected VALUES");
+    return ins;
+}
 
-        std::vector<RowValue> one;
-        while (true) {
-            RowValue v = memoria::parseLiteral(s, i);
-            one.push_back(std::move(v));
-            memoria::skipSpaces(s, i);
-            if (i < s.size() && s[i] == ',') {
-                ++i;
-                continue;
-            }
-            if (i < s.size() && s[i] == ')') {
-                ++i;
-                break;
-            }
-            throw ParseError("Expected ',' or ')' in VALUES row");
-        }
-        rows.emplace_back(std::move(one));
+// one parenthesized VALUES row; a ? in it is recorded in params as {row, position}
+static std::vector<RowValue>
+parseValuesRow(TokenReader& r, std::size_t row,
+               std::vector<std::pair<std::size_t, std::size_t>>& params) {
+    r.expect(TokenKind::LParen, "Expected '(' to start VALUES row");
 
-        memoria::skipSpaces(s, i);
-        if (i < s.size() && s[i] == ',') {
-            ++i;
+    std::vector<RowValue> one;
+    while (true) {
+        std::optional<RowValue> v = parseValue(r);
+        if (!v)
+            params.emplace_back(row, one.size());
+        one.push_back(std::move(v).value_or(RowValue{}));
+        if (r.accept(TokenKind::Comma))
             continue;
-        } // next row
-        break; // no more rows
+        r.expect(TokenKind::RParen, "Expected ',' or ')' in VALUES row");
+        return one;
     }
+}
+
+static Statement parseInsertStmt(TokenReader& r) {
+    Insert ins = parseInsertHeader(r);
 
-    memoria::skipSpaces(s, i);
-    if (i != s.size())
-        throw ParseError("Trailing tokens after INSERT");
+    // One or more parenthesized rows
+    do {
+        ins.rows.push_back(parseValuesRow(r, ins.rows.size(), ins.params));
+    } while (r.accept(TokenKind::Comma));
 
-    // Insert{ tableName, columnNames, rows }
-    return Statement{Insert{std::move(table), std::move(columnNames), std::move(rows)}};
+    expectStatementEnd(r, "INSERT");
+    return Statement{std::move(ins)};
 }
 
-// DELETE FROM <name>
-static Statement parseDeleteStmt(std::string_view s, std::size_t& i) {
-    i += std::string_view("DELETE FROM ").size();
-    std::string table = parseIdent(s, i);
-    skipSpaces(s, i);
-    if (i != s.size())
-        throw ParseError("Trailing tokens after DELETE FROM");
-    return Statement{Delete{std::move(table)}};
+// DELETE FROM <name> [WHERE ...]
+static Statement parseDeleteStmt(TokenReader& r) {
+    r.expectKeyword(Keyword::From, "Expected FROM after DELETE");
+    // braced initializers run left to right: the table, then the WHERE after it
+    Delete del{parseIdent(r), parseOptionalWhere(r)};
+    expectStatementEnd(r, "DELETE FROM");
+    return Statement{std::move(del)};
 }
 
-// UPDATE <name> SET c = lit, c = lit, ...
-static Statement parseUpdateStmt(std::string_view s, std::size_t& i) {
-    i += std::string_view("UPDATE ").size();
-    std::string table = parseIdent(s, i);
-    skipSpaces(s, i);
-    if (!starts_with(s.substr(i), "SET"))
-        throw ParseError("Expected SET");
-    i += std::string_view("SET").size();
+// UPDATE <name> SET c = lit, c = lit, ... [WHERE ...]
+static Statement parseUpdateStmt(TokenReader& r) {
+    std::string table = parseIdent(r);
+    r.expectKeyword(Keyword::Set, "Expected SET");
 
     std::vector<Assignment> assigns;
-    while (true) {
-        std::string cname = parseIdent(s, i);
-        skipSpaces(s, i);
-        if (i >= s.size() || s[i] != '=')
-            throw ParseError("Expected '=' in assignment");
-        ++i;
-        RowValue v = parseLiteral(s, i);
-        assigns.push_back(Assignment{std::move(cname), std::move(v)});
-        skipSpaces(s, i);
-        if (i < s.size() && s[i] == ',') {
-            ++i;
-            continue;
-        }
+    do {
+        std::string cname = parseIdent(r);
+        r.expect(TokenKind::Eq, "Expected '=' in assignment");
+        std::optional<RowValue> v = parseValue(r);
+        assigns.push_back(Assignment{std::move(cname), v.value_or(RowValue{}), std::nullopt});
+        if (!v)
+            assigns.back().param = 0;
+    } while (r.accept(TokenKind::Comma));
+
+    Update upd{std::move(table), std::move(assigns), parseOptionalWhere(r)};
+    expectStatementEnd(r, "UPDATE");
+    return Statement{std::move(upd)};
+}
+
+// after "<func>(": the argument and the closing ')'
+static Aggregate parseAggregateCall(const Token& func, TokenReader& r) {
+    Aggregate agg{};
+    switch (func.keyword) {
+    case Keyword::Count:
+        agg.func = AggregateFunc::Count;
+        break;
+    case Keyword::Sum:
+        agg.func = AggregateFunc::Sum;
+        break;
+    case Keyword::Min:
+        agg.func = AggregateFunc::Min;
+        break;
+    case Keyword::Max:
+        agg.func = AggregateFunc::Max;
         break;
+    case Keyword::Avg:
+        agg.func = AggregateFunc::Avg;
+        break;
+    default:
+        throw ParseError("Unknown aggregate function: " + std::string{func.text});
     }
-    skipSpaces(s, i);
-    if (i != s.size())
-        throw ParseError("Trailing tokens after UPDATE");
 
-    return Statement{Update{std::move(table), std::move(assigns)}};
+    if (r.accept(TokenKind::Star)) {
+        if (agg.func != AggregateFunc::Count)
+            throw ParseError("Only COUNT accepts *");
+    } else {
+        agg.column = parseColumnRef(r);
+    }
+    r.expect(TokenKind::RParen, "Expected ')' after aggregate argument");
+    return agg;
 }
 
-static Statement parseSelectStmt(std::string_view s, std::size_t& i) {
-    i += std::string_view("SELECT ").size();
+// a column name or an aggregate call (the function name in any case)
+static SelectItem parseSelectItem(TokenReader& r) {
+    if (r.is(TokenKind::Word) && r.peek(1).kind == TokenKind::LParen) {
+        const Token& func = r.next();
+        r.next();
+        return parseAggregateCall(func, r);
+    }
+    return parseColumnRef(r);
+}
 
-    // Build the projection
-    Select::Projection proj; // alias: std::variant<Select::Star, std::vector<std::string>>
-    skipSpaces(s, i);
-    if (i < s.size() && s[i] == '*') {
-        ++i;
-        proj = Select::Star{};
+// <col> [, <col> ...]
+static std::vector<std::string> parseColumnList(TokenReader& r) {
+    std::vector<std::string> cols;
+    do {
+        cols.push_back(parseColumnRef(r));
+    } while (r.accept(TokenKind::Comma));
+    return cols;
+}
+
+// after LIMIT / OFFSET
+static uint64_t parseCount(TokenReader& r) {
+    const int64_t v = parseInt64(r);
+    if (v < 0)
+        throw ParseError("LIMIT and OFFSET must not be negative");
+    return static_cast<uint64_t>(v);
+}
+
+// SELECT <projection> FROM <table> [JOIN ...] [WHERE ...] [GROUP BY ...] [ORDER BY ...] [LIMIT ...]
+static Statement parseSelectStmt(TokenReader& r) {
+    Select sel;
+
+    // Build the projection: *, column names, or items with aggregates
+    if (r.accept(TokenKind::Star)) {
+        sel.projection = Select::Star{};
     } else {
-        std::vector<std::string> cols;
-        while (true) {
-            cols.push_back(parseIdent(s, i));
-            skipSpaces(s, i);
-            if (i < s.size() && s[i] == ',') {
-                ++i;
-                continue;
-            }
-            break;
+        std::vector<SelectItem> items;
+        bool anyAggregate = false;
+        do {
+            items.push_back(parseSelectItem(r));
+            anyAggregate |= std::holds_alternative<Aggregate>(items.back());
+        } while (r.accept(TokenKind::Comma));
+        if (anyAggregate) {
+            sel.projection = std::move(items);
+        } else {
+            std::vector<std::string> cols;
+            cols.reserve(items.size());
+            for (auto& item : items)
+                cols.push_back(std::move(std::get<std::string>(item)));
+            sel.projection = std::move(cols);
         }
-        proj = std::move(cols);
     }
 
-    // FROM <table>
-    skipSpaces(s, i);
-    if (!starts_with(s.substr(i), "FROM "))
-        throw ParseError("Expected FROM");
-    i += std::string_view("FROM ").size();
-    std::string table = parseIdent(s, i);
+    r.expectKeyword(Keyword::From, "Expected FROM");
+    sel.table = parseIdent(r);
+
+    // [JOIN <table> ON <column> = <column>]
+    if (r.acceptKeyword(Keyword::Join)) {
+        sel.join.emplace();
+        sel.join->table = parseIdent(r);
+        r.expectKeyword(Keyword::On, "Expected ON after JOIN table");
+        sel.join->left = parseColumnRef(r);
+        r.expect(TokenKind::Eq, "JOIN supports only ON <column> = <column>");
+        sel.join->right = parseColumnRef(r);
+    }
+
+    sel.where = parseOptionalWhere(r);
 
-    // no trailing tokens in the base
-    skipSpaces(s, i);
-    if (i != s.size())
+    if (r.isKeyword(Keyword::Group) && r.isKeyword(Keyword::By, 1)) {
+        r.next();
+        r.next();
+        sel.groupBy = parseColumnList(r);
+    }
+    if (r.isKeyword(Keyword::Order) && r.isKeyword(Keyword::By, 1)) {
+        r.next();
+        r.next();
+        sel.orderBy.emplace(OrderBy{parseSelectItem(r)});
+        if (!r.acceptKeyword(Keyword::Asc) && r.acceptKeyword(Keyword::Desc))
+            sel.orderBy->descending = true;
+    }
+    if (r.acceptKeyword(Keyword::Limit)) {
+        sel.limit = parseCount(r);
+        if (r.acceptKeyword(Keyword::Offset))
+            sel.offset = parseCount(r);
+    }
+
+    if (!r.atStatementEnd())
         throw ParseError("Trailing tokens after SELECT");
+    return Statement{std::move(sel)};
+}
 
-    // NOTE: WHERE is handled upstream (peelWhere/parseWhere), so set where =
-    // nullopt here.
-    return Statement{Select{std::move(table), std::move(proj), std::nullopt}};
+// SET <name> = <int>
+static Statement parseSetStmt(TokenReader& r) {
+    std::string name = parseIdent(r);
+    r.expect(TokenKind::Eq, "Expected '=' after SET name");
+    const int64_t value = parseInt64(r);
+    expectStatementEnd(r, "SET");
+    return Statement{Set{std::move(name), value}};
 }
 
-Statement Parser::parseBase(std::string_view base) {
-    std::size_t i = 0;
-    skipSpaces(base, i);
-
-    if (starts_with(base.substr(i), "CREATE TABLE "))
-        return parseCreateTableStmt(base, i);
-    if (starts_with(base.substr(i), "INSERT INTO "))
-        return parseInsertStmt(base, i);
-    if (starts_with(base.substr(i), "DELETE FROM "))
-        return parseDeleteStmt(base, i);
-    if (starts_with(base.substr(i), "UPDATE "))
-        return parseUpdateStmt(base, i);
-    if (starts_with(base.substr(i), "SELECT "))
-        return parseSelectStmt(base, i);
+// ANALYZE <table> | SHOW STATS <table> | DEALLOCATE <name>
+template <class T> static Statement parseNameStmt(TokenReader& r, std::string_view keyword) {
+    T st{parseIdent(r)};
+    expectStatementEnd(r, keyword);
+    return Statement{std::move(st)};
+}
 
+// EXECUTE <name>[(<literal>, ...)]
+static Statement parseExecuteStmt(TokenReader& r) {
+    Execute ex{parseIdent(r), {}};
+    if (r.accept(TokenKind::LParen) && !r.accept(TokenKind::RParen)) {
+        do {
+            ex.args.push_back(parseLiteral(r));
+        } while (r.accept(TokenKind::Comma));
+        r.expect(TokenKind::RParen, "Expected ',' or ')' in EXECUTE arguments");
+    }
+    expectStatementEnd(r, "EXECUTE");
+    return Statement{std::move(ex)};
+}
+
+// Numbers the ? placeholders of st in the order they appear in the text and returns how many
+// there are. The statement of a PREPARE is numbered on its own and not counted.
+static std::size_t numberParameters(Statement& st) {
+    std::size_t n = 0;
+    const auto where = [&n](const auto& self, WhereExpr& expr) -> void {
+        if (auto* c = std::get_if<Comparison>(&expr)) {
+            if (c->param)
+                c->param = n++;
+        } else if (auto* a = std::get_if<And>(&expr)) {
+            self(self, *a->lhs);
+            self(self, *a->rhs);
+        } else {
+            self(self, *std::get<Or>(expr).lhs);
+            self(self, *std::get<Or>(expr).rhs);
+        }
+    };
+    if (auto* ins = std::get_if<Insert>(&st))
+        return ins->params.size(); // recorded in order
+    if (auto* upd = std::get_if<Update>(&st)) {
+        for (auto& a : upd->set) {
+            if (a.param)
+                a.param = n++;
+        }
+        if (upd->where)
+            where(where, *upd->where);
+    } else if (auto* sel = std::get_if<Select>(&st)) {
+        if (sel->where)
+            where(where, *sel->where);
+    } else if (auto* del = std::get_if<Delete>(&st)) {
+        if (del->where)
+            where(where, *del->where);
+    } else if (auto* ex = std::get_if<Explain>(&st)) {
+        return numberParameters(*ex->statement);
+    }
+    return n;
+}
+
+// One statement, up to (not including) its ; or the end of the text. Placeholders are numbered
+// only inside PREPARE.
+static Statement parseOneStatement(TokenReader& r) {
+    if (r.atStatementEnd())
+        throw ParseError("Empty statement");
+
+    if (r.acceptKeyword(Keyword::Explain)) {
+        const bool analyze = r.acceptKeyword(Keyword::Analyze);
+        Statement inner = parseOneStatement(r);
+        if (std::holds_alternative<Explain>(inner) || std::holds_alternative<Prepare>(inner))
+            throw ParseError("EXPLAIN cannot be nested");
+        return Statement{Explain{std::make_unique<Statement>(std::move(inner)), analyze}};
+    }
+
+    // PREPARE <name> AS <statement>
+    if (r.acceptKeyword(Keyword::Prepare)) {
+        std::string name = parseIdent(r);
+        r.expectKeyword(Keyword::As, "Expected AS after PREPARE name");
+        Statement inner = parseOneStatement(r);
+        if (std::holds_alternative<Explain>(inner) || std::holds_alternative<Prepare>(inner))
+            throw ParseError("PREPARE cannot hold EXPLAIN or PREPARE");
+        (void)numberParameters(inner);
+        return Statement{Prepare{std::move(name), std::make_unique<Statement>(std::move(inner))}};
+    }
+
+    // dispatch on the leading keyword, consumed by all but INSERT
+    const Token& first = r.peek();
+    if (first.kind == TokenKind::Word && first.upper) {
+        switch (first.keyword) {
+        case Keyword::Create:
+            r.next();
+            if (r.acceptKeyword(Keyword::Table))
+                return parseCreateTableStmt(r);
+            if (r.acceptKeyword(Keyword::Index))
+                return parseCreateIndexStmt(r);
+            break;
+        case Keyword::Insert:
+            return parseInsertStmt(r);
+        case Keyword::Delete:
+            r.next();
+            return parseDeleteStmt(r);
+        case Keyword::Update:
+            r.next();
+            return parseUpdateStmt(r);
+        case Keyword::Select:
+            r.next();
+            return parseSelectStmt(r);
+        case Keyword::Set:
+            r.next();
+            return parseSetStmt(r);
+        case Keyword::Analyze:
+            r.next();
+            return parseNameStmt<Analyze>(r, "ANALYZE");
+        case Keyword::Show:
+            r.next();
+            if (r.acceptKeyword(Keyword::Stats))
+                return parseNameStmt<ShowStats>(r, "SHOW STATS");
+            break;
+        case Keyword::Execute:
+            r.next();
+            return parseExecuteStmt(r);
+        case Keyword::Deallocate:
+            r.next();
+            return parseNameStmt<Deallocate>(r, "DEALLOCATE");
+        default:
+            break;
+        }
+    }
     throw ParseError("Unknown statement (keywords are case-sensitive)");
 }
 
 // -------------------- Public API --------------------
 Statement Parser::prepareStatement(std::string_view sql) const {
-    const std::string norm = normalizeOne(sql);
-    if (norm.empty())
-        throw ParseError("Empty statement");
+    Statement st = parseStatement(sql);
+    if (numberParameters(st) != 0)
+        throw ParseError("? parameters are only allowed in PREPARE");
+    return st;
+}
 
-    auto [base, whereTxt] = peelWhere(norm);
-    Statement st = parseBase(base);
+Statement Parser::prepareParameterized(std::string_view sql) const {
+    Statement st = parseStatement(sql);
+    (void)numberParameters(st);
+    return st;
+}
 
-    if (!whereTxt) {
-        // No WHERE present; we’re done.
-        return st;
-    }
+Statement Parser::parseStatement(std::string_view sql) {
+    const std::vector<Token> tokens = tokenize(sql);
+    TokenReader r{tokens};
+    Statement st = parseOneStatement(r);
+    r.accept(TokenKind::Semicolon); // optional
+    if (!r.is(TokenKind::End))
+        throw ParseError("Trailing tokens after ';'");
+    return st;
+}
 
-    // We have a WHERE tail -> only valid for SELECT / UPDATE / DELETE
-    WhereExpr w = parseWhere(*whereTxt);
+std::optional<Parser::Fingerprint> Parser::fingerprint(std::string_view sql) const {
+    const std::string_view s = normalizeOne(sql);
+    const auto isWordChar = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+    const auto isDigit = [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; };
+
+    Fingerprint fp;
+    fp.text.reserve(s.size());
+    std::string_view previousWord; // a number after LIMIT / OFFSET is kept
+    for (std::size_t i = 0; i < s.size();) {
+        const char c = s[i];
+        if (is_space(c)) {
+            skipSpaces(s, i);
+            fp.text.push_back(' ');
+            continue;
+        }
+        if (c == '\'' || c == '"') {
+            const std::size_t end = s.find(c, i + 1);
+            if (end == std::string_view::npos)
+                return std::nullopt;
+            fp.literals.emplace_back(std::string{s.substr(i + 1, end - i - 1)});
+            fp.text.push_back('?');
+            previousWord = {};
+            i = end + 1;
+            continue;
+        }
+        const bool sign = (c == '+' || c == '-') && i + 1 < s.size() && isDigit(s[i + 1]);
+        if (!sign && !isWordChar(c)) {
+            if (c == '?')
+                return std::nullopt;
+            fp.text.push_back(c);
+            previousWord = {};
+            ++i;
+            continue;
+        }
 
-    if (auto* sel = std::get_if<Select>(&st)) {
-        sel->where.emplace(std::move(w));
-        return st;
-    }
-    if (auto* upd = std::get_if<Update>(&st)) {
-        upd->where.emplace(std::move(w));
-        return st;
-    }
-    if (auto* del = std::get_if<Delete>(&st)) {
-        del->where.emplace(std::move(w));
-        return st;
+        std::size_t end = i + 1;
+        while (end < s.size() && isWordChar(s[end]))
+            ++end;
+        const std::string_view word = s.substr(i, end - i);
+        const std::string_view digits = word.substr(sign ? 1 : 0);
+        i = end;
+        if (!std::all_of(digits.begin(), digits.end(), isDigit) || previousWord == "LIMIT" ||
+            previousWord == "OFFSET") {
+            fp.text += word;
+            previousWord = word;
+            continue;
+        }
+        int64_t v{};
+        const std::string_view number = c == '+' ? digits : word;
+        if (std::from_chars(number.data(), number.data() + number.size(), v).ec != std::errc{})
+            return std::nullopt;
+        fp.literals.emplace_back(v);
+        fp.text.push_back('?');
+        previousWord = word;
     }
-
-    // CREATE/INSERT must not have WHERE
-    throw ParseError("WHERE is not allowed for this statement type");
+    return fp;
 }
 
 std::vector<Statement> Parser::prepareStatements(std::string_view script) const {
+    // the whole script is tokenized once; statements are cut at ; tokens, so a ; inside quotes
+    // stays in its string
+    const std::vector<Token> tokens = tokenize(script);
+    TokenReader r{tokens};
     std::vector<Statement> out;
-    for (auto& raw : splitOutsideQuotes(script)) {
-        const std::string norm = normalizeOne(raw);
-        if (norm.empty())
-            continue;
-        out.emplace_back(prepareStatement(norm));
+    while (true) {
+        while (r.accept(TokenKind::Semicolon)) {
+        }
+        if (r.is(TokenKind::End))
+            break;
+        Statement st = parseOneStatement(r);
+        if (numberParameters(st) != 0)
+            throw ParseError("? parameters are only allowed in PREPARE");
+        out.emplace_back(std::move(st));
     }
     return out;
 }
 
-bool Parser::ieqPrefix(std::string_view s, std::string_view kw) {
-    // In this project keywords are *case-sensitive*. Use a strict prefix test.
-    return starts_with(s, kw);
+// -------------------- InsertStream --------------------
+
+InsertStream::InsertStream(Sink sink, std::size_t batchRows)
+    : sink_(std::move(sink)), batchRows_(std::max<std::size_t>(1, batchRows)) {}
+
+void InsertStream::feed(std::string_view text) {
+    text_ += text;
+    parse(false);
+}
+
+void InsertStream::finish() {
+    parse(true);
+    flush();
+}
+
+// the end of the header: the first ( after a VALUES keyword, npos before it has arrived
+static std::size_t valuesStart(std::string_view s) {
+    constexpr std::string_view kw{"VALUES"};
+    for (std::size_t at = s.find(kw); at != std::string_view::npos; at = s.find(kw, at + 1)) {
+        const std::size_t after = at + kw.size();
+        if (at == 0 || !(is_space(s[at - 1]) || s[at - 1] == ')') ||
+            (after < s.size() && !is_space(s[after]) && s[after] != '('))
+            continue;
+        return s.find('(', after);
+    }
+    return std::string_view::npos;
+}
+
+void InsertStream::parse(bool last) {
+    std::size_t i = 0;
+    std::vector<std::pair<std::size_t, std::size_t>> params;
+    if (!batch_) {
+        const std::size_t end = valuesStart(text_);
+        if (!last && end == std::string::npos)
+            return;
+        // or throws what a whole statement would
+        i = std::min(end, text_.size());
+        tokenize(std::string_view{text_}.substr(0, i), tokens_);
+        TokenReader r{tokens_};
+        batch_ = parseInsertHeader(r);
+        if (!r.is(TokenKind::End))
+            throw ParseError("Expected '(' to start VALUES row");
+        batch_->rows.reserve(batchRows_);
+    }
+
+    while (true) {
+        skipSpaces(text_, i);
+        if (afterRow_) {
+            if (i == text_.size())
+                break;
+            if (text_[i] != ',')
+                throw ParseError("Trailing tokens after INSERT");
+            ++i;
+            afterRow_ = false;
+            continue;
+        }
+
+        // a tuple is parsed once its closing ) has arrived, unless the text is complete
+        scan_ = std::max(scan_, i);
+        while (scan_ < text_.size()) {
+            const char c = text_[scan_];
+            if (quote_ != 0) {
+                if (c == quote_)
+                    quote_ = 0;
+            } else if (c == '\'' || c == '"') {
+                quote_ = c;
+            } else if (c == ')') {
+                break;
+            }
+            ++scan_;
+        }
+        if (scan_ == text_.size() && !last)
+            break;
+        const std::size_t end = std::min(scan_ + 1, text_.size());
+        tokenize(std::string_view{text_}.substr(i, end - i), tokens_);
+        TokenReader r{tokens_};
+        batch_->rows.push_back(parseValuesRow(r, batch_->rows.size(), params));
+        if (!params.empty())
+            throw ParseError("? parameters are only allowed in PREPARE");
+        i = end;
+        ++rows_;
+        afterRow_ = true;
+        if (batch_->rows.size() == batchRows_)
+            flush();
+    }
+    // keep only what is not parsed yet
+    text_.erase(0, i);
+    scan_ -= std::min(scan_, i);
+}
+
+void InsertStream::flush() {
+    if (!batch_ || batch_->rows.empty())
+        return;
+    Insert out{batch_->tableName, batch_->columnNames, std::move(batch_->rows), {}};
+    batch_->rows = {};
+    batch_->rows.reserve(batchRows_);
+    sink_(std::move(out));
 }
 
-} // namespace memoria
\ No newline at end of file
+} // namespace memoria
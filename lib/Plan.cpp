@@ -0,0 +1,124 @@
+//
+// Created by Ilya Nyrkov on 25.09.25.
+//
+
+#include "memoria/Plan.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <variant>
+
+namespace memoria {
+
+const char* planOpName(PlanOp op) noexcept {
+    switch (op) {
+    case PlanOp::Scan:
+        return "Scan";
+    case PlanOp::IndexLookup:
+        return "IndexLookup";
+    case PlanOp::Filter:
+        return "Filter";
+    case PlanOp::Project:
+        return "Project";
+    case PlanOp::Aggregate:
+        return "Aggregate";
+    case PlanOp::Sort:
+        return "Sort";
+    case PlanOp::Limit:
+        return "Limit";
+    case PlanOp::Join:
+        return "Join";
+    case PlanOp::Insert:
+        return "Insert";
+    case PlanOp::Update:
+        return "Update";
+    case PlanOp::Delete:
+        return "Delete";
+    }
+    return "?";
+}
+
+std::unique_ptr<PlanNode> makePlanNode(PlanOp op, std::string detail,
+                                       std::unique_ptr<PlanNode> input) {
+    auto node = std::make_unique<PlanNode>(PlanNode{op, std::move(detail), {}, PlanStats{}, {}});
+    if (input)
+        node->children.push_back(std::move(input));
+    return node;
+}
+
+static const char* opText(CompareOp op) {
+    switch (op) {
+    case CompareOp::Eq:
+        return " = ";
+    case CompareOp::Neq:
+        return " != ";
+    case CompareOp::Lt:
+        return " < ";
+    case CompareOp::Gt:
+        return " > ";
+    case CompareOp::Le:
+        return " <= ";
+    case CompareOp::Ge:
+        return " >= ";
+    }
+    throw std::logic_error("Unhandled CompareOp");
+}
+
+std::string whereToString(const WhereExpr& expr) {
+    if (const auto* c = std::get_if<Comparison>(&expr)) {
+        std::string out = c->column + opText(c->op);
+        if (c->literal.isInt())
+            return out + std::to_string(c->literal.asInt());
+        return out + '"' + std::string{c->literal.asStr()} + '"';
+    }
+    if (const auto* a = std::get_if<And>(&expr)) {
+        // AND binds tighter than OR, so only an OR operand needs parentheses
+        const auto operand = [](const WhereExpr& e) {
+            return std::holds_alternative<Or>(e) ? "(" + whereToString(e) + ")" : whereToString(e);
+        };
+        return operand(*a->lhs) + " AND " + operand(*a->rhs);
+    }
+    const auto& o = std::get<Or>(expr);
+    return whereToString(*o.lhs) + " OR " + whereToString(*o.rhs);
+}
+
+static std::string percent(uint64_t part, uint64_t whole) {
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.1f%%", whole == 0 ? 0.0 : 100.0 * part / whole);
+    return buf;
+}
+
+static std::string statsText(const PlanStats& stats, double nsPerTick) {
+    char time[32];
+    std::snprintf(time, sizeof time, "%.3f", stats.ticks * nsPerTick / 1e6);
+    return " (in=" + std::to_string(stats.rowsIn) + " out=" + std::to_string(stats.rowsOut) +
+           " batches=" + std::to_string(stats.batches) + " time=" + time +
+           " ms bytes=" + std::to_string(stats.bytes) + ")";
+}
+
+static void appendLines(const PlanNode& node, std::size_t depth, std::optional<double> nsPerTick,
+                        std::vector<std::string>& out) {
+    const std::string indent(2 * depth, ' ');
+    std::string line = depth == 0 ? std::string{} : indent + "-> ";
+    line += planOpName(node.op);
+    if (!node.detail.empty())
+        line += " " + node.detail;
+    if (nsPerTick)
+        line += statsText(node.stats, *nsPerTick);
+    out.push_back(std::move(line));
+    for (const auto& c : node.conjuncts) {
+        out.push_back(indent + "     conjunct " + c.condition + ": " + std::to_string(c.rowsOut) +
+                      " of " + std::to_string(c.rowsIn) + " rows (" +
+                      percent(c.rowsOut, c.rowsIn) + ")");
+    }
+    for (const auto& child : node.children)
+        appendLines(*child, depth + 1, nsPerTick, out);
+}
+
+std::vector<std::string> explainLines(const PlanNode& root, std::optional<double> nsPerTick) {
+    std::vector<std::string> out;
+    appendLines(root, 0, nsPerTick, out);
+    return out;
+}
+
+} // namespace memoria
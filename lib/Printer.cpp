@@ -5,6 +5,8 @@
 #include "memoria/Printer.h"
 
 #include <algorithm>
+#include <array>
+#include <charconv>
 #include <iomanip>
 #include <ostream>
 #include <string>
@@ -12,6 +14,8 @@
 
 namespace memoria {
 
+using CellBuffer = std::array<char, 24>; // fits any int64_t
+
 static inline std::string repeat(char ch, std::size_t n) {
     return std::string(n, ch);
 }
@@ -22,6 +26,11 @@ void Printer::printQueryResult(const QueryResult& qr) {
     out_ << "(" << qr.rows.size() << (qr.rows.size() == 1 ? " row)\n" : " rows)\n");
 }
 
+void Printer::printQueryRefs(const QueryRefs& qr) {
+    printTable(qr.header, qr.rows);
+    out_ << "(" << qr.rows.size() << (qr.rows.size() == 1 ? " row)\n" : " rows)\n");
+}
+
 void Printer::printError(const std::exception& e) {
     err_ << "Error: " << e.what() << '\n';
 }
@@ -35,6 +44,8 @@ void Printer::printHelpMessage(std::string_view prog) {
             "  CREATE TABLE t (c1 STR, c2 INT);\n"
             "  INSERT INTO t VALUES ('a', 1), ('b', 2);\n"
             "  SELECT * FROM t WHERE c2 >= 2;\n"
+            "  SET threads = 4;\n"
+            "Options: --threads N  parallel scan threads (default: all cores).\n"
             "Ctrl-D (Unix) / Ctrl-Z (Windows) to end input.\n";
 }
 
@@ -42,44 +53,89 @@ void Printer::printAffected(std::size_t n) {
     out_ << "(" << n << " rows affected)\n";
 }
 
-std::string Printer::cellToString(const RowValue& v) {
-    if (std::holds_alternative<int64_t>(v)) {
-        return std::to_string(std::get<int64_t>(v));
-    }
-    return std::get<std::string>(v);
+// Text of cell k, formatted into buf when it is a number; strings are viewed in place.
+static std::string_view cellText(const Row& r, std::size_t k, CellBuffer& buf, bool& isInt) {
+    const RowValue& v = r.at(k);
+    isInt = v.isInt();
+    if (!isInt)
+        return v.asStr();
+    const auto res = std::to_chars(buf.data(), buf.data() + buf.size(), v.asInt());
+    return {buf.data(), static_cast<std::size_t>(res.ptr - buf.data())};
 }
 
-void Printer::printTable(const std::vector<std::string>& header, const std::vector<Row>& rows) {
-    const std::size_t cols = header.size();
-    if (cols == 0) {
+static std::string_view cellText(const RowRef& r, std::size_t k, CellBuffer& buf, bool& isInt) {
+    isInt = r.isInt(k);
+    if (!isInt)
+        return r.strAt(k);
+    const auto res = std::to_chars(buf.data(), buf.data() + buf.size(), r.intAt(k));
+    return {buf.data(), static_cast<std::size_t>(res.ptr - buf.data())};
+}
+
+template <class Rows>
+void Printer::printTable(const std::vector<std::string>& header, const Rows& rows) {
+    if (header.empty()) {
         // Nothing to format—still emit a blank line for consistency.
         out_ << '\n';
         return;
     }
+    const Layout layout = layoutFor(header, rows);
+    printHeader(header, layout);
+    printRows(rows, layout);
+}
+
+void Printer::printCursor(Cursor& cursor) {
+    const auto& header = cursor.header();
+    RowRefs batch = cursor.nextRefs();
+    std::size_t total = batch.size();
+    if (header.empty()) {
+        out_ << '\n';
+    } else {
+        // Column widths come from the first batch only, so nothing but the current batch is ever
+        // held; a wider cell further down simply overflows its column.
+        const Layout layout = layoutFor(header, batch);
+        printHeader(header, layout);
+        printRows(batch, layout);
+        while (!(batch = cursor.nextRefs()).empty()) {
+            printRows(batch, layout);
+            total += batch.size();
+        }
+    }
+    out_ << "(" << total << (total == 1 ? " row)\n" : " rows)\n");
+}
+
+template <class Rows>
+Printer::Layout Printer::layoutFor(const std::vector<std::string>& header, const Rows& rows) {
+    const std::size_t cols = header.size();
 
     // Compute column widths and numeric alignment flags
-    std::vector<std::size_t> widths(cols, 0);
-    std::vector<bool> isNumeric(cols, false);
+    Layout layout{std::vector<std::size_t>(cols, 0), std::vector<bool>(cols, false)};
 
     for (std::size_t i = 0; i < cols; ++i) {
-        widths[i] = std::max<std::size_t>(widths[i], header[i].size());
+        layout.widths[i] = std::max<std::size_t>(layout.widths[i], header[i].size());
     }
 
-    for (const Row& r : rows) {
+    CellBuffer buf;
+    bool isInt = false;
+    for (std::size_t r = 0; r < rows.size(); ++r) {
+        const auto& row = rows[r];
         for (std::size_t i = 0; i < cols; ++i) {
-            const RowValue& cell = r.at(i);
-            if (std::holds_alternative<int64_t>(cell))
-                isNumeric[i] = true;
-            const std::string s = cellToString(cell);
-            widths[i] = std::max<std::size_t>(widths[i], s.size());
+            const std::string_view s = cellText(row, i, buf, isInt);
+            if (isInt)
+                layout.isNumeric[i] = true;
+            layout.widths[i] = std::max<std::size_t>(layout.widths[i], s.size());
         }
     }
+    return layout;
+}
+
+void Printer::printHeader(const std::vector<std::string>& header, const Layout& layout) {
+    const std::size_t cols = header.size();
 
     // Print header
     for (std::size_t i = 0; i < cols; ++i) {
         if (i)
             out_ << " | ";
-        out_ << std::left << std::setw(static_cast<int>(widths[i])) << header[i];
+        out_ << std::left << std::setw(static_cast<int>(layout.widths[i])) << header[i];
     }
     out_ << '\n';
 
@@ -87,20 +143,25 @@ void Printer::printTable(const std::vector<std::string>& header, const std::vect
     for (std::size_t i = 0; i < cols; ++i) {
         if (i)
             out_ << "-+-";
-        out_ << repeat('-', widths[i]);
+        out_ << repeat('-', layout.widths[i]);
     }
     out_ << '\n';
+}
 
-    // Rows
-    for (const Row& r : rows) {
+template <class Rows> void Printer::printRows(const Rows& rows, const Layout& layout) {
+    const std::size_t cols = layout.widths.size();
+    CellBuffer buf;
+    bool isInt = false;
+    for (std::size_t r = 0; r < rows.size(); ++r) {
+        const auto& row = rows[r];
         for (std::size_t i = 0; i < cols; ++i) {
             if (i)
                 out_ << " | ";
-            const std::string s = cellToString(r.at(i));
-            if (isNumeric[i]) {
-                out_ << std::right << std::setw(static_cast<int>(widths[i])) << s;
+            const std::string_view s = cellText(row, i, buf, isInt);
+            if (layout.isNumeric[i]) {
+                out_ << std::right << std::setw(static_cast<int>(layout.widths[i])) << s;
             } else {
-                out_ << std::left << std::setw(static_cast<int>(widths[i])) << s;
+                out_ << std::left << std::setw(static_cast<int>(layout.widths[i])) << s;
             }
         }
         out_ << '\n';
@@ -5,6 +5,92 @@
 #include "memoria/Row.h"
 
 #include <utility>
+#include <variant>
+
+// -------------------- RowValue --------------------
+
+memoria::RowValue::RowValue(int64_t v) noexcept {
+    ref_.size_ = kIntTag;
+    std::memcpy(ref_.data_ + StringRef::kPrefixSize, &v, sizeof v);
+}
+
+memoria::RowValue::RowValue(std::string_view v) {
+    if (v.size() <= StringRef::kInlineSize) {
+        ref_ = StringRef{v};
+        return;
+    }
+    // long string: point the ref at our own copy of the bytes
+    char* buf = new char[v.size()];
+    std::memcpy(buf, v.data(), v.size());
+    try {
+        ref_ = StringRef{std::string_view{buf, v.size()}};
+    } catch (...) {
+        delete[] buf;
+        throw;
+    }
+}
+
+memoria::RowValue::RowValue(const RowValue& other) {
+    if (other.ownsHeap())
+        *this = RowValue{other.ref_.view()};
+    else
+        ref_ = other.ref_;
+}
+
+memoria::RowValue::RowValue(RowValue&& other) noexcept : ref_(other.ref_) {
+    other.ref_ = StringRef{};
+}
+
+memoria::RowValue& memoria::RowValue::operator=(const RowValue& other) {
+    if (this != &other)
+        *this = RowValue{other};
+    return *this;
+}
+
+memoria::RowValue& memoria::RowValue::operator=(RowValue&& other) noexcept {
+    if (this != &other) {
+        release();
+        ref_ = other.ref_;
+        other.ref_ = StringRef{};
+    }
+    return *this;
+}
+
+memoria::RowValue::~RowValue() {
+    release();
+}
+
+void memoria::RowValue::release() noexcept {
+    if (ownsHeap())
+        delete[] ref_.pointer();
+    ref_ = StringRef{};
+}
+
+int64_t memoria::RowValue::asInt() const {
+    if (!isInt())
+        throw std::bad_variant_access{};
+    int64_t v;
+    std::memcpy(&v, ref_.data_ + StringRef::kPrefixSize, sizeof v);
+    return v;
+}
+
+std::string_view memoria::RowValue::asStr() const {
+    return strRef().view();
+}
+
+const memoria::StringRef& memoria::RowValue::strRef() const {
+    if (!isStr())
+        throw std::bad_variant_access{};
+    return ref_;
+}
+
+bool memoria::operator==(const RowValue& a, const RowValue& b) noexcept {
+    if (a.isInt() || b.isInt())
+        return a.isInt() && b.isInt() && a.asInt() == b.asInt();
+    return a.ref_ == b.ref_;
+}
+
+// -------------------- Row --------------------
 
 memoria::Row::Row() = default;
 
@@ -0,0 +1,115 @@
+//
+// Created by Ilya Nyrkov on 04.09.25.
+//
+
+#include "memoria/RowGroup.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace memoria {
+
+RowGroup::RowGroup(const Schema& schema,
+                   const std::vector<std::shared_ptr<StrDictionary>>& dictionaries,
+                   bool presized) {
+    columns_.reserve(schema.size());
+    for (std::size_t i = 0; i < schema.size(); ++i) {
+        columns_.push_back(makeColumnStorage(schema.columns()[i], dictionaries.at(i)));
+        if (presized)
+            std::visit([](auto& c) { c.reserve(kRowGroupSize); }, columns_.back());
+    }
+}
+
+void RowGroup::append(const Row& row) {
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+        std::visit(
+            [&](auto& c) {
+                using C = std::decay_t<decltype(c)>;
+                if constexpr (std::is_same_v<C, IntColumn>)
+                    c.append(row.at(i).asInt());
+                else
+                    c.append(row.at(i).asStr());
+            },
+            columns_[i]);
+    }
+    ++size_;
+}
+
+void RowGroup::append(const std::vector<Row>& rows, std::size_t begin, std::size_t end) {
+    // reserve for the batch, but at least double a growing first group so that many small
+    // batches still reallocate only logarithmically often
+    const std::size_t capacity =
+        std::min(kRowGroupSize, std::max(size_ + (end - begin), 2 * size_));
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+        std::visit(
+            [&](auto& c) {
+                using C = std::decay_t<decltype(c)>;
+                c.reserve(capacity);
+                for (std::size_t r = begin; r < end; ++r) {
+                    if constexpr (std::is_same_v<C, IntColumn>)
+                        c.append(rows[r].at(i).asInt());
+                    else
+                        c.append(rows[r].at(i).asStr());
+                }
+            },
+            columns_[i]);
+    }
+    size_ += end - begin;
+}
+
+void RowGroup::appendFrom(const RowGroup& other, std::size_t i) {
+    for (std::size_t c = 0; c < columns_.size(); ++c) {
+        std::visit(
+            [&](auto& dst) {
+                using C = std::decay_t<decltype(dst)>;
+                const auto& src = std::get<C>(other.columns_[c]);
+                if constexpr (std::is_same_v<C, DictColumn>)
+                    dst.appendCode(src.code(i)); // groups of one table share the dictionary
+                else
+                    dst.append(src.at(i));
+            },
+            columns_[c]);
+    }
+    ++size_;
+}
+
+void RowGroup::compact(const std::vector<uint8_t>& keep) {
+    for (auto& col : columns_)
+        std::visit([&](auto& c) { c.compact(keep); }, col);
+    size_ = static_cast<std::size_t>(std::count(keep.begin(), keep.end(), uint8_t{1}));
+}
+
+void RowGroup::assign(std::size_t col, const std::vector<uint8_t>& mask, const RowValue& val) {
+    if (auto* ints = std::get_if<IntColumn>(&columns_[col])) {
+        const int64_t v = val.asInt();
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (mask[i])
+                ints->set(i, v);
+        }
+    } else {
+        const std::string_view v = val.asStr();
+        if (auto* dict = std::get_if<DictColumn>(&columns_[col]))
+            dict->assign(mask, v);
+        else
+            std::get<StrColumn>(columns_[col]).assign(mask, v);
+    }
+}
+
+Row RowGroup::materializeRow(std::size_t i) const {
+    std::vector<RowValue> cells;
+    cells.reserve(columns_.size());
+    for (const auto& col : columns_)
+        cells.push_back(cellAt(col, i));
+    return Row{std::move(cells)};
+}
+
+Row RowGroup::projectRow(std::size_t i, const std::vector<std::size_t>& columnIndices) const {
+    std::vector<RowValue> cells;
+    cells.reserve(columnIndices.size());
+    for (auto idx : columnIndices)
+        cells.push_back(cellAt(columns_[idx], i));
+    return Row{std::move(cells)};
+}
+
+} // namespace memoria
@@ -0,0 +1,57 @@
+//
+// Created by Ilya Nyrkov on 19.09.25.
+//
+
+#include "memoria/RowRefs.h"
+
+#include "memoria/Table.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace memoria {
+
+Row RowRef::materialize() const {
+    std::vector<RowValue> cells;
+    cells.reserve(size());
+    for (std::size_t k = 0; k < size(); ++k)
+        cells.push_back(at(k));
+    return Row{std::move(cells)};
+}
+
+RowRefs::RowRefs(const Table& table, std::vector<RowId> ids,
+                 std::optional<std::vector<std::size_t>> projection)
+    : RowRefs(table, table.version(), std::move(ids), std::move(projection)) {}
+
+RowRefs::RowRefs(const Table& table, uint64_t version, std::vector<RowId> ids,
+                 std::optional<std::vector<std::size_t>> projection)
+    : table_(&table), version_(version), ids_(std::move(ids)), projection_(std::move(projection)) {
+    if (projection_) {
+        for (auto idx : *projection_) {
+            if (idx >= table.getSchema().size())
+                throw std::out_of_range("Projection index out of range");
+        }
+    }
+}
+
+bool RowRefs::valid() const noexcept {
+    return table_->version() == version_;
+}
+
+RowRef RowRefs::operator[](std::size_t i) const {
+    if (!valid())
+        throw std::logic_error("Table was modified after the result was taken");
+    const RowId id = ids_.at(i);
+    const RowView row = table_->rowGroup(rowIdGroup(id)).row(rowIdOffset(id));
+    return RowRef{row, projection_ ? &*projection_ : nullptr};
+}
+
+std::vector<Row> RowRefs::materialize() const {
+    std::vector<Row> out;
+    out.reserve(size());
+    for (std::size_t i = 0; i < size(); ++i)
+        out.push_back((*this)[i].materialize());
+    return out;
+}
+
+} // namespace memoria
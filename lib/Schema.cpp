@@ -13,6 +13,10 @@ Schema::Schema(std::vector<Column> columns) {
         if (!inserted) {
             throw std::invalid_argument("Duplicate column name: " + name);
         }
+        if (columns.at(i).encoding == ColumnEncoding::Dictionary &&
+            columns.at(i).type != ColumnType::Str) {
+            throw std::invalid_argument("Dictionary encoding requires a str column: " + name);
+        }
     }
     columns_ = std::move(columns);
 }
@@ -50,9 +54,9 @@ RowValue Schema::default_value(std::size_t i) const {
     const auto& col = columns_.at(i); // throws std::out_of_range if bad index
     switch (col.type) {
     case ColumnType::Int:
-        return RowValue{std::in_place_type<int64_t>, 0};
+        return RowValue{int64_t{0}};
     case ColumnType::Str:
-        return RowValue{std::in_place_type<std::string>, ""};
+        return RowValue{std::string_view{}};
     // Fallback (should be unreachable)
     default:
         throw std::invalid_argument("unknown column type");
@@ -0,0 +1,363 @@
+//
+// Created by Ilya Nyrkov on 16.09.25.
+//
+
+#include "memoria/SimdKernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MEMORIA_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace memoria {
+
+// ----------------------- scalar -----------------------
+
+template <IntCompare Op> static bool compare(int64_t a, int64_t b) noexcept {
+    if constexpr (Op == IntCompare::Eq)
+        return a == b;
+    else if constexpr (Op == IntCompare::Ne)
+        return a != b;
+    else if constexpr (Op == IntCompare::Lt)
+        return a < b;
+    else if constexpr (Op == IntCompare::Gt)
+        return a > b;
+    else if constexpr (Op == IntCompare::Le)
+        return a <= b;
+    else
+        return a >= b;
+}
+
+// bits for cells[0, n), n <= 64
+template <IntCompare Op>
+static uint64_t compareWordScalar(const int64_t* cells, std::size_t n, int64_t rhs) noexcept {
+    uint64_t bits = 0;
+    for (std::size_t j = 0; j < n; ++j)
+        bits |= static_cast<uint64_t>(compare<Op>(cells[j], rhs)) << j;
+    return bits;
+}
+
+template <IntCompare Op>
+static void compareScalar(const int64_t* cells, std::size_t rows, int64_t rhs,
+                          const uint64_t* reach, uint64_t* out) {
+    const std::size_t words = (rows + 63) / 64;
+    for (std::size_t w = 0; w < words; ++w) {
+        const std::size_t n = std::min<std::size_t>(64, rows - w * 64);
+        out[w] = reach[w] == 0 ? 0 : compareWordScalar<Op>(cells + w * 64, n, rhs);
+    }
+}
+
+static std::size_t compressScalar(const uint64_t* words, std::size_t count, uint32_t base,
+                                  uint32_t* out) {
+    std::size_t k = 0;
+    for (std::size_t w = 0; w < count; ++w) {
+        for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1)
+            out[k++] = base + static_cast<uint32_t>(w * 64 + std::countr_zero(bits));
+    }
+    return k;
+}
+
+static void aggregateScalar(const int64_t* cells, const uint32_t* sel, std::size_t n,
+                            IntAccumulator& acc) {
+    int64_t high = 0;
+    uint64_t low = 0;
+    int64_t mn = acc.min;
+    int64_t mx = acc.max;
+    for (std::size_t k = 0; k < n; ++k) {
+        const int64_t v = sel ? cells[sel[k]] : cells[k];
+        high += v >> 32;
+        low += static_cast<uint64_t>(v) & 0xFFFFFFFFu;
+        mn = std::min(mn, v);
+        mx = std::max(mx, v);
+    }
+    acc.sumHigh += high;
+    acc.sumLow += low;
+    acc.min = mn;
+    acc.max = mx;
+}
+
+// ----------------------- AVX2 -----------------------
+
+#ifdef MEMORIA_X86_SIMD
+
+// AVX2 has only == and signed >, so the other four are a swapped > or a negation
+template <IntCompare Op>
+__attribute__((target("avx2"))) static void compareAvx2(const int64_t* cells, std::size_t rows,
+                                                        int64_t rhs, const uint64_t* reach,
+                                                        uint64_t* out) {
+    constexpr bool negate = Op == IntCompare::Ne || Op == IntCompare::Le || Op == IntCompare::Ge;
+    const __m256i r = _mm256_set1_epi64x(rhs);
+    const std::size_t words = (rows + 63) / 64;
+    for (std::size_t w = 0; w < words; ++w) {
+        const std::size_t n = std::min<std::size_t>(64, rows - w * 64);
+        if (reach[w] == 0) {
+            out[w] = 0;
+            continue;
+        }
+        if (n < 64) {
+            out[w] = compareWordScalar<Op>(cells + w * 64, n, rhs);
+            continue;
+        }
+        uint64_t bits = 0;
+        for (std::size_t k = 0; k < 16; ++k) {
+            const __m256i x =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + w * 64 + 4 * k));
+            __m256i m;
+            if constexpr (Op == IntCompare::Eq || Op == IntCompare::Ne)
+                m = _mm256_cmpeq_epi64(x, r);
+            else if constexpr (Op == IntCompare::Gt || Op == IntCompare::Le)
+                m = _mm256_cmpgt_epi64(x, r);
+            else
+                m = _mm256_cmpgt_epi64(r, x);
+            const auto lanes = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(m)));
+            bits |= static_cast<uint64_t>(lanes) << (4 * k);
+        }
+        out[w] = negate ? ~bits : bits;
+    }
+}
+
+// AVX2 has neither 64-bit arithmetic shifts nor 64-bit min/max: the high half is sign-extended
+// by blending in the sign dwords, min/max are a compare and a blend
+__attribute__((target("avx2"))) static void aggregateAvx2(const int64_t* cells,
+                                                          const uint32_t* sel, std::size_t n,
+                                                          IntAccumulator& acc) {
+    const __m256i lowMask = _mm256_set1_epi64x(0xFFFFFFFF);
+    __m256i high = _mm256_setzero_si256();
+    __m256i low = _mm256_setzero_si256();
+    __m256i mn = _mm256_set1_epi64x(acc.min);
+    __m256i mx = _mm256_set1_epi64x(acc.max);
+    std::size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        const __m256i x =
+            sel ? _mm256_i32gather_epi64(reinterpret_cast<const long long*>(cells),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(sel + k)),
+                                         8)
+                : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + k));
+        const __m256i h = _mm256_blend_epi32(_mm256_srli_epi64(x, 32), _mm256_srai_epi32(x, 31),
+                                             0b10101010);
+        high = _mm256_add_epi64(high, h);
+        low = _mm256_add_epi64(low, _mm256_and_si256(x, lowMask));
+        mn = _mm256_blendv_epi8(mn, x, _mm256_cmpgt_epi64(mn, x));
+        mx = _mm256_blendv_epi8(mx, x, _mm256_cmpgt_epi64(x, mx));
+    }
+    alignas(32) int64_t h[4], l[4], a[4], b[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(h), high);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(l), low);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(a), mn);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(b), mx);
+    for (int j = 0; j < 4; ++j) {
+        acc.sumHigh += h[j];
+        acc.sumLow += static_cast<uint64_t>(l[j]);
+        acc.min = std::min(acc.min, a[j]);
+        acc.max = std::max(acc.max, b[j]);
+    }
+    // tail
+    aggregateScalar(sel ? cells : cells + k, sel ? sel + k : nullptr, n - k, acc);
+}
+
+// ----------------------- AVX-512 -----------------------
+
+template <IntCompare Op> constexpr int kAvx512Predicate = [] {
+    switch (Op) {
+    case IntCompare::Eq:
+        return _MM_CMPINT_EQ;
+    case IntCompare::Ne:
+        return _MM_CMPINT_NE;
+    case IntCompare::Lt:
+        return _MM_CMPINT_LT;
+    case IntCompare::Gt:
+        return _MM_CMPINT_NLE;
+    case IntCompare::Le:
+        return _MM_CMPINT_LE;
+    case IntCompare::Ge:
+        return _MM_CMPINT_NLT;
+    }
+    return _MM_CMPINT_EQ;
+}();
+
+// compares straight into 8-bit masks; the partial last word uses masked loads instead of a
+// scalar tail
+template <IntCompare Op>
+__attribute__((target("avx512f"))) static void compareAvx512(const int64_t* cells,
+                                                             std::size_t rows, int64_t rhs,
+                                                             const uint64_t* reach,
+                                                             uint64_t* out) {
+    const __m512i r = _mm512_set1_epi64(rhs);
+    const std::size_t words = (rows + 63) / 64;
+    for (std::size_t w = 0; w < words; ++w) {
+        if (reach[w] == 0) {
+            out[w] = 0;
+            continue;
+        }
+        const std::size_t n = std::min<std::size_t>(64, rows - w * 64);
+        const int64_t* c = cells + w * 64;
+        uint64_t bits = 0;
+        for (std::size_t k = 0; k < 8; ++k) {
+            const std::size_t left = n > 8 * k ? n - 8 * k : 0;
+            const auto valid = static_cast<__mmask8>(left >= 8 ? 0xFF : (1u << left) - 1);
+            if (valid == 0)
+                break;
+            const __m512i x = _mm512_maskz_loadu_epi64(valid, c + 8 * k);
+            const __mmask8 m = _mm512_mask_cmp_epi64_mask(valid, x, r, kAvx512Predicate<Op>);
+            bits |= static_cast<uint64_t>(m) << (8 * k);
+        }
+        out[w] = bits;
+    }
+}
+
+// 16 offsets at a time: vpcompressd stores exactly the lanes whose bit is set
+__attribute__((target("avx512f"))) static std::size_t
+compressAvx512(const uint64_t* words, std::size_t count, uint32_t base, uint32_t* out) {
+    const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i sixteen = _mm512_set1_epi32(16);
+    __m512i idx = _mm512_add_epi32(iota, _mm512_set1_epi32(static_cast<int>(base)));
+    std::size_t k = 0;
+    for (std::size_t w = 0; w < count; ++w) {
+        const uint64_t bits = words[w];
+        for (unsigned q = 0; q < 4; ++q) {
+            const auto m = static_cast<__mmask16>(bits >> (16 * q));
+            _mm512_mask_compressstoreu_epi32(out + k, m, idx);
+            k += static_cast<std::size_t>(std::popcount(static_cast<unsigned>(m)));
+            idx = _mm512_add_epi32(idx, sixteen);
+        }
+    }
+    return k;
+}
+
+__attribute__((target("avx512f"))) static void aggregateAvx512(const int64_t* cells,
+                                                               const uint32_t* sel, std::size_t n,
+                                                               IntAccumulator& acc) {
+    const __m512i lowMask = _mm512_set1_epi64(0xFFFFFFFF);
+    __m512i high = _mm512_setzero_si512();
+    __m512i low = _mm512_setzero_si512();
+    __m512i mn = _mm512_set1_epi64(acc.min);
+    __m512i mx = _mm512_set1_epi64(acc.max);
+    std::size_t k = 0;
+    for (; k + 8 <= n; k += 8) {
+        const __m512i x =
+            sel ? _mm512_i32gather_epi64(
+                      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sel + k)), cells, 8)
+                : _mm512_loadu_si512(cells + k);
+        high = _mm512_add_epi64(high, _mm512_srai_epi64(x, 32));
+        low = _mm512_add_epi64(low, _mm512_and_si512(x, lowMask));
+        mn = _mm512_min_epi64(mn, x);
+        mx = _mm512_max_epi64(mx, x);
+    }
+    acc.sumHigh += _mm512_reduce_add_epi64(high);
+    acc.sumLow += static_cast<uint64_t>(_mm512_reduce_add_epi64(low));
+    acc.min = _mm512_reduce_min_epi64(mn);
+    acc.max = _mm512_reduce_max_epi64(mx);
+    // tail
+    aggregateScalar(sel ? cells : cells + k, sel ? sel + k : nullptr, n - k, acc);
+}
+
+#endif // MEMORIA_X86_SIMD
+
+// ----------------------- dispatch -----------------------
+
+static constexpr SimdKernels kScalar{
+    SimdLevel::Scalar,
+    {compareScalar<IntCompare::Eq>, compareScalar<IntCompare::Ne>, compareScalar<IntCompare::Lt>,
+     compareScalar<IntCompare::Gt>, compareScalar<IntCompare::Le>, compareScalar<IntCompare::Ge>},
+    compressScalar,
+    aggregateScalar,
+};
+
+#ifdef MEMORIA_X86_SIMD
+static constexpr SimdKernels kAvx2{
+    SimdLevel::Avx2,
+    {compareAvx2<IntCompare::Eq>, compareAvx2<IntCompare::Ne>, compareAvx2<IntCompare::Lt>,
+     compareAvx2<IntCompare::Gt>, compareAvx2<IntCompare::Le>, compareAvx2<IntCompare::Ge>},
+    compressScalar, // no compress instruction below AVX-512
+    aggregateAvx2,
+};
+
+static constexpr SimdKernels kAvx512{
+    SimdLevel::Avx512,
+    {compareAvx512<IntCompare::Eq>, compareAvx512<IntCompare::Ne>,
+     compareAvx512<IntCompare::Lt>, compareAvx512<IntCompare::Gt>,
+     compareAvx512<IntCompare::Le>, compareAvx512<IntCompare::Ge>},
+    compressAvx512,
+    aggregateAvx512,
+};
+#endif
+
+SimdLevel detectSimdLevel() noexcept {
+#ifdef MEMORIA_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::Avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::Avx2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+const SimdKernels& simdKernelsFor(SimdLevel level) {
+    if (level > detectSimdLevel())
+        throw std::invalid_argument("SIMD level not supported on this machine");
+    switch (level) {
+#ifdef MEMORIA_X86_SIMD
+    case SimdLevel::Avx512:
+        return kAvx512;
+    case SimdLevel::Avx2:
+        return kAvx2;
+#endif
+    default:
+        return kScalar;
+    }
+}
+
+const SimdKernels& simdKernels() noexcept {
+    static const SimdKernels& chosen = simdKernelsFor(detectSimdLevel());
+    return chosen;
+}
+
+void IntAccumulator::merge(const IntAccumulator& other) noexcept {
+    sumHigh += other.sumHigh;
+    sumLow += other.sumLow;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+std::optional<int64_t> IntAccumulator::sum() const noexcept {
+    // sum = high * 2^32 + low with low < 2^32 once the carry is moved up
+    const int64_t high = sumHigh + static_cast<int64_t>(sumLow >> 32);
+    const uint64_t low = sumLow & 0xFFFFFFFFu;
+    if (high < (std::numeric_limits<int64_t>::min() >> 32) ||
+        high > (std::numeric_limits<int64_t>::max() >> 32))
+        return std::nullopt;
+    return static_cast<int64_t>(static_cast<uint64_t>(high) << 32 | low);
+}
+
+int64_t IntAccumulator::average(uint64_t count) const noexcept {
+    // floor(sum / count) = floor(high / count) * 2^32 + floor((rem * 2^32 + low) / count), with
+    // 0 <= rem < count; the two parts may leave int64 range on their own, so add them unsigned
+    const auto c = static_cast<int64_t>(count);
+    const int64_t high = sumHigh + static_cast<int64_t>(sumLow >> 32);
+    const uint64_t low = sumLow & 0xFFFFFFFFu;
+    int64_t q = high / c;
+    int64_t rem = high % c;
+    if (rem < 0) {
+        rem += c;
+        --q;
+    }
+    const uint64_t part = (static_cast<uint64_t>(rem) << 32 | low);
+    const uint64_t floor = (static_cast<uint64_t>(q) << 32) + part / count;
+    // round toward zero like integer division: negative inexact results move up by one
+    const bool inexact = part % count != 0;
+    return static_cast<int64_t>(floor + (high < 0 && inexact ? 1 : 0));
+}
+
+std::size_t countBits(const uint64_t* words, std::size_t count) noexcept {
+    std::size_t n = 0;
+    for (std::size_t w = 0; w < count; ++w)
+        n += static_cast<std::size_t>(std::popcount(words[w]));
+    return n;
+}
+
+} // namespace memoria
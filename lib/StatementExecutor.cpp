@@ -4,13 +4,24 @@
 
 #include "memoria/StatementExecutor.h"
 
+#include "memoria/Aggregator.h"
 #include "memoria/Database.h"
+#include "memoria/FilterCompiler.h"
+#include "memoria/GroupAggregator.h"
+#include "memoria/HashJoin.h"
 #include "memoria/Row.h"
 #include "memoria/Schema.h"
 #include "memoria/Table.h"
+#include "memoria/TopK.h"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
 #include <stdexcept>
 
 namespace memoria {
@@ -18,8 +29,52 @@ namespace memoria {
 // ----------------------- small helpers -----------------------
 
 static bool valueTypeMatches(ColumnType t, const RowValue& v) {
-    return (t == ColumnType::Int && std::holds_alternative<int64_t>(v)) ||
-           (t == ColumnType::Str && std::holds_alternative<std::string>(v));
+    return (t == ColumnType::Int && v.isInt()) || (t == ColumnType::Str && v.isStr());
+}
+
+static constexpr const char* kNotPreparable = "PREPARE supports SELECT, INSERT, UPDATE and DELETE";
+
+// a deep copy: AND / OR own their operands through unique_ptr
+static WhereExpr copyWhere(const WhereExpr& expr) {
+    if (const auto* c = std::get_if<Comparison>(&expr))
+        return *c;
+    const auto copy = [](const auto& node) {
+        std::decay_t<decltype(node)> out;
+        out.lhs = std::make_unique<WhereExpr>(copyWhere(*node.lhs));
+        out.rhs = std::make_unique<WhereExpr>(copyWhere(*node.rhs));
+        return WhereExpr{std::move(out)};
+    };
+    if (const auto* a = std::get_if<And>(&expr))
+        return copy(*a);
+    return copy(std::get<Or>(expr));
+}
+
+// a copy of the statement of a PREPARE, which the prepared statement owns
+static Statement copyPreparable(const Statement& st) {
+    const auto where = [](const std::optional<WhereExpr>& w) -> std::optional<WhereExpr> {
+        if (!w)
+            return std::nullopt;
+        return copyWhere(*w);
+    };
+    if (const auto* sel = std::get_if<Select>(&st)) {
+        Select copy;
+        copy.table = sel->table;
+        copy.join = sel->join;
+        copy.projection = sel->projection;
+        copy.where = where(sel->where);
+        copy.groupBy = sel->groupBy;
+        copy.orderBy = sel->orderBy;
+        copy.limit = sel->limit;
+        copy.offset = sel->offset;
+        return copy;
+    }
+    if (const auto* upd = std::get_if<Update>(&st))
+        return Update{upd->table, upd->set, where(upd->where)};
+    if (const auto* del = std::get_if<Delete>(&st))
+        return Delete{del->table, where(del->where)};
+    if (const auto* ins = std::get_if<Insert>(&st))
+        return *ins;
+    throw std::invalid_argument(kNotPreparable);
 }
 
 // ----------------------- high-level dispatch -----------------------
@@ -32,6 +87,9 @@ std::optional<QueryResult> StatementExecutor::execute(const Statement& st) {
             if constexpr (std::is_same_v<T, CreateTable>) {
                 execCreateTable(node);
                 return std::nullopt;
+            } else if constexpr (std::is_same_v<T, CreateIndex>) {
+                execCreateIndex(node);
+                return std::nullopt;
             } else if constexpr (std::is_same_v<T, Insert>) {
                 execInsert(node);
                 return std::nullopt;
@@ -43,6 +101,32 @@ std::optional<QueryResult> StatementExecutor::execute(const Statement& st) {
                 return std::nullopt;
             } else if constexpr (std::is_same_v<T, Select>) {
                 return execSelect(node);
+            } else if constexpr (std::is_same_v<T, Set>) {
+                execSet(node);
+                return std::nullopt;
+            } else if constexpr (std::is_same_v<T, Analyze>) {
+                execAnalyze(node);
+                return std::nullopt;
+            } else if constexpr (std::is_same_v<T, ShowStats>) {
+                return execShowStats(node);
+            } else if constexpr (std::is_same_v<T, Explain>) {
+                return execExplain(node);
+            } else if constexpr (std::is_same_v<T, Prepare>) {
+                if (prepared_.contains(node.name))
+                    throw std::invalid_argument("Prepared statement already exists: " +
+                                                node.name);
+                prepared_.emplace(node.name, std::make_unique<Prepared>(
+                                                 prepare(copyPreparable(*node.statement))));
+                return std::nullopt;
+            } else if constexpr (std::is_same_v<T, Execute>) {
+                const auto it = prepared_.find(node.name);
+                if (it == prepared_.end())
+                    throw std::out_of_range("No such prepared statement: " + node.name);
+                return execute(*it->second, node.args);
+            } else if constexpr (std::is_same_v<T, Deallocate>) {
+                if (prepared_.erase(node.name) == 0)
+                    throw std::out_of_range("No such prepared statement: " + node.name);
+                return std::nullopt;
             } else {
                 static_assert(!sizeof(T*), "Unhandled Statement alternative");
             }
@@ -56,144 +140,1397 @@ void StatementExecutor::execCreateTable(const CreateTable& st) const {
     db_.createTable(st.tableName, st.schema);
 }
 
+void StatementExecutor::execCreateIndex(const CreateIndex& st) const {
+    Table& tbl = db_.getTable(st.table);
+    tbl.createIndex(st.indexName, tbl.getSchema().require_index(st.column), st.kind);
+}
+
 void StatementExecutor::execInsert(const Insert& st) const {
     Table& tbl = db_.getTable(st.tableName);
-    const Schema& sch = tbl.getSchema();
-
     // determine ordering of provided columns (or full schema order)
-    const std::vector<std::size_t> order = compileInsertColumnOrder(st, sch);
+    execInsert(st, tbl, compileInsertColumnOrder(st, tbl.getSchema()));
+}
 
-    // each VALUES tuple -> Row (reordered to schema layout)
-    for (const auto& vals : st.rows) {
-        Row r = makeRowForInsert(vals, order, sch);
-        tbl.insertRow(std::move(r));
-    }
+void StatementExecutor::execInsert(Insert&& st) const {
+    Table& tbl = db_.getTable(st.tableName);
+    const std::vector<std::size_t> order = compileInsertColumnOrder(st, tbl.getSchema());
+    tbl.insertRows(makeRowsForInsert(std::move(st.rows), order, tbl.getSchema()));
+}
+
+void StatementExecutor::execInsert(const Insert& st, Table& tbl,
+                                   const std::vector<std::size_t>& order) const {
+    // the VALUES tuples are copied: a prepared INSERT runs again
+    tbl.insertRows(makeRowsForInsert(st.rows, order, tbl.getSchema()));
 }
 
 std::size_t StatementExecutor::execDelete(const Delete& st) const {
+    return execDelete(st, planDelete(st));
+}
+
+std::size_t StatementExecutor::execDelete(const Delete& st, const WritePlan& plan) const {
     Table& tbl = db_.getTable(st.table);
+    const uint64_t start = readTicks();
+    const uint64_t groups = tbl.rowGroupCount();
 
+    std::size_t n = 0;
     if (st.where) {
-        const auto pred = compileWhere(*st.where, tbl.getSchema());
-        return tbl.deleteWhere(pred); // template method defined in header
+        const auto cand = candidates(plan.access);
+        const uint64_t scanned = cand ? cand->size() : tbl.rowCount();
+        n = tbl.deleteWhere(*plan.access.filter, cand ? &*cand : nullptr, &db_.threadPool());
+        recordRead(plan.access, scanned, n, 0, start);
     } else {
-        const std::size_t n = tbl.rowCount();
+        n = tbl.rowCount();
         tbl.deleteAllRows();
-        return n;
     }
+    plan.root->stats = {n, n, groups, 0, readTicks() - start};
+    return n;
 }
 
 std::size_t StatementExecutor::execUpdate(const Update& st) const {
+    return execUpdate(st, planUpdate(st));
+}
+
+std::size_t StatementExecutor::execUpdate(const Update& st, const WritePlan& plan) const {
     Table& tbl = db_.getTable(st.table);
-    const Schema& sch = tbl.getSchema();
+    const uint64_t start = readTicks();
 
-    // map assignments (by name) to (index, value) and validate types
-    const auto assigns = compileAssignments(st.set, sch);
+    // without WHERE every row is updated
+    const auto cand = candidates(plan.access);
+    const uint64_t scanned = cand ? cand->size() : tbl.rowCount();
+    const std::size_t n = tbl.updateWhere(plan.access.filter.value_or(Pred{}), plan.assignments,
+                                          cand ? &*cand : nullptr, &db_.threadPool());
+    recordRead(plan.access, scanned, n, 0, start);
+    plan.root->stats = {n, n, tbl.rowGroupCount(), 0, readTicks() - start};
+    return n;
+}
 
-    if (st.where) {
-        const auto pred = compileWhere(*st.where, sch);
-        return tbl.updateWhere(pred, assigns);
+void StatementExecutor::execSet(const Set& st) const {
+    if (st.name == "threads") {
+        if (st.value < 1 || st.value > kMaxThreads)
+            throw std::invalid_argument("threads must be between 1 and " +
+                                        std::to_string(kMaxThreads));
+        db_.setThreads(static_cast<std::size_t>(st.value));
+        return;
+    }
+    throw std::invalid_argument("Unknown setting: " + st.name);
+}
+
+void StatementExecutor::execAnalyze(const Analyze& st) const {
+    db_.getTable(st.table).analyze(&db_.threadPool());
+}
+
+QueryResult StatementExecutor::execShowStats(const ShowStats& st) const {
+    const Table& tbl = db_.getTable(st.table);
+    const TableStats* stats = tbl.stats();
+    if (!stats)
+        throw std::invalid_argument("No statistics for " + st.table + ", run ANALYZE " +
+                                    st.table + " first");
+    QueryResult out;
+    out.header = {"column", "rows", "distinct", "min", "max", "histogram"};
+    const auto& columns = tbl.getSchema().columns();
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        const ColumnStats& cs = stats->columns[c];
+        std::string histogram = "NULL";
+        if (const auto& buckets = cs.histogram.buckets(); !buckets.empty()) {
+            // bucket upper bounds; every bucket holds about the same number of rows
+            histogram = std::to_string(buckets.size()) + " buckets of ~" +
+                        std::to_string(cs.histogram.rows() / buckets.size()) + " rows, up to";
+            for (const auto& b : buckets)
+                histogram += " " + std::to_string(b.hi);
+        }
+        out.rows.emplace_back(std::vector<RowValue>{
+            RowValue{columns[c].name}, RowValue{static_cast<int64_t>(stats->rows)},
+            RowValue{static_cast<int64_t>(cs.distinctCount(stats->rows))},
+            cs.min.value_or(RowValue{"NULL"}), cs.max.value_or(RowValue{"NULL"}),
+            RowValue{histogram}});
+    }
+    return out;
+}
+
+QueryResult StatementExecutor::execExplain(const Explain& st) const {
+    const auto startTime = std::chrono::steady_clock::now();
+    const uint64_t start = readTicks();
+
+    // ANALYZE runs the statement on its plan, which records what every operator did
+    std::unique_ptr<PlanNode> root;
+    if (!st.analyze) {
+        root = plan(*st.statement);
+    } else if (const auto* select = std::get_if<Select>(&*st.statement)) {
+        SelectPlan plan = planSelect(*select);
+        plan.analyze = true;
+        (void)execSelect(*select, plan);
+        root = std::move(plan.root);
+    } else if (const auto* update = std::get_if<Update>(&*st.statement)) {
+        WritePlan plan = planUpdate(*update);
+        measureConjuncts(plan.access); // before the rows change
+        (void)execUpdate(*update, plan);
+        root = std::move(plan.root);
+    } else if (const auto* del = std::get_if<Delete>(&*st.statement)) {
+        WritePlan plan = planDelete(*del);
+        measureConjuncts(plan.access);
+        (void)execDelete(*del, plan);
+        root = std::move(plan.root);
     } else {
-        // update every row
-        auto always = [](const Row&) { return true; };
-        return tbl.updateWhere(always, assigns);
+        root = plan(*st.statement);
+        const uint64_t insertStart = readTicks();
+        execInsert(std::get<Insert>(*st.statement));
+        const uint64_t rows = std::get<Insert>(*st.statement).rows.size();
+        root->stats = {rows, rows, 1, 0, readTicks() - insertStart};
+    }
+
+    std::optional<double> nsPerTick;
+    if (st.analyze) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - startTime)
+                            .count();
+        const uint64_t ticks = readTicks() - start;
+        nsPerTick = ticks == 0 ? 1.0 : static_cast<double>(ns) / static_cast<double>(ticks);
+    }
+    QueryResult out;
+    out.header = {"plan"};
+    for (auto& line : explainLines(*root, nsPerTick))
+        out.rows.emplace_back(std::vector<RowValue>{RowValue{line}});
+    return out;
+}
+
+// header of a SELECT: the projected names, or every column for STAR
+static std::vector<std::string> selectHeader(const Select& st, const Schema& sch) {
+    if (!std::holds_alternative<Select::Star>(st.projection))
+        return std::get<std::vector<std::string>>(st.projection);
+    std::vector<std::string> header;
+    header.reserve(sch.size());
+    for (const auto& c : sch.columns())
+        header.push_back(c.name);
+    return header;
+}
+
+Cursor StatementExecutor::openSelect(const Select& st) const {
+    if (isAggregation(st) || st.join)
+        throw std::invalid_argument("Aggregate and JOIN queries are not streamed, use execSelect");
+    SelectPlan plan = planSelect(st);
+    return openCursor(st, plan);
+}
+
+Cursor StatementExecutor::openCursor(const Select& st, SelectPlan& plan) const {
+    Access& access = plan.access[0];
+    const Table& tbl = *access.table;
+    const Schema& sch = tbl.getSchema();
+
+    // STAR emits full rows, anything else the projected columns; the plan keeps its filter for
+    // the next execution of a prepared statement
+    Cursor cursor{tbl,
+                  selectHeader(st, sch),
+                  access.filter.value_or(Pred{}),
+                  plan.projection,
+                  candidates(access),
+                  db_.sharedThreadPool()};
+    if (st.orderBy) {
+        cursor.orderBy(
+            {sch.require_index(std::get<std::string>(st.orderBy->item)), st.orderBy->descending});
     }
+    if (st.limit)
+        cursor.limit(*st.limit, st.offset);
+    return cursor;
+}
+
+QueryRefs StatementExecutor::execSelectRefs(const Select& st) const {
+    if (isAggregation(st) || st.join)
+        throw std::invalid_argument("Aggregate and JOIN queries are not streamed, use execSelect");
+    SelectPlan plan = planSelect(st);
+    if (st.orderBy || st.limit) {
+        // the cursor already sorts and stops early
+        Cursor cursor = openCursor(st, plan);
+        return {cursor.header(), cursor.nextRefs(Cursor::kNoLimit)};
+    }
+
+    const Access& access = plan.access[0];
+    const Table& tbl = *access.table;
+    const Pred pred = access.filter.value_or(Pred{});
+    const auto cand = candidates(access);
+    const std::vector<RowId>* candPtr = cand ? &*cand : nullptr;
+
+    if (!plan.projection)
+        return {selectHeader(st, tbl.getSchema()),
+                tbl.viewRowsWhere(pred, candPtr, &db_.threadPool())};
+    return {selectHeader(st, tbl.getSchema()),
+            tbl.viewColumnRowsWhere(std::move(*plan.projection), pred, candPtr,
+                                    &db_.threadPool())};
+}
+
+std::size_t StatementExecutor::execSelect(const Select& st, const RowSink& sink) const {
+    return openSelect(st).drain(sink);
 }
 
 QueryResult StatementExecutor::execSelect(const Select& st) const {
-    const Table& tbl = db_.getTable(st.table);
+    SelectPlan plan = planSelect(st);
+    return execSelect(st, plan);
+}
+
+QueryResult StatementExecutor::execSelect(const Select& st, SelectPlan& plan) const {
+    if (plan.analyze) {
+        for (const Access& access : plan.access)
+            measureConjuncts(access);
+    }
+    if (st.join)
+        return execJoin(st, plan);
+    if (isAggregation(st))
+        return execAggregate(st, plan);
+
+    const uint64_t start = readTicks();
+    Cursor cursor = openCursor(st, plan);
+    QueryResult out;
+    out.header = cursor.header();
+    cursor.drain([&](const std::vector<Row>& batch) {
+        out.rows.insert(out.rows.end(), batch.begin(), batch.end());
+    });
+
+    // the cursor ran the read, Filter, Sort and Limit fused
+    const Cursor::Profile& p = cursor.profile();
+    const Access& access = plan.access[0];
+    if (!access.probe)
+        access.readNode->stats = {p.scanned, p.scanned, p.groups, 0, p.filterTicks};
+    if (access.filterNode) {
+        const uint64_t lookup = access.probe ? access.readNode->stats.ticks : 0;
+        access.filterNode->stats = {p.scanned, p.matched, p.groups, 0, lookup + p.filterTicks};
+    }
+    const uint64_t reached = p.pulled + p.skipped; // rows that got past the Sort
+    if (plan.sort)
+        plan.sort->stats = {p.matched, reached, 1, p.sortBytes, p.sortTicks};
+    if (plan.limit)
+        plan.limit->stats = {reached, p.pulled, p.pulls, 0, p.pullTicks};
+    plan.project->stats = {p.pulled, p.pulled, p.pulls,
+                           out.rows.size() * (sizeof(Row) + out.header.size() * sizeof(RowValue)),
+                           readTicks() - start};
+    return out;
+}
+
+// ORDER BY key as written: a column name or an aggregate such as COUNT(*)
+static std::string orderByName(const OrderBy& order) {
+    const auto* column = std::get_if<std::string>(&order.item);
+    return column ? *column : aggregateName(std::get<Aggregate>(order.item));
+}
+
+// ORDER BY / LIMIT over an aggregate or join result; ORDER BY names one of its columns. Records
+// the stats of the sort and limit nodes, where the plan has them.
+static void orderAndLimit(QueryResult& out, const Select& st, PlanNode* sortNode,
+                          PlanNode* limitNode) {
+    const uint64_t start = readTicks();
+    const uint64_t rowsIn = out.rows.size();
+    const std::size_t offset = std::min<uint64_t>(st.offset, out.rows.size());
+    const std::size_t count = std::min<uint64_t>(st.limit.value_or(out.rows.size()),
+                                                 out.rows.size() - offset);
+    if (st.orderBy) {
+        const std::string name = orderByName(*st.orderBy);
+        const auto it = std::find(out.header.begin(), out.header.end(), name);
+        if (it == out.header.end())
+            throw std::invalid_argument("ORDER BY " + name + " is not a result column");
+        const auto col = static_cast<std::size_t>(it - out.header.begin());
+        const bool descending = st.orderBy->descending;
+
+        // ints before strings ("NULL"), ties in result order
+        const auto before = [&](std::size_t a, std::size_t b) {
+            const RowValue& x = out.rows[a].at(col);
+            const RowValue& y = out.rows[b].at(col);
+            if (x.isInt() != y.isInt())
+                return x.isInt();
+            if (!(x == y)) {
+                const bool less = x.isInt() ? x.asInt() < y.asInt() : x.asStr() < y.asStr();
+                return descending ? !less : less;
+            }
+            return a < b;
+        };
+        TopK<std::size_t, decltype(before)> top{offset + count, before};
+        for (std::size_t r = 0; r < out.rows.size(); ++r)
+            top.push(r);
+        const std::vector<std::size_t> order = top.take();
+        std::vector<Row> rows;
+        rows.reserve(count);
+        for (std::size_t k = offset; k < order.size(); ++k)
+            rows.push_back(std::move(out.rows[order[k]]));
+        out.rows = std::move(rows);
+        const uint64_t ticks = readTicks() - start;
+        sortNode->stats = {rowsIn, order.size(), 1, order.capacity() * sizeof(std::size_t), ticks};
+        if (limitNode)
+            limitNode->stats = {order.size(), out.rows.size(), 1, 0, ticks};
+        return;
+    }
+    out.rows.erase(out.rows.begin() + static_cast<std::ptrdiff_t>(offset + count), out.rows.end());
+    out.rows.erase(out.rows.begin(), out.rows.begin() + static_cast<std::ptrdiff_t>(offset));
+    if (limitNode)
+        limitNode->stats = {rowsIn, out.rows.size(), 1, 0, readTicks() - start};
+}
+
+// the items of an aggregate SELECT; plain column names are GROUP BY columns
+static std::vector<SelectItem> aggregateItems(const Select& st) {
+    if (std::holds_alternative<Select::Star>(st.projection))
+        throw std::invalid_argument("SELECT * cannot be grouped, name the columns");
+    if (hasAggregates(st))
+        return std::get<std::vector<SelectItem>>(st.projection);
+    std::vector<SelectItem> items;
+    for (const auto& name : std::get<std::vector<std::string>>(st.projection))
+        items.emplace_back(name);
+    return items;
+}
+
+QueryResult StatementExecutor::execAggregate(const Select& st, const SelectPlan& plan) const {
+    const Access& access = plan.access[0];
+    const Table& tbl = *access.table;
     const Schema& sch = tbl.getSchema();
 
+    // a grouped row is the GROUP BY cells followed by the aggregate cells; cell[k] is where
+    // output column k comes from (planSelect checked every plain column is a GROUP BY one)
     QueryResult out;
+    std::vector<Aggregate> aggregates;
+    std::vector<std::size_t> cell;
+    for (const auto& item : aggregateItems(st)) {
+        if (const auto* name = std::get_if<std::string>(&item)) {
+            const auto key = std::find(st.groupBy.begin(), st.groupBy.end(), *name);
+            cell.push_back(static_cast<std::size_t>(key - st.groupBy.begin()));
+            out.header.push_back(*name);
+        } else {
+            aggregates.push_back(std::get<Aggregate>(item));
+            cell.push_back(st.groupBy.size() + aggregates.size() - 1);
+            out.header.push_back(aggregateName(aggregates.back()));
+        }
+    }
+    const Aggregator agg{std::move(aggregates), sch};
+    const uint64_t start = readTicks();
+    const std::optional<Pred>& pred = access.filter;
+    const auto cand = candidates(access);
 
-    // WHERE predicate
-    std::function<bool(const Row&)> pred =
-        st.where ? compileWhere(*st.where, sch) : [](const Row&) { return true; };
+    // folds the matching rows of every row group into a per-group partial, in parallel; returns
+    // how many rows matched
+    const auto scan = [&](auto& parts, const auto& add) -> uint64_t {
+        if (!pred) {
+            // every row of every group: the columns are read contiguously
+            db_.threadPool().parallelFor(parts.size(), [&](std::size_t g) {
+                add(parts[g], tbl.rowGroup(g), nullptr, tbl.rowGroup(g).size());
+            });
+            recordRead(access, tbl.rowCount(), tbl.rowCount(), 0, start);
+            return tbl.rowCount();
+        }
+        std::vector<uint64_t> matched(parts.size(), 0);
+        tbl.forEachGroupMatch(*pred, cand ? &*cand : nullptr, &db_.threadPool(),
+                              [&](std::size_t g, const std::vector<uint32_t>& sel) {
+                                  matched[g] = sel.size();
+                                  add(parts[g], tbl.rowGroup(g), sel.data(), sel.size());
+                              });
+        const uint64_t rows = std::accumulate(matched.begin(), matched.end(), uint64_t{0});
+        recordRead(access, cand ? cand->size() : tbl.rowCount(), rows,
+                   matched.size() * sizeof(uint64_t), start);
+        return rows;
+    };
 
-    if (std::holds_alternative<Select::Star>(st.projection)) {
-        // header = all columns
-        out.header.reserve(sch.size());
-        for (const auto& c : sch.columns())
-            out.header.push_back(c.name);
+    if (!st.groupBy.empty()) {
+        std::vector<std::size_t> keys;
+        keys.reserve(st.groupBy.size());
+        for (const auto& name : st.groupBy)
+            keys.push_back(sch.require_index(name));
+        const GroupAggregator grouper{tbl, std::move(keys), agg};
+        std::vector<GroupAggregator::Partial> parts(tbl.rowGroupCount());
+        const uint64_t rows = scan(parts, [&](auto&&... args) { grouper.add(args...); });
+        std::vector<Row> grouped = grouper.finish(parts, db_.threadPool());
+        uint64_t bytes = 0;
+        for (const auto& partial : parts) {
+            for (const auto& partition : partial)
+                bytes += partition.bytes();
+        }
+        out.rows.reserve(grouped.size());
+        for (const Row& row : grouped) {
+            std::vector<RowValue> cells;
+            cells.reserve(cell.size());
+            for (const std::size_t c : cell)
+                cells.push_back(row.at(c));
+            out.rows.emplace_back(std::move(cells));
+        }
+        plan.aggregate->stats = {rows, out.rows.size(), parts.size(), bytes, readTicks() - start};
+        orderAndLimit(out, st, plan.sort, plan.limit);
+        return out;
+    }
+
+    Aggregator::State total = agg.state();
+    if (!pred && agg.countsOnly()) {
+        // COUNT(*) over the whole table is known without a scan
+        total.count = tbl.rowCount();
+        plan.aggregate->stats = {total.count, 1, 0, 0, readTicks() - start};
+    } else {
+        std::vector<Aggregator::State> parts(tbl.rowGroupCount(), agg.state());
+        const uint64_t rows = scan(parts, [&](auto&&... args) { agg.add(args...); });
+        for (const auto& part : parts)
+            agg.merge(total, part);
+        const uint64_t bytes =
+            parts.size() * (sizeof(Aggregator::State) +
+                            agg.intColumns().size() * sizeof(IntAccumulator) +
+                            agg.strColumns().size() * sizeof(Aggregator::StrRange));
+        plan.aggregate->stats = {rows, 1, parts.size(), bytes, readTicks() - start};
+    }
+    out.rows.emplace_back(agg.result(total));
+    orderAndLimit(out, st, plan.sort, plan.limit);
+    return out;
+}
+
+// ----------------------- joins -----------------------
+
+namespace {
+
+// The two tables of a JOIN (side 0 is the FROM table) and how column names resolve against
+// them: `table.column`, or a bare name found in exactly one of the tables.
+struct JoinScope {
+    std::array<std::string, 2> tables;
+    std::array<const Schema*, 2> schemas;
+
+    // (side, column index)
+    [[nodiscard]] std::pair<std::size_t, std::size_t> resolve(const std::string& ref) const {
+        if (const auto dot = ref.find('.'); dot != std::string::npos) {
+            for (std::size_t side = 0; side < 2; ++side) {
+                if (ref.compare(0, dot, tables[side]) == 0 && tables[side].size() == dot)
+                    return {side, schemas[side]->require_index(ref.substr(dot + 1))};
+            }
+            throw std::out_of_range("Unknown table in column " + ref);
+        }
+        const auto left = schemas[0]->index_of(ref);
+        const auto right = schemas[1]->index_of(ref);
+        if (left && right)
+            throw std::invalid_argument("Column " + ref + " is ambiguous, qualify it as table." +
+                                        ref);
+        if (!left && !right)
+            throw std::out_of_range("Unknown column " + ref);
+        return left ? std::pair{std::size_t{0}, *left} : std::pair{std::size_t{1}, *right};
+    }
+
+    // bit 0: reads the left table, bit 1: the right one
+    [[nodiscard]] unsigned sidesOf(const WhereExpr& expr) const {
+        if (const auto* c = std::get_if<Comparison>(&expr))
+            return 1u << resolve(c->column).first;
+        if (const auto* a = std::get_if<And>(&expr))
+            return sidesOf(*a->lhs) | sidesOf(*a->rhs);
+        const auto& o = std::get<Or>(expr);
+        return sidesOf(*o.lhs) | sidesOf(*o.rhs);
+    }
+
+    // a copy of expr (on one side only) with plain column names, ready for compileWhere
+    [[nodiscard]] WhereExpr localize(const WhereExpr& expr) const {
+        if (const auto* c = std::get_if<Comparison>(&expr)) {
+            const auto [side, col] = resolve(c->column);
+            return Comparison{schemas[side]->columns()[col].name, c->op, c->literal, c->param};
+        }
+        const auto copy = [&](const auto& node) {
+            std::decay_t<decltype(node)> out;
+            out.lhs = std::make_unique<WhereExpr>(localize(*node.lhs));
+            out.rhs = std::make_unique<WhereExpr>(localize(*node.rhs));
+            return WhereExpr{std::move(out)};
+        };
+        if (const auto* a = std::get_if<And>(&expr))
+            return copy(*a);
+        return copy(std::get<Or>(expr));
+    }
+};
+
+} // namespace
+
+static void splitConjuncts(const WhereExpr& expr, std::vector<const WhereExpr*>& out) {
+    if (const auto* a = std::get_if<And>(&expr)) {
+        splitConjuncts(*a->lhs, out);
+        splitConjuncts(*a->rhs, out);
+    } else {
+        out.push_back(&expr);
+    }
+}
 
-        // rows = full rows
-        out.rows = tbl.getRowsWhere(pred); // <-- assign, no push_back
+// Type-checks a condition that spans both tables, with the same rules as compileWhere.
+static void checkJoinedWhere(const WhereExpr& expr, const JoinScope& scope) {
+    if (const auto* c = std::get_if<Comparison>(&expr)) {
+        const auto [side, col] = scope.resolve(c->column);
+        if (scope.schemas[side]->columns()[col].type == ColumnType::Int) {
+            if (!c->literal.isInt())
+                throw std::invalid_argument("WHERE type mismatch: expected int literal");
+        } else {
+            if (!c->literal.isStr())
+                throw std::invalid_argument("WHERE type mismatch: expected string literal");
+            if (c->op != CompareOp::Eq && c->op != CompareOp::Neq)
+                throw std::invalid_argument("String WHERE supports only = / !=");
+        }
+    } else if (const auto* a = std::get_if<And>(&expr)) {
+        checkJoinedWhere(*a->lhs, scope);
+        checkJoinedWhere(*a->rhs, scope);
     } else {
-        const auto& names = std::get<std::vector<std::string>>(st.projection);
-        const auto indices = compileProjection(st.projection, sch);
+        checkJoinedWhere(*std::get<Or>(expr).lhs, scope);
+        checkJoinedWhere(*std::get<Or>(expr).rhs, scope);
+    }
+}
+
+// Evaluates a checked condition on one joined pair of rows.
+static bool joinedMatches(const WhereExpr& expr, const JoinScope& scope,
+                          const std::array<RowView, 2>& rows) {
+    if (const auto* c = std::get_if<Comparison>(&expr)) {
+        const auto [side, col] = scope.resolve(c->column);
+        if (c->literal.isStr()) {
+            const bool eq = rows[side].strAt(col) == c->literal.asStr();
+            return c->op == CompareOp::Eq ? eq : !eq;
+        }
+        const int64_t v = rows[side].intAt(col);
+        const int64_t rhs = c->literal.asInt();
+        switch (c->op) {
+        case CompareOp::Eq:
+            return v == rhs;
+        case CompareOp::Neq:
+            return v != rhs;
+        case CompareOp::Lt:
+            return v < rhs;
+        case CompareOp::Gt:
+            return v > rhs;
+        case CompareOp::Le:
+            return v <= rhs;
+        case CompareOp::Ge:
+            return v >= rhs;
+        }
+        throw std::logic_error("Unhandled CompareOp");
+    }
+    if (const auto* a = std::get_if<And>(&expr))
+        return joinedMatches(*a->lhs, scope, rows) && joinedMatches(*a->rhs, scope, rows);
+    const auto& o = std::get<Or>(expr);
+    return joinedMatches(*o.lhs, scope, rows) || joinedMatches(*o.rhs, scope, rows);
+}
+
+QueryResult StatementExecutor::execJoin(const Select& st, const SelectPlan& plan) const {
+    const std::array<const Table*, 2> tables{plan.access[0].table, plan.access[1].table};
+    const JoinScope scope{{st.table, st.join->table},
+                          {&tables[0]->getSchema(), &tables[1]->getSchema()}};
+    const std::vector<const WhereExpr*>& residual = plan.residual;
+    const uint64_t start = readTicks();
+
+    std::array<JoinInput, 2> inputs;
+    for (std::size_t side = 0; side < 2; ++side) {
+        const uint64_t sideStart = readTicks();
+        const Access& access = plan.access[side];
+        const auto cand = candidates(access);
+        inputs[side] = {access.table, plan.joinColumns[side],
+                        access.table->getRowIdsWhere(access.filter.value_or(Pred{}),
+                                                     cand ? &*cand : nullptr, &db_.threadPool())};
+        const auto& rows = inputs[side].rows;
+        recordRead(access, cand ? cand->size() : access.table->rowCount(), rows.size(),
+                   rows.capacity() * sizeof(RowId), sideStart);
+    }
+    std::vector<JoinPair> pairs =
+        hashJoin(inputs[0], inputs[1], db_.threadPool(), l2CacheBytes(),
+                 plan.buildSide == 0 ? JoinBuild::Left : JoinBuild::Right);
+    plan.join->stats = {inputs[0].rows.size() + inputs[1].rows.size(), pairs.size(), 1,
+                        pairs.capacity() * sizeof(JoinPair), readTicks() - start};
+
+    const auto rowsOf = [&](const JoinPair& pair) {
+        const auto view = [&](std::size_t side, RowId id) {
+            return tables[side]->rowGroup(rowIdGroup(id)).row(rowIdOffset(id));
+        };
+        return std::array{view(0, pair.first), view(1, pair.second)};
+    };
+    if (!residual.empty()) {
+        const uint64_t rowsIn = pairs.size();
+        if (plan.analyze) {
+            for (const WhereExpr* c : residual) {
+                const auto matched = std::count_if(pairs.begin(), pairs.end(), [&](auto& pair) {
+                    return joinedMatches(*c, scope, rowsOf(pair));
+                });
+                plan.residualFilter->conjuncts.push_back(
+                    {whereToString(*c), rowsIn, static_cast<uint64_t>(matched)});
+            }
+        }
+        const auto rejected = [&](const JoinPair& pair) {
+            const auto rows = rowsOf(pair);
+            return !std::all_of(residual.begin(), residual.end(), [&](const WhereExpr* c) {
+                return joinedMatches(*c, scope, rows);
+            });
+        };
+        pairs.erase(std::remove_if(pairs.begin(), pairs.end(), rejected), pairs.end());
+        plan.residualFilter->stats = {rowsIn, pairs.size(), 1, 0, readTicks() - start};
+    }
 
-        out.header = names;
-        out.rows = tbl.getColumnRowsWhere(indices, pred); // <-- assign, no push_back
+    // output columns: every column of both tables as table.column for *, else the names given
+    QueryResult out;
+    std::vector<std::pair<std::size_t, std::size_t>> columns;
+    if (std::holds_alternative<Select::Star>(st.projection)) {
+        for (std::size_t side = 0; side < 2; ++side) {
+            for (std::size_t c = 0; c < scope.schemas[side]->size(); ++c) {
+                columns.emplace_back(side, c);
+                out.header.push_back(scope.tables[side] + "." +
+                                     scope.schemas[side]->columns()[c].name);
+            }
+        }
+    } else {
+        for (const auto& name : std::get<std::vector<std::string>>(st.projection)) {
+            columns.push_back(scope.resolve(name));
+            out.header.push_back(name);
+        }
     }
 
+    constexpr std::size_t kMorsel = 16384;
+    const std::size_t morsels = (pairs.size() + kMorsel - 1) / kMorsel;
+    out.rows.resize(pairs.size());
+    db_.threadPool().parallelFor(morsels, [&](std::size_t m) {
+        const std::size_t end = std::min(pairs.size(), (m + 1) * kMorsel);
+        for (std::size_t k = m * kMorsel; k < end; ++k) {
+            const auto rows = rowsOf(pairs[k]);
+            std::vector<RowValue> cells;
+            cells.reserve(columns.size());
+            for (const auto& [side, col] : columns)
+                cells.push_back(rows[side].at(col));
+            out.rows[k] = Row{std::move(cells)};
+        }
+    });
+    plan.project->stats = {pairs.size(), out.rows.size(), morsels,
+                           out.rows.size() * (sizeof(Row) + columns.size() * sizeof(RowValue)),
+                           readTicks() - start};
+    orderAndLimit(out, st, plan.sort, plan.limit);
     return out;
 }
 
+// ----------------------- planning -----------------------
+
+static std::string commaList(const std::vector<std::string>& names) {
+    std::string out;
+    for (const auto& name : names)
+        out += (out.empty() ? "" : ", ") + name;
+    return out;
+}
+
+static std::string projectionText(const Select::Projection& proj) {
+    if (const auto* names = std::get_if<std::vector<std::string>>(&proj))
+        return commaList(*names);
+    if (const auto* items = std::get_if<std::vector<SelectItem>>(&proj)) {
+        std::vector<std::string> names;
+        for (const auto& item : *items) {
+            const auto* column = std::get_if<std::string>(&item);
+            names.push_back(column ? *column : aggregateName(std::get<Aggregate>(item)));
+        }
+        return commaList(names);
+    }
+    return "*";
+}
+
+// Sort and Limit for the ORDER BY / LIMIT of st over input; sort / limit are set to the nodes
+static std::unique_ptr<PlanNode> planSortAndLimit(const Select& st,
+                                                  std::unique_ptr<PlanNode> input,
+                                                  PlanNode*& sort, PlanNode*& limit) {
+    if (st.orderBy) {
+        std::string detail = orderByName(*st.orderBy) + (st.orderBy->descending ? " DESC" : " ASC");
+        if (st.limit)
+            detail += " (top-k heap)";
+        input = makePlanNode(PlanOp::Sort, std::move(detail), std::move(input));
+        sort = input.get();
+    }
+    if (st.limit) {
+        std::string detail = std::to_string(*st.limit);
+        if (st.offset != 0)
+            detail += " OFFSET " + std::to_string(st.offset);
+        input = makePlanNode(PlanOp::Limit, std::move(detail), std::move(input));
+        limit = input.get();
+    }
+    return input;
+}
+
+StatementExecutor::Access StatementExecutor::planAccess(const Table& table,
+                                                        const WhereExpr* where) const {
+    Access access;
+    access.table = &table;
+    access.where = where;
+    if (where)
+        access.filter = compileWhere(*where, table);
+    planProbe(access);
+    return access;
+}
+
+void StatementExecutor::planProbe(Access& access) const {
+    const Table& table = *access.table;
+    const WhereExpr* where = access.where;
+    access.probe = where ? planIndex(*where, table) : std::nullopt;
+    const TableStats* stats = table.stats();
+    if (!stats)
+        return;
+
+    const auto rows = static_cast<double>(table.rowCount());
+    access.estimate = table.rowCount();
+    if (where) {
+        access.estimate = static_cast<uint64_t>(
+            std::llround(rows * stats->selectivity(*where, table.getSchema())));
+    }
+    // reading a large share of the table through an index costs more than scanning it
+    if (const auto& probe = access.probe) {
+        const double share =
+            probe->hash ? stats->columns[probe->hash->column()].selectivity(
+                              CompareOp::Eq, probe->key, stats->rows)
+                        : stats->columns[probe->btree->column()].fractionBetween(probe->lo,
+                                                                                 probe->hi);
+        if (share > 0.25)
+            access.probe.reset();
+    }
+}
+
+std::unique_ptr<PlanNode> StatementExecutor::accessNode(const std::string& table,
+                                                        Access& access) {
+    std::unique_ptr<PlanNode> node;
+    if (!access.probe) {
+        node = makePlanNode(PlanOp::Scan, table);
+    } else if (const IndexProbe& probe = *access.probe; probe.hash) {
+        const std::string& column = access.table->getSchema().columns()[probe.hash->column()].name;
+        const Comparison eq{column, CompareOp::Eq, probe.key, std::nullopt};
+        node = makePlanNode(PlanOp::IndexLookup, table + " using " + probe.hash->name() +
+                                                     " (hash): " + whereToString(eq));
+    } else {
+        const std::string& column = access.table->getSchema().columns()[probe.btree->column()].name;
+        std::string range;
+        if (probe.lo > probe.hi)
+            range = "no rows";
+        else if (probe.lo == probe.hi)
+            range = column + " = " + std::to_string(probe.lo);
+        else if (probe.lo == std::numeric_limits<int64_t>::min())
+            range = column + " <= " + std::to_string(probe.hi);
+        else if (probe.hi == std::numeric_limits<int64_t>::max())
+            range = column + " >= " + std::to_string(probe.lo);
+        else
+            range = column + " BETWEEN " + std::to_string(probe.lo) + " AND " +
+                    std::to_string(probe.hi);
+        node = makePlanNode(PlanOp::IndexLookup,
+                            table + " using " + probe.btree->name() + " (btree): " + range);
+    }
+    access.readNode = node.get();
+    // the filter re-checks the whole condition on the rows the index yields
+    if (access.where) {
+        std::string detail = whereToString(*access.where);
+        if (access.estimate)
+            detail += " (estimated " + std::to_string(*access.estimate) + " rows)";
+        node = makePlanNode(PlanOp::Filter, std::move(detail), std::move(node));
+        access.filterNode = node.get();
+    }
+    return node;
+}
+
+void StatementExecutor::pickBuildSide(const Select& st, SelectPlan& plan) {
+    std::array<uint64_t, 2> rows{plan.access[0].table->rowCount(),
+                                 plan.access[1].table->rowCount()};
+    if (plan.access[0].estimate && plan.access[1].estimate)
+        rows = {*plan.access[0].estimate, *plan.access[1].estimate};
+    plan.buildSide = rows[0] < rows[1] ? 0 : 1;
+    std::string& detail = plan.join->detail;
+    detail.erase(std::min(detail.rfind(", build "), detail.size()));
+    detail += ", build " + (plan.buildSide == 0 ? st.table : st.join->table);
+}
+
+StatementExecutor::SelectPlan StatementExecutor::planSelect(const Select& st) const {
+    SelectPlan plan;
+    const Table& tbl = db_.getTable(st.table);
+    const Schema& sch = tbl.getSchema();
+    const WhereExpr* where = st.where ? &*st.where : nullptr;
+
+    if (st.join) {
+        if (isAggregation(st))
+            throw std::invalid_argument("Aggregates and GROUP BY over a JOIN are not supported");
+        if (st.table == st.join->table)
+            throw std::invalid_argument("A table cannot be joined with itself");
+        const Table& other = db_.getTable(st.join->table);
+        const JoinScope scope{{st.table, st.join->table}, {&sch, &other.getSchema()}};
+
+        // ON compares a column of each table, written in either order
+        auto on = std::array{scope.resolve(st.join->left), scope.resolve(st.join->right)};
+        if (on[0].first == on[1].first)
+            throw std::invalid_argument("JOIN ON must compare a column of each table");
+        if (on[0].first == 1)
+            std::swap(on[0], on[1]);
+        plan.joinColumns = {on[0].second, on[1].second};
+
+        // WHERE conjuncts on one table are pushed down into its scan; the others are checked on
+        // the joined pairs
+        if (where) {
+            std::vector<const WhereExpr*> conjuncts;
+            splitConjuncts(*where, conjuncts);
+            for (const WhereExpr* c : conjuncts) {
+                const unsigned sides = scope.sidesOf(*c);
+                if (sides == 3) {
+                    checkJoinedWhere(*c, scope);
+                    plan.residual.push_back(c);
+                    continue;
+                }
+                auto& into = plan.pushed[sides == 1 ? 0 : 1];
+                auto local = std::make_unique<WhereExpr>(scope.localize(*c));
+                if (!into) {
+                    into = std::move(local);
+                    continue;
+                }
+                And both;
+                both.lhs = std::move(into);
+                both.rhs = std::move(local);
+                into = std::make_unique<WhereExpr>(std::move(both));
+            }
+        }
+        if (const auto* names = std::get_if<std::vector<std::string>>(&st.projection)) {
+            for (const auto& name : *names)
+                (void)scope.resolve(name);
+        }
+
+        const std::array<const Table*, 2> tables{&tbl, &other};
+        auto join = makePlanNode(PlanOp::Join,
+                                 scope.tables[0] + "." +
+                                     scope.schemas[0]->columns()[on[0].second].name + " = " +
+                                     scope.tables[1] + "." +
+                                     scope.schemas[1]->columns()[on[1].second].name);
+        for (std::size_t side = 0; side < 2; ++side) {
+            plan.access[side] = planAccess(*tables[side], plan.pushed[side].get());
+            join->children.push_back(accessNode(scope.tables[side], plan.access[side]));
+        }
+        plan.join = join.get();
+        pickBuildSide(st, plan);
+        std::unique_ptr<PlanNode> node = std::move(join);
+        if (!plan.residual.empty()) {
+            std::string detail;
+            for (const WhereExpr* c : plan.residual)
+                detail += (detail.empty() ? "" : " AND ") + whereToString(*c);
+            node = makePlanNode(PlanOp::Filter, std::move(detail), std::move(node));
+            plan.residualFilter = node.get();
+        }
+        node = makePlanNode(PlanOp::Project, projectionText(st.projection), std::move(node));
+        plan.project = node.get();
+        plan.root = planSortAndLimit(st, std::move(node), plan.sort, plan.limit);
+        return plan;
+    }
+
+    if (isAggregation(st)) {
+        std::vector<Aggregate> aggregates;
+        for (const auto& item : aggregateItems(st)) {
+            if (const auto* name = std::get_if<std::string>(&item)) {
+                if (std::find(st.groupBy.begin(), st.groupBy.end(), *name) == st.groupBy.end())
+                    throw std::invalid_argument("Column " + *name +
+                                                " must appear in GROUP BY or inside an aggregate");
+            } else {
+                aggregates.push_back(std::get<Aggregate>(item));
+            }
+        }
+        for (const auto& name : st.groupBy)
+            (void)sch.require_index(name);
+        std::vector<std::string> names;
+        for (const auto& agg : aggregates)
+            names.push_back(aggregateName(agg));
+        const bool countsOnly = Aggregator{std::move(aggregates), sch}.countsOnly();
+
+        std::string detail = commaList(names);
+        if (!st.groupBy.empty())
+            detail += (detail.empty() ? "GROUP BY " : " GROUP BY ") + commaList(st.groupBy);
+        plan.access[0] = planAccess(tbl, where);
+        std::unique_ptr<PlanNode> node;
+        if (!where && countsOnly && st.groupBy.empty()) {
+            // COUNT(*) over the whole table is known without a scan
+            node = makePlanNode(PlanOp::Aggregate, detail + " from the row count");
+        } else {
+            node = makePlanNode(PlanOp::Aggregate, std::move(detail),
+                                accessNode(st.table, plan.access[0]));
+        }
+        plan.aggregate = node.get();
+        plan.root = planSortAndLimit(st, std::move(node), plan.sort, plan.limit);
+        return plan;
+    }
+
+    if (st.orderBy) {
+        const auto* column = std::get_if<std::string>(&st.orderBy->item);
+        if (!column)
+            throw std::invalid_argument("ORDER BY an aggregate needs an aggregate query");
+        (void)sch.require_index(*column);
+    }
+    plan.access[0] = planAccess(tbl, where);
+    if (!std::holds_alternative<Select::Star>(st.projection))
+        plan.projection = compileProjection(st.projection, sch);
+    // the cursor sorts and limits RowIds, and only builds the rows it returns
+    plan.root = makePlanNode(PlanOp::Project, projectionText(st.projection),
+                             planSortAndLimit(st, accessNode(st.table, plan.access[0]), plan.sort,
+                                              plan.limit));
+    plan.project = plan.root.get();
+    return plan;
+}
+
+StatementExecutor::WritePlan StatementExecutor::planUpdate(const Update& st) const {
+    const Table& tbl = db_.getTable(st.table);
+    const Schema& sch = tbl.getSchema();
+    WritePlan plan;
+    // map assignments (by name) to (index, value) and validate types
+    plan.assignments = compileAssignments(st.set, sch);
+    std::vector<std::string> sets;
+    for (const auto& [col, value] : plan.assignments)
+        sets.push_back(
+            whereToString(Comparison{sch.columns()[col].name, CompareOp::Eq, value, std::nullopt}));
+    plan.access = planAccess(tbl, st.where ? &*st.where : nullptr);
+    plan.root = makePlanNode(PlanOp::Update, st.table + " SET " + commaList(sets),
+                             accessNode(st.table, plan.access));
+    return plan;
+}
+
+StatementExecutor::WritePlan StatementExecutor::planDelete(const Delete& st) const {
+    const Table& tbl = db_.getTable(st.table);
+    WritePlan plan;
+    if (!st.where) {
+        plan.root = makePlanNode(PlanOp::Delete, st.table + " (all rows)");
+        return plan;
+    }
+    plan.access = planAccess(tbl, &*st.where);
+    plan.root = makePlanNode(PlanOp::Delete, st.table, accessNode(st.table, plan.access));
+    return plan;
+}
+
+std::unique_ptr<PlanNode> StatementExecutor::plan(const Statement& st) const {
+    if (const auto* select = std::get_if<Select>(&st))
+        return planSelect(*select).root;
+    if (const auto* update = std::get_if<Update>(&st))
+        return planUpdate(*update).root;
+    if (const auto* del = std::get_if<Delete>(&st))
+        return planDelete(*del).root;
+    if (const auto* insert = std::get_if<Insert>(&st)) {
+        const Table& tbl = db_.getTable(insert->tableName);
+        (void)compileInsertColumnOrder(*insert, tbl.getSchema());
+        const std::size_t rows = insert->rows.size();
+        return makePlanNode(PlanOp::Insert, insert->tableName + " (" + std::to_string(rows) +
+                                                (rows == 1 ? " row)" : " rows)"));
+    }
+    throw std::invalid_argument("EXPLAIN supports SELECT, INSERT, UPDATE and DELETE");
+}
+
+std::optional<std::vector<RowId>> StatementExecutor::candidates(const Access& access) const {
+    if (!access.probe)
+        return std::nullopt;
+    const uint64_t start = readTicks();
+    const IndexProbe& probe = *access.probe;
+    std::optional<std::vector<RowId>> ids{std::in_place};
+    if (probe.hash) {
+        // already in storage order, as the Table walks candidates
+        if (const auto* found = probe.hash->find(probe.key))
+            *ids = *found;
+    } else if (probe.lo <= probe.hi) {
+        // a range covering a large share of the table is cheaper to scan than to sort
+        if (probe.btree->range(probe.lo, probe.hi, *ids, access.table->rowCount() / 4))
+            std::sort(ids->begin(), ids->end());
+        else
+            ids.reset();
+    }
+    if (access.readNode) {
+        // a lookup that falls back to a scan hands the whole table on
+        const uint64_t out = ids ? ids->size() : access.table->rowCount();
+        access.readNode->stats = {out, out, 1, ids ? ids->capacity() * sizeof(RowId) : 0,
+                                  readTicks() - start};
+    }
+    return ids;
+}
+
+void StatementExecutor::recordRead(const Access& access, uint64_t scanned, uint64_t matched,
+                                   uint64_t bytes, uint64_t start) {
+    if (!access.readNode)
+        return;
+    const uint64_t ticks = readTicks() - start;
+    const uint64_t groups = access.table->rowGroupCount();
+    if (!access.probe)
+        access.readNode->stats = {scanned, scanned, groups, 0, ticks};
+    if (access.filterNode)
+        access.filterNode->stats = {scanned, matched, groups, bytes, ticks};
+}
+
+void StatementExecutor::measureConjuncts(const Access& access) const {
+    if (!access.filterNode)
+        return;
+    const Table& tbl = *access.table;
+    const auto cand = candidates(access);
+    const uint64_t input = cand ? cand->size() : tbl.rowCount();
+    std::vector<const WhereExpr*> conjuncts;
+    splitConjuncts(*access.where, conjuncts);
+    access.filterNode->conjuncts.clear();
+    for (const WhereExpr* c : conjuncts) {
+        std::vector<uint64_t> matched(tbl.rowGroupCount(), 0);
+        tbl.forEachGroupMatch(compileWhere(*c, tbl), cand ? &*cand : nullptr, &db_.threadPool(),
+                              [&](std::size_t g, const std::vector<uint32_t>& sel) {
+                                  matched[g] = sel.size();
+                              });
+        const uint64_t rows = std::accumulate(matched.begin(), matched.end(), uint64_t{0});
+        access.filterNode->conjuncts.push_back({whereToString(*c), input, rows});
+    }
+}
+
+// ----------------------- prepared statements -----------------------
+
+// f(comparison) for every comparison of expr, in the order they are written
+template <class F> static void forEachComparison(WhereExpr& expr, const F& f) {
+    if (auto* c = std::get_if<Comparison>(&expr)) {
+        f(*c);
+    } else if (auto* a = std::get_if<And>(&expr)) {
+        forEachComparison(*a->lhs, f);
+        forEachComparison(*a->rhs, f);
+    } else {
+        forEachComparison(*std::get<Or>(expr).lhs, f);
+        forEachComparison(*std::get<Or>(expr).rhs, f);
+    }
+}
+
+StatementExecutor::Prepared StatementExecutor::prepare(Statement st) const {
+    if (!std::holds_alternative<Select>(st) && !std::holds_alternative<Insert>(st) &&
+        !std::holds_alternative<Update>(st) && !std::holds_alternative<Delete>(st))
+        throw std::invalid_argument(kNotPreparable);
+    Prepared p;
+    p.statement_ = std::make_unique<Statement>(std::move(st));
+    Statement& stmt = *p.statement_;
+    auto* select = std::get_if<Select>(&stmt);
+    auto* update = std::get_if<Update>(&stmt);
+    auto* del = std::get_if<Delete>(&stmt);
+    auto* insert = std::get_if<Insert>(&stmt);
+
+    // A ? takes the type of the column it is compared with, assigned to or inserted into, and a
+    // value of that type until it is bound, so planning type-checks the statement as usual.
+    const auto typed = [&p](std::size_t param, ColumnType type, RowValue& value) {
+        if (p.types_.size() <= param)
+            p.types_.resize(param + 1, ColumnType::Int);
+        p.types_[param] = type;
+        value = type == ColumnType::Int ? RowValue{int64_t{0}} : RowValue{""};
+    };
+    std::vector<Comparison*> dictLiterals; // become hidden parameters
+    // column(name) -> (table, column index)
+    const auto prepareWhere = [&](WhereExpr& where, const auto& column) {
+        forEachComparison(where, [&](Comparison& c) {
+            const auto [table, idx] = column(c.column);
+            if (c.param)
+                typed(*c.param, table->getSchema().columns()[idx].type, c.literal);
+            else if (table->dictionary(idx) && c.literal.isStr())
+                dictLiterals.push_back(&c);
+        });
+    };
+    const auto columnOf = [](const Table& tbl) {
+        return [&tbl](const std::string& name) {
+            return std::pair{&tbl, tbl.getSchema().require_index(name)};
+        };
+    };
+
+    if (select && select->where) {
+        const Table& tbl = db_.getTable(select->table);
+        if (!select->join) {
+            prepareWhere(*select->where, columnOf(tbl));
+        } else {
+            const std::array<const Table*, 2> tables{&tbl, &db_.getTable(select->join->table)};
+            const JoinScope scope{{select->table, select->join->table},
+                                  {&tables[0]->getSchema(), &tables[1]->getSchema()}};
+            prepareWhere(*select->where, [&](const std::string& name) {
+                const auto [side, idx] = scope.resolve(name);
+                return std::pair{tables[side], idx};
+            });
+        }
+    } else if (update) {
+        const Table& tbl = db_.getTable(update->table);
+        const Schema& sch = tbl.getSchema();
+        for (auto& a : update->set) {
+            if (a.param)
+                typed(*a.param, sch.columns()[sch.require_index(a.column)].type, a.value);
+        }
+        if (update->where)
+            prepareWhere(*update->where, columnOf(tbl));
+    } else if (del && del->where) {
+        prepareWhere(*del->where, columnOf(db_.getTable(del->table)));
+    } else if (insert) {
+        Table& tbl = db_.getTable(insert->tableName);
+        const Schema& sch = tbl.getSchema();
+        p.insertOrder_ = compileInsertColumnOrder(*insert, sch);
+        for (std::size_t k = 0; k < insert->params.size(); ++k) {
+            const auto [row, pos] = insert->params[k];
+            if (pos < p.insertOrder_.size())
+                typed(k, sch.columns()[p.insertOrder_[pos]].type, insert->rows[row][pos]);
+        }
+        // arity and the types of the other values
+        tbl.validateRows(makeRowsForInsert(insert->rows, p.insertOrder_, sch));
+        p.insertInto_ = &tbl;
+    }
+    p.parameters_ = p.types_.size();
+    p.values_.resize(p.parameters_);
+    for (Comparison* c : dictLiterals) {
+        c->param = p.types_.size();
+        p.types_.push_back(ColumnType::Str);
+        p.values_.push_back(c->literal);
+    }
+
+    // plan with every parameter in place, then note where the values are copied to: the AST,
+    // the WHERE conjuncts a JOIN pushed down, the UPDATE assignments, the INSERT rows
+    const auto sitesIn = [&p](WhereExpr* where) {
+        if (!where)
+            return;
+        forEachComparison(*where, [&](Comparison& c) {
+            if (c.param)
+                p.sites_.emplace_back(*c.param, &c.literal);
+        });
+    };
+    if (select) {
+        p.select_ = planSelect(*select);
+        sitesIn(select->where ? &*select->where : nullptr);
+        for (auto& pushed : p.select_->pushed)
+            sitesIn(pushed.get());
+    } else if (update) {
+        p.write_ = planUpdate(*update);
+        sitesIn(update->where ? &*update->where : nullptr);
+        for (std::size_t k = 0; k < update->set.size(); ++k) {
+            if (update->set[k].param)
+                p.sites_.emplace_back(*update->set[k].param, &p.write_->assignments[k].second);
+        }
+    } else if (del) {
+        p.write_ = planDelete(*del);
+        sitesIn(del->where ? &*del->where : nullptr);
+    } else {
+        for (std::size_t k = 0; k < insert->params.size(); ++k) {
+            const auto [row, pos] = insert->params[k];
+            p.sites_.emplace_back(k, &insert->rows[row][pos]);
+        }
+    }
+    return p;
+}
+
+std::vector<std::string> StatementExecutor::Prepared::explain() const {
+    if (select_)
+        return explainLines(*select_->root);
+    if (write_)
+        return explainLines(*write_->root);
+    return {};
+}
+
+std::optional<QueryResult> StatementExecutor::execute(Prepared& prepared,
+                                                      const std::vector<RowValue>& args) const {
+    bindPrepared(prepared, args);
+    return runPrepared(prepared);
+}
+
+void StatementExecutor::bindPrepared(Prepared& prepared,
+                                     const std::vector<RowValue>& args) const {
+    if (args.size() != prepared.parameters_)
+        throw std::invalid_argument("Expected " + std::to_string(prepared.parameters_) +
+                                    " parameters, got " + std::to_string(args.size()));
+    for (std::size_t k = 0; k < args.size(); ++k) {
+        if (!valueTypeMatches(prepared.types_[k], args[k]))
+            throw std::invalid_argument(
+                "Parameter " + std::to_string(k + 1) +
+                (prepared.types_[k] == ColumnType::Int ? " must be an int" : " must be a string"));
+    }
+    std::copy(args.begin(), args.end(), prepared.values_.begin());
+    for (const auto& [param, site] : prepared.sites_)
+        *site = prepared.values_[param];
+
+    // the filters take the new values, and the index lookup may change with them
+    const auto bind = [this, &prepared](Access& access) {
+        if (access.filter)
+            bindFilter(*access.filter, prepared.values_, *access.table);
+        if (access.where)
+            planProbe(access);
+    };
+    if (prepared.select_) {
+        for (Access& access : prepared.select_->access) {
+            if (access.table)
+                bind(access);
+        }
+        // the tables may have grown or shrunk since the last run
+        if (prepared.select_->join)
+            pickBuildSide(std::get<Select>(*prepared.statement_), *prepared.select_);
+    } else if (prepared.write_ && prepared.write_->access.table) {
+        bind(prepared.write_->access);
+    }
+}
+
+std::optional<QueryResult> StatementExecutor::runPrepared(Prepared& prepared) const {
+    Statement& st = *prepared.statement_;
+    if (const auto* select = std::get_if<Select>(&st))
+        return execSelect(*select, *prepared.select_);
+    if (const auto* insert = std::get_if<Insert>(&st)) {
+        execInsert(*insert, *prepared.insertInto_, prepared.insertOrder_);
+        return std::nullopt;
+    }
+    WritePlan& plan = *prepared.write_;
+    if (const auto* update = std::get_if<Update>(&st))
+        (void)execUpdate(*update, plan);
+    else
+        (void)execDelete(std::get<Delete>(st), plan);
+    return std::nullopt;
+}
+
+// ----------------------- plan cache -----------------------
+
+std::optional<QueryResult> StatementExecutor::executeSql(std::string_view sql,
+                                                         const CursorSink& stream) {
+    const Parser parser;
+    const auto streamed = [&stream](const Select& st) {
+        return stream && !isAggregation(st) && !st.join;
+    };
+    const std::optional<Parser::Fingerprint> fp = parser.fingerprint(sql);
+    if (Prepared* prepared = fp ? cachedPlan(*fp) : nullptr) {
+        bindPrepared(*prepared, fp->literals);
+        const auto* select = std::get_if<Select>(prepared->statement_.get());
+        if (!select || !streamed(*select))
+            return runPrepared(*prepared);
+        Cursor cursor = openCursor(*select, *prepared->select_);
+        stream(cursor);
+        return std::nullopt;
+    }
+
+    Statement st = parser.prepareStatement(sql);
+    if (auto* insert = std::get_if<Insert>(&st)) {
+        execInsert(std::move(*insert));
+        return std::nullopt;
+    }
+    const auto* select = std::get_if<Select>(&st);
+    if (!select || !streamed(*select))
+        return execute(st);
+    Cursor cursor = openSelect(*select);
+    stream(cursor);
+    return std::nullopt;
+}
+
+StatementExecutor::Prepared* StatementExecutor::cachedPlan(const Parser::Fingerprint& fp) {
+    // INSERT has nothing to compile, the rest nothing to plan
+    const std::string_view text = fp.text;
+    if (!text.starts_with("SELECT ") && !text.starts_with("UPDATE ") &&
+        !text.starts_with("DELETE "))
+        return nullptr;
+
+    Prepared* prepared = nullptr;
+    if (const auto it = planCacheIndex_.find(text); it != planCacheIndex_.end()) {
+        const auto entry = it->second;
+        const bool current =
+            std::all_of(entry->tables.begin(), entry->tables.end(), [](const auto& t) {
+                return t.first->catalogVersion() == t.second;
+            });
+        if (current) {
+            ++cacheStats_.hits;
+            planCache_.splice(planCache_.begin(), planCache_, entry);
+            prepared = entry->prepared.get();
+        } else {
+            ++cacheStats_.invalidations;
+            planCacheIndex_.erase(it);
+            planCache_.erase(entry);
+        }
+    }
+    if (!prepared) {
+        ++cacheStats_.misses;
+        CachedPlan entry{std::string{text}, {}, nullptr};
+        try {
+            entry.prepared = std::make_unique<Prepared>(
+                prepare(Parser{}.prepareParameterized(entry.fingerprint)));
+        } catch (const std::exception&) {
+            return nullptr; // run as written, for its own result or error
+        }
+        const auto track = [&](const std::string& name) {
+            const Table& tbl = db_.getTable(name);
+            entry.tables.emplace_back(&tbl, tbl.catalogVersion());
+        };
+        const Statement& st = *entry.prepared->statement_;
+        if (const auto* select = std::get_if<Select>(&st)) {
+            track(select->table);
+            if (select->join)
+                track(select->join->table);
+        } else if (const auto* update = std::get_if<Update>(&st)) {
+            track(update->table);
+        } else {
+            track(std::get<Delete>(st).table);
+        }
+        planCache_.push_front(std::move(entry));
+        planCacheIndex_.emplace(planCache_.front().fingerprint, planCache_.begin());
+        if (planCache_.size() > kPlanCacheEntries) {
+            ++cacheStats_.evictions;
+            planCacheIndex_.erase(planCache_.back().fingerprint);
+            planCache_.pop_back();
+        }
+        prepared = planCache_.front().prepared.get();
+    }
+
+    // the same text with, say, a string where the plan has an int: executed as written, it throws
+    if (fp.literals.size() != prepared->parameters_)
+        return nullptr;
+    for (std::size_t k = 0; k < fp.literals.size(); ++k) {
+        if (!valueTypeMatches(prepared->types_[k], fp.literals[k]))
+            return nullptr;
+    }
+    return prepared;
+}
+
 // ----------------------- helper compilers -----------------------
 
 StatementExecutor::Pred StatementExecutor::compileWhere(const WhereExpr& expr,
-                                                        const Schema& schema) const {
-    // comparison node
-    auto cmp = [&](const Comparison& c) -> Pred {
-        const std::size_t idx = schema.require_index(c.column);
-        const ColumnType t = schema.columns().at(idx).type;
+                                                        const Table& table) const {
+    return compileFilter(expr, table);
+}
 
-        if (t == ColumnType::Int) {
-            if (!std::holds_alternative<int64_t>(c.literal))
-                throw std::invalid_argument("WHERE type mismatch: expected int literal");
+// collect the comparisons of the top-level AND chain; anything under an OR is not a conjunct
+static void collectConjuncts(const WhereExpr& expr, std::vector<const Comparison*>& out) {
+    if (const auto* a = std::get_if<And>(&expr)) {
+        collectConjuncts(*a->lhs, out);
+        collectConjuncts(*a->rhs, out);
+    } else if (const auto* c = std::get_if<Comparison>(&expr)) {
+        out.push_back(c);
+    }
+}
+
+std::optional<StatementExecutor::IndexProbe>
+StatementExecutor::planIndex(const WhereExpr& expr, const Table& table) const {
+    if (!table.hasIndexes())
+        return std::nullopt;
+    std::vector<const Comparison*> conjuncts;
+    collectConjuncts(expr, conjuncts);
+    const Schema& schema = table.getSchema();
+
+    // an equality on a hash index pins the rows down directly
+    const TableStats* stats = table.stats();
+    std::optional<IndexProbe> best;
+    double bestShare = 2;
+    for (const auto* c : conjuncts) {
+        if (c->op != CompareOp::Eq)
+            continue;
+        const std::size_t col = schema.require_index(c->column);
+        const HashIndex* index = table.hashIndex(col);
+        if (!index)
+            continue;
+        if (!stats)
+            return IndexProbe{index, nullptr, c->literal};
+        const double share = stats->columns[col].selectivity(c->op, c->literal, stats->rows);
+        if (share < bestShare) {
+            best = IndexProbe{index, nullptr, c->literal};
+            bestShare = share;
+        }
+    }
+    if (best)
+        return best;
+
+    // otherwise intersect every bound on a B-tree indexed column into one [lo, hi] range
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+    for (const auto* first : conjuncts) {
+        const std::size_t col = schema.require_index(first->column);
+        const BTreeIndex* index = table.btreeIndex(col);
+        if (!index || first->op == CompareOp::Neq)
+            continue;
 
-            const int64_t rhs = std::get<int64_t>(c.literal);
-            switch (c.op) {
+        int64_t lo = kMin, hi = kMax;
+        bool empty = false;
+        for (const auto* c : conjuncts) {
+            if (schema.require_index(c->column) != col)
+                continue;
+            const int64_t v = c->literal.asInt();
+            switch (c->op) {
             case CompareOp::Eq:
-                return [=](const Row& r) { return std::get<int64_t>(r.at(idx)) == rhs; };
-            case CompareOp::Neq:
-                return [=](const Row& r) { return std::get<int64_t>(r.at(idx)) != rhs; };
+                lo = std::max(lo, v);
+                hi = std::min(hi, v);
+                break;
             case CompareOp::Lt:
-                return [=](const Row& r) { return std::get<int64_t>(r.at(idx)) < rhs; };
-            case CompareOp::Gt:
-                return [=](const Row& r) { return std::get<int64_t>(r.at(idx)) > rhs; };
+                empty |= v == kMin;
+                hi = std::min(hi, v - (v != kMin));
+                break;
             case CompareOp::Le:
-                return [=](const Row& r) { return std::get<int64_t>(r.at(idx)) <= rhs; };
+                hi = std::min(hi, v);
+                break;
+            case CompareOp::Gt:
+                empty |= v == kMax;
+                lo = std::max(lo, v + (v != kMax));
+                break;
             case CompareOp::Ge:
-                return [=](const Row& r) { return std::get<int64_t>(r.at(idx)) >= rhs; };
-            }
-        } else { // string column
-            if (!std::holds_alternative<std::string>(c.literal))
-                throw std::invalid_argument("WHERE type mismatch: expected string literal");
-
-            const std::string rhs = std::get<std::string>(c.literal);
-            switch (c.op) {
-            case CompareOp::Eq:
-                return [=](const Row& r) { return std::get<std::string>(r.at(idx)) == rhs; };
+                lo = std::max(lo, v);
+                break;
             case CompareOp::Neq:
-                return [=](const Row& r) { return std::get<std::string>(r.at(idx)) != rhs; };
-            default:
-                throw std::invalid_argument("String WHERE supports only = / !=");
+                break;
             }
         }
-
-        throw std::logic_error("Unhandled CompareOp");
-    };
-
-    // recursion
-    return std::visit(
-        [&](const auto& node) -> Pred {
-            using T = std::decay_t<decltype(node)>;
-            if constexpr (std::is_same_v<T, Comparison>) {
-                return cmp(node);
-            } else if constexpr (std::is_same_v<T, And>) {
-                Pred L = compileWhere(*node.lhs, schema);
-                Pred R = compileWhere(*node.rhs, schema);
-                return [L = std::move(L), R = std::move(R)](const Row& r) { return L(r) && R(r); };
-            } else if constexpr (std::is_same_v<T, Or>) {
-                Pred L = compileWhere(*node.lhs, schema);
-                Pred R = compileWhere(*node.rhs, schema);
-                return [L = std::move(L), R = std::move(R)](const Row& r) { return L(r) || R(r); };
-            } else {
-                static_assert(!sizeof(T*), "Unknown WhereExpr alternative");
-            }
-        },
-        expr);
+        if (empty)
+            return IndexProbe{nullptr, index, {}, kMax, kMin};
+        return IndexProbe{nullptr, index, {}, lo, hi};
+    }
+    return std::nullopt;
 }
 
 std::vector<std::size_t> StatementExecutor::compileProjection(const Select::Projection& proj,
@@ -246,32 +1583,39 @@ std::vector<std::size_t> StatementExecutor::compileInsertColumnOrder(const Inser
     return order;
 }
 
-Row StatementExecutor::makeRowForInsert(const std::vector<RowValue>& values,
-                                        const std::vector<std::size_t>& columnOrder,
-                                        const Schema& schema) const {
-    if (values.size() != columnOrder.size())
-        throw std::invalid_argument("INSERT arity mismatch");
-
-    // start with defaults
-    std::vector<RowValue> cells;
-    cells.reserve(schema.size());
-    for (std::size_t i = 0; i < schema.size(); ++i) {
-        cells.push_back(schema.default_value(i));
-    }
-
-    // plug provided values into schema positions
+std::vector<Row>
+StatementExecutor::makeRowsForInsert(std::vector<std::vector<RowValue>> values,
+                                     const std::vector<std::size_t>& columnOrder,
+                                     const Schema& schema) const {
+    // where each schema column's value sits in a VALUES tuple; a repeated column takes the last
+    constexpr std::size_t kOmitted = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> position(schema.size(), kOmitted);
+    bool schemaOrder = columnOrder.size() == schema.size();
     for (std::size_t j = 0; j < columnOrder.size(); ++j) {
-        const std::size_t idx = columnOrder[j];
-        const ColumnType t = schema.columns().at(idx).type;
-        const RowValue& v = values[j];
-
-        if (!valueTypeMatches(t, v))
-            throw std::invalid_argument("INSERT type mismatch");
-
-        cells[idx] = v; // copy RowValue into the right slot
+        position[columnOrder[j]] = j;
+        schemaOrder = schemaOrder && columnOrder[j] == j;
     }
 
-    return Row{std::move(cells)};
+    std::vector<Row> rows;
+    rows.reserve(values.size());
+    for (auto& vals : values) {
+        if (vals.size() != columnOrder.size())
+            throw std::invalid_argument("INSERT arity mismatch");
+        if (schemaOrder) {
+            rows.emplace_back(std::move(vals)); // already laid out
+            continue;
+        }
+        std::vector<RowValue> cells;
+        cells.reserve(schema.size());
+        for (std::size_t i = 0; i < schema.size(); ++i) {
+            if (position[i] == kOmitted)
+                cells.push_back(schema.default_value(i));
+            else
+                cells.push_back(std::move(vals[position[i]]));
+        }
+        rows.emplace_back(std::move(cells));
+    }
+    return rows;
 }
 
 } // namespace memoria
@@ -2,6 +2,7 @@
 #include "memoria/StatementReader.h"
 
 #include <cctype>
+#include <exception>
 #include <istream>
 #include <ostream>
 #include <string>
@@ -205,4 +206,145 @@ std::optional<std::string> StatementReader::next() {
     return last;
 }
 
+bool StatementReader::readPiece(std::string& out) {
+    out.clear();
+    if (in_.peek() == std::istream::traits_type::eof())
+        return false;
+    out.resize(kPieceSize);
+    in_.get(out.data(), static_cast<std::streamsize>(out.size() + 1), '\n');
+    out.resize(static_cast<std::size_t>(in_.gcount()));
+    if (in_.fail() && !in_.eof())
+        in_.clear(); // an empty line: get() stored nothing
+    if (in_.peek() == '\n') {
+        in_.ignore();
+        out.push_back('\n');
+    }
+    return true;
+}
+
+bool StatementReader::skipToStatement() {
+    std::string piece;
+    while (true) {
+        std::size_t i = 0;
+        while (i < buffer_.size()) {
+            const char c = buffer_[i];
+            std::size_t end = i + 1;
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+                continue;
+            }
+            if ((c == '-' || c == '/') && end == buffer_.size())
+                break; // may start a comment
+            if (c == '-' && buffer_[end] == '-') {
+                end = buffer_.find('\n', end);
+                if (end == std::string::npos)
+                    break;
+                i = end + 1;
+            } else if (c == '/' && buffer_[end] == '*') {
+                end = buffer_.find("*/", end + 1);
+                if (end == std::string::npos)
+                    break;
+                i = end + 2;
+            } else {
+                buffer_.erase(0, i);
+                return true;
+            }
+        }
+        buffer_.erase(0, i); // what is left is the start of a comment
+        if (!readPiece(piece))
+            return !buffer_.empty();
+        buffer_ += piece;
+    }
+}
+
+bool StatementReader::streamStatement(std::string_view keyword,
+                                      const std::function<void(std::string_view)>& sink) {
+    if (!skipToStatement())
+        return false;
+    std::string piece;
+    while (buffer_.size() < keyword.size() &&
+           std::string_view{keyword}.starts_with(buffer_) && readPiece(piece))
+        buffer_ += piece;
+    if (!std::string_view{buffer_}.starts_with(keyword))
+        return false;
+
+    std::exception_ptr error;
+    const auto emit = [&](std::string_view text) {
+        if (error || text.empty())
+            return;
+        try {
+            sink(text);
+        } catch (...) {
+            error = std::current_exception(); // read on to the end of the statement
+        }
+    };
+
+    bool inBlock = false, inLine = false, more = true;
+    char quote = 0;
+    std::string text = std::move(buffer_);
+    buffer_.clear();
+    std::string out;
+    while (true) {
+        out.clear();
+        std::size_t i = 0;
+        bool ended = false;
+        for (; i < text.size(); ++i) {
+            const char c = text[i];
+            const bool last = i + 1 == text.size();
+            if (inLine) {
+                if (c == '\n') {
+                    inLine = false;
+                    out.push_back(c);
+                }
+                continue;
+            }
+            if (inBlock) {
+                if (c == '*' && last && more)
+                    break; // a '/' may follow in the next piece
+                if (c == '*' && !last && text[i + 1] == '/') {
+                    inBlock = false;
+                    ++i;
+                }
+                continue;
+            }
+            if (quote) {
+                out.push_back(c);
+                if (c == quote)
+                    quote = 0;
+                continue;
+            }
+            if ((c == '-' || c == '/') && last && more)
+                break; // may start a comment
+            if (c == '\'' || c == '"') {
+                quote = c;
+            } else if (c == '-' && !last && text[i + 1] == '-') {
+                inLine = true;
+                ++i;
+                continue;
+            } else if (c == '/' && !last && text[i + 1] == '*') {
+                inBlock = true;
+                ++i;
+                continue;
+            } else if (c == ';') {
+                ended = true;
+                break;
+            }
+            out.push_back(c);
+        }
+        emit(out);
+        if (ended) {
+            buffer_ = text.substr(i + 1);
+            break;
+        }
+        if (!more)
+            break; // EOF ends the statement too
+        text.erase(0, i); // a character held back, if any
+        more = readPiece(piece);
+        text += piece;
+    }
+    if (error)
+        std::rethrow_exception(error);
+    return true;
+}
+
 } // namespace memoria
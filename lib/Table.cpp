@@ -4,12 +4,16 @@
 
 #include "memoria/Table.h"
 
+#include <algorithm>
 #include <utility>
 namespace memoria {
 
 static bool valueTypeMatches(ColumnType t, const RowValue& v) {
-    return (t == ColumnType::Int && std::holds_alternative<int64_t>(v)) ||
-           (t == ColumnType::Str && std::holds_alternative<std::string>(v));
+    return (t == ColumnType::Int && v.isInt()) || (t == ColumnType::Str && v.isStr());
+}
+
+Table::Table(Schema schema) : schema_(std::move(schema)) {
+    resetDictionaries();
 }
 
 const Schema& Table::getSchema() const noexcept {
@@ -17,7 +21,119 @@ const Schema& Table::getSchema() const noexcept {
 }
 
 std::size_t Table::rowCount() const noexcept {
-    return rows_.size();
+    return rowCount_;
+}
+
+std::size_t Table::rowGroupCount() const noexcept {
+    return groups_.size();
+}
+
+const RowGroup& Table::rowGroup(std::size_t g) const {
+    return *groups_.at(g);
+}
+
+const StrDictionary* Table::dictionary(std::size_t col) const {
+    return dictionaries_.at(col).get();
+}
+
+void Table::createIndex(std::string name, std::size_t column, IndexKind kind) {
+    if (column >= schema_.size())
+        throw std::out_of_range("Index column out of range");
+    for (const auto& index : indexes_) {
+        if (std::visit([](const auto& ix) -> const std::string& { return ix.name(); }, index) ==
+            name)
+            throw std::invalid_argument("Index already exists: " + name);
+    }
+    if (kind == IndexKind::BTree && schema_.columns()[column].type != ColumnType::Int)
+        throw std::invalid_argument("BTREE index requires an int column");
+
+    Index index = kind == IndexKind::BTree ? Index{BTreeIndex{std::move(name), column}}
+                                           : Index{HashIndex{std::move(name), column}};
+    std::visit(
+        [&](auto& ix) {
+            for (std::size_t g = 0; g < groups_.size(); ++g)
+                ix.addGroup(*groups_[g], g);
+        },
+        index);
+    indexes_.push_back(std::move(index));
+    ++catalogVersion_;
+}
+
+const HashIndex* Table::hashIndex(std::size_t column) const noexcept {
+    for (const auto& index : indexes_) {
+        const auto* ix = std::get_if<HashIndex>(&index);
+        if (ix && ix->column() == column)
+            return ix;
+    }
+    return nullptr;
+}
+
+const BTreeIndex* Table::btreeIndex(std::size_t column) const noexcept {
+    for (const auto& index : indexes_) {
+        const auto* ix = std::get_if<BTreeIndex>(&index);
+        if (ix && ix->column() == column)
+            return ix;
+    }
+    return nullptr;
+}
+
+void Table::analyze(ThreadPool* pool) {
+    TableStats stats{schema_};
+    stats.rows = rowCount_;
+    const auto column = [&](std::size_t c) {
+        ColumnStats& out = stats.columns[c];
+        std::vector<int64_t> values; // Int columns, for the histogram
+        std::vector<uint8_t> seen;   // Dictionary columns: codes in use, added once each
+        if (out.type == ColumnType::Int)
+            values.reserve(rowCount_);
+        for (const auto& group : groups_) {
+            std::visit(
+                [&](const auto& col) {
+                    using C = std::decay_t<decltype(col)>;
+                    if constexpr (std::is_same_v<C, IntColumn>) {
+                        const int64_t* data = col.data();
+                        for (std::size_t i = 0; i < col.size(); ++i)
+                            out.add(data[i]);
+                        values.insert(values.end(), data, data + col.size());
+                    } else if constexpr (std::is_same_v<C, StrColumn>) {
+                        for (std::size_t i = 0; i < col.size(); ++i)
+                            out.add(col.at(i));
+                    } else {
+                        seen.resize(dictionaries_[c]->size(), 0);
+                        const uint32_t* codes = col.data();
+                        for (std::size_t i = 0; i < col.size(); ++i)
+                            seen[codes[i]] = 1;
+                    }
+                },
+                group->columns()[c]);
+        }
+        for (uint32_t code = 0; code < seen.size(); ++code) {
+            if (seen[code])
+                out.add(dictionaries_[c]->at(code));
+        }
+        if (out.type == ColumnType::Int)
+            out.histogram = Histogram{std::move(values)};
+    };
+    if (pool && pool->size() > 1) {
+        pool->parallelFor(schema_.size(), column);
+    } else {
+        for (std::size_t c = 0; c < schema_.size(); ++c)
+            column(c);
+    }
+    stats_.emplace(std::move(stats));
+    ++catalogVersion_;
+}
+
+void Table::resetDictionaries() {
+    dictionaries_.assign(schema_.size(), nullptr);
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+        if (schema_.columns()[i].encoding == ColumnEncoding::Dictionary)
+            dictionaries_[i] = std::make_shared<StrDictionary>();
+    }
+}
+
+std::unique_ptr<RowGroup> Table::newGroup(bool presized) const {
+    return std::make_unique<RowGroup>(schema_, dictionaries_, presized);
 }
 
 void Table::insertRow(Row row) {
@@ -32,11 +148,120 @@ void Table::insertRow(Row row) {
             throw std::invalid_argument("Row type mismatch at column " + std::to_string(i));
         }
     }
-    rows_.push_back(std::move(row));
+    if (groups_.empty() || groups_.back()->full()) {
+        // the first group grows on demand so small tables stay small; once a table spills over,
+        // later groups are allocated at full size and never reallocate
+        groups_.push_back(newGroup(!groups_.empty()));
+    }
+    groups_.back()->append(row);
+    const RowId id = makeRowId(groups_.size() - 1, groups_.back()->size() - 1);
+    for (auto& index : indexes_)
+        std::visit([&](auto& ix) { ix.insert(row.at(ix.column()), id); }, index);
+    ++rowCount_;
+    ++version_;
+    if (stats_)
+        stats_->add(row);
+}
+
+void Table::validateRows(const std::vector<Row>& rows) const {
+    for (const Row& row : rows) {
+        if (row.size() != schema_.size())
+            throw std::invalid_argument("Row arity mismatch");
+    }
+    for (std::size_t i = 0; i < schema_.size(); ++i) {
+        const ColumnType type = schema_.columns()[i].type;
+        for (const Row& row : rows) {
+            if (!valueTypeMatches(type, row.at(i)))
+                throw std::invalid_argument("Row type mismatch at column " + std::to_string(i));
+        }
+    }
+}
+
+void Table::insertRows(std::vector<Row> rows) {
+    validateRows(rows);
+    for (std::size_t begin = 0; begin < rows.size();) {
+        if (groups_.empty() || groups_.back()->full())
+            groups_.push_back(newGroup(!groups_.empty()));
+        RowGroup& group = *groups_.back();
+        const std::size_t g = groups_.size() - 1;
+        const std::size_t first = group.size();
+        const std::size_t end = begin + std::min(rows.size() - begin, kRowGroupSize - first);
+        group.append(rows, begin, end);
+        for (auto& index : indexes_) {
+            std::visit(
+                [&](auto& ix) {
+                    for (std::size_t r = begin; r < end; ++r)
+                        ix.insert(rows[r].at(ix.column()), makeRowId(g, first + (r - begin)));
+                },
+                index);
+        }
+        if (stats_) {
+            for (std::size_t r = begin; r < end; ++r)
+                stats_->add(rows[r]);
+        }
+        begin = end;
+    }
+    rowCount_ += rows.size();
+    ++version_;
 }
 
 void Table::deleteAllRows() {
-    rows_.clear();
+    groups_.clear();
+    rowCount_ = 0;
+    ++version_;
+    resetDictionaries(); // nothing references the old codes any more
+    if (stats_)
+        stats_.emplace(schema_);
+    for (auto& index : indexes_)
+        std::visit([](auto& ix) { ix.clear(); }, index);
+}
+
+void Table::validateAssignments(
+    const std::vector<std::pair<std::size_t, RowValue>>& assignments) const {
+    for (const auto& [idx, val] : assignments) {
+        if (idx >= schema_.size())
+            throw std::out_of_range("Assignment column index out of range");
+        if (!valueTypeMatches(schema_.columns().at(idx).type, val))
+            throw std::invalid_argument("Assignment type mismatch");
+    }
+}
+
+void Table::repackGroups() {
+    // both steps renumber groups, which invalidates every RowId held by an index
+    const std::size_t before = groups_.size();
+    std::erase_if(groups_, [](const auto& g) { return g->size() == 0; });
+
+    // rewrite into dense groups only when at least half the allocated group space is empty
+    const std::size_t denseGroups = (rowCount_ + kRowGroupSize - 1) / kRowGroupSize;
+    if (groups_.size() <= 1 || groups_.size() < 2 * denseGroups) {
+        if (groups_.size() != before)
+            rebuildIndexes();
+        return;
+    }
+
+    std::vector<std::unique_ptr<RowGroup>> packed;
+    packed.reserve(denseGroups);
+    for (const auto& group : groups_) {
+        for (std::size_t i = 0, n = group->size(); i < n; ++i) {
+            if (packed.empty() || packed.back()->full())
+                packed.push_back(newGroup(rowCount_ > kRowGroupSize));
+            packed.back()->appendFrom(*group, i);
+        }
+    }
+    groups_ = std::move(packed);
+    rebuildIndexes();
+}
+
+void Table::rebuildIndexes() {
+    for (auto& index : indexes_) {
+        std::visit(
+            [&](auto& ix) {
+                ix.clear();
+                for (std::size_t g = 0; g < groups_.size(); ++g)
+                    ix.addGroup(*groups_[g], g);
+            },
+            index);
+    }
 }
 
-} // namespace memoria
\ No newline at end of file
+} // namespace memoria
@@ -0,0 +1,126 @@
+//
+// Created by Ilya Nyrkov on 20.09.25.
+//
+
+#include "memoria/ThreadPool.h"
+
+#include <stdexcept>
+
+namespace memoria {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0)
+        throw std::invalid_argument("Thread pool needs at least one thread");
+    for (std::size_t q = 0; q < threads; ++q)
+        queues_.push_back(std::make_unique<Queue>());
+    workers_.reserve(threads - 1);
+    for (std::size_t w = 0; w + 1 < threads; ++w)
+        workers_.emplace_back([this, w] { workerLoop(w); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{sleepM_};
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_)
+        t.join();
+}
+
+void ThreadPool::parallelFor(std::size_t n, const std::function<void(std::size_t)>& fn) {
+    if (n == 0)
+        return;
+    if (workers_.empty() || n == 1) {
+        for (std::size_t i = 0; i < n; ++i)
+            fn(i);
+        return;
+    }
+
+    Job job;
+    job.fn = &fn;
+    job.remaining = n;
+
+    // counted before they are queued, so a worker never sees a task it has not been woken for
+    {
+        std::lock_guard lock{sleepM_};
+        pending_ += n;
+    }
+    // contiguous runs per queue: neighbouring morsels (adjacent row groups) stay on one thread
+    // unless they get stolen
+    const std::size_t queues = queues_.size();
+    for (std::size_t q = 0; q < queues; ++q) {
+        const std::size_t begin = n * q / queues;
+        const std::size_t end = n * (q + 1) / queues;
+        std::lock_guard lock{queues_[q]->m};
+        // the owner pops from the back, so push in reverse to run the run in order
+        for (std::size_t i = end; i-- > begin;)
+            queues_[q]->tasks.push_back(Task{&job, i});
+    }
+    wake_.notify_all();
+
+    // help until no morsel is left to take (tasks of concurrent jobs may be run too), then wait
+    // for the ones still running on workers
+    const std::size_t self = queues - 1;
+    Task task{};
+    while (take(self, task))
+        run(task);
+    std::unique_lock lock{job.m};
+    job.done.wait(lock, [&] { return job.remaining == 0; });
+    if (job.error)
+        std::rethrow_exception(job.error);
+}
+
+bool ThreadPool::take(std::size_t self, Task& out) {
+    if (pending_.load(std::memory_order_acquire) == 0)
+        return false;
+    const std::size_t queues = queues_.size();
+    for (std::size_t k = 0; k < queues; ++k) {
+        Queue& q = *queues_[(self + k) % queues];
+        std::lock_guard lock{q.m};
+        if (q.tasks.empty())
+            continue;
+        if (k == 0) {
+            out = q.tasks.back();
+            q.tasks.pop_back();
+        } else {
+            out = q.tasks.front();
+            q.tasks.pop_front();
+        }
+        pending_.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(const Task& task) {
+    Job& job = *task.job;
+    if (!job.failed.load(std::memory_order_acquire)) {
+        try {
+            (*job.fn)(task.index);
+        } catch (...) {
+            if (!job.failed.exchange(true, std::memory_order_acq_rel))
+                job.error = std::current_exception();
+        }
+    }
+    // under the lock: once the caller sees 0 it destroys the job, so this must be the last access
+    std::lock_guard lock{job.m};
+    if (--job.remaining == 0)
+        job.done.notify_all();
+}
+
+void ThreadPool::workerLoop(std::size_t self) {
+    Task task{};
+    while (true) {
+        if (take(self, task)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock lock{sleepM_};
+        wake_.wait(lock, [&] { return stop_ || pending_.load(std::memory_order_acquire) != 0; });
+        if (stop_)
+            return;
+    }
+}
+
+} // namespace memoria
@@ -1,19 +1,44 @@
+#include "memoria/BulkInsert.h"
 #include "memoria/Database.h"
 #include "memoria/Parser.h"
 #include "memoria/Printer.h"
 #include "memoria/StatementExecutor.h"
 #include "memoria/StatementReader.h"
 
-int main() {
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+int main(int argc, char** argv) {
     using namespace memoria;
 
     Database db;
     StatementExecutor exec{db};
-    Parser parser;
 
     StatementReader reader{std::cin};
     Printer printer{std::cout, std::cerr};
 
+    // scans use every core, up to kMaxThreads, unless --threads N says otherwise (SET threads = N
+    // changes it later)
+    int64_t threads = std::clamp<int64_t>(std::thread::hardware_concurrency(), 1,
+                                          StatementExecutor::kMaxThreads);
+    for (int a = 1; a < argc; ++a) {
+        if (std::string_view{argv[a]} == "--threads" && a + 1 < argc) {
+            threads = std::atoll(argv[++a]);
+        } else {
+            printer.printHelpMessage(argv[0]);
+            return 1;
+        }
+    }
+    try {
+        exec.execSet(Set{"threads", threads});
+    } catch (const std::exception& e) {
+        printer.printError(e);
+        return 1;
+    }
+
     std::cout << "memoriadb started" << std::endl;
 
     while (true) {
@@ -21,6 +46,22 @@ int main() {
         if (reader.readsFromCin())
             reader.printPrompt();
 
+        // an INSERT is parsed and stored while it is read, a batch of rows at a time, so a large
+        // one never has to fit in memory as a whole
+        try {
+            BulkInsert writer{exec};
+            InsertStream insert{[&writer](Insert&& batch) { writer.add(std::move(batch)); }};
+            if (reader.streamStatement("INSERT INTO ",
+                                       [&insert](std::string_view text) { insert.feed(text); })) {
+                insert.finish();
+                (void)writer.finish();
+                continue;
+            }
+        } catch (const std::exception& e) {
+            printer.printError(e);
+            continue;
+        }
+
         auto stmtTextOpt = reader.next();
         if (!stmtTextOpt)
             break; // EOF
@@ -30,9 +71,10 @@ int main() {
             continue;
 
         try {
-            auto st = parser.prepareStatement(stmtText);
-
-            auto result = exec.execute(st);
+            // plain SELECTs stream rows to the terminal instead of materialising the result
+            auto result = exec.executeSql(stmtText, [&](Cursor& cursor) {
+                printer.printCursor(cursor);
+            });
             if (result)
                 printer.printQueryResult(*result);
         } catch (const std::exception& e) {
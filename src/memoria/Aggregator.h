@@ -0,0 +1,96 @@
+//
+// Created by Ilya Nyrkov on 21.09.25.
+//
+
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include "Row.h"
+#include "RowGroup.h"
+#include "Schema.h"
+#include "SimdKernels.h"
+#include "Statement.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace memoria {
+
+// Evaluates the aggregates of a SELECT inside the scan: the matching rows of a row group are
+// folded into a State straight from the column arrays and never materialized. Aggregates over
+// the same Int column share one pass of the SIMD aggregate kernel (sum, min and max at once).
+//
+// There are no NULLs: COUNT and SUM of no rows are 0; MIN, MAX and AVG of no rows yield the
+// string "NULL". AVG of an Int column is an Int, truncated toward zero like integer division.
+class Aggregator {
+  public:
+    // throws std::out_of_range for an unknown column, std::invalid_argument for SUM / AVG over
+    // a Str column
+    Aggregator(std::vector<Aggregate> aggregates, const Schema& schema);
+
+    // MIN / MAX of a Str column
+    struct StrRange {
+        std::string_view min, max; // point into the table, valid while it is not modified
+        bool any = false;
+
+        void add(std::string_view v) noexcept {
+            if (!any) {
+                *this = {v, v, true};
+            } else if (v < min) {
+                min = v;
+            } else if (v > max) {
+                max = v;
+            }
+        }
+        void merge(const StrRange& other) noexcept;
+    };
+
+    // partial result over some rows; states of disjoint row sets combine with merge()
+    struct State {
+        uint64_t count = 0;
+        std::vector<IntAccumulator> ints; // per entry of intColumns()
+        std::vector<StrRange> strs;       // per entry of strColumns()
+    };
+
+    [[nodiscard]] State state() const;
+    // rows sel[0, n) of group, or all n first rows when sel is nullptr
+    void add(State& st, const RowGroup& group, const uint32_t* sel, std::size_t n) const;
+    void merge(State& into, const State& from) const;
+    // one cell per aggregate; throws std::overflow_error if a SUM does not fit an int64
+    [[nodiscard]] std::vector<RowValue> result(const State& st) const;
+    // the same from accumulators kept elsewhere (ints / strs laid out like State's), appended
+    void appendResult(uint64_t count, const IntAccumulator* ints, const StrRange* strs,
+                      std::vector<RowValue>& out) const;
+
+    // the columns State::ints / strs accumulate, each at most once
+    [[nodiscard]] const std::vector<std::size_t>& intColumns() const noexcept {
+        return intColumns_;
+    }
+    [[nodiscard]] const std::vector<std::size_t>& strColumns() const noexcept {
+        return strColumns_;
+    }
+
+    [[nodiscard]] const std::vector<Aggregate>& aggregates() const noexcept {
+        return aggregates_;
+    }
+    // true when every aggregate is a count, so the number of matching rows is the whole answer
+    [[nodiscard]] bool countsOnly() const noexcept;
+
+  private:
+    // where an aggregate reads its value from
+    struct Target {
+        enum class Kind : uint8_t { Count, Int, Str } kind;
+        std::size_t slot; // into State::ints / strs
+    };
+
+    std::vector<Aggregate> aggregates_;
+    std::vector<Target> targets_;         // per aggregate
+    std::vector<std::size_t> intColumns_; // column of each ints slot
+    std::vector<std::size_t> strColumns_; // column of each strs slot
+};
+
+} // namespace memoria
+
+#endif // AGGREGATOR_H
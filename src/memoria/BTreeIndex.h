@@ -0,0 +1,92 @@
+//
+// Created by Ilya Nyrkov on 11.09.25.
+//
+
+#ifndef BTREEINDEX_H
+#define BTREEINDEX_H
+
+#include "Row.h"
+#include "RowGroup.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace memoria {
+
+// Ordered index over one Int column: a B+-tree of (key, RowId) entries, answering range scans in
+// O(log n + output). Nodes live in two flat vectors and refer to each other by position; each
+// node keeps its keys in one contiguous array so a node search touches a few cache lines, and
+// leaves are chained for range walks. Like HashIndex it is kept in sync by the Table through
+// insert/addGroup/removeGroup.
+// Erasing never merges nodes: leaves may run under-full (even empty) until occupancy drops below
+// a quarter, at which point the tree is bulk-loaded again from its entries.
+class BTreeIndex {
+  public:
+    BTreeIndex(std::string name, std::size_t column);
+
+    [[nodiscard]] const std::string& name() const noexcept {
+        return name_;
+    }
+    [[nodiscard]] std::size_t column() const noexcept {
+        return column_;
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return size_;
+    }
+
+    void insert(const RowValue& key, RowId id); // key must be an Int
+    void erase(int64_t key, RowId id);
+
+    // appends the RowIds of rows with lo <= key <= hi to out, in key order. Stops and returns
+    // false as soon as more than limit ids would be appended (the caller is better off scanning).
+    bool range(int64_t lo, int64_t hi, std::vector<RowId>& out,
+               std::size_t limit = std::numeric_limits<std::size_t>::max()) const;
+
+    // (un)register every row of group g, which currently holds the data of `group`
+    void addGroup(const RowGroup& group, std::size_t g);
+    void removeGroup(const RowGroup& group, std::size_t g);
+    void clear();
+
+  private:
+    static constexpr std::size_t kLeafSlots = 64;
+    static constexpr std::size_t kInnerSlots = 64; // separators; an inner node has one more child
+    static constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+    struct Leaf {
+        uint32_t count = 0;
+        uint32_t next = kNone; // right sibling
+        int64_t keys[kLeafSlots];
+        RowId ids[kLeafSlots];
+    };
+    // children[j] holds entries below separator j, children[j + 1] those at or above it
+    struct Inner {
+        uint32_t count = 0; // separators in use
+        int64_t keys[kInnerSlots];
+        RowId ids[kInnerSlots];
+        uint32_t children[kInnerSlots + 1];
+    };
+    struct Split {
+        int64_t key;
+        RowId id;
+        uint32_t node; // new right sibling
+    };
+
+    std::string name_;
+    std::size_t column_;
+    std::vector<Leaf> leaves_;
+    std::vector<Inner> inners_;
+    uint32_t root_ = 0;
+    unsigned height_ = 0; // inner levels above the leaves; 0 => root is a leaf
+    std::size_t size_ = 0;
+
+    void insertKey(int64_t key, RowId id);
+    [[nodiscard]] uint32_t findLeaf(int64_t key, RowId id) const;
+    bool insertInto(uint32_t node, unsigned level, int64_t key, RowId id, Split& split);
+    void rebuild();
+};
+
+} // namespace memoria
+
+#endif // BTREEINDEX_H
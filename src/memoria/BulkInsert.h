@@ -0,0 +1,56 @@
+//
+// Created by Ilya Nyrkov on 29.09.25.
+//
+
+#ifndef BULKINSERT_H
+#define BULKINSERT_H
+
+#include "Statement.h"
+#include "StatementExecutor.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace memoria {
+
+// Stores the batches of a streamed INSERT (InsertStream) on a thread of its own, so the caller
+// parses the next batch while the last one is validated and appended (StatementExecutor::
+// execInsert, one batch at a time and in order). add() waits while maxQueued batches are queued,
+// which bounds the rows held in memory. The first batch that fails stops the writer: later ones
+// are dropped and its exception is rethrown by the next add() or by finish().
+// Nothing else may touch the table until finish() has returned.
+class BulkInsert {
+  public:
+    explicit BulkInsert(const StatementExecutor& exec, std::size_t maxQueued = 2);
+    // waits for the queued batches to be stored; their errors are dropped
+    ~BulkInsert();
+    BulkInsert(const BulkInsert&) = delete;
+    BulkInsert& operator=(const BulkInsert&) = delete;
+
+    void add(Insert&& batch);
+    // waits until every batch added is stored; returns the rows inserted
+    std::size_t finish();
+
+  private:
+    const StatementExecutor& exec_;
+    std::size_t maxQueued_;
+
+    std::mutex m_;
+    std::condition_variable changed_;
+    std::deque<Insert> queue_;    // guarded by m_
+    bool closing_ = false;        // guarded by m_
+    std::exception_ptr error_;    // guarded by m_
+    std::size_t rows_ = 0;        // guarded by m_
+    std::thread writer_;          // started by the first add()
+
+    void run();
+    void stop();
+};
+
+} // namespace memoria
+
+#endif // BULKINSERT_H
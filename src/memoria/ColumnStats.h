@@ -0,0 +1,113 @@
+//
+// Created by Ilya Nyrkov on 27.09.25.
+//
+
+#ifndef COLUMNSTATS_H
+#define COLUMNSTATS_H
+
+#include "Row.h"
+#include "Schema.h"
+#include "Statement.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace memoria {
+
+// Distinct-count sketch: 2^kBits one-byte registers, each holding the longest run of leading
+// zeros seen among the hashes routed to it. Standard error is about 1.04 / sqrt(2^kBits) (1.6%).
+class HyperLogLog {
+  public:
+    static constexpr unsigned kBits = 12;
+
+    // hash must be well mixed: the top kBits pick the register
+    void add(uint64_t hash) noexcept;
+    void merge(const HyperLogLog& other) noexcept;
+    [[nodiscard]] uint64_t estimate() const noexcept;
+
+  private:
+    std::array<uint8_t, std::size_t{1} << kBits> registers_{};
+};
+
+// hash of a cell as HyperLogLog::add wants it
+[[nodiscard]] uint64_t statsHash(int64_t v) noexcept;
+[[nodiscard]] uint64_t statsHash(std::string_view v) noexcept;
+
+// Equi-depth histogram of an Int column: buckets of about the same number of values, in value
+// order. A run of equal values never spans two buckets, so bucket ranges do not overlap.
+class Histogram {
+  public:
+    static constexpr std::size_t kBuckets = 32;
+
+    struct Bucket {
+        int64_t lo, hi; // smallest and largest value in the bucket
+        uint64_t rows;
+    };
+
+    Histogram() = default;
+    // over values (any order; sorted in place)
+    explicit Histogram(std::vector<int64_t> values, std::size_t buckets = kBuckets);
+
+    [[nodiscard]] const std::vector<Bucket>& buckets() const noexcept {
+        return buckets_;
+    }
+    [[nodiscard]] uint64_t rows() const noexcept {
+        return rows_;
+    }
+    // share of the values that are <= v, assuming values spread evenly inside a bucket
+    [[nodiscard]] double fractionAtMost(int64_t v) const noexcept;
+
+  private:
+    std::vector<Bucket> buckets_;
+    uint64_t rows_ = 0;
+};
+
+// Statistics of one column. min / max and the distinct sketch follow every value added; the
+// histogram (Int columns) is built by Table::analyze and describes the rows present then.
+struct ColumnStats {
+    ColumnType type;
+    std::optional<RowValue> min, max; // nullopt while no value was added
+    HyperLogLog distinct;
+    Histogram histogram;
+
+    explicit ColumnStats(ColumnType t) : type(t) {}
+
+    void add(int64_t v);
+    void add(std::string_view v);
+    void add(const RowValue& v);
+
+    // Estimated share (0..1) of the table's rows with `column op literal`; rows is the table's
+    // row count, which caps the distinct count.
+    [[nodiscard]] double selectivity(CompareOp op, const RowValue& literal,
+                                     uint64_t rows) const;
+    // estimated share of rows with an Int value in [lo, hi]
+    [[nodiscard]] double fractionBetween(int64_t lo, int64_t hi) const;
+    // distinct values, at most rows
+    [[nodiscard]] uint64_t distinctCount(uint64_t rows) const noexcept;
+
+  private:
+    [[nodiscard]] double fractionAtMost(int64_t v) const;
+};
+
+// Statistics of a Table, collected by Table::analyze and then kept up to date by its mutations
+// where that is cheap (see Table::stats).
+struct TableStats {
+    uint64_t rows = 0;
+    std::vector<ColumnStats> columns; // schema order
+
+    explicit TableStats(const Schema& schema);
+
+    // an inserted row
+    void add(const Row& row);
+
+    // Estimated share of rows satisfying expr: comparisons from their column's statistics (a
+    // guess for one on a ? parameter), AND / OR combined as if their operands were independent.
+    [[nodiscard]] double selectivity(const WhereExpr& expr, const Schema& schema) const;
+};
+
+} // namespace memoria
+
+#endif // COLUMNSTATS_H
@@ -0,0 +1,228 @@
+//
+// Created by Ilya Nyrkov on 02.09.25.
+//
+
+#ifndef COLUMNSTORAGE_H
+#define COLUMNSTORAGE_H
+
+#include "Row.h"
+#include "Schema.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace memoria {
+
+// Int column: one contiguous int64_t array.
+class IntColumn {
+  public:
+    void append(int64_t v) {
+        values_.push_back(v);
+    }
+    [[nodiscard]] int64_t at(std::size_t i) const noexcept {
+        return values_[i];
+    }
+    void set(std::size_t i, int64_t v) noexcept {
+        values_[i] = v;
+    }
+    [[nodiscard]] const int64_t* data() const noexcept {
+        return values_.data();
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return values_.size();
+    }
+
+    void reserve(std::size_t rows) {
+        values_.reserve(rows);
+    }
+    void clear() noexcept;
+    // keep only rows whose flag is non-zero, preserving order
+    void compact(const std::vector<uint8_t>& keep);
+
+  private:
+    std::vector<int64_t> values_;
+};
+
+// Append-only byte arena made of fixed blocks; bytes never move once stored.
+class StringArena {
+  public:
+    static constexpr std::size_t kBlockSize = 64 * 1024;
+
+    // copy v into the arena and return the stored bytes
+    std::string_view store(std::string_view v);
+    [[nodiscard]] std::size_t bytesUsed() const noexcept {
+        return bytesUsed_;
+    }
+    void clear() noexcept;
+
+  private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::size_t blockUsed_ = 0;
+    std::size_t blockCapacity_ = 0;
+    std::size_t bytesUsed_ = 0;
+};
+
+// Str column: one 16-byte StringRef per row; strings longer than StringRef::kInlineSize are
+// stored in the column's arena. Rewritten or deleted bytes stay in the arena until it is
+// collected, which happens once dead bytes outweigh live ones.
+class StrColumn {
+  public:
+    void append(std::string_view v) {
+        refs_.push_back(makeRef(v));
+    }
+    [[nodiscard]] std::string_view at(std::size_t i) const noexcept {
+        return refs_[i].view();
+    }
+    [[nodiscard]] const StringRef& ref(std::size_t i) const noexcept {
+        return refs_[i];
+    }
+    [[nodiscard]] const StringRef* data() const noexcept {
+        return refs_.data();
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return refs_.size();
+    }
+
+    void reserve(std::size_t rows) {
+        refs_.reserve(rows);
+    }
+    void clear() noexcept;
+    void compact(const std::vector<uint8_t>& keep);
+    // overwrite every row whose flag is non-zero with v (long values are stored once)
+    void assign(const std::vector<uint8_t>& mask, std::string_view v);
+
+  private:
+    std::vector<StringRef> refs_;
+    StringArena arena_;
+
+    [[nodiscard]] StringRef makeRef(std::string_view v) {
+        return StringRef{v.size() <= StringRef::kInlineSize ? v : arena_.store(v)};
+    }
+    void collectArena();
+};
+
+// Distinct strings of one dictionary-encoded column, shared by all row groups of a table.
+// Codes are dense (0..size-1) and never reused, so a code stays valid for the table's lifetime.
+class StrDictionary {
+  public:
+    // code of v, adding it if new
+    uint32_t intern(std::string_view v);
+    // code of v if present
+    [[nodiscard]] std::optional<uint32_t> find(std::string_view v) const;
+    [[nodiscard]] std::string_view at(uint32_t code) const noexcept {
+        return *values_[code];
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return values_.size();
+    }
+
+  private:
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view v) const noexcept {
+            return std::hash<std::string_view>{}(v);
+        }
+    };
+    std::unordered_map<std::string, uint32_t, Hash, std::equal_to<>> codes_;
+    std::vector<const std::string*> values_; // code -> key stored in codes_ (nodes are stable)
+};
+
+// Dictionary-encoded Str column: one uint32_t code per row.
+class DictColumn {
+  public:
+    explicit DictColumn(std::shared_ptr<StrDictionary> dict) : dict_(std::move(dict)) {}
+
+    void append(std::string_view v) {
+        codes_.push_back(dict_->intern(v));
+    }
+    // code must come from the same dictionary
+    void appendCode(uint32_t code) {
+        codes_.push_back(code);
+    }
+    [[nodiscard]] std::string_view at(std::size_t i) const noexcept {
+        return dict_->at(codes_[i]);
+    }
+    [[nodiscard]] uint32_t code(std::size_t i) const noexcept {
+        return codes_[i];
+    }
+    [[nodiscard]] const uint32_t* data() const noexcept {
+        return codes_.data();
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return codes_.size();
+    }
+    [[nodiscard]] const StrDictionary& dictionary() const noexcept {
+        return *dict_;
+    }
+
+    void reserve(std::size_t rows) {
+        codes_.reserve(rows);
+    }
+    void clear() noexcept;
+    void compact(const std::vector<uint8_t>& keep);
+    void assign(const std::vector<uint8_t>& mask, std::string_view v);
+
+  private:
+    std::shared_ptr<StrDictionary> dict_;
+    std::vector<uint32_t> codes_;
+};
+
+using ColumnStorage = std::variant<IntColumn, StrColumn, DictColumn>;
+
+// dict is the table-wide dictionary for Dictionary-encoded columns, ignored otherwise
+[[nodiscard]] ColumnStorage makeColumnStorage(const Column& column,
+                                              std::shared_ptr<StrDictionary> dict = nullptr);
+
+// Copy one cell out of a column.
+[[nodiscard]] RowValue cellAt(const ColumnStorage& column, std::size_t row);
+
+// Lightweight read-only view of one stored row; cells are read straight from the column arrays.
+class RowView {
+  public:
+    RowView(const std::vector<ColumnStorage>& columns, std::size_t row) noexcept
+        : columns_(&columns), row_(row) {}
+
+    [[nodiscard]] int64_t intAt(std::size_t col) const {
+        return std::get<IntColumn>((*columns_)[col]).at(row_);
+    }
+    // plain Str columns only
+    [[nodiscard]] const StringRef& strRefAt(std::size_t col) const {
+        return std::get<StrColumn>((*columns_)[col]).ref(row_);
+    }
+    [[nodiscard]] std::string_view strAt(std::size_t col) const {
+        const ColumnStorage& c = (*columns_)[col];
+        if (const auto* dict = std::get_if<DictColumn>(&c))
+            return dict->at(row_);
+        return std::get<StrColumn>(c).at(row_);
+    }
+    [[nodiscard]] uint32_t codeAt(std::size_t col) const {
+        return std::get<DictColumn>((*columns_)[col]).code(row_);
+    }
+    [[nodiscard]] RowValue at(std::size_t col) const {
+        return cellAt(columns_->at(col), row_);
+    }
+    [[nodiscard]] std::size_t size() const noexcept {
+        return columns_->size();
+    }
+    [[nodiscard]] std::size_t index() const noexcept {
+        return row_;
+    }
+    [[nodiscard]] const std::vector<ColumnStorage>& columns() const noexcept {
+        return *columns_;
+    }
+
+  private:
+    const std::vector<ColumnStorage>* columns_;
+    std::size_t row_;
+};
+
+} // namespace memoria
+
+#endif // COLUMNSTORAGE_H
@@ -0,0 +1,148 @@
+//
+// Created by Ilya Nyrkov on 18.09.25.
+//
+
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include "FilterProgram.h"
+#include "Row.h"
+#include "RowGroup.h"
+#include "RowRefs.h"
+#include "Table.h"
+#include "ThreadPool.h"
+#include "Ticks.h"
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace memoria {
+
+// Pull-based SELECT result: filters the table one row group at a time as rows are requested, so
+// only the current group's selection vector and the batch being handed out are held in memory.
+// With a pool, the next pool->size() groups are filtered concurrently whenever the cursor runs
+// out of matches, and held until consumed.
+// A LIMIT stops the scan as soon as enough rows have been handed out. An ORDER BY has to see
+// every match first: the first pull scans them all, keeping only the RowIds of the first
+// OFFSET + LIMIT rows in a TopK heap, and rows are then built from those in order.
+// The table must outlive the cursor. The cursor remembers Table::version() when it is opened: once
+// the table has been modified, pulling throws std::logic_error, and RowRefs handed out before are
+// no longer valid().
+class Cursor {
+  public:
+    static constexpr std::size_t kNoLimit = std::numeric_limits<std::size_t>::max();
+
+    // What the cursor has done so far, for EXPLAIN ANALYZE. Counted per row group or pull, never
+    // per row, so it is always on.
+    struct Profile {
+        uint64_t scanned = 0;     // rows of the filtered groups (candidates only, with an index)
+        uint64_t matched = 0;     // of those, the rows the filter kept
+        uint64_t groups = 0;      // row groups filtered
+        uint64_t filterTicks = 0; // filtering, wall clock
+        uint64_t sortTicks = 0;   // the ORDER BY pass, filtering included
+        uint64_t sortBytes = 0;   // its heap and result
+        uint64_t skipped = 0;     // matches dropped for OFFSET
+        uint64_t pulled = 0;      // rows handed out
+        uint64_t pulls = 0;       // calls that handed out rows
+        uint64_t pullTicks = 0;   // all of them, filtering and sorting included
+    };
+
+    // sort order: one column, ties kept in storage order
+    struct SortKey {
+        std::size_t column;
+        bool descending = false;
+    };
+
+    // projection: column indices to emit, nullopt for every column (SELECT *).
+    // candidates: ascending RowIds to restrict the scan to (index lookup), nullopt for all rows.
+    // pool: filters groups in parallel when it has more than one thread; the cursor shares it, so
+    // it keeps working when the database switches to another pool (SET threads).
+    Cursor(const Table& table, std::vector<std::string> header, FilterProgram filter,
+           std::optional<std::vector<std::size_t>> projection = std::nullopt,
+           std::optional<std::vector<RowId>> candidates = std::nullopt,
+           std::shared_ptr<ThreadPool> pool = nullptr);
+
+    [[nodiscard]] const std::vector<std::string>& header() const noexcept {
+        return header_;
+    }
+
+    // Both only before the first row is pulled; throw std::logic_error afterwards, and orderBy
+    // std::out_of_range for a bad column.
+    void orderBy(SortKey key);
+    // skips offset matching rows, then hands out at most count
+    void limit(std::size_t count, std::size_t offset = 0);
+
+    [[nodiscard]] const Profile& profile() const noexcept {
+        return profile_;
+    }
+
+    // All three throw std::logic_error once the table has been modified since the cursor opened.
+    // next matching row, nullopt once the scan is exhausted
+    [[nodiscard]] std::optional<Row> next();
+    // replaces out with up to maxRows next matching rows; false (and out empty) when exhausted
+    bool nextBatch(std::vector<Row>& out, std::size_t maxRows = FilterProgram::kBatchRows);
+    // the same batch without copying cells: references into the table, empty when exhausted
+    [[nodiscard]] RowRefs nextRefs(std::size_t maxRows = FilterProgram::kBatchRows);
+
+    // push variant: hands every remaining batch to sink(const std::vector<Row>&), returns the
+    // number of rows delivered
+    template <class Sink>
+    std::size_t drain(Sink&& sink, std::size_t maxRows = FilterProgram::kBatchRows) {
+        std::size_t total = 0;
+        std::vector<Row> batch;
+        while (nextBatch(batch, maxRows)) {
+            total += batch.size();
+            sink(static_cast<const std::vector<Row>&>(batch));
+        }
+        return total;
+    }
+
+  private:
+    const Table* table_;
+    std::vector<std::string> header_;
+    FilterProgram filter_;
+    std::optional<std::vector<std::size_t>> projection_;
+    std::optional<std::vector<RowId>> candidates_;
+    std::shared_ptr<ThreadPool> pool_;
+    uint64_t version_; // of the table when the cursor was opened
+
+    std::size_t group_ = 0; // next group to filter
+    // matches of groups waveBase_ + k, filtered ahead
+    std::vector<std::vector<uint32_t>> wave_;
+    std::size_t waveBase_ = 0;
+    std::size_t wavePos_ = 0;   // next of them to move into sel_
+    std::vector<uint32_t> sel_; // matches of the current group
+    std::size_t selPos_ = 0;    // next of them to emit
+    std::size_t currentGroup_ = 0;
+
+    std::optional<SortKey> order_;
+    std::size_t skip_ = 0;                     // matches still to skip for OFFSET
+    std::size_t remaining_ = kNoLimit;         // rows still to hand out for LIMIT
+    bool started_ = false;                     // a row has been pulled
+    std::optional<std::vector<RowId>> sorted_; // the ORDER BY result once computed
+    std::size_t sortedPos_ = 0;
+    Profile profile_;
+
+    // moves to the next group with matches; false when none is left
+    bool advance();
+    // filters the next groups into wave_
+    void fillWave();
+    // returns how many rows the filter looked at
+    std::size_t selectGroup(std::size_t g, std::vector<uint32_t>& sel) const;
+    // scans every match into sorted_
+    void sortAll();
+    template <class Key, class KeyAt>
+    void sortBy(const KeyAt& keyAt);
+    // hands up to maxRows next rows to fn(group, offset); returns how many
+    template <class Fn>
+    std::size_t pull(std::size_t maxRows, const Fn& fn);
+    [[nodiscard]] Row emit(std::size_t group, std::size_t offset) const;
+};
+
+} // namespace memoria
+
+#endif // CURSOR_H
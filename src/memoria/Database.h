@@ -7,7 +7,9 @@
 
 #pragma once
 #include "Table.h"
+#include "ThreadPool.h"
 
+#include <memory>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -21,8 +23,21 @@ class Database {
     [[nodiscard]] const Table& getTable(std::string tableName) const;
     [[nodiscard]] bool hasTable(std::string tableName) const noexcept;
 
+    // engine-wide pool that scans run on; a fresh database is single-threaded
+    [[nodiscard]] ThreadPool& threadPool() const noexcept {
+        return *pool_;
+    }
+    // the same pool for whatever keeps using it across statements (a Cursor): it stays alive
+    // when setThreads replaces it
+    [[nodiscard]] std::shared_ptr<ThreadPool> sharedThreadPool() const noexcept {
+        return pool_;
+    }
+    // replaces the pool; throws std::invalid_argument if threads == 0
+    void setThreads(std::size_t threads);
+
   private:
     std::unordered_map<std::string, Table> tables_;
+    std::shared_ptr<ThreadPool> pool_ = std::make_shared<ThreadPool>(1);
 };
 
 } // namespace memoria
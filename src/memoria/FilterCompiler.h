@@ -0,0 +1,43 @@
+//
+// Created by Ilya Nyrkov on 28.09.25.
+//
+
+#ifndef FILTERCOMPILER_H
+#define FILTERCOMPILER_H
+
+#include "FilterProgram.h"
+#include "Statement.h"
+#include "Table.h"
+
+#include <vector>
+
+namespace memoria {
+
+// Compiles a WHERE over table into a FilterProgram. Throws std::out_of_range on an unknown column
+// and std::invalid_argument on a literal of the wrong type or an ordering test on a string.
+//
+// Literals on dictionary-encoded columns are resolved to codes once, up front. The condition is
+// then rewritten before it is emitted:
+//  - nested AND / OR chains are flattened into one operand list each, and operands known to be
+//    always true or false are dropped or decide the chain;
+//  - AND-ed bounds on the same int column (`a > 5 AND a < 10`) fold into one range test;
+//  - the operands of every chain are ordered so that rejecting (AND) or accepting (OR) rows costs
+//    the least on average: AND by cost / (1 - selectivity), OR by cost / selectivity. Cost is the
+//    test's relative price (string compares cost more than int and code compares), selectivity
+//    the share of rows it accepts, measured on the table's first batch of rows and averaged with
+//    the table statistics (Table::stats) when ANALYZE has run.
+// Ties keep the order the conditions were written in.
+//
+// A comparison with a ? parameter (Comparison::param) compiles to a test whose operand is set
+// later by bindFilter; it takes part in the ordering with a guessed selectivity and is never
+// folded into a range.
+[[nodiscard]] FilterProgram compileFilter(const WhereExpr& expr, const Table& table);
+
+// Sets every ? parameter test of program, compiled for table, to its value in values (indexed by
+// parameter, of the column's type). Strings on dictionary-encoded columns are resolved to codes
+// now, so a value interned since compilation is found.
+void bindFilter(FilterProgram& program, const std::vector<RowValue>& values, const Table& table);
+
+} // namespace memoria
+
+#endif // FILTERCOMPILER_H
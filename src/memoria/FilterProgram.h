@@ -0,0 +1,142 @@
+//
+// Created by Ilya Nyrkov on 13.09.25.
+//
+
+#ifndef FILTERPROGRAM_H
+#define FILTERPROGRAM_H
+
+#include "ColumnStorage.h"
+#include "Row.h"
+#include "RowGroup.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace memoria {
+
+// Typed test on one column. Int* compare an IntColumn with an int64 literal (the six
+// comparisons come first, in IntCompare order), IntBetween checks it lies in an inclusive range,
+// Code* compare a DictColumn with a dictionary code, Str* a plain StrColumn with a string literal.
+enum class FilterOp : uint8_t {
+    IntEq,
+    IntNe,
+    IntLt,
+    IntGt,
+    IntLe,
+    IntGe,
+    IntBetween,
+    CodeEq,
+    CodeNe,
+    StrEq,
+    StrNe,
+};
+
+struct FilterInstr {
+    FilterOp op;
+    uint32_t column;
+    uint32_t onTrue; // next instruction, or FilterProgram::kAccept / kReject
+    uint32_t onFalse;
+    int64_t operand; // int literal, dictionary code, or index of a string literal or range
+};
+
+// IntBetween operand: lo <= v && v <= lo + span, tested as one unsigned compare of v - lo
+struct IntRange {
+    int64_t lo;
+    uint64_t span;
+};
+
+// An instruction whose operand is a ? parameter of a prepared statement
+struct FilterParam {
+    uint32_t instr;
+    std::size_t param;
+};
+
+// Compiled WHERE: a flat array of column tests, each naming the instruction to continue with on
+// success and on failure, so AND/OR short-circuit by jumping instead of nesting calls. Every jump
+// goes forward; a row matches when control reaches kAccept.
+// Built back to front by the WHERE compiler: emit* returns the new instruction's index and takes
+// already-known targets, finish() fixes the entry point. A default program accepts every row.
+//
+// Evaluation binds the program to a row group first (column arrays resolved once, no variant
+// checks per row), then works through the group in batches of kBatchRows: each test is evaluated
+// over a column slice into a bitmask, and AND/OR become bitwise ops routing those masks along the
+// jumps. Single rows go through a small interpreter.
+class FilterProgram {
+  public:
+    static constexpr uint32_t kAccept = std::numeric_limits<uint32_t>::max() - 1;
+    static constexpr uint32_t kReject = std::numeric_limits<uint32_t>::max();
+    static constexpr std::size_t kBatchRows = 2048;
+
+    uint32_t emit(FilterOp op, std::size_t column, int64_t operand, uint32_t onTrue,
+                  uint32_t onFalse);
+    uint32_t emitStr(FilterOp op, std::size_t column, RowValue literal, uint32_t onTrue,
+                     uint32_t onFalse);
+    // IntBetween over [lo, hi], lo <= hi
+    uint32_t emitRange(std::size_t column, int64_t lo, int64_t hi, uint32_t onTrue,
+                       uint32_t onFalse);
+    // marks instruction pc (as returned by emit / emitStr) as reading ? parameter param
+    void markParam(uint32_t pc, std::size_t param);
+    // entry: the instruction to start at, or a label if the whole expression folded to a constant
+    void finish(uint32_t entry);
+
+    [[nodiscard]] const std::vector<FilterInstr>& instructions() const noexcept {
+        return instrs_;
+    }
+
+    // Rebinding: the instructions reading ? parameters, and setters for their operand, an int
+    // literal or dictionary code (bindOperand) or the string literal of a Str* test (bindString).
+    // A bound program must not be rebound while it is being evaluated.
+    [[nodiscard]] const std::vector<FilterParam>& params() const noexcept {
+        return params_;
+    }
+    void bindOperand(const FilterParam& p, int64_t operand) noexcept {
+        instrs_[p.instr].operand = operand;
+    }
+    void bindString(const FilterParam& p, RowValue literal) {
+        strings_[static_cast<std::size_t>(instrs_[p.instr].operand)] = std::move(literal);
+    }
+
+    // a program resolved against one row group's columns
+    class Bound {
+      public:
+        [[nodiscard]] bool operator()(std::size_t row) const;
+        // offsets of every matching row of the group, ascending
+        void select(std::vector<uint32_t>& sel) const;
+        // keeps the offsets of sel (ascending, e.g. index candidates) whose rows match
+        void refine(std::vector<uint32_t>& sel) const;
+
+      private:
+        friend class FilterProgram;
+        Bound(const FilterProgram& program, const RowGroup& group);
+
+        // appends matching offsets among the rows set in seed (a group-wide bitmap; nullptr means
+        // every row)
+        void evaluate(const uint64_t* seed, std::vector<uint32_t>& sel) const;
+
+        const FilterProgram* program_;
+        std::size_t rows_;
+        std::vector<const void*> columns_; // per instruction, the array it reads
+    };
+
+    [[nodiscard]] Bound bind(const RowGroup& group) const {
+        return Bound{*this, group};
+    }
+
+    // single-row evaluation for callers outside a group scan
+    [[nodiscard]] bool operator()(const RowView& row) const;
+
+  private:
+    std::vector<FilterInstr> instrs_;
+    std::vector<RowValue> strings_; // Str* literals
+    std::vector<IntRange> ranges_;  // IntBetween ranges
+    std::vector<FilterParam> params_;
+    uint32_t entry_ = kAccept;
+
+    // columnFor(pc) yields the array instruction pc reads
+    template <class ColumnFor> [[nodiscard]] bool run(ColumnFor columnFor, std::size_t row) const;
+};
+
+} // namespace memoria
+
+#endif // FILTERPROGRAM_H
@@ -0,0 +1,92 @@
+//
+// Created by Ilya Nyrkov on 22.09.25.
+//
+
+#ifndef GROUPAGGREGATOR_H
+#define GROUPAGGREGATOR_H
+
+#include "Aggregator.h"
+#include "ColumnStorage.h"
+#include "Row.h"
+#include "RowGroup.h"
+#include "SimdKernels.h"
+#include "Table.h"
+#include "ThreadPool.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace memoria {
+
+// GROUP BY as a partitioned hash aggregation. Every morsel (row group) is pre-aggregated into a
+// Partial of its own, so the scan threads share nothing; the key of a row is hashed once and the
+// top bits of that hash pick one of kPartitions open-addressing tables. finish() then merges the
+// partials partition by partition in parallel, reusing the stored hashes.
+//
+// Keys are packed into 64-bit words: an Int is its value, a Dictionary string its code and a
+// plain Str a pointer / length pair into the table, so no key is copied before the output.
+// Output rows hold the key cells (in key order) followed by the aggregate cells; groups come out
+// in a deterministic but unspecified order.
+class GroupAggregator {
+  public:
+    static constexpr std::size_t kPartitionBits = 4;
+    static constexpr std::size_t kPartitions = std::size_t{1} << kPartitionBits;
+
+    // keys: the GROUP BY columns, at least one; aggregator must outlive this
+    GroupAggregator(const Table& table, std::vector<std::size_t> keys,
+                    const Aggregator& aggregator);
+
+    class Partition {
+        friend class GroupAggregator;
+        std::vector<uint32_t> slots_;            // group + 1, 0 if free; a power of two of them
+        std::vector<uint64_t> hashes_;           // per group
+        std::vector<uint64_t> keys_;             // per group, keyWords_ each
+        std::vector<uint64_t> counts_;           // per group
+        std::vector<IntAccumulator> ints_;       // per group, one per Aggregator::intColumns()
+        std::vector<Aggregator::StrRange> strs_; // per group, one per Aggregator::strColumns()
+
+      public:
+        [[nodiscard]] std::size_t groups() const noexcept {
+            return hashes_.size();
+        }
+        // memory held by the table and the group states
+        [[nodiscard]] std::size_t bytes() const noexcept {
+            return slots_.capacity() * sizeof(uint32_t) +
+                   (hashes_.capacity() + keys_.capacity() + counts_.capacity()) * sizeof(uint64_t) +
+                   ints_.capacity() * sizeof(IntAccumulator) +
+                   strs_.capacity() * sizeof(Aggregator::StrRange);
+        }
+    };
+    // the groups of one morsel
+    using Partial = std::array<Partition, kPartitions>;
+
+    // rows sel[0, n) of group, or all n first rows when sel is nullptr
+    void add(Partial& partial, const RowGroup& group, const uint32_t* sel, std::size_t n) const;
+    // merges partials and builds one row per group; throws std::overflow_error like Aggregator
+    [[nodiscard]] std::vector<Row> finish(const std::vector<Partial>& partials,
+                                          ThreadPool& pool) const;
+
+  private:
+    struct Key {
+        enum class Kind : uint8_t { Int, Code, Str } kind;
+        std::size_t column;
+        std::size_t word;          // first word in the packed key
+        const StrDictionary* dict; // Code keys only
+    };
+
+    const Aggregator* aggregator_;
+    std::vector<Key> keys_;
+    std::size_t keyWords_ = 0;
+    bool bitwiseKeys_ = true; // no Str key: packed keys are equal iff their words are
+
+    [[nodiscard]] bool keysEqual(const uint64_t* a, const uint64_t* b) const noexcept;
+    // index of the group with this key in part, inserted (empty) if new
+    uint32_t findOrInsert(Partition& part, uint64_t hash, const uint64_t* key) const;
+    static void grow(Partition& part);
+};
+
+} // namespace memoria
+
+#endif // GROUPAGGREGATOR_H
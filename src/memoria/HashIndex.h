@@ -0,0 +1,52 @@
+//
+// Created by Ilya Nyrkov on 09.09.25.
+//
+
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include "Row.h"
+#include "RowGroup.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace memoria {
+
+struct RowValueHash {
+    std::size_t operator()(const RowValue& v) const noexcept;
+};
+
+// Equality index over one column: key -> RowIds of the rows holding it, ascending, so the ids of
+// one row group are a contiguous run. Maintained by Table on every mutation; the Table calls
+// removeGroup/addGroup around anything that shifts a group, which touch only that group's run.
+class HashIndex {
+  public:
+    HashIndex(std::string name, std::size_t column) : name_(std::move(name)), column_(column) {}
+
+    [[nodiscard]] const std::string& name() const noexcept {
+        return name_;
+    }
+    [[nodiscard]] std::size_t column() const noexcept {
+        return column_;
+    }
+
+    void insert(const RowValue& key, RowId id);
+    // rows holding key (ascending), nullptr if none
+    [[nodiscard]] const std::vector<RowId>* find(const RowValue& key) const;
+
+    // (un)register every row of group g, which currently holds the data of `group`
+    void addGroup(const RowGroup& group, std::size_t g);
+    void removeGroup(const RowGroup& group, std::size_t g);
+    void clear() noexcept;
+
+  private:
+    std::string name_;
+    std::size_t column_;
+    std::unordered_map<RowValue, std::vector<RowId>, RowValueHash> map_;
+};
+
+} // namespace memoria
+
+#endif // HASHINDEX_H
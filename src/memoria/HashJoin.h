@@ -0,0 +1,56 @@
+//
+// Created by Ilya Nyrkov on 24.09.25.
+//
+
+#ifndef HASHJOIN_H
+#define HASHJOIN_H
+
+#include "RowGroup.h"
+#include "Table.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace memoria {
+
+// One side of an equi-join: the rows taking part (WHERE conditions on this table already
+// applied) and the column they are joined on.
+struct JoinInput {
+    const Table* table;
+    std::size_t column;
+    std::vector<RowId> rows;
+};
+
+// (left RowId, right RowId) of two rows with equal join keys
+using JoinPair = std::pair<RowId, RowId>;
+
+// Which input hashJoin builds into its hash table; the other one probes it.
+enum class JoinBuild : uint8_t {
+    Smaller, // the input with fewer rows
+    Left,
+    Right,
+};
+
+// Size of the per-core L2 cache, or a 1 MiB guess where it cannot be queried.
+[[nodiscard]] std::size_t l2CacheBytes() noexcept;
+
+// Joins left.rows and right.rows on left.column = right.column; the key columns must be both Int
+// or both Str (std::invalid_argument otherwise). The side build picks is built into a chained
+// hash table and the other side probes it.
+//
+// If that hash table would not fit in cacheBytes, both sides are first radix-partitioned on the
+// key hash so that each partition's table does, and each partition is built and probed on its
+// own. Builds run in parallel on pool, and probes in morsels of probe rows. Pairs come out in a
+// deterministic order that does not depend on the pool size: by partition, then probe row,
+// then build row (both in storage order).
+[[nodiscard]] std::vector<JoinPair> hashJoin(const JoinInput& left, const JoinInput& right,
+                                             ThreadPool& pool,
+                                             std::size_t cacheBytes = l2CacheBytes(),
+                                             JoinBuild build = JoinBuild::Smaller);
+
+} // namespace memoria
+
+#endif // HASHJOIN_H
@@ -0,0 +1,72 @@
+//
+// Created by Ilya Nyrkov on 30.09.25.
+//
+
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace memoria {
+
+enum class TokenKind : uint8_t {
+    End,    // after the last token
+    Word,   // identifier or keyword: [A-Za-z_][A-Za-z0-9_]*
+    Int,    // digits with an optional sign
+    String, // '...' or "..."; text is what is between the quotes
+    Param,  // ?
+    LParen,
+    RParen,
+    Comma,
+    Dot,
+    Star,
+    Semicolon,
+    Eq,
+    Neq,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+};
+
+// Words the grammar gives a meaning to. A keyword is still a Word token and can be an identifier
+// wherever the grammar expects one.
+enum class Keyword : uint8_t {
+    None,
+    Select, From, Where, And, Or, Insert, Into, Values, Create, Table, Index, On, Using,
+    Delete, Update, Set, Join, Group, Order, By, Asc, Desc, Limit, Offset, Analyze, Show, Stats,
+    Explain, Prepare, As, Execute, Deallocate,
+    Int, Str, Dict, Hash, BTree, Count, Sum, Min, Max, Avg,
+};
+
+struct Token {
+    TokenKind kind = TokenKind::End;
+    Keyword keyword = Keyword::None; // Word: the keyword it spells in any case
+    bool upper = false;              // Word: keyword spelled in upper case, as statements need it
+    std::string_view text;           // a view into the tokenized source
+    std::size_t pos = 0;             // offset of the token in the source
+};
+
+// Splits SQL text into tokens in one pass without copying: every token is a view into the text,
+// which must outlive them. out is cleared first and ends with an End token. Throws ParseError on
+// a character that starts no token and on an unterminated string.
+void tokenize(std::string_view sql, std::vector<Token>& out);
+[[nodiscard]] inline std::vector<Token> tokenize(std::string_view sql) {
+    std::vector<Token> out;
+    tokenize(sql, out);
+    return out;
+}
+
+// The keyword word spells, ignoring case, or Keyword::None. A perfect hash of the word's length
+// and first, second and last letter picks the only candidate, which is then compared.
+[[nodiscard]] Keyword lookupKeyword(std::string_view word) noexcept;
+
+// The keyword as statements spell it ("SELECT", "BTREE", ...)
+[[nodiscard]] std::string_view keywordText(Keyword kw) noexcept;
+
+} // namespace memoria
+
+#endif // LEXER_H
@@ -5,7 +5,10 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <memoria/Lexer.h>
 #include <memoria/Statement.h>
+#include <functional>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -20,36 +23,73 @@ class Parser {
   public:
     Parser() = default;
 
-    // parse one sql statement
+    // parse one sql statement; ? placeholders are only accepted inside PREPARE
     [[nodiscard]] Statement prepareStatement(std::string_view sql) const;
 
+    // parse one sql statement whose values may be ? placeholders, numbered from 0 in the order
+    // they appear; for StatementExecutor::prepare
+    [[nodiscard]] Statement prepareParameterized(std::string_view sql) const;
+
+    // A statement with its literals taken out: the text with every int and string literal
+    // replaced by ?, whitespace outside quotes collapsed and the trailing ; dropped, and the
+    // literals in the order they appear. Statements that differ only in their values share the
+    // text, which prepareParameterized parses. LIMIT / OFFSET counts stay in the text.
+    struct Fingerprint {
+        std::string text;
+        std::vector<RowValue> literals;
+    };
+    // nullopt if sql already has a ?, an unterminated string or an int out of range
+    [[nodiscard]] std::optional<Fingerprint> fingerprint(std::string_view sql) const;
+
     // parse multiple sql statements
     [[nodiscard]] std::vector<Statement> prepareStatements(std::string_view script) const;
 
   private:
-    // ---------- low-level helpers (pure string munging) ----------
-    [[nodiscard]] static std::string trimLeft(std::string_view s);
-
-    [[nodiscard]] static std::vector<std::string> splitOutsideQuotes(std::string_view script);
-
     // remove surrounding spaces and trailing ;
-    [[nodiscard]] static std::string normalizeOne(std::string_view s);
+    [[nodiscard]] static std::string_view normalizeOne(std::string_view s);
 
-    // ---------- mid-level extraction ----------
+    // one statement (tokenized in one pass, then parsed by recursive descent over the tokens),
+    // placeholders numbered only inside PREPARE
+    [[nodiscard]] static Statement parseStatement(std::string_view sql);
+};
 
-    // Extract WHERE clause (if any) from the full normalized statement text
-    // and return {base_without_where, where_text}.
-    [[nodiscard]] static std::pair<std::string, std::optional<std::string>>
-    peelWhere(std::string_view normalized);
+// Incremental parser of one INSERT INTO ... VALUES statement whose text arrives in pieces of any
+// size (feed, then finish). Instead of building the whole Insert::rows, VALUES tuples are handed
+// to the sink as soon as batchRows of them are complete, each batch as an Insert of its own with
+// the statement's table and column names. Only the text of the tuple being read and the current
+// batch are held, so memory does not grow with the statement.
+// Throws ParseError as Parser::prepareStatement would; batches handed on before stay handed on.
+class InsertStream {
+  public:
+    using Sink = std::function<void(Insert&&)>;
+    static constexpr std::size_t kBatchRows = 4096;
+
+    explicit InsertStream(Sink sink, std::size_t batchRows = kBatchRows);
 
-    [[nodiscard]] static Statement parseBase(std::string_view base);
+    // the next piece of the statement's text (comment-free, without the ending ;)
+    void feed(std::string_view text);
+    // the statement is complete: hands on the last batch; throws if it was cut short
+    void finish();
 
-    [[nodiscard]] static WhereExpr parseWhere(std::string_view whereTail);
+    // tuples parsed so far
+    [[nodiscard]] std::size_t rows() const noexcept {
+        return rows_;
+    }
 
-    // ---------- tiny utilities ----------
-    [[nodiscard]] static bool ieqPrefix(std::string_view s,
-                                        std::string_view kw); // case-sensitive keywords if you
-                                                              // want: set to strict eq if needed
+  private:
+    Sink sink_;
+    std::size_t batchRows_;
+    std::string text_;           // fed, from the first character not parsed yet
+    std::size_t scan_ = 0;       // in text_: how far the end of the next tuple was looked for
+    char quote_ = 0;             // quote open at scan_
+    std::optional<Insert> batch_; // once the header is parsed: it, and the rows of the batch
+    std::vector<Token> tokens_;  // of the tuple being parsed, kept for their capacity
+    bool afterRow_ = false;      // a tuple was parsed last, a ',' or the end comes next
+    std::size_t rows_ = 0;
+
+    // parses what text_ holds in full; last: nothing more will come
+    void parse(bool last);
+    void flush();
 };
 
 } // namespace memoria
@@ -0,0 +1,82 @@
+//
+// Created by Ilya Nyrkov on 25.09.25.
+//
+
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "Statement.h"
+#include "Ticks.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace memoria {
+
+enum class PlanOp : uint8_t {
+    Scan,        // every row of a table
+    IndexLookup, // the rows a hash or B-tree index yields for part of the WHERE
+    Filter,      // rows of the input that satisfy a condition
+    Project,     // output columns
+    Aggregate,   // aggregates, per group with GROUP BY
+    Sort,        // ORDER BY, as a top-k heap under a LIMIT
+    Limit,       // LIMIT / OFFSET
+    Join,        // hash equi-join of its two inputs
+    Insert,
+    Update,
+    Delete,
+};
+
+// "Scan", "IndexLookup", ...
+[[nodiscard]] const char* planOpName(PlanOp op) noexcept;
+
+// What an operator did while its statement ran. Operators run fused (a Filter evaluates inside
+// its Scan, a LIMIT stops the scan under it), so ticks are inclusive of the inputs, and fused
+// operators report the same time.
+struct PlanStats {
+    uint64_t rowsIn = 0;
+    uint64_t rowsOut = 0;
+    uint64_t batches = 0; // row groups, morsels or output batches the operator went through
+    uint64_t bytes = 0;   // size of the buffers it materialized (selection, heap, result rows)
+    uint64_t ticks = 0;   // readTicks() elapsed, wall clock
+};
+
+// Rows of a Filter's input that satisfy one top-level AND conjunct on its own.
+struct ConjunctStats {
+    std::string condition;
+    uint64_t rowsIn = 0;
+    uint64_t rowsOut = 0;
+};
+
+// One operator of a physical plan. Rows flow from the children (the inputs; a Join has the FROM
+// table first) to the parent; detail says what the operator does in SQL terms.
+struct PlanNode {
+    PlanOp op;
+    std::string detail;
+    std::vector<std::unique_ptr<PlanNode>> children;
+    PlanStats stats;                      // filled in as the plan runs
+    std::vector<ConjunctStats> conjuncts; // Filter under EXPLAIN ANALYZE only
+};
+
+// a node over input (none when null)
+[[nodiscard]] std::unique_ptr<PlanNode>
+makePlanNode(PlanOp op, std::string detail, std::unique_ptr<PlanNode> input = nullptr);
+
+// A condition as it would be written in SQL: `age > 18 AND (city = "Paris" OR id = 1)`.
+[[nodiscard]] std::string whereToString(const WhereExpr& expr);
+
+// The plan as EXPLAIN prints it, one operator per line, root first and every input indented
+// under its consumer:
+//   Limit 10
+//     -> Scan Users
+// With nsPerTick (EXPLAIN ANALYZE) every line also shows the operator's PlanStats, and a Filter
+// the selectivity of each of its conjuncts on a line of its own.
+[[nodiscard]] std::vector<std::string>
+explainLines(const PlanNode& root, std::optional<double> nsPerTick = std::nullopt);
+
+} // namespace memoria
+
+#endif // PLAN_H
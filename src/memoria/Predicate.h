@@ -8,9 +8,11 @@
 #include <functional>
 
 namespace memoria {
-class Row;
+class RowView;
 
-using Predicate = std::function<bool(const Row&)>;
+// Type-erased row predicate for ad-hoc callers; reads cells in place from the table's column
+// arrays. The executor compiles WHERE into a FilterProgram instead.
+using Predicate = std::function<bool(const RowView&)>;
 
 } // namespace memoria
 
@@ -17,6 +17,9 @@ class Printer {
         : out_(out), err_(err) {}
 
     void printQueryResult(const QueryResult& qr); // to out_
+    void printQueryRefs(const QueryRefs& qr);     // same table, cells read from the Table
+    // same table as printQueryResult, written batch by batch while the cursor is drained
+    void printCursor(Cursor& cursor);
     void printError(const std::exception& e);     // to err_
     void printHelpMessage(std::string_view prog = "memoriadb");
 
@@ -27,9 +30,19 @@ class Printer {
     std::ostream& out_;
     std::ostream& err_;
 
-    static std::string cellToString(const RowValue& v);
+    struct Layout {
+        std::vector<std::size_t> widths;
+        std::vector<bool> isNumeric; // right-aligned
+    };
+
+    // Rows: std::vector<Row> or RowRefs (indexable, size())
+    template <class Rows>
     void printTable(const std::vector<std::string>& header,
-                    const std::vector<Row>& rows); // internal used by printQueryResult
+                    const Rows& rows); // internal used by printQueryResult
+    template <class Rows>
+    static Layout layoutFor(const std::vector<std::string>& header, const Rows& rows);
+    void printHeader(const std::vector<std::string>& header, const Layout& layout);
+    template <class Rows> void printRows(const Rows& rows, const Layout& layout);
 };
 
 } // namespace memoria
@@ -5,14 +5,64 @@
 #ifndef ROW_H
 #define ROW_H
 
+#include "StringRef.h"
+
 #include <cstdint>
+#include <initializer_list>
 #include <string>
-#include <variant>
+#include <string_view>
 #include <vector>
 
 namespace memoria {
 
-using RowValue = std::variant<int64_t, std::string>;
+// One cell: either an int64_t or a string, in 16 bytes. Strings use the StringRef layout; those
+// longer than StringRef::kInlineSize live in a heap buffer owned by the value. Accessing the
+// wrong alternative throws std::bad_variant_access.
+class RowValue {
+  public:
+    RowValue() noexcept : RowValue(int64_t{0}) {}
+    RowValue(int64_t v) noexcept;
+    RowValue(int v) noexcept : RowValue(int64_t{v}) {}
+    RowValue(std::string_view v);
+    RowValue(const std::string& v) : RowValue(std::string_view{v}) {}
+    RowValue(const char* v) : RowValue(std::string_view{v}) {}
+
+    RowValue(const RowValue& other);
+    RowValue(RowValue&& other) noexcept;
+    RowValue& operator=(const RowValue& other);
+    RowValue& operator=(RowValue&& other) noexcept;
+    ~RowValue();
+
+    [[nodiscard]] bool isInt() const noexcept {
+        return ref_.size_ == kIntTag;
+    }
+    [[nodiscard]] bool isStr() const noexcept {
+        return !isInt();
+    }
+
+    [[nodiscard]] int64_t asInt() const;
+    [[nodiscard]] std::string_view asStr() const;
+    [[nodiscard]] const StringRef& strRef() const;
+    [[nodiscard]] std::string str() const {
+        return std::string{asStr()};
+    }
+
+    friend bool operator==(const RowValue& a, const RowValue& b) noexcept;
+
+  private:
+    static constexpr uint32_t kIntTag = std::numeric_limits<uint32_t>::max();
+
+    StringRef ref_; // size_ == kIntTag marks an int stored in the pointer slot
+
+    [[nodiscard]] bool ownsHeap() const noexcept {
+        return isStr() && !ref_.isInline();
+    }
+    void release() noexcept;
+};
+
+bool operator==(const RowValue& a, const RowValue& b) noexcept;
+
+static_assert(sizeof(RowValue) == 16);
 
 class Row {
   public:
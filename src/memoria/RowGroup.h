@@ -0,0 +1,82 @@
+//
+// Created by Ilya Nyrkov on 04.09.25.
+//
+
+#ifndef ROWGROUP_H
+#define ROWGROUP_H
+
+#include "ColumnStorage.h"
+#include "Row.h"
+#include "Schema.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace memoria {
+
+// Number of rows a group holds before the table starts a new one.
+inline constexpr std::size_t kRowGroupSize = 64 * 1024;
+
+// Position of a row: (group index << 16) | offset in group. Stable until a delete compacts the
+// row's group; anything keyed by RowId (indexes) is refreshed by the Table when that happens.
+using RowId = uint64_t;
+inline constexpr unsigned kRowIdOffsetBits = 16;
+static_assert(kRowGroupSize == std::size_t{1} << kRowIdOffsetBits);
+
+[[nodiscard]] constexpr RowId makeRowId(std::size_t group, std::size_t offset) noexcept {
+    return (RowId{group} << kRowIdOffsetBits) | offset;
+}
+[[nodiscard]] constexpr std::size_t rowIdGroup(RowId id) noexcept {
+    return static_cast<std::size_t>(id >> kRowIdOffsetBits);
+}
+[[nodiscard]] constexpr std::size_t rowIdOffset(RowId id) noexcept {
+    return static_cast<std::size_t>(id & (kRowGroupSize - 1));
+}
+
+// Fixed-capacity horizontal slice of a table, stored column-major. Tables own groups through
+// unique_ptr, so a group never moves once allocated and growing the table only ever touches the
+// last group.
+class RowGroup {
+  public:
+    // presized = true reserves kRowGroupSize rows up front, so appends never reallocate.
+    // dictionaries holds the table-wide dictionary of every Dictionary-encoded column (nullptr
+    // for the others).
+    RowGroup(const Schema& schema, const std::vector<std::shared_ptr<StrDictionary>>& dictionaries,
+             bool presized);
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return size_;
+    }
+    [[nodiscard]] bool full() const noexcept {
+        return size_ == kRowGroupSize;
+    }
+    [[nodiscard]] const std::vector<ColumnStorage>& columns() const noexcept {
+        return columns_;
+    }
+    [[nodiscard]] RowView row(std::size_t i) const noexcept {
+        return RowView{columns_, i};
+    }
+
+    // row must already be validated against the schema
+    void append(const Row& row);
+    // rows[begin, end), a column at a time; they must be validated and fit in the group
+    void append(const std::vector<Row>& rows, std::size_t begin, std::size_t end);
+    // copy row i of another group with the same schema
+    void appendFrom(const RowGroup& other, std::size_t i);
+
+    void compact(const std::vector<uint8_t>& keep);
+    void assign(std::size_t col, const std::vector<uint8_t>& mask, const RowValue& val);
+
+    [[nodiscard]] Row materializeRow(std::size_t i) const;
+    [[nodiscard]] Row projectRow(std::size_t i,
+                                 const std::vector<std::size_t>& columnIndices) const;
+
+  private:
+    std::vector<ColumnStorage> columns_;
+    std::size_t size_ = 0;
+};
+
+} // namespace memoria
+
+#endif // ROWGROUP_H
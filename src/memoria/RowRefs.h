@@ -0,0 +1,93 @@
+//
+// Created by Ilya Nyrkov on 19.09.25.
+//
+
+#ifndef ROWREFS_H
+#define ROWREFS_H
+
+#include "ColumnStorage.h"
+#include "Row.h"
+#include "RowGroup.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace memoria {
+
+class Table;
+
+// One matching row read in place: cell k is column projection[k] of the stored row (or column k
+// without a projection). Only valid while the RowRefs it came from is.
+class RowRef {
+  public:
+    RowRef(RowView row, const std::vector<std::size_t>* projection) noexcept
+        : row_(row), projection_(projection) {}
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return projection_ ? projection_->size() : row_.size();
+    }
+    [[nodiscard]] bool isInt(std::size_t k) const {
+        return std::holds_alternative<IntColumn>(row_.columns().at(column(k)));
+    }
+    [[nodiscard]] int64_t intAt(std::size_t k) const {
+        return row_.intAt(column(k));
+    }
+    [[nodiscard]] std::string_view strAt(std::size_t k) const {
+        return row_.strAt(column(k));
+    }
+    // copies the cell (a long string is allocated)
+    [[nodiscard]] RowValue at(std::size_t k) const {
+        return row_.at(column(k));
+    }
+    [[nodiscard]] Row materialize() const;
+
+  private:
+    RowView row_;
+    const std::vector<std::size_t>* projection_;
+
+    [[nodiscard]] std::size_t column(std::size_t k) const {
+        return projection_ ? projection_->at(k) : k;
+    }
+};
+
+// Read-only query result that references table storage instead of copying it: the RowIds of the
+// matching rows plus the projection. The table must outlive the result; any mutation of the
+// table after the result was taken is detected through Table::version() and makes row access
+// throw std::logic_error instead of reading moved or rewritten storage.
+class RowRefs {
+  public:
+    RowRefs(const Table& table, std::vector<RowId> ids,
+            std::optional<std::vector<std::size_t>> projection = std::nullopt);
+    // ids selected when table was at version: the result is invalid as soon as it is not any more
+    RowRefs(const Table& table, uint64_t version, std::vector<RowId> ids,
+            std::optional<std::vector<std::size_t>> projection = std::nullopt);
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return ids_.size();
+    }
+    [[nodiscard]] bool empty() const noexcept {
+        return ids_.empty();
+    }
+    [[nodiscard]] const std::vector<RowId>& rowIds() const noexcept {
+        return ids_;
+    }
+    // false once the table has been modified
+    [[nodiscard]] bool valid() const noexcept;
+
+    // throws std::logic_error if !valid(), std::out_of_range if i >= size()
+    [[nodiscard]] RowRef operator[](std::size_t i) const;
+    [[nodiscard]] std::vector<Row> materialize() const;
+
+  private:
+    const Table* table_;
+    uint64_t version_;
+    std::vector<RowId> ids_;
+    std::optional<std::vector<std::size_t>> projection_;
+};
+
+} // namespace memoria
+
+#endif // ROWREFS_H
@@ -17,9 +17,16 @@ namespace memoria {
 
 enum class ColumnType { Int, Str };
 
+// Physical encoding of a column; Dictionary is only valid for Str columns.
+enum class ColumnEncoding { Plain, Dictionary };
+
+// physical index structure: Hash answers equality, BTree (Int columns only) also ranges
+enum class IndexKind { Hash, BTree };
+
 struct Column {
     std::string name;
     ColumnType type;
+    ColumnEncoding encoding = ColumnEncoding::Plain;
 };
 
 class Schema {
@@ -0,0 +1,77 @@
+//
+// Created by Ilya Nyrkov on 16.09.25.
+//
+
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace memoria {
+
+// Instruction sets the scan kernels come in. Avx2 / Avx512 are only built on x86-64 with
+// GCC/Clang (per-function target attributes, no global -m flags); elsewhere only Scalar exists.
+enum class SimdLevel { Scalar, Avx2, Avx512 };
+
+// the six int64 comparisons, in CompareOp order
+enum class IntCompare : uint8_t { Eq, Ne, Lt, Gt, Le, Ge };
+
+// Sets out[w] bit j iff cmp(cells[64 * w + j], rhs), for every word w < ceil(rows / 64) whose
+// reach[w] is non-zero; other words are set to 0, and rows at or past `rows` never pass.
+using IntCompareKernel = void (*)(const int64_t* cells, std::size_t rows, int64_t rhs,
+                                  const uint64_t* reach, uint64_t* out);
+// Writes base + i for every set bit i of words[0, count), ascending, to out; returns how many.
+using CompressKernel = std::size_t (*)(const uint64_t* words, std::size_t count, uint32_t base,
+                                       uint32_t* out);
+
+// Running SUM / MIN / MAX of int64 values, filled by IntAggregateKernel. The sum is kept exactly
+// as high and low 32-bit halves summed separately (no overflow below 2^32 values), so vector
+// lanes never overflow and the result does not depend on the order values were added in.
+struct IntAccumulator {
+    int64_t sumHigh = 0; // sum of v >> 32 (arithmetic)
+    uint64_t sumLow = 0; // sum of v & 0xFFFFFFFF
+    int64_t min = std::numeric_limits<int64_t>::max();
+    int64_t max = std::numeric_limits<int64_t>::min();
+
+    void add(int64_t v) noexcept {
+        sumHigh += v >> 32;
+        sumLow += static_cast<uint64_t>(v) & 0xFFFFFFFFu;
+        min = v < min ? v : min;
+        max = v > max ? v : max;
+    }
+    void merge(const IntAccumulator& other) noexcept;
+    // the sum, nullopt if it does not fit an int64
+    [[nodiscard]] std::optional<int64_t> sum() const noexcept;
+    // sum / count truncated toward zero (exact even when the sum itself overflows); count > 0
+    [[nodiscard]] int64_t average(uint64_t count) const noexcept;
+};
+
+// Folds cells[sel[k]] for k < n into acc, or cells[0, n) when sel is nullptr. Sum, min and max
+// come out of one pass.
+using IntAggregateKernel = void (*)(const int64_t* cells, const uint32_t* sel, std::size_t n,
+                                    IntAccumulator& acc);
+
+struct SimdKernels {
+    SimdLevel level;
+    std::array<IntCompareKernel, 6> compare; // indexed by IntCompare
+    CompressKernel compress;
+    IntAggregateKernel aggregate;
+};
+
+// best level this build and CPU support (cpuid, including the OS enabling the vector state)
+[[nodiscard]] SimdLevel detectSimdLevel() noexcept;
+// kernels of a given level; throws std::invalid_argument if this build or CPU lacks it
+[[nodiscard]] const SimdKernels& simdKernelsFor(SimdLevel level);
+// kernels of detectSimdLevel(), chosen once on first use
+[[nodiscard]] const SimdKernels& simdKernels() noexcept;
+
+// number of set bits in words[0, count)
+[[nodiscard]] std::size_t countBits(const uint64_t* words, std::size_t count) noexcept;
+
+} // namespace memoria
+
+#endif // SIMDKERNELS_H
@@ -8,10 +8,13 @@
 #include "Row.h"
 #include "Schema.h"
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <variant>
+#include <vector>
 
 // ==== Where Statements ====
 
@@ -22,6 +25,7 @@ struct Comparison {
     std::string column;
     CompareOp op;
     RowValue literal;
+    std::optional<std::size_t> param; // ? placeholder: the parameter bound to literal
 };
 
 struct And;
@@ -45,10 +49,20 @@ struct CreateTable {
     Schema schema;
 };
 
+// CREATE INDEX <name> ON <table>(<column>) [USING HASH | BTREE]
+struct CreateIndex {
+    std::string indexName;
+    std::string table;
+    std::string column;
+    IndexKind kind = IndexKind::Hash;
+};
+
 struct Insert {
     std::string tableName;
     std::vector<std::string> columnNames;
     std::vector<std::vector<RowValue>> rows;
+    // ? placeholders among the values, in parameter order: {row, position in the row}
+    std::vector<std::pair<std::size_t, std::size_t>> params;
 };
 
 struct Delete {
@@ -60,6 +74,7 @@ struct Delete {
 struct Assignment {
     std::string column;
     RowValue value;
+    std::optional<std::size_t> param; // ? placeholder: the parameter bound to value
 };
 
 struct Update {
@@ -69,16 +84,107 @@ struct Update {
     std::optional<WhereExpr> where;
 };
 
+enum class AggregateFunc { Count, Sum, Min, Max, Avg };
+
+// COUNT(*) | COUNT(c) | SUM(c) | MIN(c) | MAX(c) | AVG(c)
+struct Aggregate {
+    AggregateFunc func;
+    std::optional<std::string> column; // nullopt for COUNT(*)
+};
+
+// one output column of a projection that has aggregates
+using SelectItem = std::variant<std::string, Aggregate>;
+
+// ORDER BY <column or aggregate> [ASC|DESC]
+struct OrderBy {
+    SelectItem item;
+    bool descending = false;
+};
+
+// JOIN <table> ON <left column> = <right column>; columns may be qualified as table.column
+struct Join {
+    std::string table;
+    std::string left;
+    std::string right;
+};
+
 struct Select {
     std::string table;
-    // projection: either * or a list of names
+    std::optional<Join> join; // a second table, joined to table
+    // projection: *, a list of column names, or items with at least one aggregate
     struct Star {};
-    using Projection = std::variant<Star, std::vector<std::string>>;
+    using Projection = std::variant<Star, std::vector<std::string>, std::vector<SelectItem>>;
     Projection projection;
     std::optional<WhereExpr> where;
+    std::vector<std::string> groupBy; // GROUP BY columns, empty without the clause
+    std::optional<OrderBy> orderBy;
+    std::optional<uint64_t> limit; // LIMIT n
+    uint64_t offset = 0;           // OFFSET m, only with LIMIT
+};
+
+[[nodiscard]] inline bool hasAggregates(const Select& st) noexcept {
+    return std::holds_alternative<std::vector<SelectItem>>(st.projection);
+}
+
+// true when the result is one row per group (or a single row) rather than one per matching row
+[[nodiscard]] inline bool isAggregation(const Select& st) noexcept {
+    return hasAggregates(st) || !st.groupBy.empty();
+}
+
+// output column name, e.g. "SUM(c2)" or "COUNT(*)"
+[[nodiscard]] inline std::string aggregateName(const Aggregate& agg) {
+    static constexpr const char* kNames[] = {"COUNT", "SUM", "MIN", "MAX", "AVG"};
+    return std::string{kNames[static_cast<int>(agg.func)]} + "(" + agg.column.value_or("*") + ")";
+}
+
+// SET <name> = <int>, engine settings (currently only `threads`)
+struct Set {
+    std::string name;
+    int64_t value;
 };
 
-using Statement = std::variant<CreateTable, Insert, Delete, Update, Select>;
+// ANALYZE <table>: (re)collect the table's statistics for the planner
+struct Analyze {
+    std::string table;
+};
+
+// SHOW STATS <table>: the statistics ANALYZE collected, one row per column
+struct ShowStats {
+    std::string table;
+};
+
+// EXECUTE <name>[(<literal>, ...)]: runs a prepared statement, the literals bound to its ?
+// parameters in order
+struct Execute {
+    std::string name;
+    std::vector<RowValue> args;
+};
+
+// DEALLOCATE <name>: forgets a prepared statement
+struct Deallocate {
+    std::string name;
+};
+
+struct Explain;
+struct Prepare;
+
+// recursive like WhereExpr: EXPLAIN and PREPARE hold the statement they apply to
+using Statement = std::variant<CreateTable, CreateIndex, Insert, Delete, Update, Select, Set,
+                               Analyze, ShowStats, Execute, Deallocate, Explain, Prepare>;
+
+// EXPLAIN [ANALYZE] <statement>: the physical plan of a SELECT / INSERT / UPDATE / DELETE;
+// ANALYZE runs the statement (side effects included) and reports what every operator did
+struct Explain {
+    std::unique_ptr<Statement> statement;
+    bool analyze = false;
+};
+
+// PREPARE <name> AS <statement>: a SELECT / INSERT / UPDATE / DELETE planned once and run by
+// EXECUTE; its values may be ? placeholders, numbered in the order they appear
+struct Prepare {
+    std::string name;
+    std::unique_ptr<Statement> statement;
+};
 
 } // namespace memoria
 
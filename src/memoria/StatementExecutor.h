@@ -5,13 +5,24 @@
 #ifndef STATEMENTEXECUTOR_H
 #define STATEMENTEXECUTOR_H
 
+#include "memoria/Cursor.h"
 #include "memoria/Database.h"
+#include "memoria/FilterProgram.h"
+#include "memoria/Parser.h"
+#include "memoria/Plan.h"
 #include "memoria/Statement.h"
 
+#include <array>
 #include <functional>
+#include <list>
 #include <memoria/Row.h>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace memoria {
 struct QueryResult {
@@ -19,30 +30,215 @@ struct QueryResult {
     std::vector<Row> rows;
 };
 
+// SELECT result that references the table's storage instead of copying cells; see RowRefs.
+struct QueryRefs {
+    std::vector<std::string> header;
+    RowRefs rows;
+};
+
 class StatementExecutor {
   public:
     explicit StatementExecutor(Database& db) : db_(db) {}
 
     // High-level single entry point.
-    // - CREATE/INSERT/UPDATE/DELETE: returns std::nullopt (side effects only)
-    // - SELECT: returns QueryResult
+    // - CREATE/INSERT/UPDATE/DELETE/SET/ANALYZE/PREPARE/DEALLOCATE: returns std::nullopt (side
+    //   effects only)
+    // - SELECT / EXPLAIN / SHOW STATS: returns QueryResult
+    // - EXECUTE: returns what the prepared statement returns
     [[nodiscard]] std::optional<QueryResult> execute(const Statement& st);
 
+    // Prepared statements: a SELECT / INSERT / UPDATE / DELETE, typically parsed with
+    // Parser::prepareParameterized, is validated and planned once, then run any number of times
+    // with new values for its ? parameters. PREPARE / EXECUTE / DEALLOCATE keep them by name.
+    class Prepared;
+    // throws like execution would, and std::invalid_argument for other statements
+    [[nodiscard]] Prepared prepare(Statement st) const;
+    // args are bound to the ? parameters in order; throws std::invalid_argument on a wrong count
+    // or type. Returns like execute().
+    std::optional<QueryResult> execute(Prepared& prepared, const std::vector<RowValue>& args) const;
+
+    // One statement of SQL text, as the REPL runs it. A SELECT, UPDATE or DELETE goes through the
+    // plan cache: it is looked up by its fingerprint (Parser::fingerprint, the text without its
+    // literals) and run as a prepared statement with the literals as values, skipping parsing,
+    // name resolution and WHERE compilation. On a miss it is prepared and cached, replacing the
+    // least recently used of kPlanCacheEntries plans; plans of a table are dropped once it gets
+    // an index or statistics (Table::catalogVersion). A statement that cannot be run that way
+    // (say, a literal of the wrong type) runs uncached, and throws as execute() would.
+    // With stream, a SELECT without aggregates or JOIN is handed to it as a Cursor instead of
+    // being collected, and nullopt is returned.
+    using CursorSink = std::function<void(Cursor&)>;
+    [[nodiscard]] std::optional<QueryResult> executeSql(std::string_view sql,
+                                                        const CursorSink& stream = {});
+
+    static constexpr std::size_t kPlanCacheEntries = 256;
+    struct PlanCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;        // plans made, whether or not they could be cached
+        uint64_t invalidations = 0; // plans dropped for a new index or statistics
+        uint64_t evictions = 0;     // least recently used plans dropped for room
+        std::size_t entries = 0;    // plans cached now
+    };
+    [[nodiscard]] PlanCacheStats planCacheStats() const noexcept {
+        PlanCacheStats stats = cacheStats_;
+        stats.entries = planCache_.size();
+        return stats;
+    }
+
     // Fine-grained operations (useful for tests or REPL routing)
     void execCreateTable(const CreateTable& st) const; // throws on duplicate table / bad schema
+    void execCreateIndex(const CreateIndex& st) const; // throws on unknown column / duplicate
     void execInsert(const Insert& st) const;           // throws on arity/type mismatch
+    void execInsert(Insert&& st) const;                // the same, moving the values out of st
     std::size_t execDelete(const Delete& st) const;    // returns rows removed
     std::size_t execUpdate(const Update& st) const;    // returns rows updated
     QueryResult execSelect(const Select& st) const;    // returns projected rows
+    void execSet(const Set& st) const;                 // throws on unknown setting / bad value
+    QueryResult execExplain(const Explain& st) const;  // one "plan" row per operator
+    void execAnalyze(const Analyze& st) const;         // throws on unknown table
+    QueryResult execShowStats(const ShowStats& st) const; // throws before the first ANALYZE
+
+    // Physical plan of a SELECT / INSERT / UPDATE / DELETE: the operators the exec* methods run
+    // it with and the access path chosen for each table. Validates like execution does, but
+    // reads no rows; other statements throw std::invalid_argument.
+    [[nodiscard]] std::unique_ptr<PlanNode> plan(const Statement& st) const;
+
+    static constexpr int64_t kMaxThreads = 256;
+
+    // A SELECT whose projection has aggregates (COUNT / SUM / MIN / MAX / AVG) returns one row,
+    // computed inside the scan; it has no cursor or RowRefs form (both throw).
+
+    // Streaming SELECT: rows are produced from the table as they are consumed, instead of being
+    // collected into a QueryResult first. The table must not change while the cursor is in use.
+    using RowSink = std::function<void(const std::vector<Row>&)>;
+    [[nodiscard]] Cursor openSelect(const Select& st) const; // pull: next() / nextBatch()
+    std::size_t execSelect(const Select& st, const RowSink& sink) const; // push, returns row count
+    // Zero-copy SELECT for read-only consumers: only the ids of matching rows are collected; cells
+    // are read from the table on access, until the table is next modified.
+    [[nodiscard]] QueryRefs execSelectRefs(const Select& st) const;
 
   private:
     Database& db_;
+    std::unordered_map<std::string, std::unique_ptr<Prepared>> prepared_; // PREPARE <name>
+
+    // plan cache of executeSql, most recently used first
+    struct CachedPlan {
+        std::string fingerprint;
+        std::vector<std::pair<const Table*, uint64_t>> tables; // and their catalogVersion
+        std::unique_ptr<Prepared> prepared;
+    };
+    std::list<CachedPlan> planCache_;
+    // keys view the fingerprint of their entry
+    std::unordered_map<std::string_view, std::list<CachedPlan>::iterator> planCacheIndex_;
+    PlanCacheStats cacheStats_;
+    // the cached plan for fp, made now on a miss; nullptr for other statements and for literals
+    // the plan cannot take
+    [[nodiscard]] Prepared* cachedPlan(const Parser::Fingerprint& fp);
+
+    // Compiled WHERE the Table evaluates a row group at a time; a default Pred accepts every row.
+    using Pred = FilterProgram;
+
+    // ---- planning: the decisions execution follows, made once per statement ----
+
+    // Part of a WHERE an index answers: an equality on a hash index, or the inclusive [lo, hi]
+    // range on a B-tree index (lo > hi when no row can match).
+    struct IndexProbe {
+        const HashIndex* hash = nullptr;
+        const BTreeIndex* btree = nullptr;
+        RowValue key;
+        int64_t lo = 0, hi = 0;
+    };
+    // How the rows of one table are read: its WHERE compiled, narrowed by an index when it can.
+    struct Access {
+        const Table* table = nullptr;
+        const WhereExpr* where = nullptr; // what filter was compiled from
+        std::optional<Pred> filter;       // nullopt without WHERE: every row
+        std::optional<IndexProbe> probe;  // nullopt: full scan
+        std::optional<uint64_t> estimate; // rows the read should hand on, from table statistics
+        PlanNode* readNode = nullptr;     // its Scan or IndexLookup, once accessNode built it
+        PlanNode* filterNode = nullptr;   // its Filter, none without WHERE
+    };
+    // A SELECT planned: the operator tree for EXPLAIN and what the execution paths below need.
+    // Running it records what every operator did in the tree (PlanNode::stats).
+    struct SelectPlan {
+        std::unique_ptr<PlanNode> root;
+        std::array<Access, 2> access;                       // FROM table, then JOIN table
+        std::optional<std::vector<std::size_t>> projection; // plain SELECT; nullopt for *
+        std::array<std::size_t, 2> joinColumns{};           // ON column of each table
+        std::size_t buildSide = 0;                          // JOIN input built into the hash table
+        std::vector<const WhereExpr*> residual;             // JOIN conjuncts on both tables
+        std::array<std::unique_ptr<WhereExpr>, 2> pushed;   // JOIN conjuncts on one table
+        // operators above the table reads, null where the plan has none
+        PlanNode* project = nullptr;
+        PlanNode* sort = nullptr;
+        PlanNode* limit = nullptr;
+        PlanNode* aggregate = nullptr;
+        PlanNode* join = nullptr;
+        PlanNode* residualFilter = nullptr;
+        bool analyze = false; // EXPLAIN ANALYZE: also measure each Filter conjunct on its own
+    };
+    // An UPDATE / DELETE planned; access.table is null for a DELETE without WHERE.
+    struct WritePlan {
+        std::unique_ptr<PlanNode> root;
+        Access access;
+        std::vector<std::pair<std::size_t, RowValue>> assignments; // UPDATE only
+    };
+    [[nodiscard]] SelectPlan planSelect(const Select& st) const;
+    [[nodiscard]] WritePlan planUpdate(const Update& st) const;
+    [[nodiscard]] WritePlan planDelete(const Delete& st) const;
+    // With table statistics, an index expected to yield more than a quarter of the table is
+    // passed over for a scan, and estimate is set.
+    [[nodiscard]] Access planAccess(const Table& table, const WhereExpr* where) const;
+    // the index lookup and estimate of planAccess, for the current literals of access.where
+    void planProbe(Access& access) const;
+    // The JOIN input hashJoin builds: the side expected to hand on fewer rows, by the statistics
+    // when both tables have them, else the smaller table. Named in the Join node's detail.
+    static void pickBuildSide(const Select& st, SelectPlan& plan);
+    // Scan or IndexLookup of the table, under a Filter when there is a WHERE
+    [[nodiscard]] static std::unique_ptr<PlanNode> accessNode(const std::string& table,
+                                                              Access& access);
+    // Runs the index lookup of access: the ascending RowIds it yields (possibly empty), or nullopt
+    // for a full scan, also chosen when a range would return more than a quarter of the table.
+    // Records the IndexLookup's stats.
+    [[nodiscard]] std::optional<std::vector<RowId>> candidates(const Access& access) const;
+    // Records the read and Filter of access after a pass over every row group since start, in
+    // which the filter looked at scanned rows and kept matched.
+    static void recordRead(const Access& access, uint64_t scanned, uint64_t matched,
+                           uint64_t bytes, uint64_t start);
+    // EXPLAIN ANALYZE: the selectivity of each top-level conjunct of the Filter of access
+    void measureConjuncts(const Access& access) const;
+
+    // ---- execution of planned statements ----
+
+    // execute(Prepared&) in two steps: args written into the plan, then the plan run
+    void bindPrepared(Prepared& prepared, const std::vector<RowValue>& args) const;
+    std::optional<QueryResult> runPrepared(Prepared& prepared) const;
+
+    // rows pulled from a Cursor over the filtered table, sorted / limited / projected per row
+    [[nodiscard]] Cursor openCursor(const Select& st, SelectPlan& plan) const;
+    [[nodiscard]] QueryResult execSelect(const Select& st, SelectPlan& plan) const;
+    // aggregates folded over the matching rows of each row group in parallel on the pool, one
+    // result row overall or, with GROUP BY, one per group
+    [[nodiscard]] QueryResult execAggregate(const Select& st, const SelectPlan& plan) const;
+    // SELECT ... FROM a JOIN b ON a.x = b.y: WHERE conditions on one table filter its scan, both
+    // sides meet in hashJoin, and conditions spanning both tables are checked per joined pair
+    [[nodiscard]] QueryResult execJoin(const Select& st, const SelectPlan& plan) const;
+    std::size_t execDelete(const Delete& st, const WritePlan& plan) const;
+    std::size_t execUpdate(const Update& st, const WritePlan& plan) const;
+    // the rows of st into tbl, values in the column order compileInsertColumnOrder returned
+    void execInsert(const Insert& st, Table& tbl, const std::vector<std::size_t>& order) const;
 
     // ---- helpers (pure compilation/validation; no side effects) ----
 
-    // Build a predicate the Table can consume. Type-erased for header simplicity.
-    using Pred = std::function<bool(const Row&)>;
-    [[nodiscard]] Pred compileWhere(const WhereExpr& expr, const Schema& schema) const;
+    // compileFilter: takes the Table (not just its Schema) so literals on dictionary-encoded
+    // columns resolve to codes once, and conditions are ordered by the table's data.
+    [[nodiscard]] Pred compileWhere(const WhereExpr& expr, const Table& table) const;
+
+    // Index access over the top-level AND conjuncts: `col = literal` on a hash-indexed column (the
+    // most selective one when the table has statistics), or else the range all bounds on a B-tree
+    // indexed column intersect to; nullopt when no index applies. Call after compileWhere, which
+    // has already type-checked the expression.
+    [[nodiscard]] std::optional<IndexProbe> planIndex(const WhereExpr& expr,
+                                                      const Table& table) const;
 
     // Turn SELECT projection into column indices (empty => STAR/*)
     [[nodiscard]] std::vector<std::size_t> compileProjection(const Select::Projection& proj,
@@ -57,11 +253,42 @@ class StatementExecutor {
     [[nodiscard]] std::vector<std::size_t> compileInsertColumnOrder(const Insert& st,
                                                                     const Schema& schema) const;
 
-    // Reorder/validate a VALUES row according to indices; throws on arity/type
-    // mismatch
-    [[nodiscard]] Row makeRowForInsert(const std::vector<RowValue>& values,
-                                       const std::vector<std::size_t>& columnOrder,
-                                       const Schema& schema) const;
+    // Lay the VALUES rows out in schema order according to indices (values moved, omitted
+    // columns defaulted); throws on arity mismatch. Types are checked by Table::insertRows.
+    [[nodiscard]] std::vector<Row> makeRowsForInsert(std::vector<std::vector<RowValue>> values,
+                                                     const std::vector<std::size_t>& columnOrder,
+                                                     const Schema& schema) const;
+};
+
+// A statement prepared by StatementExecutor::prepare: its AST, plan and compiled WHERE filters,
+// kept between executions. Executing writes the parameter values into the AST, the plan and the
+// filters, then runs the plan: no parsing, name resolution or WHERE compilation. Only the index
+// lookup is chosen again each time, as it depends on the values. Literals compared with
+// dictionary-encoded columns are rebound too, as hidden parameters, since the dictionary may have
+// grown since. The plan itself is fixed; one execution at a time.
+class StatementExecutor::Prepared {
+  public:
+    // ? parameters execute() expects
+    [[nodiscard]] std::size_t parameterCount() const noexcept {
+        return parameters_;
+    }
+    // the plan as EXPLAIN shows it for the values bound last; empty for an INSERT
+    [[nodiscard]] std::vector<std::string> explain() const;
+
+  private:
+    friend class StatementExecutor;
+
+    std::unique_ptr<Statement> statement_;
+    std::size_t parameters_ = 0;
+    std::vector<ColumnType> types_; // of every parameter, hidden ones last
+    std::vector<RowValue> values_;  // the values bound last; hidden ones never change
+    // (parameter, a place its value is copied to) in the AST or the plan; all of them are heap
+    // storage that moves with the Prepared
+    std::vector<std::pair<std::size_t, RowValue*>> sites_;
+    std::optional<SelectPlan> select_;
+    std::optional<WritePlan> write_; // UPDATE / DELETE
+    Table* insertInto_ = nullptr;    // INSERT
+    std::vector<std::size_t> insertOrder_;
 };
 } // namespace memoria
 
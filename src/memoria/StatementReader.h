@@ -5,6 +5,7 @@
 #ifndef READER_H
 #define READER_H
 
+#include <functional>
 #include <iostream>
 #include <optional>
 #include <string>
@@ -23,6 +24,15 @@ class StatementReader {
     // Returns the next statement without the trailing ';', or nullopt at EOF.
     std::optional<std::string> next();
 
+    // If the next statement starts with keyword, hands its text to sink piece by piece as it is
+    // read instead of collecting it: comments stripped, without the ending ';', in pieces of at
+    // most a line or kPieceSize bytes. Returns false, consuming nothing but leading whitespace and
+    // comments, for another statement or at EOF. When sink throws, the rest of the statement is
+    // skipped and the exception rethrown once it has been read.
+    bool streamStatement(std::string_view keyword,
+                         const std::function<void(std::string_view)>& sink);
+    static constexpr std::size_t kPieceSize = 64 * 1024;
+
     // Optional helper for REPL prompt
     void printPrompt(std::ostream& out = std::cout) const;
 
@@ -35,6 +45,11 @@ class StatementReader {
     static void trim(std::string& s);
     static std::vector<std::string> splitBySemisOutsideQuotes(std::string_view s);
     std::optional<std::string> extractOneFromBuffer();
+    // drops leading whitespace and comments from buffer_, reading until something else follows
+    // them or EOF; false at EOF with nothing else
+    bool skipToStatement();
+    // the next line of the input, or kPieceSize bytes of it; false at EOF
+    bool readPiece(std::string& out);
 };
 
 } // namespace memoria
@@ -0,0 +1,101 @@
+//
+// Created by Ilya Nyrkov on 06.09.25.
+//
+
+#ifndef STRINGREF_H
+#define STRINGREF_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace memoria {
+
+class RowValue;
+
+// 16-byte "German string" reference: a 32-bit length and the first four bytes of the string,
+// followed by either the rest of a short string (up to 12 bytes in total) inline or a pointer to
+// the bytes. Length and prefix share one 8-byte word, so most inequalities and prefix checks are
+// decided without following the pointer. Non-owning: long strings must outlive the ref.
+class StringRef {
+  public:
+    static constexpr std::size_t kInlineSize = 12;
+    static constexpr std::size_t kPrefixSize = 4;
+    static constexpr std::size_t kMaxSize = std::numeric_limits<uint32_t>::max() - 1;
+
+    StringRef() noexcept = default;
+    explicit StringRef(std::string_view v) {
+        if (v.size() > kMaxSize)
+            throw std::length_error("string too long");
+        size_ = static_cast<uint32_t>(v.size());
+        if (v.size() <= kInlineSize) {
+            if (!v.empty())
+                std::memcpy(data_, v.data(), v.size());
+        } else {
+            std::memcpy(data_, v.data(), kPrefixSize);
+            const char* p = v.data();
+            std::memcpy(data_ + kPrefixSize, &p, sizeof p);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return size_;
+    }
+    [[nodiscard]] bool isInline() const noexcept {
+        return size_ <= kInlineSize;
+    }
+    [[nodiscard]] const char* data() const noexcept {
+        return isInline() ? data_ : pointer();
+    }
+    [[nodiscard]] std::string_view view() const noexcept {
+        return {data(), size_};
+    }
+
+    [[nodiscard]] bool startsWith(std::string_view p) const noexcept {
+        if (p.size() > size_)
+            return false;
+        const std::size_t head = p.size() < kPrefixSize ? p.size() : kPrefixSize;
+        if (std::memcmp(data_, p.data(), head) != 0)
+            return false; // answered from the inline prefix
+        return std::memcmp(data() + head, p.data() + head, p.size() - head) == 0;
+    }
+
+    friend bool operator==(const StringRef& a, const StringRef& b) noexcept {
+        if (a.head() != b.head())
+            return false; // length or prefix differ
+        if (a.isInline())
+            return a.tail() == b.tail(); // unused inline bytes are zero
+        return std::memcmp(a.pointer() + kPrefixSize, b.pointer() + kPrefixSize,
+                           a.size_ - kPrefixSize) == 0;
+    }
+
+  private:
+    friend class RowValue;
+
+    uint32_t size_ = 0;
+    char data_[kInlineSize] = {}; // [prefix | rest of short string or pointer]
+
+    [[nodiscard]] uint64_t head() const noexcept {
+        uint32_t prefix;
+        std::memcpy(&prefix, data_, sizeof prefix);
+        return (uint64_t{prefix} << 32) | size_;
+    }
+    [[nodiscard]] uint64_t tail() const noexcept {
+        uint64_t t;
+        std::memcpy(&t, data_ + kPrefixSize, sizeof t);
+        return t;
+    }
+    [[nodiscard]] const char* pointer() const noexcept {
+        const char* p;
+        std::memcpy(&p, data_ + kPrefixSize, sizeof p);
+        return p;
+    }
+};
+
+static_assert(sizeof(StringRef) == 16);
+
+} // namespace memoria
+
+#endif // STRINGREF_H
@@ -5,109 +5,388 @@
 #ifndef TABLE_H
 #define TABLE_H
 
+#include "BTreeIndex.h"
+#include "ColumnStats.h"
+#include "ColumnStorage.h"
+#include "HashIndex.h"
 #include "Row.h"
+#include "RowGroup.h"
+#include "RowRefs.h"
 #include "Schema.h"
+#include "ThreadPool.h"
 
 #include <algorithm>
+#include <iterator>
+#include <memory>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <variant>
 #include <vector>
 
 namespace memoria {
 
-static bool valueTypeMatches(ColumnType t, const RowValue& v);
-
+// Column-major table split into fixed-size row groups (see RowGroup.h). Inserts append to the
+// last group, so the table never re-copies existing rows; scans, updates and deletes walk the
+// table group by group.
+// Predicates may take either a RowView (reads cells in place) or a const Row& (the row is
+// materialized first, convenient for tests and ad-hoc callers).
+// Every read/mutation accepts optional candidates: ascending RowIds (e.g. from an index lookup)
+// to test instead of scanning the whole table.
 class Table {
   public:
-    explicit Table(Schema schema) : schema_(std::move(schema)) {}
+    explicit Table(Schema schema);
 
     // metadata
     [[nodiscard]] const Schema& getSchema() const noexcept;
     [[nodiscard]] std::size_t rowCount() const noexcept;
+    // bumped by every mutation; results holding references into storage (RowRefs) compare it
+    [[nodiscard]] uint64_t version() const noexcept {
+        return version_;
+    }
+
+    // storage layout (for scans that work a group at a time)
+    [[nodiscard]] std::size_t rowGroupCount() const noexcept;
+    [[nodiscard]] const RowGroup& rowGroup(std::size_t g) const;
+
+    // shared dictionary of a Dictionary-encoded column, nullptr for other columns
+    [[nodiscard]] const StrDictionary* dictionary(std::size_t col) const;
+
+    // indexes: built from the current rows, then kept in sync by every mutation. Throws on a
+    // duplicate name, or a BTree over a non-Int column.
+    void createIndex(std::string name, std::size_t column, IndexKind kind = IndexKind::Hash);
+    // first index of that kind on column, nullptr if none
+    [[nodiscard]] const HashIndex* hashIndex(std::size_t column) const noexcept;
+    [[nodiscard]] const BTreeIndex* btreeIndex(std::size_t column) const noexcept;
+    [[nodiscard]] bool hasIndexes() const noexcept {
+        return !indexes_.empty();
+    }
+    // changes when an index is created or analyze() runs: plans made for the table before may
+    // no longer be the best ones
+    [[nodiscard]] uint64_t catalogVersion() const noexcept {
+        return catalogVersion_;
+    }
+
+    // Statistics for the planner: collected by analyze() (on the pool, a column per task), then
+    // maintained by mutations. Inserts and UPDATE values extend min / max and the distinct
+    // sketches, deletes lower the row count; histograms only change at the next analyze(), and
+    // min / max / distinct never shrink until then. nullptr until the first analyze().
+    void analyze(ThreadPool* pool = nullptr);
+    [[nodiscard]] const TableStats* stats() const noexcept {
+        return stats_ ? &*stats_ : nullptr;
+    }
 
     // mutations (validate arity & types against schema)
     void insertRow(Row row);
+    // Bulk append: the whole batch is validated first, a column at a time, so a bad row leaves
+    // the table unchanged. Each row group is then reserved once and filled a column at a time.
+    void insertRows(std::vector<Row> rows);
+    // the checks of insertRows, without inserting; throws std::invalid_argument
+    void validateRows(const std::vector<Row>& rows) const;
     void deleteAllRows();
 
-    template <class Pred> std::size_t deleteWhere(Pred pred) {
-        const auto old = rows_.size();
-        rows_.erase(
-            std::remove_if(rows_.begin(), rows_.end(), [&](const Row& r) { return pred(r); }),
-            rows_.end());
-        return old - rows_.size();
-    }
+    // Scans below take an optional pool: with more than one thread, a WHERE that is a
+    // FilterProgram (const, so safe to share) is evaluated on several row groups concurrently.
+    // Results are always in storage order. Other predicates are called on this thread only.
 
     template <class Pred>
-    std::size_t updateWhere(Pred pred,
-                            const std::vector<std::pair<std::size_t, RowValue>>& assignments) {
-        for (const auto& [idx, val] : assignments) {
-            if (idx >= schema_.size())
-                throw std::out_of_range("Assignment column index out of range");
-            const auto& col = schema_.columns().at(idx);
-            const bool ok =
-                (col.type == ColumnType::Int && std::holds_alternative<int64_t>(val)) ||
-                (col.type == ColumnType::Str && std::holds_alternative<std::string>(val));
-            if (!ok)
-                throw std::invalid_argument("Assignment type mismatch");
-        }
+    std::size_t deleteWhere(Pred pred, const std::vector<RowId>* candidates = nullptr,
+                            ThreadPool* pool = nullptr) {
+        std::size_t removed = 0;
+        std::vector<uint8_t> keep;
+        scanGroups(pred, candidates, pool, [&](std::size_t g, const std::vector<uint32_t>& sel) {
+            keep.assign(groups_[g]->size(), 1);
+            for (auto i : sel)
+                keep[i] = 0;
 
-        std::size_t count = 0;
+            for (auto& index : indexes_)
+                std::visit([&](auto& ix) { ix.removeGroup(*groups_[g], g); }, index);
+            groups_[g]->compact(keep);
+            for (auto& index : indexes_)
+                std::visit([&](auto& ix) { ix.addGroup(*groups_[g], g); }, index);
+            removed += sel.size();
+        });
+        if (removed == 0)
+            return 0;
 
-        // ---- index-based iteration avoids the rvalue-binding issue
-        for (std::size_t i = 0, n = rows_.size(); i < n; ++i) {
-            Row& r = rows_.at(i); // mutable reference
-            if (!pred(r))
-                continue;
-            ++count;
+        ++version_;
+        rowCount_ -= removed;
+        if (stats_)
+            stats_->rows -= removed;
+        repackGroups();
+        return removed;
+    }
 
+    template <class Pred>
+    std::size_t updateWhere(Pred pred,
+                            const std::vector<std::pair<std::size_t, RowValue>>& assignments,
+                            const std::vector<RowId>* candidates = nullptr,
+                            ThreadPool* pool = nullptr) {
+        validateAssignments(assignments);
+
+        // indexes whose column is assigned must be refreshed for every touched group
+        std::vector<Index*> touched;
+        for (auto& index : indexes_) {
             for (const auto& [idx, val] : assignments) {
-                if (const auto* pi = std::get_if<int64_t>(&val)) {
-                    r.at(idx).emplace<int64_t>(*pi);
-                } else {
-                    const auto& ps = std::get<std::string>(val);
-                    r.at(idx).emplace<std::string>(ps);
+                if (indexColumn(index) == idx) {
+                    touched.push_back(&index);
+                    break;
                 }
             }
         }
 
+        // evaluate WHERE on the pre-update state of a group, then apply column by column
+        std::size_t count = 0;
+        std::vector<uint8_t> mask;
+        scanGroups(pred, candidates, pool, [&](std::size_t g, const std::vector<uint32_t>& sel) {
+            mask.assign(groups_[g]->size(), 0);
+            for (auto i : sel)
+                mask[i] = 1;
+
+            for (auto* index : touched)
+                std::visit([&](auto& ix) { ix.removeGroup(*groups_[g], g); }, *index);
+            for (const auto& [idx, val] : assignments)
+                groups_[g]->assign(idx, mask, val);
+            for (auto* index : touched)
+                std::visit([&](auto& ix) { ix.addGroup(*groups_[g], g); }, *index);
+            count += sel.size();
+        });
+        if (count == 0)
+            return 0;
+        ++version_;
+        if (stats_) {
+            for (const auto& [idx, val] : assignments)
+                stats_->columns[idx].add(val);
+        }
         return count;
     }
 
-    template <class Pred> [[nodiscard]] std::vector<Row> getRowsWhere(Pred pred) const {
-        std::vector<Row> out;
-        out.reserve(rows_.size());
-        for (const auto& r : rows_) {
-            if (pred(r))
-                out.push_back(r);
-        }
-        return out;
+    template <class Pred>
+    [[nodiscard]] std::vector<Row> getRowsWhere(Pred pred,
+                                                const std::vector<RowId>* candidates = nullptr,
+                                                ThreadPool* pool = nullptr) const {
+        return collect<Row>(pred, candidates, pool, [](const RowGroup& group, std::size_t,
+                                                       uint32_t i) {
+            return group.materializeRow(i);
+        });
     }
 
     template <class Pred>
-    [[nodiscard]] std::vector<Row> getColumnRowsWhere(const std::vector<std::size_t>& columnIndices,
-                                                      Pred pred) const {
+    [[nodiscard]] std::vector<Row>
+    getColumnRowsWhere(const std::vector<std::size_t>& columnIndices, Pred pred,
+                       const std::vector<RowId>* candidates = nullptr,
+                       ThreadPool* pool = nullptr) const {
         for (auto idx : columnIndices) {
             if (idx >= schema_.size())
                 throw std::out_of_range("Projection index out of range");
         }
+        return collect<Row>(pred, candidates, pool,
+                            [&](const RowGroup& group, std::size_t, uint32_t i) {
+                                return group.projectRow(i, columnIndices);
+                            });
+    }
+
+    // ids of the matching rows, in storage order
+    template <class Pred>
+    [[nodiscard]] std::vector<RowId>
+    getRowIdsWhere(Pred pred, const std::vector<RowId>* candidates = nullptr,
+                   ThreadPool* pool = nullptr) const {
+        return collect<RowId>(pred, candidates, pool,
+                              [](const RowGroup&, std::size_t g, uint32_t i) {
+                                  return makeRowId(g, i);
+                              });
+    }
+
+    // Calls fn(g, sel) with the matching offsets of every group that has any. On a pool the calls
+    // for different groups run concurrently and in no particular order, so fn may only touch
+    // per-group state.
+    template <class Pred, class Fn>
+    void forEachGroupMatch(Pred pred, const std::vector<RowId>* candidates, ThreadPool* pool,
+                           Fn fn) const {
+        if (!parallel<Pred>(pool)) {
+            scanGroups(pred, candidates, nullptr, fn);
+            return;
+        }
+        pool->parallelFor(groups_.size(), [&](std::size_t g) {
+            std::vector<uint32_t> sel;
+            Candidates cand = candidatesFrom(candidates, g);
+            selectInGroup(pred, g, cand, sel);
+            if (!sel.empty())
+                fn(g, static_cast<const std::vector<uint32_t>&>(sel));
+        });
+    }
+
+    // zero-copy counterparts of getRowsWhere / getColumnRowsWhere: the result reads cells from
+    // the table in place and is only usable until the next mutation
+    template <class Pred>
+    [[nodiscard]] RowRefs viewRowsWhere(Pred pred, const std::vector<RowId>* candidates = nullptr,
+                                        ThreadPool* pool = nullptr) const {
+        return RowRefs{*this, getRowIdsWhere(std::move(pred), candidates, pool)};
+    }
+
+    template <class Pred>
+    [[nodiscard]] RowRefs
+    viewColumnRowsWhere(std::vector<std::size_t> columnIndices, Pred pred,
+                        const std::vector<RowId>* candidates = nullptr,
+                        ThreadPool* pool = nullptr) const {
+        return RowRefs{*this, getRowIdsWhere(std::move(pred), candidates, pool),
+                       std::move(columnIndices)};
+    }
+
+  private:
+    using Index = std::variant<HashIndex, BTreeIndex>;
+
+    Schema schema_;
+    std::vector<std::unique_ptr<RowGroup>> groups_;
+    std::vector<std::shared_ptr<StrDictionary>> dictionaries_; // per column, nullptr if plain
+    std::vector<Index> indexes_;
+    std::size_t rowCount_ = 0;
+    uint64_t version_ = 0;
+    uint64_t catalogVersion_ = 0;
+    std::optional<TableStats> stats_;
+
+    // cursor over ascending candidate RowIds; ids == nullptr means "every row"
+    struct Candidates {
+        const std::vector<RowId>* ids;
+        std::size_t pos = 0;
+    };
+
+    template <class Pred> static bool matches(Pred& pred, const RowGroup& group, std::size_t i) {
+        if constexpr (std::is_invocable_r_v<bool, Pred&, const RowView&>)
+            return pred(group.row(i));
+        else
+            return pred(group.materializeRow(i));
+    }
+
+    // predicates that can bind to a group (FilterProgram) resolve its columns once and filter a
+    // group in batches themselves
+    template <class Pred>
+    static constexpr bool kBindable = requires(const Pred& p, const RowGroup& g) { p.bind(g); };
+
+    // offsets of the rows of group g that satisfy pred, in storage order
+    template <class Pred>
+    void selectInGroup(Pred& pred, std::size_t g, Candidates& cand,
+                       std::vector<uint32_t>& sel) const {
+        sel.clear();
+        const RowGroup& group = *groups_[g];
+        if (!cand.ids) {
+            if constexpr (kBindable<Pred>) {
+                pred.bind(group).select(sel);
+            } else {
+                for (std::size_t i = 0, n = group.size(); i < n; ++i) {
+                    if (matches(pred, group, i))
+                        sel.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            return;
+        }
+        const auto& ids = *cand.ids;
+        while (cand.pos < ids.size() && rowIdGroup(ids[cand.pos]) < g)
+            ++cand.pos;
+        if (cand.pos == ids.size() || rowIdGroup(ids[cand.pos]) != g)
+            return;
 
-        std::vector<Row> out;
-        for (const auto& r : rows_) {
-            if (!pred(r))
+        for (; cand.pos < ids.size() && rowIdGroup(ids[cand.pos]) == g; ++cand.pos) {
+            const std::size_t i = rowIdOffset(ids[cand.pos]);
+            if (i >= group.size())
                 continue;
-            std::vector<RowValue> projected;
-            projected.reserve(columnIndices.size());
-            for (auto idx : columnIndices) {
-                projected.push_back(r.at(idx)); // copy cell
+            if constexpr (kBindable<Pred>)
+                sel.push_back(static_cast<uint32_t>(i)); // tested below, as one batch
+            else if (matches(pred, group, i))
+                sel.push_back(static_cast<uint32_t>(i));
+        }
+        if constexpr (kBindable<Pred>)
+            pred.bind(group).refine(sel);
+    }
+
+    // candidate cursor positioned at the first RowId of group g
+    static Candidates candidatesFrom(const std::vector<RowId>* ids, std::size_t g) {
+        if (!ids)
+            return Candidates{nullptr};
+        const auto it = std::lower_bound(ids->begin(), ids->end(), makeRowId(g, 0));
+        return Candidates{ids, static_cast<std::size_t>(it - ids->begin())};
+    }
+
+    template <class Pred> static bool parallel(const ThreadPool* pool) {
+        return kBindable<Pred> && pool && pool->size() > 1;
+    }
+
+    // Calls visit(g, sel) in group order for every group with matches. In parallel, a wave of
+    // pool->size() groups is filtered concurrently before their selections are visited, so visit
+    // (which runs on this thread and may mutate group g) never races with the filtering.
+    template <class Pred, class Visit>
+    void scanGroups(Pred& pred, const std::vector<RowId>* candidates, ThreadPool* pool,
+                    Visit visit) const {
+        if (!parallel<Pred>(pool)) {
+            Candidates cand{candidates};
+            std::vector<uint32_t> sel;
+            for (std::size_t g = 0; g < groups_.size(); ++g) {
+                selectInGroup(pred, g, cand, sel);
+                if (!sel.empty())
+                    visit(g, sel);
+            }
+            return;
+        }
+        std::vector<std::vector<uint32_t>> wave(pool->size());
+        for (std::size_t base = 0; base < groups_.size(); base += wave.size()) {
+            const std::size_t n = std::min(wave.size(), groups_.size() - base);
+            pool->parallelFor(n, [&](std::size_t k) {
+                Candidates cand = candidatesFrom(candidates, base + k);
+                selectInGroup(pred, base + k, cand, wave[k]);
+            });
+            for (std::size_t k = 0; k < n; ++k) {
+                if (!wave[k].empty())
+                    visit(base + k, wave[k]);
             }
-            out.emplace_back(std::move(projected));
         }
+    }
+
+    // emit(group, g, offset) for every matching row, concatenated in storage order. In parallel
+    // every group fills its own buffer (filter and emit both run on the worker) and the buffers
+    // are appended in group order afterwards.
+    template <class Out, class Pred, class Emit>
+    std::vector<Out> collect(Pred& pred, const std::vector<RowId>* candidates, ThreadPool* pool,
+                             Emit emit) const {
+        std::vector<Out> out;
+        if (!parallel<Pred>(pool)) {
+            scanGroups(pred, candidates, nullptr,
+                       [&](std::size_t g, const std::vector<uint32_t>& sel) {
+                           for (auto i : sel)
+                               out.push_back(emit(*groups_[g], g, i));
+                       });
+            return out;
+        }
+        std::vector<std::vector<Out>> parts(groups_.size());
+        forEachGroupMatch(pred, candidates, pool,
+                          [&](std::size_t g, const std::vector<uint32_t>& sel) {
+                              parts[g].reserve(sel.size());
+                              for (auto i : sel)
+                                  parts[g].push_back(emit(*groups_[g], g, i));
+                          });
+        std::size_t total = 0;
+        for (const auto& part : parts)
+            total += part.size();
+        out.reserve(total);
+        for (auto& part : parts)
+            std::move(part.begin(), part.end(), std::back_inserter(out));
         return out;
     }
 
-  private:
-    Schema schema_;
-    std::vector<Row> rows_;
+    static std::size_t indexColumn(const Index& index) {
+        return std::visit([](const auto& ix) { return ix.column(); }, index);
+    }
+
+    void resetDictionaries();
+    [[nodiscard]] std::unique_ptr<RowGroup> newGroup(bool presized) const;
+
+    void
+    validateAssignments(const std::vector<std::pair<std::size_t, RowValue>>& assignments) const;
+
+    // drop empty groups; rebuild densely when deletes left groups mostly empty
+    void repackGroups();
+    void rebuildIndexes();
 };
 
 } // namespace memoria
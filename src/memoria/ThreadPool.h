@@ -0,0 +1,77 @@
+//
+// Created by Ilya Nyrkov on 20.09.25.
+//
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace memoria {
+
+// Fixed set of worker threads with one task deque each. parallelFor spreads its morsels over the
+// deques; a worker drains its own deque from the back and, once that is empty, steals from the
+// front of the others, so a slow morsel on one thread does not hold back the rest.
+// The calling thread works through morsels too, which keeps a pool of size 1 fully serial (no
+// workers are started) and lets a morsel call parallelFor again without deadlocking.
+class ThreadPool {
+  public:
+    // threads: total parallelism including the caller, at least 1
+    explicit ThreadPool(std::size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return workers_.size() + 1;
+    }
+
+    // Runs fn(i) for every i in [0, n) and returns once all have finished. fn is called
+    // concurrently from several threads. If a call throws, morsels not yet started are skipped
+    // and the first exception is rethrown here.
+    void parallelFor(std::size_t n, const std::function<void(std::size_t)>& fn);
+
+  private:
+    struct Job {
+        const std::function<void(std::size_t)>* fn;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error; // written by the first failing morsel only
+        std::mutex m;
+        std::size_t remaining; // guarded by m
+        std::condition_variable done;
+    };
+    struct Task {
+        Job* job;
+        std::size_t index;
+    };
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_; // one per worker, the last for callers
+    std::vector<std::thread> workers_;
+    std::mutex sleepM_;
+    std::condition_variable wake_;
+    std::atomic<std::size_t> pending_{0}; // queued, not yet taken
+    bool stop_ = false;                   // guarded by sleepM_
+
+    // own queue from the back, then the others from the front
+    bool take(std::size_t self, Task& out);
+    static void run(const Task& task);
+    void workerLoop(std::size_t self);
+};
+
+} // namespace memoria
+
+#endif // THREADPOOL_H
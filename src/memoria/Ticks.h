@@ -0,0 +1,34 @@
+//
+// Created by Ilya Nyrkov on 26.09.25.
+//
+
+#ifndef TICKS_H
+#define TICKS_H
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define MEMORIA_HAS_RDTSC
+#endif
+
+namespace memoria {
+
+// Timestamp for operator timings: the time-stamp counter where there is one (a few ns to read,
+// so the counters stay on for every statement), steady_clock nanoseconds elsewhere. Ticks only
+// measure differences; EXPLAIN ANALYZE turns them into time by reading steady_clock alongside
+// over the whole statement.
+[[nodiscard]] inline uint64_t readTicks() noexcept {
+#ifdef MEMORIA_HAS_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+} // namespace memoria
+
+#endif // TICKS_H
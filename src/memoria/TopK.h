@@ -0,0 +1,54 @@
+//
+// Created by Ilya Nyrkov on 23.09.25.
+//
+
+#ifndef TOPK_H
+#define TOPK_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace memoria {
+
+// Keeps the k smallest values pushed (under less) in a bounded max-heap: O(log k) per push and
+// O(k) memory however many values go through. ORDER BY ... LIMIT k uses it so the sorted prefix
+// is found without sorting, or even holding, every matching row.
+template <class T, class Less = std::less<T>>
+class TopK {
+  public:
+    explicit TopK(std::size_t k, Less less = Less{}) : k_(k), less_(std::move(less)) {}
+
+    void push(T v) {
+        if (heap_.size() < k_) {
+            heap_.push_back(std::move(v));
+            std::push_heap(heap_.begin(), heap_.end(), less_);
+        } else if (k_ > 0 && less_(v, heap_.front())) {
+            // replaces the largest kept value
+            std::pop_heap(heap_.begin(), heap_.end(), less_);
+            heap_.back() = std::move(v);
+            std::push_heap(heap_.begin(), heap_.end(), less_);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return heap_.size();
+    }
+
+    // the kept values in ascending order; leaves this empty
+    [[nodiscard]] std::vector<T> take() {
+        std::sort_heap(heap_.begin(), heap_.end(), less_);
+        return std::exchange(heap_, {});
+    }
+
+  private:
+    std::size_t k_;
+    Less less_;
+    std::vector<T> heap_; // a max-heap under less_
+};
+
+} // namespace memoria
+
+#endif // TOPK_H
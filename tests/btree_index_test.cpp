@@ -0,0 +1,125 @@
+//
+// Created by Ilya Nyrkov on 11.09.25.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <memoria/BTreeIndex.h>
+#include <memoria/Table.h>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace memoria;
+
+// reference answer: ids of entries with lo <= key <= hi, in (key, id) order
+static std::vector<RowId> expectedRange(const std::set<std::pair<int64_t, RowId>>& ref, int64_t lo,
+                                        int64_t hi) {
+    std::vector<RowId> out;
+    for (auto it = ref.lower_bound({lo, 0}); it != ref.end() && it->first <= hi; ++it)
+        out.push_back(it->second);
+    return out;
+}
+
+static std::vector<RowId> rangeOf(const BTreeIndex& index, int64_t lo, int64_t hi) {
+    std::vector<RowId> out;
+    EXPECT_TRUE(index.range(lo, hi, out));
+    return out;
+}
+
+TEST(BTreeIndex, RangeOnEmptyAndSmall) {
+    BTreeIndex index{"i", 0};
+    EXPECT_TRUE(rangeOf(index, std::numeric_limits<int64_t>::min(),
+                        std::numeric_limits<int64_t>::max())
+                    .empty());
+
+    index.insert(RowValue{int64_t{5}}, 1);
+    index.insert(RowValue{int64_t{3}}, 2);
+    index.insert(RowValue{int64_t{5}}, 0);
+    EXPECT_EQ(index.size(), 3u);
+    EXPECT_EQ(rangeOf(index, 4, 10), (std::vector<RowId>{0, 1}));
+    EXPECT_EQ(rangeOf(index, 3, 3), (std::vector<RowId>{2}));
+    EXPECT_TRUE(rangeOf(index, 6, 4).empty());
+
+    std::vector<RowId> capped;
+    EXPECT_FALSE(index.range(0, 10, capped, 2));
+
+    EXPECT_THROW(index.insert(RowValue{"x"}, 3), std::bad_variant_access);
+}
+
+TEST(BTreeIndex, MatchesReferenceUnderInsertAndErase) {
+    std::mt19937_64 rng{42};
+    std::uniform_int_distribution<int64_t> keyDist{-500, 500};
+    BTreeIndex index{"i", 0};
+    std::set<std::pair<int64_t, RowId>> ref;
+
+    // enough entries for a three-level tree, many duplicate keys
+    for (RowId id = 0; id < 20000; ++id) {
+        const int64_t key = keyDist(rng);
+        index.insert(RowValue{key}, id);
+        ref.emplace(key, id);
+    }
+    EXPECT_EQ(index.size(), ref.size());
+    for (int q = 0; q < 50; ++q) {
+        int64_t lo = keyDist(rng), hi = keyDist(rng);
+        if (lo > hi)
+            std::swap(lo, hi);
+        ASSERT_EQ(rangeOf(index, lo, hi), expectedRange(ref, lo, hi));
+    }
+
+    // erase most entries so the tree is rebuilt along the way, then keep inserting
+    for (auto it = ref.begin(); it != ref.end();) {
+        if (rng() % 10 != 0) {
+            index.erase(it->first, it->second);
+            it = ref.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    index.erase(1000, 0); // absent entries are ignored
+    EXPECT_EQ(index.size(), ref.size());
+    for (RowId id = 20000; id < 25000; ++id) {
+        const int64_t key = keyDist(rng);
+        index.insert(RowValue{key}, id);
+        ref.emplace(key, id);
+    }
+    EXPECT_EQ(rangeOf(index, std::numeric_limits<int64_t>::min(),
+                      std::numeric_limits<int64_t>::max()),
+              expectedRange(ref, std::numeric_limits<int64_t>::min(),
+                            std::numeric_limits<int64_t>::max()));
+    EXPECT_EQ(rangeOf(index, -100, 100), expectedRange(ref, -100, 100));
+}
+
+TEST(BTreeIndex, TableKeepsIndexInSync) {
+    Table t{Schema{{Column{"ts", ColumnType::Int}, Column{"s", ColumnType::Str}}}};
+    EXPECT_THROW(t.createIndex("by_s", 1, IndexKind::BTree), std::invalid_argument);
+
+    for (int64_t i = 0; i < 1000; ++i)
+        t.insertRow(Row{RowValue{i}, RowValue{"x"}});
+    t.createIndex("by_ts", 0, IndexKind::BTree);
+    const BTreeIndex* index = t.btreeIndex(0);
+    ASSERT_NE(index, nullptr);
+    EXPECT_EQ(t.hashIndex(0), nullptr);
+
+    t.insertRow(Row{RowValue{int64_t{5000}}, RowValue{"y"}});
+    EXPECT_EQ(rangeOf(*index, 4000, 6000), (std::vector<RowId>{makeRowId(0, 1000)}));
+
+    // deleting rows 0..99 shifts the rest of the group down
+    t.deleteWhere([](const Row& r) { return r.at(0).asInt() < 100; });
+    EXPECT_TRUE(rangeOf(*index, 0, 99).empty());
+    EXPECT_EQ(rangeOf(*index, 100, 101), (std::vector<RowId>{makeRowId(0, 0), makeRowId(0, 1)}));
+
+    std::vector<std::pair<std::size_t, RowValue>> assigns;
+    assigns.emplace_back(0, RowValue{int64_t{-7}});
+    t.updateWhere([](const Row& r) { return r.at(0).asInt() == 500; }, assigns);
+    EXPECT_TRUE(rangeOf(*index, 500, 500).empty());
+    EXPECT_EQ(rangeOf(*index, -7, -7), (std::vector<RowId>{makeRowId(0, 400)}));
+    EXPECT_EQ(index->size(), t.rowCount());
+
+    t.deleteAllRows();
+    EXPECT_EQ(index->size(), 0u);
+}
@@ -0,0 +1,173 @@
+//
+// Created by Ilya Nyrkov on 27.09.25.
+//
+
+#include "memoria/ColumnStats.h"
+#include "memoria/Table.h"
+#include "memoria/ThreadPool.h"
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace memoria;
+
+static RowValue VInt(int64_t v) {
+    return RowValue{v};
+}
+static RowValue VStr(std::string s) {
+    return RowValue{std::move(s)};
+}
+
+TEST(ColumnStats, HyperLogLogEstimatesDistinctCounts) {
+    HyperLogLog empty;
+    EXPECT_EQ(empty.estimate(), 0u);
+
+    for (const int64_t n : {10, 1000, 200000}) {
+        HyperLogLog hll;
+        for (int64_t i = 0; i < 3 * n; ++i) // every value three times
+            hll.add(statsHash(i % n));
+        EXPECT_NEAR(static_cast<double>(hll.estimate()), static_cast<double>(n), 0.05 * n) << n;
+    }
+
+    // merging two sketches counts the union
+    HyperLogLog a, b;
+    for (int64_t i = 0; i < 60000; ++i) {
+        a.add(statsHash("k" + std::to_string(i)));
+        b.add(statsHash("k" + std::to_string(i + 40000)));
+    }
+    a.merge(b);
+    EXPECT_NEAR(static_cast<double>(a.estimate()), 100000.0, 5000.0);
+}
+
+TEST(ColumnStats, HistogramIsEquiDepthAndKeepsRunsTogether) {
+    std::vector<int64_t> values;
+    for (int64_t i = 1000; i-- > 0;)
+        values.push_back(i);
+    for (int i = 0; i < 500; ++i)
+        values.push_back(7); // a run that must not be split
+    Histogram h{values, 10};
+    EXPECT_EQ(h.rows(), 1500u);
+    uint64_t rows = 0;
+    int64_t previous = std::numeric_limits<int64_t>::min();
+    for (const auto& b : h.buckets()) {
+        EXPECT_GT(b.lo, previous);
+        EXPECT_LE(b.lo, b.hi);
+        previous = b.hi;
+        rows += b.rows;
+    }
+    EXPECT_EQ(rows, 1500u);
+    EXPECT_EQ(h.buckets().front().lo, 0);
+    EXPECT_EQ(h.buckets().back().hi, 999);
+
+    EXPECT_DOUBLE_EQ(h.fractionAtMost(-1), 0.0);
+    EXPECT_DOUBLE_EQ(h.fractionAtMost(999), 1.0);
+    EXPECT_NEAR(h.fractionAtMost(7), 508.0 / 1500, 0.01);
+    EXPECT_NEAR(h.fractionAtMost(499), 1000.0 / 1500, 0.02);
+    EXPECT_TRUE(Histogram{}.buckets().empty());
+    EXPECT_DOUBLE_EQ(Histogram{}.fractionAtMost(0), 0.0);
+}
+
+TEST(ColumnStats, SelectivityFromMinMaxDistinctAndHistogram) {
+    ColumnStats ints{ColumnType::Int};
+    std::vector<int64_t> values;
+    for (int64_t i = 0; i < 10000; ++i) {
+        ints.add(i % 100);
+        values.push_back(i % 100);
+    }
+    ints.histogram = Histogram{values};
+    EXPECT_EQ(ints.min->asInt(), 0);
+    EXPECT_EQ(ints.max->asInt(), 99);
+    EXPECT_NEAR(static_cast<double>(ints.distinctCount(10000)), 100.0, 5.0);
+    EXPECT_EQ(ints.distinctCount(50), 50u);
+
+    EXPECT_NEAR(ints.selectivity(CompareOp::Eq, VInt(5), 10000), 0.01, 0.001);
+    EXPECT_DOUBLE_EQ(ints.selectivity(CompareOp::Eq, VInt(500), 10000), 0.0);
+    EXPECT_NEAR(ints.selectivity(CompareOp::Neq, VInt(5), 10000), 0.99, 0.001);
+    EXPECT_NEAR(ints.selectivity(CompareOp::Lt, VInt(25), 10000), 0.25, 0.02);
+    EXPECT_NEAR(ints.selectivity(CompareOp::Ge, VInt(90), 10000), 0.10, 0.02);
+    EXPECT_DOUBLE_EQ(ints.selectivity(CompareOp::Gt, VInt(99), 10000), 0.0);
+    EXPECT_DOUBLE_EQ(ints.selectivity(CompareOp::Le, VInt(99), 10000), 1.0);
+    EXPECT_DOUBLE_EQ(ints.selectivity(CompareOp::Lt, VInt(std::numeric_limits<int64_t>::min()),
+                                      10000),
+                     0.0);
+    EXPECT_NEAR(ints.fractionBetween(10, 19), 0.10, 0.02);
+    EXPECT_DOUBLE_EQ(ints.fractionBetween(20, 10), 0.0);
+
+    // no histogram: an even spread over [min, max]
+    ColumnStats spread{ColumnType::Int};
+    spread.add(int64_t{0});
+    spread.add(int64_t{99});
+    EXPECT_NEAR(spread.selectivity(CompareOp::Le, VInt(49), 2), 0.5, 1e-9);
+
+    ColumnStats strs{ColumnType::Str};
+    EXPECT_DOUBLE_EQ(strs.selectivity(CompareOp::Eq, VStr("a"), 0), 0.0);
+    for (const char* s : {"b", "c", "d", "e", "b"})
+        strs.add(std::string_view{s});
+    EXPECT_EQ(strs.min->asStr(), "b");
+    EXPECT_EQ(strs.max->asStr(), "e");
+    EXPECT_NEAR(strs.selectivity(CompareOp::Eq, VStr("c"), 5), 0.25, 1e-9);
+    EXPECT_DOUBLE_EQ(strs.selectivity(CompareOp::Eq, VStr("a"), 5), 0.0);
+    EXPECT_NEAR(strs.selectivity(CompareOp::Neq, VStr("c"), 5), 0.75, 1e-9);
+}
+
+TEST(ColumnStats, TableAnalyzeAndMaintenance) {
+    Table t{Schema{{{"id", ColumnType::Int},
+                    {"city", ColumnType::Str, ColumnEncoding::Dictionary},
+                    {"name", ColumnType::Str}}}};
+    EXPECT_EQ(t.stats(), nullptr);
+    const char* cities[] = {"Paris", "London", "Rome", "Oslo"};
+    for (int64_t i = 0; i < 70000; ++i) // two row groups
+        t.insertRow(Row{{VInt(i), VStr(cities[i % 4]), VStr("n" + std::to_string(i))}});
+    EXPECT_EQ(t.stats(), nullptr); // nothing is collected before ANALYZE
+
+    ThreadPool pool{3};
+    t.analyze(&pool);
+    const TableStats* stats = t.stats();
+    ASSERT_NE(stats, nullptr);
+    EXPECT_EQ(stats->rows, 70000u);
+    EXPECT_EQ(stats->columns[0].min->asInt(), 0);
+    EXPECT_EQ(stats->columns[0].max->asInt(), 69999);
+    EXPECT_NEAR(static_cast<double>(stats->columns[0].distinctCount(70000)), 70000.0, 3500.0);
+    EXPECT_EQ(stats->columns[0].histogram.rows(), 70000u);
+    EXPECT_EQ(stats->columns[1].distinctCount(70000), 4u);
+    EXPECT_EQ(stats->columns[1].min->asStr(), "London");
+    EXPECT_EQ(stats->columns[1].max->asStr(), "Rome");
+    EXPECT_TRUE(stats->columns[1].histogram.buckets().empty());
+    EXPECT_NEAR(static_cast<double>(stats->columns[2].distinctCount(70000)), 70000.0, 3500.0);
+
+    // AND multiplies, OR adds the shares as if independent
+    const Schema& schema = t.getSchema();
+    And both{std::make_unique<WhereExpr>(
+                 Comparison{"city", CompareOp::Eq, VStr("Rome"), std::nullopt}),
+             std::make_unique<WhereExpr>(
+                 Comparison{"id", CompareOp::Lt, VInt(35000), std::nullopt})};
+    EXPECT_NEAR(stats->selectivity(WhereExpr{std::move(both)}, schema), 0.125, 0.01);
+    Or either{std::make_unique<WhereExpr>(
+                  Comparison{"city", CompareOp::Eq, VStr("Rome"), std::nullopt}),
+              std::make_unique<WhereExpr>(
+                  Comparison{"city", CompareOp::Eq, VStr("Oslo"), std::nullopt})};
+    EXPECT_NEAR(stats->selectivity(WhereExpr{std::move(either)}, schema), 0.4375, 1e-9);
+
+    // inserts and updates widen min / max and the sketches, deletes lower the row count
+    t.insertRow(Row{{VInt(-5), VStr("Bern"), VStr("x")}});
+    EXPECT_EQ(stats->rows, 70001u);
+    EXPECT_EQ(stats->columns[0].min->asInt(), -5);
+    EXPECT_EQ(stats->columns[1].distinctCount(70001), 5u);
+    EXPECT_EQ(stats->columns[1].min->asStr(), "Bern");
+    (void)t.updateWhere([](const RowView& r) { return r.intAt(0) == 1; },
+                        {{0, RowValue{100000}}});
+    EXPECT_EQ(stats->columns[0].max->asInt(), 100000);
+    // -5 and 0..999 except the updated 1
+    EXPECT_EQ(t.deleteWhere([](const RowView& r) { return r.intAt(0) < 1000; }), 1000u);
+    EXPECT_EQ(stats->rows, 69001u);
+
+    // deleting everything leaves exact, empty statistics
+    t.deleteAllRows();
+    ASSERT_EQ(t.stats(), stats);
+    EXPECT_EQ(stats->rows, 0u);
+    EXPECT_FALSE(stats->columns[0].min);
+    EXPECT_EQ(stats->columns[0].distinctCount(0), 0u);
+}
@@ -0,0 +1,121 @@
+//
+// Created by Ilya Nyrkov on 02.09.25.
+//
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memoria/ColumnStorage.h>
+#include <memoria/Table.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace memoria;
+
+TEST(ColumnStorage, IntColumnAppendAndCompact) {
+    IntColumn c;
+    for (int64_t v : {1, 2, 3, 4})
+        c.append(v);
+    ASSERT_EQ(c.size(), 4u);
+    EXPECT_EQ(c.data()[2], 3);
+
+    c.compact({1, 0, 1, 0});
+    ASSERT_EQ(c.size(), 2u);
+    EXPECT_EQ(c.at(0), 1);
+    EXPECT_EQ(c.at(1), 3);
+}
+
+TEST(ColumnStorage, StrColumnHeapAndOffsets) {
+    StrColumn c;
+    c.append("alpha");
+    c.append("");
+    c.append("gamma");
+    ASSERT_EQ(c.size(), 3u);
+    EXPECT_EQ(c.at(0), "alpha");
+    EXPECT_EQ(c.at(1), "");
+    EXPECT_EQ(c.at(2), "gamma");
+
+    c.compact({0, 1, 1});
+    ASSERT_EQ(c.size(), 2u);
+    EXPECT_EQ(c.at(0), "");
+    EXPECT_EQ(c.at(1), "gamma");
+
+    c.append("delta");
+    c.assign({1, 0, 1}, "zz");
+    ASSERT_EQ(c.size(), 3u);
+    EXPECT_EQ(c.at(0), "zz");
+    EXPECT_EQ(c.at(1), "gamma");
+    EXPECT_EQ(c.at(2), "zz");
+}
+
+TEST(ColumnStorage, TableRowViewPredicateReadsColumns) {
+    Table t{Schema{{{"name", ColumnType::Str}, {"age", ColumnType::Int}}}};
+    t.insertRow(Row{RowValue{std::string{"ann"}}, RowValue{int64_t{31}}});
+    t.insertRow(Row{RowValue{std::string{"bob"}}, RowValue{int64_t{17}}});
+    t.insertRow(Row{RowValue{std::string{"cid"}}, RowValue{int64_t{45}}});
+
+    auto adults = t.getColumnRowsWhere({0}, [](const RowView& r) { return r.intAt(1) >= 18; });
+    ASSERT_EQ(adults.size(), 2u);
+    EXPECT_EQ(adults[0].at(0).str(), "ann");
+    EXPECT_EQ(adults[1].at(0).str(), "cid");
+
+    EXPECT_EQ(t.deleteWhere([](const RowView& r) { return r.strAt(0) == "bob"; }), 1u);
+    EXPECT_EQ(t.rowCount(), 2u);
+}
+
+TEST(ColumnStorage, DictionaryInternsOnce) {
+    auto dict = std::make_shared<StrDictionary>();
+    DictColumn c{dict};
+    for (const char* v : {"DE", "FR", "DE", "DE", "US"})
+        c.append(v);
+    ASSERT_EQ(c.size(), 5u);
+    EXPECT_EQ(dict->size(), 3u);
+    EXPECT_EQ(c.code(0), c.code(2));
+    EXPECT_EQ(c.at(4), "US");
+    EXPECT_EQ(dict->find("FR"), c.code(1));
+    EXPECT_FALSE(dict->find("IT").has_value());
+
+    c.assign({1, 1, 0, 0, 0}, "IT");
+    EXPECT_EQ(c.at(0), "IT");
+    EXPECT_EQ(c.at(2), "DE");
+    EXPECT_EQ(dict->size(), 4u);
+}
+
+TEST(ColumnStorage, TableDictionarySharedAcrossRowGroups) {
+    Table t{Schema{{{"cc", ColumnType::Str, ColumnEncoding::Dictionary}}}};
+    ASSERT_NE(t.dictionary(0), nullptr);
+    for (size_t i = 0; i < kRowGroupSize + 3; ++i)
+        t.insertRow(Row{RowValue{std::string{i % 2 ? "odd" : "even"}}});
+    ASSERT_EQ(t.rowGroupCount(), 2u);
+    EXPECT_EQ(t.dictionary(0)->size(), 2u);
+
+    const uint32_t odd = *t.dictionary(0)->find("odd");
+    auto rows = t.getRowsWhere([&](const RowView& r) { return r.codeAt(0) == odd; });
+    EXPECT_EQ(rows.size(), (kRowGroupSize + 3) / 2);
+    EXPECT_EQ(rows.back().at(0).str(), "odd");
+}
+
+TEST(ColumnStorage, DictionaryRejectsIntColumn) {
+    EXPECT_THROW((Schema{{{"n", ColumnType::Int, ColumnEncoding::Dictionary}}}),
+                 std::invalid_argument);
+}
+
+TEST(ColumnStorage, StrColumnArenaReclaimsDeadBytes) {
+    StrColumn c;
+    const std::string big(1000, 'x');
+    for (int i = 0; i < 200; ++i)
+        c.append(big + std::to_string(i));
+    c.append("short");
+    EXPECT_EQ(c.at(7), big + "7");
+    EXPECT_TRUE(c.ref(200).isInline());
+
+    // rewrite every long row many times; refs must stay valid as the arena is collected
+    std::vector<uint8_t> mask(201, 1);
+    mask[200] = 0;
+    for (int round = 0; round < 50; ++round)
+        c.assign(mask, big + "r" + std::to_string(round));
+    EXPECT_EQ(c.at(0), big + "r49");
+    EXPECT_EQ(c.at(199), big + "r49");
+    EXPECT_EQ(c.at(200), "short");
+}
@@ -25,8 +25,8 @@ TEST(Database, CreateAndGetTable) {
 
     // insert a row to prove it's the same table
     std::vector<RowValue> v;
-    v.emplace_back(std::in_place_type<std::string>, "a");
-    v.emplace_back(std::in_place_type<int64_t>, 1);
+    v.emplace_back("a");
+    v.emplace_back(1);
     t.insertRow(Row{v});
     EXPECT_EQ(t.rowCount(), 1u);
 }
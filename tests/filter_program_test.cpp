@@ -0,0 +1,265 @@
+//
+// Created by Ilya Nyrkov on 13.09.25.
+//
+
+#include <cstdint>
+#include <functional>
+#include <gtest/gtest.h>
+#include <limits>
+#include <memoria/FilterCompiler.h>
+#include <memoria/FilterProgram.h>
+#include <memoria/Table.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace memoria;
+
+static const std::string kLong = "a string longer than inline";
+
+// k: 0..n-1, s: kLong on every third row, d: "red"/"green"/"blue" round robin
+static Table makeTable(int64_t n) {
+    Table t{Schema{{Column{"k", ColumnType::Int}, Column{"s", ColumnType::Str},
+                    Column{"d", ColumnType::Str, ColumnEncoding::Dictionary}}}};
+    const char* colors[] = {"red", "green", "blue"};
+    for (int64_t i = 0; i < n; ++i)
+        t.insertRow(Row{RowValue{i}, RowValue{i % 3 ? "x" : kLong}, RowValue{colors[i % 3]}});
+    return t;
+}
+
+// every evaluation path must agree with the reference predicate
+static void expectSelects(const FilterProgram& program, const RowGroup& group,
+                          const std::function<bool(int64_t)>& expected) {
+    std::vector<uint32_t> want;
+    for (std::size_t i = 0; i < group.size(); ++i) {
+        if (expected(static_cast<int64_t>(i)))
+            want.push_back(static_cast<uint32_t>(i));
+    }
+
+    const auto bound = program.bind(group);
+    std::vector<uint32_t> sel;
+    bound.select(sel);
+    EXPECT_EQ(sel, want);
+
+    // refine keeps only candidates that match
+    std::vector<uint32_t> candidates, wantCandidates;
+    for (uint32_t i = 0; i < group.size(); i += 3) {
+        candidates.push_back(i);
+        if (expected(i))
+            wantCandidates.push_back(i);
+    }
+    bound.refine(candidates);
+    EXPECT_EQ(candidates, wantCandidates);
+    for (std::size_t i = 0; i < group.size(); ++i) {
+        ASSERT_EQ(bound(i), expected(static_cast<int64_t>(i))) << "row " << i;
+        ASSERT_EQ(program(group.row(i)), expected(static_cast<int64_t>(i))) << "row " << i;
+    }
+}
+
+TEST(FilterProgram, DefaultAndConstantPrograms) {
+    Table t = makeTable(10);
+    expectSelects(FilterProgram{}, t.rowGroup(0), [](int64_t) { return true; });
+
+    FilterProgram none;
+    none.finish(FilterProgram::kReject);
+    expectSelects(none, t.rowGroup(0), [](int64_t) { return false; });
+    EXPECT_TRUE(none.instructions().empty());
+}
+
+TEST(FilterProgram, ConjunctionOfIntTests) {
+    // several batches, the last one partial
+    Table t = makeTable(2 * FilterProgram::kBatchRows + 77);
+    using P = FilterProgram;
+    P program;
+    const uint32_t ne = program.emit(FilterOp::IntNe, 0, 15, P::kAccept, P::kReject);
+    const uint32_t lt = program.emit(FilterOp::IntLt, 0, 20, ne, P::kReject);
+    program.finish(program.emit(FilterOp::IntGe, 0, 10, lt, P::kReject));
+    ASSERT_EQ(program.instructions().size(), 3u);
+    EXPECT_EQ(program.instructions()[0].op, FilterOp::IntGe); // entry comes first
+    expectSelects(program, t.rowGroup(0), [](int64_t k) { return k >= 10 && k < 20 && k != 15; });
+
+    for (FilterOp op : {FilterOp::IntEq, FilterOp::IntNe, FilterOp::IntLt, FilterOp::IntGt,
+                        FilterOp::IntLe, FilterOp::IntGe}) {
+        P single;
+        single.finish(single.emit(op, 0, 500, P::kAccept, P::kReject));
+        const std::function<bool(int64_t)> ref[] = {
+            [](int64_t k) { return k == 500; }, [](int64_t k) { return k != 500; },
+            [](int64_t k) { return k < 500; },  [](int64_t k) { return k > 500; },
+            [](int64_t k) { return k <= 500; }, [](int64_t k) { return k >= 500; }};
+        expectSelects(single, t.rowGroup(0), ref[static_cast<int>(op)]);
+    }
+}
+
+TEST(FilterProgram, StringAndCodeTests) {
+    Table t = makeTable(300);
+    using P = FilterProgram;
+    const auto green = t.dictionary(2)->find("green");
+    ASSERT_TRUE(green.has_value());
+
+    // s = kLong AND d != green
+    P program;
+    const uint32_t d = program.emit(FilterOp::CodeNe, 2, *green, P::kAccept, P::kReject);
+    program.finish(program.emitStr(FilterOp::StrEq, 1, RowValue{kLong}, d, P::kReject));
+    expectSelects(program, t.rowGroup(0), [](int64_t k) { return k % 3 == 0; });
+
+    // copies own their literals
+    P copy = program;
+    program = P{};
+    expectSelects(copy, t.rowGroup(0), [](int64_t k) { return k % 3 == 0; });
+}
+
+TEST(FilterProgram, GeneralShapeShortCircuits) {
+    Table t = makeTable(FilterProgram::kBatchRows + 100);
+    using P = FilterProgram;
+
+    // (k < 10 OR s != "x") AND k > 5
+    P program;
+    const uint32_t gt = program.emit(FilterOp::IntGt, 0, 5, P::kAccept, P::kReject);
+    const uint32_t s = program.emitStr(FilterOp::StrNe, 1, RowValue{"x"}, gt, P::kReject);
+    program.finish(program.emit(FilterOp::IntLt, 0, 10, gt, s));
+    expectSelects(program, t.rowGroup(0),
+                  [](int64_t k) { return (k < 10 || k % 3 == 0) && k > 5; });
+}
+
+TEST(FilterProgram, IntRangeTests) {
+    Table t = makeTable(FilterProgram::kBatchRows + 100);
+    using P = FilterProgram;
+    for (const auto& [lo, hi] : std::vector<std::pair<int64_t, int64_t>>{
+             {10, 20}, {-5, 3}, {2000, 2100}, {7, 7}, {std::numeric_limits<int64_t>::min(), 4},
+             {50, std::numeric_limits<int64_t>::max()}}) {
+        P program;
+        program.finish(program.emitRange(0, lo, hi, P::kAccept, P::kReject));
+        expectSelects(program, t.rowGroup(0),
+                      [lo = lo, hi = hi](int64_t k) { return lo <= k && k <= hi; });
+    }
+    P empty;
+    EXPECT_THROW((void)empty.emitRange(0, 5, 4, P::kAccept, P::kReject), std::invalid_argument);
+}
+
+// ---- compileFilter ----
+
+static WhereExpr cmp(std::string column, CompareOp op, RowValue literal) {
+    return Comparison{std::move(column), op, std::move(literal), std::nullopt};
+}
+static WhereExpr both(WhereExpr l, WhereExpr r) {
+    return And{std::make_unique<WhereExpr>(std::move(l)),
+               std::make_unique<WhereExpr>(std::move(r))};
+}
+static WhereExpr either(WhereExpr l, WhereExpr r) {
+    return Or{std::make_unique<WhereExpr>(std::move(l)),
+              std::make_unique<WhereExpr>(std::move(r))};
+}
+
+TEST(FilterCompiler, FoldsBoundsOnOneColumnIntoARange) {
+    Table t = makeTable(3000);
+    // (k > 5 AND s = kLong) AND (k < 100 AND k >= 7): nested chains flatten, the bounds fold
+    auto program = compileFilter(both(both(cmp("k", CompareOp::Gt, RowValue{5}),
+                                           cmp("s", CompareOp::Eq, RowValue{kLong})),
+                                      both(cmp("k", CompareOp::Lt, RowValue{100}),
+                                           cmp("k", CompareOp::Ge, RowValue{7}))),
+                                 t);
+    ASSERT_EQ(program.instructions().size(), 2u);
+    EXPECT_EQ(program.instructions()[0].op, FilterOp::IntBetween);
+    expectSelects(program, t.rowGroup(0),
+                  [](int64_t k) { return k >= 7 && k < 100 && k % 3 == 0; });
+
+    // bounds that cannot all hold reject every row without a test; a single value is an equality
+    program = compileFilter(both(cmp("k", CompareOp::Gt, RowValue{5}),
+                                 cmp("k", CompareOp::Lt, RowValue{3})),
+                            t);
+    EXPECT_TRUE(program.instructions().empty());
+    expectSelects(program, t.rowGroup(0), [](int64_t) { return false; });
+    program = compileFilter(both(cmp("k", CompareOp::Ge, RowValue{5}),
+                                 cmp("k", CompareOp::Le, RowValue{5})),
+                            t);
+    ASSERT_EQ(program.instructions().size(), 1u);
+    EXPECT_EQ(program.instructions()[0].op, FilterOp::IntEq);
+
+    // an OR is not folded, and a dictionary literal that never occurs drops out
+    program = compileFilter(either(cmp("d", CompareOp::Eq, RowValue{"purple"}),
+                                   either(cmp("k", CompareOp::Lt, RowValue{3}),
+                                          cmp("k", CompareOp::Gt, RowValue{2990}))),
+                            t);
+    ASSERT_EQ(program.instructions().size(), 2u);
+    expectSelects(program, t.rowGroup(0), [](int64_t k) { return k < 3 || k > 2990; });
+
+    EXPECT_THROW((void)compileFilter(cmp("s", CompareOp::Lt, RowValue{"x"}), t),
+                 std::invalid_argument);
+    EXPECT_THROW((void)compileFilter(cmp("k", CompareOp::Eq, RowValue{"x"}), t),
+                 std::invalid_argument);
+    EXPECT_THROW((void)compileFilter(cmp("nope", CompareOp::Eq, RowValue{1}), t),
+                 std::out_of_range);
+}
+
+static WhereExpr param(std::string column, CompareOp op, std::size_t index) {
+    Comparison c{std::move(column), op, RowValue{}, std::nullopt};
+    c.param = index;
+    return c;
+}
+
+TEST(FilterCompiler, BindsParameters) {
+    Table t = makeTable(3000);
+    // bounds on a parameter are not folded: its value is not known yet
+    auto program = compileFilter(both(both(param("k", CompareOp::Ge, 0),
+                                           cmp("k", CompareOp::Lt, RowValue{100})),
+                                      either(param("d", CompareOp::Eq, 1),
+                                             param("s", CompareOp::Neq, 2))),
+                                 t);
+    EXPECT_EQ(program.params().size(), 3u);
+    EXPECT_EQ(program.instructions().size(), 4u);
+
+    bindFilter(program, {RowValue{10}, RowValue{"green"}, RowValue{kLong}}, t);
+    expectSelects(program, t.rowGroup(0),
+                  [](int64_t k) { return k >= 10 && k < 100 && k % 3 != 0; });
+    // rebinding replaces every value; a string missing from the dictionary matches no row
+    bindFilter(program, {RowValue{50}, RowValue{"purple"}, RowValue{"x"}}, t);
+    expectSelects(program, t.rowGroup(0),
+                  [](int64_t k) { return k >= 50 && k < 100 && k % 3 == 0; });
+    bindFilter(program, {RowValue{95}, RowValue{"red"}, RowValue{kLong}}, t);
+    expectSelects(program, t.rowGroup(0), [](int64_t k) { return k >= 95 && k < 100; });
+
+    program = compileFilter(param("d", CompareOp::Neq, 0), t);
+    bindFilter(program, {RowValue{"purple"}}, t);
+    expectSelects(program, t.rowGroup(0), [](int64_t) { return true; });
+    EXPECT_THROW((void)compileFilter(param("s", CompareOp::Lt, 0), t), std::invalid_argument);
+}
+
+TEST(FilterCompiler, OrdersTestsByCostAndSelectivity) {
+    Table t = makeTable(70000);
+    const auto first = [](const FilterProgram& p) { return p.instructions().front().op; };
+
+    // int before string at the same selectivity: k % 3 == 0 rows have s = kLong
+    EXPECT_EQ(first(compileFilter(both(cmp("s", CompareOp::Eq, RowValue{kLong}),
+                                       cmp("k", CompareOp::Lt, RowValue{700})),
+                                  t)),
+              FilterOp::IntLt);
+    // a test every row passes goes last, whatever it costs
+    auto program = compileFilter(both(cmp("k", CompareOp::Ge, RowValue{0}),
+                                      cmp("d", CompareOp::Eq, RowValue{"red"})),
+                                 t);
+    EXPECT_EQ(first(program), FilterOp::CodeEq);
+    expectSelects(program, t.rowGroup(0), [](int64_t k) { return k % 3 == 0; });
+    // OR starts with the test that accepts most rows per unit of cost
+    program = compileFilter(either(cmp("s", CompareOp::Eq, RowValue{kLong}),
+                                   cmp("k", CompareOp::Ge, RowValue{0})),
+                            t);
+    EXPECT_EQ(first(program), FilterOp::IntGe);
+    expectSelects(program, t.rowGroup(0), [](int64_t) { return true; });
+    // ties keep the written order
+    program = compileFilter(both(cmp("k", CompareOp::Neq, RowValue{2}),
+                                 cmp("k", CompareOp::Neq, RowValue{1})),
+                            t);
+    EXPECT_EQ(program.instructions().front().operand, 2);
+
+    // the first batch alone says every row passes k < 2048; the statistics know better
+    const auto where = [] {
+        return both(cmp("s", CompareOp::Eq, RowValue{kLong}),
+                    cmp("k", CompareOp::Lt, RowValue{2048}));
+    };
+    EXPECT_EQ(first(compileFilter(where(), t)), FilterOp::StrEq);
+    t.analyze();
+    program = compileFilter(where(), t);
+    EXPECT_EQ(first(program), FilterOp::IntLt);
+    expectSelects(program, t.rowGroup(0), [](int64_t k) { return k < 2048 && k % 3 == 0; });
+}
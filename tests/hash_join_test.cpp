@@ -0,0 +1,86 @@
+//
+// Created by Ilya Nyrkov on 24.09.25.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memoria/HashJoin.h>
+#include <memoria/Row.h>
+#include <memoria/Schema.h>
+#include <memoria/Table.h>
+#include <memoria/ThreadPool.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace memoria;
+
+static std::vector<RowId> allRows(const Table& t) {
+    return t.getRowIdsWhere([](const RowView&) { return true; });
+}
+
+// every pair with equal keys, in (left, right) order
+static std::vector<JoinPair> nestedLoop(const Table& l, std::size_t lc, const Table& r,
+                                        std::size_t rc) {
+    std::vector<JoinPair> out;
+    for (const RowId a : allRows(l)) {
+        const RowValue x = l.rowGroup(rowIdGroup(a)).row(rowIdOffset(a)).at(lc);
+        for (const RowId b : allRows(r)) {
+            if (x == r.rowGroup(rowIdGroup(b)).row(rowIdOffset(b)).at(rc))
+                out.emplace_back(a, b);
+        }
+    }
+    return out;
+}
+
+TEST(HashJoin, PartitionedAndInCacheJoinsAgree) {
+    Table orders{Schema{{{"id", ColumnType::Int}, {"customer", ColumnType::Str}}}};
+    Table customers{Schema{{{"name", ColumnType::Str}, {"rank", ColumnType::Int}}}};
+    for (int64_t i = 0; i < 3000; ++i)
+        orders.insertRow(Row{{RowValue{i}, RowValue{"c" + std::to_string(i % 250)}}});
+    for (int64_t i = 0; i < 300; ++i) // c250..c299 match nothing, c0..c9 twice
+        customers.insertRow(Row{{RowValue{"c" + std::to_string(i < 290 ? i : i - 290)},
+                                 RowValue{i % 10}}});
+
+    JoinInput left{&orders, 1, allRows(orders)};
+    JoinInput right{&customers, 0, allRows(customers)};
+    auto expected = nestedLoop(orders, 1, customers, 0);
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected.size(), 3000u + 10 * 12);
+
+    for (std::size_t threads : {1u, 4u}) {
+        ThreadPool pool{threads};
+        auto inCache = hashJoin(left, right, pool);
+        auto partitioned = hashJoin(left, right, pool, 1024); // forces radix partitioning
+        // the smaller table is built, so the result follows the probe side: orders in order
+        EXPECT_TRUE(std::is_sorted(inCache.begin(), inCache.end()));
+        std::sort(partitioned.begin(), partitioned.end());
+        EXPECT_EQ(inCache, expected);
+        EXPECT_EQ(partitioned, expected);
+    }
+}
+
+TEST(HashJoin, IntKeysFilteredInputsAndErrors) {
+    Table a{Schema{{{"k", ColumnType::Int}}}};
+    Table b{Schema{{{"k", ColumnType::Int}, {"s", ColumnType::Str}}}};
+    for (int64_t i = 0; i < 100; ++i)
+        a.insertRow(Row{{RowValue{i % 7}}});
+    for (int64_t i = 0; i < 10; ++i)
+        b.insertRow(Row{{RowValue{i}, RowValue{"x"}}});
+
+    ThreadPool pool{2};
+    // only the rows handed in take part
+    JoinInput left{&a, 0, {makeRowId(0, 3), makeRowId(0, 10)}}; // keys 3 and 3
+    JoinInput right{&b, 0, allRows(b)};
+    EXPECT_EQ(hashJoin(left, right, pool),
+              (std::vector<JoinPair>{{makeRowId(0, 3), makeRowId(0, 3)},
+                                     {makeRowId(0, 10), makeRowId(0, 3)}}));
+    left.rows.clear();
+    EXPECT_TRUE(hashJoin(left, right, pool).empty());
+
+    JoinInput mismatched{&b, 1, allRows(b)};
+    EXPECT_THROW((void)hashJoin(JoinInput{&a, 0, allRows(a)}, mismatched, pool),
+                 std::invalid_argument);
+    EXPECT_GT(l2CacheBytes(), 0u);
+}
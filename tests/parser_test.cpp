@@ -3,13 +3,16 @@
 //
 // tests/parser_test.cpp
 #include <gtest/gtest.h>
+#include <memoria/Lexer.h>
 #include <memoria/Parser.h>
 #include <memoria/Row.h>
 #include <memoria/Schema.h>
 #include <memoria/Statement.h>
+#include <cctype>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -18,7 +21,7 @@
 using namespace memoria;
 
 static Comparison Cmp(std::string col, CompareOp op, RowValue lit) {
-    return Comparison{std::move(col), op, std::move(lit)};
+    return Comparison{std::move(col), op, std::move(lit), std::nullopt};
 }
 
 static WhereExpr W(Comparison c) {
@@ -40,11 +43,11 @@ static WhereExpr WOr(WhereExpr l, WhereExpr r) {
 }
 
 static bool rowValueEq(const RowValue& a, const RowValue& b) {
-    if (a.index() != b.index())
+    if (a.isInt() != b.isInt())
         return false;
-    if (std::holds_alternative<int64_t>(a))
-        return std::get<int64_t>(a) == std::get<int64_t>(b);
-    return std::get<std::string>(a) == std::get<std::string>(b);
+    if (a.isInt())
+        return a.asInt() == b.asInt();
+    return a.str() == b.str();
 }
 
 // compare to WhereExpr objects
@@ -100,6 +103,267 @@ TEST(Parser, CreateTable_Basic) {
     EXPECT_EQ(ct.schema.columns()[1].type, ColumnType::Str);
 }
 
+TEST(Parser, CreateTable_DictEncodedStr) {
+    Parser p;
+    auto st = p.prepareStatement("CREATE TABLE t (id int, status str dict, note str);");
+
+    ASSERT_TRUE(std::holds_alternative<CreateTable>(st));
+    const auto& cols = std::get<CreateTable>(st).schema.columns();
+    ASSERT_EQ(cols.size(), 3u);
+    EXPECT_EQ(cols[0].encoding, ColumnEncoding::Plain);
+    EXPECT_EQ(cols[1].type, ColumnType::Str);
+    EXPECT_EQ(cols[1].encoding, ColumnEncoding::Dictionary);
+    EXPECT_EQ(cols[2].encoding, ColumnEncoding::Plain);
+}
+
+TEST(Parser, CreateIndex) {
+    Parser p;
+    auto st = p.prepareStatement("CREATE INDEX users_id ON users ( id );");
+
+    ASSERT_TRUE(std::holds_alternative<CreateIndex>(st));
+    const auto& ci = std::get<CreateIndex>(st);
+    EXPECT_EQ(ci.indexName, "users_id");
+    EXPECT_EQ(ci.table, "users");
+    EXPECT_EQ(ci.column, "id");
+    EXPECT_EQ(ci.kind, IndexKind::Hash);
+
+    auto bt = p.prepareStatement("CREATE INDEX by_ts ON events(ts) USING btree");
+    EXPECT_EQ(std::get<CreateIndex>(bt).kind, IndexKind::BTree);
+    EXPECT_THROW((void)p.prepareStatement("CREATE INDEX i ON t(c) USING rtree"), ParseError);
+
+    EXPECT_THROW((void)p.prepareStatement("CREATE INDEX i ON t(c) extra"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("CREATE INDEX i t(c)"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("CREATE INDEX i ON t(c) WHERE c = 1"), ParseError);
+}
+
+TEST(Parser, Select_Aggregates) {
+    Parser p;
+    auto st = p.prepareStatement("SELECT COUNT(*), sum( c2 ), MIN(c1), Max(c2), AVG(c2) FROM t "
+                                 "WHERE c2 > 1;");
+    ASSERT_TRUE(std::holds_alternative<Select>(st));
+    const auto& sel = std::get<Select>(st);
+    ASSERT_TRUE(hasAggregates(sel));
+    const auto& items = std::get<std::vector<SelectItem>>(sel.projection);
+    ASSERT_EQ(items.size(), 5u);
+    std::vector<std::string> names;
+    for (const auto& item : items)
+        names.push_back(aggregateName(std::get<Aggregate>(item)));
+    EXPECT_EQ(names, (std::vector<std::string>{"COUNT(*)", "SUM(c2)", "MIN(c1)", "MAX(c2)",
+                                               "AVG(c2)"}));
+    EXPECT_TRUE(sel.where.has_value());
+
+    // plain columns next to aggregates are kept, in order
+    auto mixed = std::get<Select>(p.prepareStatement("SELECT c1, COUNT(c2) FROM t"));
+    const auto& mixedItems = std::get<std::vector<SelectItem>>(mixed.projection);
+    ASSERT_EQ(mixedItems.size(), 2u);
+    EXPECT_EQ(std::get<std::string>(mixedItems[0]), "c1");
+
+    EXPECT_FALSE(hasAggregates(std::get<Select>(p.prepareStatement("SELECT c1, c2 FROM t"))));
+    EXPECT_THROW((void)p.prepareStatement("SELECT SUM(*) FROM t"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT MEDIAN(c2) FROM t"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT COUNT(c2 FROM t"), ParseError);
+}
+
+TEST(Parser, Select_GroupBy) {
+    Parser p;
+    auto sel = std::get<Select>(
+        p.prepareStatement("SELECT c1, k, SUM(c2) FROM t WHERE c1 = 'GROUP BY' GROUP BY c1, k;"));
+    EXPECT_EQ(sel.groupBy, (std::vector<std::string>{"c1", "k"}));
+    ASSERT_TRUE(sel.where.has_value());
+    EXPECT_EQ(std::get<Comparison>(*sel.where).literal.asStr(), "GROUP BY");
+    EXPECT_TRUE(isAggregation(sel));
+
+    // grouping without aggregates keeps the plain column list
+    auto keys = std::get<Select>(p.prepareStatement("SELECT c1 FROM t GROUP BY c1"));
+    EXPECT_TRUE(std::holds_alternative<std::vector<std::string>>(keys.projection));
+    EXPECT_EQ(keys.groupBy, std::vector<std::string>{"c1"});
+    EXPECT_TRUE(isAggregation(keys));
+    EXPECT_FALSE(isAggregation(std::get<Select>(p.prepareStatement("SELECT c1 FROM t"))));
+
+    EXPECT_THROW((void)p.prepareStatement("SELECT c1 FROM t GROUP BY"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT c1 FROM t GROUP BY c1,"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT c1 FROM t GROUP BY c1 c2"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("DELETE FROM t GROUP BY c1"), ParseError);
+}
+
+TEST(Parser, Select_OrderByLimit) {
+    Parser p;
+    auto sel = std::get<Select>(p.prepareStatement(
+        "SELECT c1, COUNT(*) FROM t WHERE c2 > 0 GROUP BY c1 ORDER BY COUNT(*) DESC LIMIT 10 "
+        "OFFSET 20;"));
+    EXPECT_EQ(sel.groupBy, std::vector<std::string>{"c1"});
+    ASSERT_TRUE(sel.orderBy.has_value());
+    EXPECT_EQ(aggregateName(std::get<Aggregate>(sel.orderBy->item)), "COUNT(*)");
+    EXPECT_TRUE(sel.orderBy->descending);
+    EXPECT_EQ(sel.limit, std::optional<uint64_t>{10});
+    EXPECT_EQ(sel.offset, 20u);
+    EXPECT_TRUE(sel.where.has_value());
+
+    auto asc = std::get<Select>(p.prepareStatement("SELECT * FROM t ORDER BY c2 ASC"));
+    EXPECT_EQ(std::get<std::string>(asc.orderBy->item), "c2");
+    EXPECT_FALSE(asc.orderBy->descending);
+    EXPECT_FALSE(asc.limit.has_value());
+
+    auto limited = std::get<Select>(p.prepareStatement("SELECT * FROM t LIMIT 0"));
+    EXPECT_FALSE(limited.orderBy.has_value());
+    EXPECT_EQ(limited.limit, std::optional<uint64_t>{0});
+    EXPECT_EQ(limited.offset, 0u);
+
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t LIMIT -1"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t LIMIT 5 ORDER BY c2"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t ORDER BY c2 UP"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t LIMIT 1 OFFSET"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("DELETE FROM t LIMIT 1"), ParseError);
+}
+
+TEST(Parser, Select_Join) {
+    Parser p;
+    auto sel = std::get<Select>(
+        p.prepareStatement("SELECT o.id, name FROM o JOIN c ON o.cid = c.id WHERE c.rank > 2 "
+                           "ORDER BY o.id LIMIT 5"));
+    EXPECT_EQ(sel.table, "o");
+    ASSERT_TRUE(sel.join.has_value());
+    EXPECT_EQ(sel.join->table, "c");
+    EXPECT_EQ(sel.join->left, "o.cid");
+    EXPECT_EQ(sel.join->right, "c.id");
+    EXPECT_EQ(std::get<std::vector<std::string>>(sel.projection),
+              (std::vector<std::string>{"o.id", "name"}));
+    EXPECT_EQ(std::get<Comparison>(*sel.where).column, "c.rank");
+    EXPECT_EQ(std::get<std::string>(sel.orderBy->item), "o.id");
+    EXPECT_FALSE(std::get<Select>(p.prepareStatement("SELECT * FROM o")).join.has_value());
+
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM o JOIN c"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM o JOIN c ON o.cid < c.id"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM o JOIN c ON o. = c.id"), ParseError);
+}
+
+TEST(Parser, Explain) {
+    Parser p;
+    auto st = p.prepareStatement("EXPLAIN SELECT c1 FROM t WHERE c2 > 1 ORDER BY c2 LIMIT 3;");
+    ASSERT_TRUE(std::holds_alternative<Explain>(st));
+    const auto& sel = std::get<Select>(*std::get<Explain>(st).statement);
+    EXPECT_EQ(sel.table, "t");
+    EXPECT_EQ(std::get<Comparison>(*sel.where).column, "c2");
+    EXPECT_EQ(sel.limit, 3u);
+    EXPECT_FALSE(std::get<Explain>(st).analyze);
+    auto analyze = p.prepareStatement("EXPLAIN ANALYZE DELETE FROM t");
+    EXPECT_TRUE(std::get<Explain>(analyze).analyze);
+    EXPECT_TRUE(std::holds_alternative<Delete>(*std::get<Explain>(analyze).statement));
+
+    EXPECT_THROW((void)p.prepareStatement("EXPLAIN EXPLAIN SELECT * FROM t"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("EXPLAIN ANALYZE EXPLAIN SELECT * FROM t"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("EXPLAIN"), ParseError);
+}
+
+TEST(Parser, AnalyzeAndShowStats) {
+    Parser p;
+    auto st = p.prepareStatement("ANALYZE Users;");
+    ASSERT_TRUE(std::holds_alternative<Analyze>(st));
+    EXPECT_EQ(std::get<Analyze>(st).table, "Users");
+    st = p.prepareStatement("SHOW STATS Users");
+    ASSERT_TRUE(std::holds_alternative<ShowStats>(st));
+    EXPECT_EQ(std::get<ShowStats>(st).table, "Users");
+    // EXPLAIN ANALYZE still reads as EXPLAIN
+    EXPECT_TRUE(std::get<Explain>(p.prepareStatement("EXPLAIN ANALYZE SELECT * FROM t")).analyze);
+
+    EXPECT_THROW((void)p.prepareStatement("ANALYZE"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("ANALYZE t u"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("ANALYZE t WHERE c = 1"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SHOW STATS"), ParseError);
+}
+
+TEST(Parser, PrepareExecuteDeallocate) {
+    Parser p;
+    // placeholders are numbered in the order they are written: SET before WHERE
+    auto st = p.prepareStatement("PREPARE q AS UPDATE t SET c1 = ?, c2 = 3 WHERE c2 > ? OR "
+                                 "(c1 = 'a' AND c2 < ?)");
+    ASSERT_TRUE(std::holds_alternative<Prepare>(st));
+    EXPECT_EQ(std::get<Prepare>(st).name, "q");
+    const auto& upd = std::get<Update>(*std::get<Prepare>(st).statement);
+    EXPECT_EQ(upd.set[0].param, 0u);
+    EXPECT_FALSE(upd.set[1].param);
+    const auto& o = std::get<Or>(*upd.where);
+    EXPECT_EQ(std::get<Comparison>(*o.lhs).param, 1u);
+    const auto& a = std::get<And>(*o.rhs);
+    EXPECT_FALSE(std::get<Comparison>(*a.lhs).param);
+    EXPECT_EQ(std::get<Comparison>(*a.rhs).param, 2u);
+
+    st = p.prepareStatement("PREPARE ins AS INSERT INTO t VALUES (?, 1), ('x', ?)");
+    EXPECT_EQ(std::get<Insert>(*std::get<Prepare>(st).statement).params,
+              (std::vector<std::pair<std::size_t, std::size_t>>{{0, 0}, {1, 1}}));
+
+    st = p.prepareStatement("EXECUTE q(1, 'two' , -3);");
+    ASSERT_TRUE(std::holds_alternative<Execute>(st));
+    const auto& ex = std::get<Execute>(st);
+    EXPECT_EQ(ex.name, "q");
+    ASSERT_EQ(ex.args.size(), 3u);
+    EXPECT_EQ(ex.args[1].str(), "two");
+    EXPECT_EQ(ex.args[2].asInt(), -3);
+    EXPECT_TRUE(std::get<Execute>(p.prepareStatement("EXECUTE q")).args.empty());
+    EXPECT_TRUE(std::get<Execute>(p.prepareStatement("EXECUTE q()")).args.empty());
+    EXPECT_EQ(std::get<Deallocate>(p.prepareStatement("DEALLOCATE q")).name, "q");
+
+    // the C++ API parses placeholders without PREPARE
+    st = p.prepareParameterized("SELECT * FROM t WHERE c1 = ? AND c2 = ?");
+    EXPECT_EQ(std::get<Comparison>(*std::get<And>(*std::get<Select>(st).where).rhs).param, 1u);
+
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t WHERE c1 = ?"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("EXPLAIN SELECT * FROM t WHERE c1 = ?"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("PREPARE q SELECT * FROM t"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("PREPARE q AS EXPLAIN SELECT * FROM t"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("PREPARE q AS PREPARE r AS SELECT * FROM t"),
+                 ParseError);
+    EXPECT_THROW((void)p.prepareStatement("PREPARE q AS SELECT * FROM t LIMIT ?"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("EXECUTE q(1"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("EXECUTE q(?)"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("DEALLOCATE q r"), ParseError);
+}
+
+TEST(Parser, Fingerprint) {
+    Parser p;
+    auto fp = p.fingerprint("  SELECT id, t2.x FROM t2 WHERE (a = -5 OR b != 'it')\n"
+                            "  AND c >= +7 AND d = \"x y\" ORDER BY a LIMIT 10 OFFSET 3 ; ");
+    ASSERT_TRUE(fp);
+    EXPECT_EQ(fp->text, "SELECT id, t2.x FROM t2 WHERE (a = ? OR b != ?) AND c >= ? AND d = ? "
+                        "ORDER BY a LIMIT 10 OFFSET 3");
+    ASSERT_EQ(fp->literals.size(), 4u);
+    EXPECT_EQ(fp->literals[0].asInt(), -5);
+    EXPECT_EQ(fp->literals[1].asStr(), "it");
+    EXPECT_EQ(fp->literals[2].asInt(), 7);
+    EXPECT_EQ(fp->literals[3].asStr(), "x y");
+
+    // statements that differ only in values and spacing share the text, which parses
+    const auto a = p.fingerprint("UPDATE t SET v = 1, w = 'a' WHERE k = 2");
+    const auto b = p.fingerprint("UPDATE t  SET v=10, w='bb'  WHERE k =  20;");
+    ASSERT_TRUE(a && b);
+    EXPECT_EQ(a->text, "UPDATE t SET v = ?, w = ? WHERE k = ?");
+    EXPECT_EQ(b->text, "UPDATE t SET v=?, w=? WHERE k = ?");
+    const auto c = p.fingerprint("UPDATE t SET v = 10, w = 'bb' WHERE k = 20");
+    ASSERT_TRUE(c);
+    EXPECT_EQ(c->text, a->text);
+    auto st = p.prepareParameterized(a->text);
+    ASSERT_TRUE(std::holds_alternative<Update>(st));
+    EXPECT_EQ(std::get<Update>(st).set[1].param, std::optional<std::size_t>{1});
+
+    EXPECT_FALSE(p.fingerprint("SELECT * FROM t WHERE a = ?"));
+    EXPECT_FALSE(p.fingerprint("SELECT * FROM t WHERE a = 'open"));
+    EXPECT_FALSE(p.fingerprint("SELECT * FROM t WHERE a = 99999999999999999999"));
+    EXPECT_EQ(p.fingerprint("SELECT * FROM t WHERE x1 = '?'")->text,
+              "SELECT * FROM t WHERE x1 = ?");
+}
+
+TEST(Parser, Set) {
+    Parser p;
+    auto st = p.prepareStatement("SET threads = 8;");
+    ASSERT_TRUE(std::holds_alternative<Set>(st));
+    EXPECT_EQ(std::get<Set>(st).name, "threads");
+    EXPECT_EQ(std::get<Set>(st).value, 8);
+
+    EXPECT_THROW((void)p.prepareStatement("SET threads 8"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SET threads = 'x'"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SET threads = 8 9"), ParseError);
+}
+
 TEST(Parser, Insert_Values) {
     Parser p;
     auto st = p.prepareStatement("INSERT INTO t VALUES (42, 'foo');");
@@ -114,11 +378,11 @@ TEST(Parser, Insert_Values) {
     const auto& row0 = ins.rows[0];
     ASSERT_EQ(row0.size(), 2u);
 
-    EXPECT_TRUE(std::holds_alternative<int64_t>(row0[0]));
-    EXPECT_EQ(std::get<int64_t>(row0[0]), 42);
+    EXPECT_TRUE(row0[0].isInt());
+    EXPECT_EQ(row0[0].asInt(), 42);
 
-    EXPECT_TRUE(std::holds_alternative<std::string>(row0[1]));
-    EXPECT_EQ(std::get<std::string>(row0[1]), "foo");
+    EXPECT_TRUE(row0[1].isStr());
+    EXPECT_EQ(row0[1].str(), "foo");
 }
 
 TEST(Parser, Insert_WithColumnList) {
@@ -136,8 +400,8 @@ TEST(Parser, Insert_WithColumnList) {
     ASSERT_EQ(ins.rows.size(), 1u);
     const auto& row0 = ins.rows[0];
     ASSERT_EQ(row0.size(), 2u);
-    EXPECT_EQ(std::get<int64_t>(row0[0]), 7);
-    EXPECT_EQ(std::get<std::string>(row0[1]), "x");
+    EXPECT_EQ(row0[0].asInt(), 7);
+    EXPECT_EQ(row0[1].str(), "x");
 }
 
 TEST(Parser, Insert_MultiRow) {
@@ -152,14 +416,14 @@ TEST(Parser, Insert_MultiRow) {
 
     ASSERT_EQ(ins.rows.size(), 3u);
 
-    EXPECT_EQ(std::get<int64_t>(ins.rows[0][0]), 1);
-    EXPECT_EQ(std::get<std::string>(ins.rows[0][1]), "a");
+    EXPECT_EQ(ins.rows[0][0].asInt(), 1);
+    EXPECT_EQ(ins.rows[0][1].str(), "a");
 
-    EXPECT_EQ(std::get<int64_t>(ins.rows[1][0]), 2);
-    EXPECT_EQ(std::get<std::string>(ins.rows[1][1]), "b");
+    EXPECT_EQ(ins.rows[1][0].asInt(), 2);
+    EXPECT_EQ(ins.rows[1][1].str(), "b");
 
-    EXPECT_EQ(std::get<int64_t>(ins.rows[2][0]), 3);
-    EXPECT_EQ(std::get<std::string>(ins.rows[2][1]), "c");
+    EXPECT_EQ(ins.rows[2][0].asInt(), 3);
+    EXPECT_EQ(ins.rows[2][1].str(), "c");
 }
 
 TEST(Parser, Delete_WithWhere) {
@@ -184,11 +448,11 @@ TEST(Parser, Update_Set_WithWhere_AND) {
     EXPECT_EQ(up.table, "t");
     ASSERT_EQ(up.set.size(), 2u);
     EXPECT_EQ(up.set[0].column, "c2");
-    EXPECT_TRUE(std::holds_alternative<int64_t>(up.set[0].value));
-    EXPECT_EQ(std::get<int64_t>(up.set[0].value), 7);
+    EXPECT_TRUE(up.set[0].value.isInt());
+    EXPECT_EQ(up.set[0].value.asInt(), 7);
     EXPECT_EQ(up.set[1].column, "c1");
-    EXPECT_TRUE(std::holds_alternative<std::string>(up.set[1].value));
-    EXPECT_EQ(std::get<std::string>(up.set[1].value), "x");
+    EXPECT_TRUE(up.set[1].value.isStr());
+    EXPECT_EQ(up.set[1].value.str(), "x");
 
     WhereExpr expWhere = WAnd(W(Cmp("c2", CompareOp::Ge, RowValue{int64_t{3}})),
                               W(Cmp("c1", CompareOp::Neq, RowValue{std::string{"y"}})));
@@ -255,11 +519,11 @@ TEST(Parser, Script_SplitOutsideQuotes) {
         const auto& row0 = ins.rows[0];
         ASSERT_EQ(row0.size(), 2u);
 
-        EXPECT_TRUE(std::holds_alternative<int64_t>(row0[0]));
-        EXPECT_EQ(std::get<int64_t>(row0[0]), 1);
+        EXPECT_TRUE(row0[0].isInt());
+        EXPECT_EQ(row0[0].asInt(), 1);
 
-        EXPECT_TRUE(std::holds_alternative<std::string>(row0[1]));
-        EXPECT_EQ(std::get<std::string>(row0[1]), "a;b;c");
+        EXPECT_TRUE(row0[1].isStr());
+        EXPECT_EQ(row0[1].str(), "a;b;c");
     }
     // #2 DELETE WHERE
     {
@@ -300,11 +564,11 @@ TEST(Parser, Whitespace_And_TrailingSemicolonOptional) {
     ASSERT_EQ(a.size(), 2u);
     ASSERT_EQ(b.size(), 2u);
 
-    EXPECT_EQ(std::get<int64_t>(a[0]), 2);
-    EXPECT_EQ(std::get<std::string>(a[1]), "x");
+    EXPECT_EQ(a[0].asInt(), 2);
+    EXPECT_EQ(a[1].str(), "x");
 
-    EXPECT_EQ(std::get<int64_t>(b[0]), 2);
-    EXPECT_EQ(std::get<std::string>(b[1]), "x");
+    EXPECT_EQ(b[0].asInt(), 2);
+    EXPECT_EQ(b[1].str(), "x");
 }
 
 TEST(Parser, CaseSensitivity_Keywords) {
@@ -321,4 +585,130 @@ TEST(Parser, CaseSensitivity_Keywords) {
     } catch (...) {
         FAIL() << "Expected memoria::ParseError, got non-std exception";
     }
-}
\ No newline at end of file
+}
+
+TEST(Parser, InsertStream_BatchesRowsFedInPieces) {
+    const std::string sql =
+        "INSERT INTO t (a, b) VALUES (1, 'x)y'), (2,\"b\" ) ,(3, 'c'),(4, 'd'), (5, 'e')  ";
+    // every split point, including inside keywords, numbers and quoted strings
+    for (std::size_t piece = 1; piece <= sql.size(); ++piece) {
+        std::vector<Insert> batches;
+        InsertStream stream{[&](Insert&& b) { batches.push_back(std::move(b)); }, 2};
+        for (std::size_t at = 0; at < sql.size(); at += piece)
+            stream.feed(std::string_view{sql}.substr(at, piece));
+        stream.finish();
+
+        ASSERT_EQ(batches.size(), 3u) << "piece " << piece;
+        EXPECT_EQ(stream.rows(), 5u);
+        for (const Insert& b : batches) {
+            EXPECT_EQ(b.tableName, "t");
+            EXPECT_EQ(b.columnNames, (std::vector<std::string>{"a", "b"}));
+            EXPECT_TRUE(b.params.empty());
+        }
+        ASSERT_EQ(batches[0].rows.size(), 2u);
+        ASSERT_EQ(batches[2].rows.size(), 1u);
+        EXPECT_EQ(batches[0].rows[0][1].str(), "x)y");
+        EXPECT_EQ(batches[0].rows[1][1].str(), "b");
+        EXPECT_EQ(batches[1].rows[1][0].asInt(), 4);
+        EXPECT_EQ(batches[2].rows[0][0].asInt(), 5);
+    }
+}
+
+TEST(Parser, InsertStream_Errors) {
+    const auto run = [](std::string_view sql, std::size_t& handedOn) {
+        handedOn = 0;
+        InsertStream stream{[&](Insert&& b) { handedOn += b.rows.size(); }, 1};
+        stream.feed(sql);
+        stream.finish();
+    };
+    std::size_t handedOn = 0;
+    EXPECT_THROW(run("INSERT INTO t VALUES (1), (2) x", handedOn), ParseError);
+    EXPECT_EQ(handedOn, 2u); // batches before the error stay handed on
+    EXPECT_THROW(run("INSERT INTO t VALUES (1), (2", handedOn), ParseError);
+    EXPECT_EQ(handedOn, 1u);
+    EXPECT_THROW(run("INSERT INTO t VALUES (1),", handedOn), ParseError);
+    EXPECT_THROW(run("INSERT INTO t VALUES", handedOn), ParseError);
+    EXPECT_THROW(run("INSERT INTO t (1)", handedOn), ParseError);
+    EXPECT_THROW(run("INSERT INTO t VALUES (?)", handedOn), ParseError);
+    EXPECT_EQ(handedOn, 0u);
+}
+
+TEST(Lexer, TokensAreViewsIntoTheText) {
+    const std::string_view sql = "SELECT t.a,COUNT(*) FROM t WHERE b<=-12 AND c!='x;y'?;";
+    const std::vector<Token> tokens = tokenize(sql);
+    std::vector<TokenKind> kinds;
+    for (const Token& t : tokens) {
+        kinds.push_back(t.kind);
+        if (t.kind != TokenKind::End) { // no copies: every view points into sql
+            EXPECT_TRUE(t.text.data() >= sql.data() && t.text.data() < sql.data() + sql.size());
+        }
+    }
+    using K = TokenKind;
+    EXPECT_EQ(kinds, (std::vector<TokenKind>{K::Word, K::Word, K::Dot, K::Word, K::Comma, K::Word,
+                                             K::LParen, K::Star, K::RParen, K::Word, K::Word,
+                                             K::Word, K::Word, K::Le, K::Int, K::Word, K::Word,
+                                             K::Neq, K::String, K::Param, K::Semicolon, K::End}));
+    EXPECT_EQ(tokens[0].keyword, Keyword::Select);
+    EXPECT_TRUE(tokens[0].upper);
+    EXPECT_EQ(tokens[1].keyword, Keyword::None); // t
+    EXPECT_EQ(tokens[14].text, "-12");
+    EXPECT_EQ(tokens[18].text, "x;y");
+    EXPECT_EQ(tokens[18].pos, sql.find('\''));
+
+    EXPECT_THROW((void)tokenize("SELECT * FROM t WHERE a = 'open"), ParseError);
+    EXPECT_THROW((void)tokenize("SELECT a # b"), ParseError);
+    EXPECT_THROW((void)tokenize("a ! b"), ParseError);
+}
+
+TEST(Lexer, KeywordLookupIgnoresCase) {
+    // every keyword is found in any case through its own hash slot
+    for (auto k = static_cast<int>(Keyword::Select); k <= static_cast<int>(Keyword::Avg); ++k) {
+        const auto kw = static_cast<Keyword>(k);
+        const std::string upper{keywordText(kw)};
+        std::string lower = upper;
+        for (char& c : lower)
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        EXPECT_EQ(lookupKeyword(upper), kw) << upper;
+        EXPECT_EQ(lookupKeyword(lower), kw) << lower;
+    }
+    EXPECT_EQ(lookupKeyword("BTree"), Keyword::BTree);
+    for (std::string_view word :
+         {"", "A", "SELECTS", "SELEC", "FORM", "users", "t1", "DEALLOCATED", "_", "OR_", "AND1"})
+        EXPECT_EQ(lookupKeyword(word), Keyword::None) << word;
+
+    // lower-case keywords are words, so statements still need them in upper case
+    const std::vector<Token> tokens = tokenize("select Count");
+    EXPECT_EQ(tokens[0].keyword, Keyword::Select);
+    EXPECT_FALSE(tokens[0].upper);
+    EXPECT_EQ(tokens[1].keyword, Keyword::Count);
+    EXPECT_FALSE(tokens[1].upper);
+}
+
+TEST(Parser, Tokens_SpacingAndKeywordsAsNames) {
+    Parser p;
+    // tokens need no spaces between them
+    auto sel = std::get<Select>(p.prepareStatement("SELECT*FROM t WHERE(a>=+1 AND b='x')OR c<2"));
+    EXPECT_TRUE(std::holds_alternative<Select::Star>(sel.projection));
+    const auto& o = std::get<Or>(*sel.where);
+    EXPECT_EQ(std::get<Comparison>(*std::get<And>(*o.lhs).lhs).literal.asInt(), 1);
+
+    // keywords are only keywords where the grammar expects them, and in upper case
+    auto named =
+        std::get<Select>(p.prepareStatement("SELECT count, order FROM limit WHERE on = 1"));
+    EXPECT_EQ(std::get<std::vector<std::string>>(named.projection),
+              (std::vector<std::string>{"count", "order"}));
+    EXPECT_EQ(named.table, "limit");
+    EXPECT_EQ(std::get<Comparison>(*named.where).column, "on");
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t ORDER BY a desc"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t WHERE a = 1 and b = 2"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * from t"), ParseError);
+
+    EXPECT_THROW((void)p.prepareStatement("CREATE TABLE t (a int b int)"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("CREATE TABLE t (a integer)"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("UPDATE t SET a = 1 LIMIT 1"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement("SELECT * FROM t; SELECT * FROM u"), ParseError);
+    EXPECT_THROW((void)p.prepareStatement(";"), ParseError);
+    EXPECT_TRUE(p.prepareStatements(" ;; ").empty());
+    EXPECT_THROW((void)p.prepareStatements("SELECT * FROM t; DELETE FROM t WHERE a = ?"),
+                 ParseError);
+}
@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <gtest/gtest.h>
 #include <memoria/Row.h>
+#include <memoria/StringRef.h>
 #include <stdexcept>
 #include <string>
 #include <variant>
@@ -11,7 +12,7 @@ using namespace memoria;
 static Row rowSI(std::string s, int64_t i) {
     std::vector<RowValue> v;
     v.emplace_back(std::move(s));
-    v.emplace_back(std::in_place_type<int64_t>, i);
+    v.emplace_back(i);
     return Row{std::move(v)};
 }
 
@@ -20,25 +21,25 @@ TEST(Row, AccessAndTypesConst) {
     const RowValue& v0 = r.at(0);
     const RowValue& v1 = r.at(1);
 
-    EXPECT_TRUE(std::holds_alternative<std::string>(v0));
-    EXPECT_TRUE(std::holds_alternative<int64_t>(v1));
-    EXPECT_EQ(std::get<std::string>(v0), "foo");
-    EXPECT_EQ(std::get<int64_t>(v1), 42);
+    EXPECT_TRUE(v0.isStr());
+    EXPECT_TRUE(v1.isInt());
+    EXPECT_EQ(v0.str(), "foo");
+    EXPECT_EQ(v1.asInt(), 42);
 }
 
 TEST(Row, MutateThroughNonConstAt) {
     Row r = rowSI("x", 1);
-    r.at(0).emplace<std::string>("bar");
-    r.at(1).emplace<int64_t>(7);
+    r.at(0) = "bar";
+    r.at(1) = 7;
 
-    EXPECT_EQ(std::get<std::string>(r.at(0)), "bar");
-    EXPECT_EQ(std::get<int64_t>(r.at(1)), 7);
+    EXPECT_EQ(r.at(0).str(), "bar");
+    EXPECT_EQ(r.at(1).asInt(), 7);
 }
 
 TEST(Row, MutateInPlaceViaReference) {
     Row r = rowSI("hi", 5);
-    std::get<std::string>(r.at(0)) += " there";
-    EXPECT_EQ(std::get<std::string>(r.at(0)), "hi there");
+    r.at(0) = r.at(0).str() + " there";
+    EXPECT_EQ(r.at(0).str(), "hi there");
 }
 
 TEST(Row, OutOfRangeThrows) {
@@ -60,3 +61,49 @@ TEST(Row, Size) {
     Row r = rowSI("a", 1);
     EXPECT_EQ(r.size(), 2u);
 }
+
+TEST(RowValue, CompactTaggedLayout) {
+    EXPECT_EQ(sizeof(RowValue), 16u);
+    EXPECT_EQ(sizeof(StringRef), 16u);
+
+    const RowValue i{int64_t{-5}};
+    const RowValue s{"twelve bytes"};
+    EXPECT_TRUE(i.isInt());
+    EXPECT_TRUE(s.isStr());
+    EXPECT_TRUE(s.strRef().isInline());
+    EXPECT_THROW((void)i.asStr(), std::bad_variant_access);
+    EXPECT_THROW((void)s.asInt(), std::bad_variant_access);
+}
+
+TEST(RowValue, LongStringsCopyAndMove) {
+    const std::string text = "a string well past the inline limit";
+    RowValue a{text};
+    EXPECT_FALSE(a.strRef().isInline());
+
+    RowValue b = a; // deep copy
+    EXPECT_NE(a.asStr().data(), b.asStr().data());
+    EXPECT_EQ(b.asStr(), text);
+
+    RowValue c = std::move(a);
+    EXPECT_EQ(c.asStr(), text);
+    EXPECT_EQ(a.asStr(), ""); // moved-from is reset to an empty string, not dangling
+
+    c = RowValue{int64_t{9}};
+    EXPECT_EQ(c.asInt(), 9);
+}
+
+TEST(RowValue, EqualityAndPrefix) {
+    EXPECT_TRUE(RowValue{"same long string value"} == RowValue{"same long string value"});
+    EXPECT_FALSE(RowValue{"same long string value"} == RowValue{"same long string valuE"});
+    EXPECT_FALSE(RowValue{"abcd-long-string-one"} == RowValue{"abce-long-string-one"});
+    EXPECT_FALSE(RowValue{"short"} == RowValue{"shorT"});
+    EXPECT_FALSE(RowValue{"1"} == RowValue{int64_t{1}});
+    EXPECT_TRUE(RowValue{int64_t{1}} == RowValue{int64_t{1}});
+    EXPECT_TRUE(RowValue{""} == RowValue{std::string_view{}});
+
+    const StringRef ref{std::string_view{"prefix-then-the-rest"}};
+    EXPECT_TRUE(ref.startsWith("pre"));
+    EXPECT_TRUE(ref.startsWith("prefix-then"));
+    EXPECT_FALSE(ref.startsWith("prefix-than"));
+    EXPECT_FALSE(ref.startsWith("x"));
+}
@@ -44,10 +44,10 @@ TEST(Schema, DefaultValues) {
     auto v0 = s.default_value(0);
     auto v1 = s.default_value(1);
 
-    EXPECT_TRUE(std::holds_alternative<std::string>(v0));
-    EXPECT_EQ(std::get<std::string>(v0), "");
-    EXPECT_TRUE(std::holds_alternative<int64_t>(v1));
-    EXPECT_EQ(std::get<int64_t>(v1), 0);
+    EXPECT_TRUE(v0.isStr());
+    EXPECT_EQ(v0.str(), "");
+    EXPECT_TRUE(v1.isInt());
+    EXPECT_EQ(v1.asInt(), 0);
 }
 
 TEST(Schema, DuplicateColumnsRejected) {
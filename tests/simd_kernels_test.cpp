@@ -0,0 +1,190 @@
+//
+// Created by Ilya Nyrkov on 16.09.25.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <limits>
+#include <memoria/SimdKernels.h>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace memoria;
+
+static std::vector<SimdLevel> supportedLevels() {
+    std::vector<SimdLevel> levels{SimdLevel::Scalar};
+    if (detectSimdLevel() >= SimdLevel::Avx2)
+        levels.push_back(SimdLevel::Avx2);
+    if (detectSimdLevel() >= SimdLevel::Avx512)
+        levels.push_back(SimdLevel::Avx512);
+    return levels;
+}
+
+static bool reference(IntCompare op, int64_t a, int64_t b) {
+    switch (op) {
+    case IntCompare::Eq:
+        return a == b;
+    case IntCompare::Ne:
+        return a != b;
+    case IntCompare::Lt:
+        return a < b;
+    case IntCompare::Gt:
+        return a > b;
+    case IntCompare::Le:
+        return a <= b;
+    case IntCompare::Ge:
+        return a >= b;
+    }
+    return false;
+}
+
+TEST(SimdKernels, DispatchPicksASupportedLevel) {
+    EXPECT_EQ(simdKernels().level, detectSimdLevel());
+    EXPECT_EQ(simdKernelsFor(SimdLevel::Scalar).level, SimdLevel::Scalar);
+    if (detectSimdLevel() < SimdLevel::Avx512) {
+        EXPECT_THROW((void)simdKernelsFor(SimdLevel::Avx512), std::invalid_argument);
+    }
+}
+
+TEST(SimdKernels, CompareMatchesScalarForAllOpsAndTails) {
+    std::mt19937_64 rng{7};
+    std::uniform_int_distribution<int64_t> small{-3, 3};
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+
+    // lengths around word and vector boundaries, few distinct values so every op hits both ways
+    for (std::size_t rows : {0u, 1u, 3u, 4u, 7u, 8u, 9u, 31u, 63u, 64u, 65u, 100u, 127u, 128u,
+                             129u, 200u}) {
+        std::vector<int64_t> cells(rows + 8); // slack past `rows` must never be read as a match
+        for (auto& c : cells)
+            c = small(rng);
+        if (rows > 2) {
+            cells[0] = kMin;
+            cells[rows - 1] = kMax;
+        }
+        const std::size_t words = (rows + 63) / 64;
+        std::vector<uint64_t> reach(words, ~uint64_t{0});
+        if (words > 1)
+            reach[1] = 0; // unreached words come back empty
+
+        for (int op = 0; op < 6; ++op) {
+            for (int64_t rhs : {int64_t{0}, int64_t{2}, kMin, kMax}) {
+                std::vector<uint64_t> want(words, 0);
+                for (std::size_t i = 0; i < rows; ++i) {
+                    if (reach[i / 64] != 0 && reference(IntCompare(op), cells[i], rhs))
+                        want[i / 64] |= uint64_t{1} << (i % 64);
+                }
+                for (SimdLevel level : supportedLevels()) {
+                    std::vector<uint64_t> got(words, 0xDEAD);
+                    simdKernelsFor(level).compare[op](cells.data(), rows, rhs, reach.data(),
+                                                      got.data());
+                    ASSERT_EQ(got, want) << "level " << int(level) << " op " << op << " rows "
+                                         << rows << " rhs " << rhs;
+                }
+            }
+        }
+    }
+}
+
+TEST(SimdKernels, CompressAndCount) {
+    std::mt19937_64 rng{11};
+    for (std::size_t words : {0u, 1u, 2u, 5u, 32u}) {
+        std::vector<uint64_t> bits(words);
+        for (auto& w : bits)
+            w = rng() & rng(); // about a quarter of the bits set
+        if (words > 0)
+            bits[0] = ~uint64_t{0};
+
+        std::vector<uint32_t> want;
+        for (std::size_t i = 0; i < words * 64; ++i) {
+            if (bits[i / 64] >> (i % 64) & 1)
+                want.push_back(static_cast<uint32_t>(1000 + i));
+        }
+        EXPECT_EQ(countBits(bits.data(), words), want.size());
+        for (SimdLevel level : supportedLevels()) {
+            std::vector<uint32_t> got(want.size());
+            EXPECT_EQ(simdKernelsFor(level).compress(bits.data(), words, 1000, got.data()),
+                      want.size());
+            EXPECT_EQ(got, want) << "level " << int(level);
+        }
+    }
+}
+
+TEST(SimdKernels, AggregateMatchesScalarWithAndWithoutSelection) {
+    std::mt19937_64 rng{13};
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+    for (std::size_t rows : {0u, 1u, 3u, 7u, 8u, 9u, 17u, 100u, 1000u}) {
+        std::vector<int64_t> cells(rows);
+        for (auto& c : cells)
+            c = static_cast<int64_t>(rng()); // full range, so halves carry and lanes would wrap
+        if (rows > 2) {
+            cells[1] = kMin;
+            cells[rows - 1] = kMax;
+        }
+        std::vector<uint32_t> sel;
+        for (uint32_t i = 0; i < rows; i += 1 + static_cast<uint32_t>(rng() % 3))
+            sel.push_back(i);
+
+        const std::vector<uint32_t>* selections[] = {nullptr, &sel};
+        for (const auto* s : selections) {
+            const std::size_t n = s ? s->size() : rows;
+            IntAccumulator want;
+            want.min = 5; // folds into an existing state
+            want.max = 5;
+            IntAccumulator base = want;
+            for (std::size_t k = 0; k < n; ++k) {
+                const int64_t v = cells[s ? (*s)[k] : k];
+                want.sumHigh += v >> 32;
+                want.sumLow += static_cast<uint64_t>(v) & 0xFFFFFFFFu;
+                want.min = std::min(want.min, v);
+                want.max = std::max(want.max, v);
+            }
+            for (SimdLevel level : supportedLevels()) {
+                IntAccumulator got = base;
+                simdKernelsFor(level).aggregate(cells.data(), s ? s->data() : nullptr, n, got);
+                // the halves may be split differently between lanes, the value may not
+                const auto normalized = [](const IntAccumulator& a) {
+                    return std::pair{a.sumHigh + static_cast<int64_t>(a.sumLow >> 32),
+                                     a.sumLow & 0xFFFFFFFFu};
+                };
+                EXPECT_EQ(normalized(got), normalized(want)) << "level " << int(level);
+                EXPECT_EQ(got.min, want.min);
+                EXPECT_EQ(got.max, want.max);
+            }
+        }
+    }
+}
+
+TEST(SimdKernels, AccumulatorSumAndAverageAreExact) {
+    auto fold = [](std::vector<int64_t> values) {
+        IntAccumulator acc;
+        simdKernels().aggregate(values.data(), nullptr, values.size(), acc);
+        return acc;
+    };
+    constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+    constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+
+    EXPECT_EQ(fold({}).sum(), 0);
+    EXPECT_EQ(fold({1, -2, 3}).sum(), 2);
+    EXPECT_EQ(fold({kMax, 1, -1}).sum(), kMax); // overflows on the way, not in the result
+    EXPECT_EQ(fold({kMin, -1, 1}).sum(), kMin);
+    EXPECT_FALSE(fold({kMax, 1}).sum().has_value());
+    EXPECT_FALSE(fold({kMin, -1}).sum().has_value());
+
+    EXPECT_EQ(fold({1, 2}).average(2), 1);
+    EXPECT_EQ(fold({-1, -2}).average(2), -1); // toward zero
+    EXPECT_EQ(fold({-7, 0, 0}).average(3), -2);
+    EXPECT_EQ(fold({kMax, kMax, kMax}).average(3), kMax);
+    EXPECT_EQ(fold({kMin, kMin}).average(2), kMin);
+    EXPECT_EQ(fold({kMax, kMin}).average(2), 0);
+
+    IntAccumulator a = fold({1, 9});
+    a.merge(fold({-3}));
+    EXPECT_EQ(a.sum(), 7);
+    EXPECT_EQ(a.min, -3);
+    EXPECT_EQ(a.max, 9);
+}
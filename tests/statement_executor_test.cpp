@@ -4,14 +4,23 @@
 
 // tests/executor_test.cpp
 #include <gtest/gtest.h>
+#include <memoria/BulkInsert.h>
 #include <memoria/Database.h>
+#include <memoria/Parser.h>
 #include <memoria/Row.h>
 #include <memoria/Schema.h>
 #include <memoria/Statement.h>
 #include <memoria/StatementExecutor.h>
+#include <memoria/StatementReader.h>
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <optional>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -41,7 +50,7 @@ static WhereExpr W(Comparison c) {
     return WhereExpr{std::move(c)};
 }
 static Comparison Cmp(std::string col, CompareOp op, RowValue lit) {
-    return Comparison{std::move(col), op, std::move(lit)};
+    return Comparison{std::move(col), op, std::move(lit), std::nullopt};
 }
 static WhereExpr WAnd(WhereExpr l, WhereExpr r) {
     And a;
@@ -105,10 +114,10 @@ static Delete deleteFrom(std::string table, std::optional<WhereExpr> w = std::nu
 
 // ---- tiny check helpers ----
 static std::string asStr(const Row& r, size_t i) {
-    return std::get<std::string>(r.at(i));
+    return r.at(i).str();
 }
 static int64_t asInt(const Row& r, size_t i) {
-    return std::get<int64_t>(r.at(i));
+    return r.at(i).asInt();
 }
 
 // ============================================================
@@ -178,6 +187,33 @@ TEST(StatementExecutor, ExecInsert_MultiRow) {
     EXPECT_EQ(asInt(qr.rows[1], 1), 2);
 }
 
+TEST(StatementExecutor, ExecInsert_BatchIsAllOrNothing) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+
+    // the lvalue overload leaves the statement as it was, the rvalue one may consume it
+    const Insert ins = insertRows("t", {"c2"}, {{VInt(1)}, {VInt(2)}, {VInt(3)}});
+    exec.execInsert(ins);
+    exec.execInsert(ins);
+    ASSERT_EQ(ins.rows.size(), 3u);
+    EXPECT_EQ(ins.rows[2][0].asInt(), 3);
+    exec.execInsert(insertRows("t", {"c2", "c1", "c2"}, {{VInt(0), VStr("dup"), VInt(9)}}));
+    QueryResult qr = exec.execSelect(selectStar("t"));
+    ASSERT_EQ(qr.rows.size(), 7u);
+    EXPECT_EQ(asStr(qr.rows[5], 0), ""); // omitted column: its default
+    EXPECT_EQ(asInt(qr.rows[5], 1), 3);
+    EXPECT_EQ(asStr(qr.rows[6], 0), "dup"); // a repeated column takes the last value
+    EXPECT_EQ(asInt(qr.rows[6], 1), 9);
+
+    // a bad last row: no row of the batch is inserted
+    EXPECT_THROW(exec.execInsert(insertRows("t", {}, {{VStr("a"), VInt(1)}, {VInt(2), VInt(2)}})),
+                 std::invalid_argument);
+    EXPECT_THROW(exec.execInsert(insertRows("t", {}, {{VStr("a"), VInt(1)}, {VStr("b")}})),
+                 std::invalid_argument);
+    EXPECT_EQ(exec.execSelect(selectStar("t")).rows.size(), 7u);
+}
+
 TEST(StatementExecutor, ExecInsert_ArityOrTypeMismatchThrows) {
     Database db;
     initTable(db);
@@ -241,7 +277,7 @@ TEST(StatementExecutor, ExecUpdate_SetWhere) {
     exec.execInsert(insertRows("t", {}, {{VStr("a"), VInt(1)}, {VStr("b"), VInt(2)}}));
 
     // UPDATE t SET c2 = 7 WHERE c1 = 'a'
-    std::vector<Assignment> sets = {Assignment{"c2", VInt(7)}};
+    std::vector<Assignment> sets = {Assignment{"c2", VInt(7), std::nullopt}};
     size_t changed = exec.execUpdate(updateSet("t", sets, W(Cmp("c1", CompareOp::Eq, VStr("a")))));
     EXPECT_EQ(changed, 1u);
 
@@ -259,7 +295,7 @@ TEST(StatementExecutor, ExecUpdate_UnknownColumnOrTypeMismatchThrows) {
 
     // unknown column
     try {
-        exec.execUpdate(updateSet("t", {Assignment{"nope", VInt(5)}}));
+        exec.execUpdate(updateSet("t", {Assignment{"nope", VInt(5), std::nullopt}}));
         FAIL() << "Expected out_of_range for unknown column";
     } catch (const std::out_of_range&) {
         SUCCEED();
@@ -269,7 +305,7 @@ TEST(StatementExecutor, ExecUpdate_UnknownColumnOrTypeMismatchThrows) {
 
     // type mismatch: set c2 (int) to string
     try {
-        exec.execUpdate(updateSet("t", {Assignment{"c2", VStr("oops")}}));
+        exec.execUpdate(updateSet("t", {Assignment{"c2", VStr("oops"), std::nullopt}}));
         FAIL() << "Expected invalid_argument for type mismatch";
     } catch (const std::invalid_argument&) {
         SUCCEED();
@@ -357,3 +393,1180 @@ TEST(StatementExecutor, Execute_Dispatch) {
     QueryResult after = exec.execSelect(selectStar("t"));
     EXPECT_TRUE(after.rows.empty());
 }
+
+TEST(StatementExecutor, DictColumn_EqualityUsesDictionary) {
+    Database db;
+    db.createTable("t", Schema{{{"c1", ColumnType::Str, ColumnEncoding::Dictionary},
+                                {"c2", ColumnType::Int}}});
+    StatementExecutor exec{db};
+    exec.execInsert(insertRows(
+        "t", {}, {{VStr("ok"), VInt(1)}, {VStr("err"), VInt(2)}, {VStr("ok"), VInt(3)}}));
+
+    QueryResult eq =
+        exec.execSelect(selectCols("t", {"c2"}, W(Cmp("c1", CompareOp::Eq, VStr("ok")))));
+    ASSERT_EQ(eq.rows.size(), 2u);
+    EXPECT_EQ(asInt(eq.rows[0], 0), 1);
+    EXPECT_EQ(asInt(eq.rows[1], 0), 3);
+
+    // literal absent from the dictionary
+    auto absentEq = exec.execSelect(selectStar("t", W(Cmp("c1", CompareOp::Eq, VStr("nope")))));
+    EXPECT_TRUE(absentEq.rows.empty());
+    auto absentNeq = exec.execSelect(selectStar("t", W(Cmp("c1", CompareOp::Neq, VStr("nope")))));
+    EXPECT_EQ(absentNeq.rows.size(), 3u);
+
+    // updates intern new values; string order comparisons are still rejected
+    EXPECT_EQ(exec.execUpdate(updateSet("t", {Assignment{"c1", VStr("warn"), std::nullopt}},
+                                        W(Cmp("c2", CompareOp::Eq, VInt(2))))),
+              1u);
+    QueryResult warn = exec.execSelect(selectStar("t", W(Cmp("c1", CompareOp::Eq, VStr("warn")))));
+    ASSERT_EQ(warn.rows.size(), 1u);
+    EXPECT_EQ(asInt(warn.rows[0], 1), 2);
+    EXPECT_THROW((void)exec.execSelect(selectStar("t", W(Cmp("c1", CompareOp::Lt, VStr("a"))))),
+                 std::invalid_argument);
+}
+
+TEST(StatementExecutor, CreateIndex_EqualityLookups) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    exec.execInsert(insertRows(
+        "t", {}, {{VStr("a"), VInt(1)}, {VStr("b"), VInt(2)}, {VStr("c"), VInt(2)}}));
+    exec.execCreateIndex(CreateIndex{"t_c2", "t", "c2"});
+    EXPECT_THROW(exec.execCreateIndex(CreateIndex{"bad", "t", "nope"}), std::out_of_range);
+
+    // index conjunct combined with a residual filter
+    QueryResult qr = exec.execSelect(selectStar(
+        "t", WAnd(W(Cmp("c1", CompareOp::Neq, VStr("b"))), W(Cmp("c2", CompareOp::Eq, VInt(2))))));
+    ASSERT_EQ(qr.rows.size(), 1u);
+    EXPECT_EQ(asStr(qr.rows[0], 0), "c");
+
+    QueryResult none = exec.execSelect(selectStar("t", W(Cmp("c2", CompareOp::Eq, VInt(9)))));
+    EXPECT_TRUE(none.rows.empty());
+    EXPECT_THROW((void)exec.execSelect(selectStar("t", W(Cmp("c2", CompareOp::Eq, VStr("x"))))),
+                 std::invalid_argument);
+
+    // UPDATE/DELETE through the index keep it consistent
+    EXPECT_EQ(exec.execUpdate(updateSet("t", {Assignment{"c2", VInt(5), std::nullopt}},
+                                        W(Cmp("c2", CompareOp::Eq, VInt(1))))),
+              1u);
+    EXPECT_EQ(exec.execDelete(deleteFrom("t", W(Cmp("c2", CompareOp::Eq, VInt(2))))), 2u);
+    QueryResult rest = exec.execSelect(selectStar("t", W(Cmp("c2", CompareOp::Eq, VInt(5)))));
+    ASSERT_EQ(rest.rows.size(), 1u);
+    EXPECT_EQ(asStr(rest.rows[0], 0), "a");
+
+    // OR cannot use the index but still answers correctly
+    QueryResult either = exec.execSelect(selectStar(
+        "t", WOr(W(Cmp("c2", CompareOp::Eq, VInt(5))), W(Cmp("c1", CompareOp::Eq, VStr("z"))))));
+    EXPECT_EQ(either.rows.size(), 1u);
+}
+
+TEST(StatementExecutor, BTreeIndex_RangeLookups) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < 1000; ++i)
+        rows.push_back({VStr(i % 2 ? "odd" : "even"), VInt(i)});
+    exec.execInsert(insertRows("t", {}, rows));
+    exec.execCreateIndex(CreateIndex{"t_c2", "t", "c2", IndexKind::BTree});
+    EXPECT_THROW(exec.execCreateIndex(CreateIndex{"t_c1", "t", "c1", IndexKind::BTree}),
+                 std::invalid_argument);
+
+    auto count = [&](WhereExpr w) {
+        return exec.execSelect(selectStar("t", std::move(w))).rows.size();
+    };
+
+    // bounds on the same column intersect; other conjuncts still filter
+    EXPECT_EQ(
+        count(WAnd(W(Cmp("c2", CompareOp::Ge, VInt(100))), W(Cmp("c2", CompareOp::Lt, VInt(110))))),
+        10u);
+    EXPECT_EQ(count(WAnd(W(Cmp("c2", CompareOp::Gt, VInt(100))),
+                         WAnd(W(Cmp("c2", CompareOp::Le, VInt(110))),
+                              W(Cmp("c1", CompareOp::Eq, VStr("odd")))))),
+              5u);
+    EXPECT_EQ(count(W(Cmp("c2", CompareOp::Eq, VInt(7)))), 1u);
+    EXPECT_EQ(count(W(Cmp("c2", CompareOp::Lt, VInt(std::numeric_limits<int64_t>::min())))), 0u);
+    EXPECT_EQ(
+        count(WAnd(W(Cmp("c2", CompareOp::Gt, VInt(10))), W(Cmp("c2", CompareOp::Lt, VInt(5))))),
+        0u);
+    // unselective range falls back to a scan, same answer
+    EXPECT_EQ(count(W(Cmp("c2", CompareOp::Ge, VInt(0)))), 1000u);
+
+    EXPECT_EQ(exec.execDelete(deleteFrom("t", W(Cmp("c2", CompareOp::Ge, VInt(990))))), 10u);
+    EXPECT_EQ(exec.execUpdate(updateSet("t", {Assignment{"c2", VInt(2000), std::nullopt}},
+                                        W(Cmp("c2", CompareOp::Lt, VInt(3))))),
+              3u);
+    EXPECT_EQ(count(W(Cmp("c2", CompareOp::Gt, VInt(989)))), 3u);
+    EXPECT_EQ(count(W(Cmp("c2", CompareOp::Lt, VInt(5)))), 2u);
+}
+
+TEST(StatementExecutor, Where_NestedAndOrOverManyRows) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < 500; ++i)
+        rows.push_back({VStr(i % 5 ? "plain" : "fifth row, long string"), VInt(i)});
+    exec.execInsert(insertRows("t", {}, rows));
+
+    auto count = [&](WhereExpr w) {
+        return exec.execSelect(selectStar("t", std::move(w))).rows.size();
+    };
+    // (c2 < 100 AND c1 = "plain") OR (c2 >= 400 AND c1 != "plain")
+    EXPECT_EQ(count(WOr(WAnd(W(Cmp("c2", CompareOp::Lt, VInt(100))),
+                             W(Cmp("c1", CompareOp::Eq, VStr("plain")))),
+                        WAnd(W(Cmp("c2", CompareOp::Ge, VInt(400))),
+                             W(Cmp("c1", CompareOp::Neq, VStr("plain")))))),
+              80u + 20u);
+    // c2 > 10 AND (c2 < 20 OR c2 = 300)
+    EXPECT_EQ(count(WAnd(W(Cmp("c2", CompareOp::Gt, VInt(10))),
+                         WOr(W(Cmp("c2", CompareOp::Lt, VInt(20))),
+                             W(Cmp("c2", CompareOp::Eq, VInt(300)))))),
+              10u);
+    // type errors are reported even on the side that would short-circuit
+    auto bad = WOr(W(Cmp("c2", CompareOp::Ge, VInt(0))), W(Cmp("c1", CompareOp::Lt, VStr("a"))));
+    EXPECT_THROW((void)exec.execSelect(selectStar("t", std::move(bad))), std::invalid_argument);
+}
+
+TEST(StatementExecutor, OpenSelect_StreamsAcrossRowGroups) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    constexpr int64_t kRows = 70000; // more than one 64K row group
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < kRows; ++i)
+        rows.push_back({VStr(i % 2 ? "odd" : "even"), VInt(i)});
+    exec.execInsert(insertRows("t", {}, rows));
+
+    // pull row by row: ascending, projected, filtered
+    auto odd = [] { return W(Cmp("c1", CompareOp::Eq, VStr("odd"))); };
+    Cursor cursor = exec.openSelect(selectCols("t", {"c2"}, odd()));
+    ASSERT_EQ(cursor.header(), (std::vector<std::string>{"c2"}));
+    int64_t expect = 1;
+    while (auto row = cursor.next()) {
+        ASSERT_EQ(row->size(), 1u);
+        ASSERT_EQ(asInt(*row, 0), expect);
+        expect += 2;
+    }
+    EXPECT_EQ(expect, kRows + 1);
+    EXPECT_FALSE(cursor.next().has_value());
+
+    // batches never exceed the requested size and add up to the whole result
+    Cursor all = exec.openSelect(selectStar("t"));
+    std::vector<Row> batch;
+    std::size_t total = 0;
+    while (all.nextBatch(batch, 1000)) {
+        ASSERT_LE(batch.size(), 1000u);
+        EXPECT_EQ(asInt(batch.front(), 1), static_cast<int64_t>(total));
+        total += batch.size();
+    }
+    EXPECT_EQ(total, static_cast<std::size_t>(kRows));
+    EXPECT_TRUE(batch.empty());
+
+    // push variant and the materialising execSelect agree
+    std::size_t pushed = 0;
+    EXPECT_EQ(exec.execSelect(selectStar("t", odd()),
+                              [&](const std::vector<Row>& b) { pushed += b.size(); }),
+              static_cast<std::size_t>(kRows / 2));
+    EXPECT_EQ(pushed, static_cast<std::size_t>(kRows / 2));
+    EXPECT_EQ(exec.execSelect(selectStar("t", odd())).rows.size(), pushed);
+
+    // empty result
+    Cursor none = exec.openSelect(selectStar("t", W(Cmp("c2", CompareOp::Lt, VInt(0)))));
+    EXPECT_FALSE(none.next().has_value());
+    EXPECT_FALSE(none.nextBatch(batch));
+
+    // a table that shrinks under an open cursor is reported, not read past its row groups
+    Cursor shrinking = exec.openSelect(selectStar("t", odd()));
+    ASSERT_TRUE(shrinking.next().has_value());
+    exec.execDelete(deleteFrom("t"));
+    EXPECT_THROW((void)shrinking.next(), std::logic_error);
+    EXPECT_THROW((void)shrinking.nextBatch(batch), std::logic_error);
+}
+
+TEST(StatementExecutor, OpenSelect_UsesIndexCandidates) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < 70000; ++i)
+        rows.push_back({VStr("r"), VInt(i % 1000)});
+    exec.execInsert(insertRows("t", {}, rows));
+    exec.execCreateIndex(CreateIndex{"t_c2", "t", "c2", IndexKind::BTree});
+
+    // 3 keys x 70 rows, the last ones in the second row group
+    Cursor cursor = exec.openSelect(selectStar(
+        "t", WAnd(W(Cmp("c2", CompareOp::Ge, VInt(10))), W(Cmp("c2", CompareOp::Le, VInt(12))))));
+    std::size_t n = 0;
+    while (auto row = cursor.next()) {
+        EXPECT_GE(asInt(*row, 1), 10);
+        EXPECT_LE(asInt(*row, 1), 12);
+        ++n;
+    }
+    EXPECT_EQ(n, 210u);
+}
+
+TEST(StatementExecutor, ExecSelectRefs_MatchesExecSelect) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    exec.execInsert(insertRows("t", {}, {{VStr("a"), VInt(1)}, {VStr("b"), VInt(2)},
+                                         {VStr("c"), VInt(3)}}));
+
+    auto refs = exec.execSelectRefs(selectCols("t", {"c2", "c1"},
+                                               W(Cmp("c2", CompareOp::Gt, VInt(1)))));
+    EXPECT_EQ(refs.header, (std::vector<std::string>{"c2", "c1"}));
+    ASSERT_EQ(refs.rows.size(), 2u);
+    EXPECT_EQ(refs.rows[0].intAt(0), 2);
+    EXPECT_EQ(refs.rows[1].strAt(1), "c");
+
+    auto copied = exec.execSelect(selectCols("t", {"c2", "c1"},
+                                             W(Cmp("c2", CompareOp::Gt, VInt(1)))));
+    ASSERT_EQ(refs.rows.materialize().size(), copied.rows.size());
+    for (std::size_t i = 0; i < copied.rows.size(); ++i) {
+        EXPECT_EQ(refs.rows[i].at(0), copied.rows[i].at(0));
+        EXPECT_EQ(refs.rows[i].at(1), copied.rows[i].at(1));
+    }
+
+    // cursors hand out the same references batch by batch
+    Cursor cursor = exec.openSelect(selectCols("t", {"c1"}));
+    RowRefs first = cursor.nextRefs(2);
+    ASSERT_EQ(first.size(), 2u);
+    EXPECT_EQ(first[1].size(), 1u);
+    EXPECT_EQ(first[1].strAt(0), "b");
+    EXPECT_EQ(cursor.nextRefs(2).size(), 1u);
+    EXPECT_TRUE(cursor.nextRefs(2).empty());
+
+    // refs carry the version the cursor was opened at, not the one they were pulled at
+    Cursor open = exec.openSelect(selectCols("t", {"c1"}));
+    RowRefs before = open.nextRefs(1);
+    exec.execUpdate(updateSet("t", {Assignment{"c2", VInt(9), std::nullopt}}));
+    EXPECT_FALSE(before.valid());
+    EXPECT_THROW((void)open.nextRefs(1), std::logic_error);
+    EXPECT_THROW((void)open.next(), std::logic_error);
+
+    auto star = exec.execSelectRefs(selectStar("t"));
+    EXPECT_EQ(star.header, (std::vector<std::string>{"c1", "c2"}));
+    EXPECT_EQ(star.rows.size(), 3u);
+
+    exec.execDelete(deleteFrom("t", W(Cmp("c1", CompareOp::Eq, VStr("a")))));
+    EXPECT_THROW((void)star.rows[0], std::logic_error);
+}
+
+TEST(StatementExecutor, SetThreads_ParallelResultsMatch) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < 150000; ++i) // three row groups
+        rows.push_back({VStr(i % 3 ? "x" : "y"), VInt(i)});
+    exec.execInsert(insertRows("t", {}, rows));
+
+    auto where = [] {
+        return WOr(W(Cmp("c1", CompareOp::Eq, VStr("y"))), W(Cmp("c2", CompareOp::Lt, VInt(10))));
+    };
+    const auto serial = exec.execSelect(selectCols("t", {"c2"}, where()));
+
+    exec.execSet(Set{"threads", 4});
+    EXPECT_EQ(db.threadPool().size(), 4u);
+    const auto par = exec.execSelect(selectCols("t", {"c2"}, where()));
+    ASSERT_EQ(par.rows.size(), serial.rows.size());
+    for (std::size_t i = 0; i < par.rows.size(); ++i)
+        ASSERT_EQ(asInt(par.rows[i], 0), asInt(serial.rows[i], 0));
+    EXPECT_EQ(exec.execSelectRefs(selectStar("t", where())).rows.size(), serial.rows.size());
+
+    EXPECT_EQ(exec.execUpdate(updateSet("t", {{"c1", VStr("z"), std::nullopt}}, where())),
+              serial.rows.size());
+    EXPECT_EQ(exec.execDelete(deleteFrom("t", W(Cmp("c1", CompareOp::Eq, VStr("z"))))),
+              serial.rows.size());
+    EXPECT_EQ(db.getTable("t").rowCount(), 150000u - serial.rows.size());
+
+    EXPECT_THROW(exec.execSet(Set{"threads", 0}), std::invalid_argument);
+    EXPECT_THROW(exec.execSet(Set{"nope", 1}), std::invalid_argument);
+    EXPECT_FALSE(exec.execute(Set{"threads", 1}).has_value());
+    EXPECT_EQ(db.threadPool().size(), 1u);
+}
+
+TEST(StatementExecutor, SetThreads_OpenCursorKeepsItsPool) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < 200000; ++i) // four row groups, two waves on two threads
+        rows.push_back({VStr("r"), VInt(i)});
+    exec.execInsert(insertRows("t", {}, rows));
+    exec.execSet(Set{"threads", 2});
+
+    // the pool is replaced while the cursor has its second wave still to filter
+    Cursor cursor = exec.openSelect(selectCols("t", {"c2"}));
+    ASSERT_TRUE(cursor.next());
+    exec.execSet(Set{"threads", 4});
+    EXPECT_EQ(db.threadPool().size(), 4u);
+    int64_t expected = 1;
+    while (auto row = cursor.next())
+        ASSERT_EQ(asInt(*row, 0), expected++);
+    EXPECT_EQ(expected, 200000);
+}
+
+TEST(StatementExecutor, Aggregates_ComputedInsideTheScan) {
+    Database db;
+    db.createTable("t", Schema{{{"c1", ColumnType::Str},
+                                {"c2", ColumnType::Int},
+                                {"d", ColumnType::Str, ColumnEncoding::Dictionary}}});
+    StatementExecutor exec{db};
+    const char* colors[] = {"red", "green", "blue"};
+    std::vector<std::vector<RowValue>> rows;
+    int64_t sum = 0;
+    for (int64_t i = 0; i < 70000; ++i) { // two row groups
+        rows.push_back({VStr("s" + std::to_string(i % 1000)), VInt(i - 1000), VStr(colors[i % 3])});
+        sum += i - 1000;
+    }
+    exec.execInsert(insertRows("t", {}, rows));
+
+    auto agg = [](std::vector<Aggregate> aggs, std::optional<WhereExpr> w = std::nullopt) {
+        Select s;
+        s.table = "t";
+        s.projection = std::vector<SelectItem>(aggs.begin(), aggs.end());
+        s.where = std::move(w);
+        return s;
+    };
+    const Aggregate count{AggregateFunc::Count, std::nullopt};
+    const Aggregate sumC2{AggregateFunc::Sum, "c2"};
+    const Aggregate minC2{AggregateFunc::Min, "c2"};
+    const Aggregate maxC2{AggregateFunc::Max, "c2"};
+    const Aggregate avgC2{AggregateFunc::Avg, "c2"};
+    const Aggregate minC1{AggregateFunc::Min, "c1"};
+    const Aggregate maxD{AggregateFunc::Max, "d"};
+
+    for (int64_t threads : {1, 3}) {
+        exec.execSet(Set{"threads", threads});
+        auto all = exec.execSelect(agg({count, sumC2, minC2, maxC2, avgC2, minC1, maxD}));
+        EXPECT_EQ(all.header, (std::vector<std::string>{"COUNT(*)", "SUM(c2)", "MIN(c2)",
+                                                        "MAX(c2)", "AVG(c2)", "MIN(c1)",
+                                                        "MAX(d)"}));
+        ASSERT_EQ(all.rows.size(), 1u);
+        const Row& r = all.rows[0];
+        EXPECT_EQ(asInt(r, 0), 70000);
+        EXPECT_EQ(asInt(r, 1), sum);
+        EXPECT_EQ(asInt(r, 2), -1000);
+        EXPECT_EQ(asInt(r, 3), 68999);
+        EXPECT_EQ(asInt(r, 4), sum / 70000);
+        EXPECT_EQ(asStr(r, 5), "s0");
+        EXPECT_EQ(asStr(r, 6), "red");
+
+        // c2 in [0, 10) and d = "green": i = 1000, 1003, 1006, 1009
+        auto some = exec.execSelect(agg({count, sumC2, minC2, maxC2, avgC2, minC1},
+                                        WAnd(W(Cmp("c2", CompareOp::Ge, VInt(0))),
+                                             WAnd(W(Cmp("c2", CompareOp::Lt, VInt(10))),
+                                                  W(Cmp("d", CompareOp::Eq, VStr("green")))))));
+        const Row& w = some.rows.at(0);
+        EXPECT_EQ(asInt(w, 0), 4);
+        EXPECT_EQ(asInt(w, 1), 0 + 3 + 6 + 9);
+        EXPECT_EQ(asInt(w, 2), 0);
+        EXPECT_EQ(asInt(w, 3), 9);
+        EXPECT_EQ(asInt(w, 4), 4);
+        EXPECT_EQ(asStr(w, 5), "s0");
+
+        // no matches: counts and sums are 0, the rest NULL
+        auto none = exec.execSelect(
+            agg({count, sumC2, minC2, avgC2, minC1}, W(Cmp("c2", CompareOp::Lt, VInt(-5000)))));
+        const Row& n = none.rows.at(0);
+        EXPECT_EQ(asInt(n, 0), 0);
+        EXPECT_EQ(asInt(n, 1), 0);
+        EXPECT_EQ(asStr(n, 2), "NULL");
+        EXPECT_EQ(asStr(n, 3), "NULL");
+        EXPECT_EQ(asStr(n, 4), "NULL");
+
+        // counts alone come straight from the row count
+        auto counts = exec.execSelect(agg({count, Aggregate{AggregateFunc::Count, "c1"}}));
+        EXPECT_EQ(asInt(counts.rows.at(0), 0), 70000);
+        EXPECT_EQ(asInt(counts.rows.at(0), 1), 70000);
+    }
+}
+
+TEST(StatementExecutor, Aggregates_Errors) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    const int64_t big = std::numeric_limits<int64_t>::max();
+    exec.execInsert(insertRows("t", {}, {{VStr("a"), VInt(big)}, {VStr("b"), VInt(big)}}));
+
+    auto agg = [](std::vector<SelectItem> items) {
+        Select s;
+        s.table = "t";
+        s.projection = std::move(items);
+        return s;
+    };
+    EXPECT_THROW((void)exec.execSelect(agg({Aggregate{AggregateFunc::Sum, "c2"}})),
+                 std::overflow_error);
+    EXPECT_EQ(asInt(exec.execSelect(agg({Aggregate{AggregateFunc::Avg, "c2"}})).rows.at(0), 0),
+              big);
+    EXPECT_THROW((void)exec.execSelect(agg({Aggregate{AggregateFunc::Sum, "c1"}})),
+                 std::invalid_argument);
+    EXPECT_THROW((void)exec.execSelect(agg({Aggregate{AggregateFunc::Max, "nope"}})),
+                 std::out_of_range);
+    EXPECT_THROW((void)exec.execSelect(agg({std::string{"c1"},
+                                            Aggregate{AggregateFunc::Count, std::nullopt}})),
+                 std::invalid_argument);
+    EXPECT_THROW((void)exec.openSelect(agg({Aggregate{AggregateFunc::Count, std::nullopt}})),
+                 std::invalid_argument);
+}
+
+TEST(StatementExecutor, GroupBy_PartitionedHashAggregation) {
+    Database db;
+    db.createTable("t", Schema{{{"c1", ColumnType::Str},
+                                {"c2", ColumnType::Int},
+                                {"d", ColumnType::Str, ColumnEncoding::Dictionary},
+                                {"k", ColumnType::Int}}});
+    StatementExecutor exec{db};
+    const char* colors[] = {"red", "green", "blue"};
+    std::vector<std::vector<RowValue>> rows;
+    struct Expected {
+        int64_t count = 0, sum = 0, max = INT64_MIN;
+        std::string min;
+    };
+    std::map<std::string, Expected> byColor;
+    std::map<std::pair<std::string, int64_t>, Expected> byStrInt; // rows with c2 >= 0
+    for (int64_t i = 0; i < 70000; ++i) { // two row groups
+        const std::string c1 = "s" + std::to_string(i % 1000);
+        rows.push_back({VStr(c1), VInt(i - 1000), VStr(colors[i % 3]), VInt(i % 7)});
+        Expected& e = byColor[colors[i % 3]];
+        e.min = e.count++ == 0 ? c1 : std::min(e.min, c1);
+        e.sum += i - 1000;
+        e.max = std::max(e.max, i - 1000);
+        if (i >= 1000) {
+            Expected& f = byStrInt[{c1, i % 7}];
+            ++f.count;
+            f.sum += i - 1000;
+        }
+    }
+    exec.execInsert(insertRows("t", {}, rows));
+
+    auto grouped = [](std::vector<SelectItem> items, std::vector<std::string> groupBy,
+                      std::optional<WhereExpr> w = std::nullopt) {
+        Select s;
+        s.table = "t";
+        s.projection = std::move(items);
+        s.where = std::move(w);
+        s.groupBy = std::move(groupBy);
+        return s;
+    };
+    const Aggregate count{AggregateFunc::Count, std::nullopt};
+    const Aggregate sumC2{AggregateFunc::Sum, "c2"};
+    const Aggregate maxC2{AggregateFunc::Max, "c2"};
+    const Aggregate minC1{AggregateFunc::Min, "c1"};
+
+    std::vector<Row> firstRun;
+    for (int64_t threads : {1, 3}) {
+        exec.execSet(Set{"threads", threads});
+
+        // dictionary key
+        auto colorsOut =
+            exec.execSelect(grouped({std::string{"d"}, count, sumC2, minC1, maxC2}, {"d"}));
+        EXPECT_EQ(colorsOut.header,
+                  (std::vector<std::string>{"d", "COUNT(*)", "SUM(c2)", "MIN(c1)", "MAX(c2)"}));
+        ASSERT_EQ(colorsOut.rows.size(), 3u);
+        for (const Row& r : colorsOut.rows) {
+            const Expected& e = byColor.at(asStr(r, 0));
+            EXPECT_EQ(asInt(r, 1), e.count);
+            EXPECT_EQ(asInt(r, 2), e.sum);
+            EXPECT_EQ(asStr(r, 3), e.min);
+            EXPECT_EQ(asInt(r, 4), e.max);
+        }
+
+        // plain Str and Int keys together, after a WHERE, in a different order than GROUP BY
+        auto pairs = exec.execSelect(grouped({count, std::string{"k"}, sumC2, std::string{"c1"}},
+                                             {"c1", "k"},
+                                             W(Cmp("c2", CompareOp::Ge, VInt(0)))));
+        ASSERT_EQ(pairs.rows.size(), byStrInt.size());
+        for (const Row& r : pairs.rows) {
+            const Expected& e = byStrInt.at({asStr(r, 3), asInt(r, 1)});
+            EXPECT_EQ(asInt(r, 0), e.count);
+            EXPECT_EQ(asInt(r, 2), e.sum);
+        }
+        if (threads == 1)
+            firstRun = pairs.rows;
+        // the group order does not depend on the thread count
+        for (std::size_t i = 0; i < pairs.rows.size(); ++i)
+            ASSERT_EQ(asStr(pairs.rows[i], 3), asStr(firstRun[i], 3));
+
+        // without aggregates: the distinct keys
+        auto keys = exec.execSelect(grouped({std::string{"k"}}, {"k"}));
+        std::vector<int64_t> ks;
+        for (const Row& r : keys.rows)
+            ks.push_back(asInt(r, 0));
+        std::sort(ks.begin(), ks.end());
+        EXPECT_EQ(ks, (std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6}));
+
+        // nothing matches: no groups
+        auto none = exec.execSelect(
+            grouped({std::string{"d"}, count}, {"d"}, W(Cmp("c2", CompareOp::Lt, VInt(-5000)))));
+        EXPECT_TRUE(none.rows.empty());
+    }
+
+    EXPECT_THROW((void)exec.execSelect(grouped({std::string{"c2"}, count}, {"d"})),
+                 std::invalid_argument);
+    EXPECT_THROW((void)exec.execSelect(grouped({count}, {"nope"})), std::out_of_range);
+    Select star = grouped({}, {"d"});
+    star.projection = Select::Star{};
+    EXPECT_THROW((void)exec.execSelect(star), std::invalid_argument);
+    EXPECT_THROW((void)exec.openSelect(grouped({std::string{"d"}}, {"d"})), std::invalid_argument);
+}
+
+TEST(StatementExecutor, OrderByLimit_TopKAndEarlyStop) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    constexpr int64_t kRows = 70000; // two row groups
+    std::vector<std::vector<RowValue>> rows;
+    std::vector<std::pair<int64_t, int64_t>> s7; // (c2, i) of the rows with c1 = "s7"
+    for (int64_t i = 0; i < kRows; ++i) {
+        const int64_t c2 = i * 7919 % kRows; // a permutation of [0, kRows)
+        rows.push_back({VStr("s" + std::to_string(i % 100)), VInt(c2)});
+        if (i % 100 == 7)
+            s7.emplace_back(c2, i);
+    }
+    exec.execInsert(insertRows("t", {}, rows));
+    std::sort(s7.begin(), s7.end());
+
+    auto ordered = [](std::string column, bool descending, std::optional<uint64_t> limit,
+                      uint64_t offset = 0, std::optional<WhereExpr> w = std::nullopt) {
+        Select s = selectStar("t", std::move(w));
+        s.orderBy = OrderBy{std::move(column), descending};
+        s.limit = limit;
+        s.offset = offset;
+        return s;
+    };
+    for (int64_t threads : {1, 3}) {
+        exec.execSet(Set{"threads", threads});
+
+        auto top = exec.execSelect(ordered("c2", true, 5));
+        ASSERT_EQ(top.rows.size(), 5u);
+        for (int64_t k = 0; k < 5; ++k)
+            EXPECT_EQ(asInt(top.rows[k], 1), kRows - 1 - k);
+
+        // filtered, with an offset
+        auto page = exec.execSelect(
+            ordered("c2", false, 3, 10, W(Cmp("c1", CompareOp::Eq, VStr("s7")))));
+        ASSERT_EQ(page.rows.size(), 3u);
+        for (std::size_t k = 0; k < 3; ++k)
+            EXPECT_EQ(asInt(page.rows[k], 1), s7[10 + k].first);
+
+        // string key; equal keys stay in storage order (rows 0, 100, 200)
+        auto byStr = exec.execSelect(ordered("c1", false, 3));
+        ASSERT_EQ(byStr.rows.size(), 3u);
+        for (int64_t k = 0; k < 3; ++k) {
+            EXPECT_EQ(asStr(byStr.rows[k], 0), "s0");
+            EXPECT_EQ(asInt(byStr.rows[k], 1), k * 100 * 7919 % kRows);
+        }
+
+        // no LIMIT: a full sort
+        Cursor all = exec.openSelect(ordered("c2", false, std::nullopt));
+        int64_t expect = 0;
+        while (auto row = all.next())
+            ASSERT_EQ(asInt(*row, 1), expect++);
+        EXPECT_EQ(expect, kRows);
+    }
+
+    // LIMIT alone keeps storage order across the row group boundary and then stops
+    Select window = selectStar("t");
+    window.limit = 5;
+    window.offset = 65534;
+    Cursor cursor = exec.openSelect(window);
+    for (int64_t i = 65534; i < 65539; ++i)
+        EXPECT_EQ(asInt(*cursor.next(), 1), i * 7919 % kRows);
+    EXPECT_FALSE(cursor.next().has_value());
+    auto refs = exec.execSelectRefs(window);
+    ASSERT_EQ(refs.rows.size(), 5u);
+    EXPECT_EQ(refs.rows[0].intAt(1), 65534 * 7919 % kRows);
+    EXPECT_TRUE(exec.execSelect(ordered("c2", false, 0)).rows.empty());
+    EXPECT_TRUE(exec.execSelect(ordered("c2", false, 5, kRows)).rows.empty());
+
+    // aggregate results are ordered by one of their columns
+    Select groups;
+    groups.table = "t";
+    groups.projection = std::vector<SelectItem>{std::string{"c1"},
+                                                Aggregate{AggregateFunc::Max, "c2"}};
+    groups.groupBy = {"c1"};
+    groups.orderBy = OrderBy{std::string{"c1"}, false};
+    groups.limit = 2;
+    groups.offset = 1;
+    auto names = exec.execSelect(groups);
+    ASSERT_EQ(names.rows.size(), 2u);
+    EXPECT_EQ(asStr(names.rows[0], 0), "s1");
+    EXPECT_EQ(asStr(names.rows[1], 0), "s10");
+    groups.orderBy = OrderBy{Aggregate{AggregateFunc::Max, "c2"}, true};
+    groups.offset = 0;
+    auto maxes = exec.execSelect(groups);
+    ASSERT_EQ(maxes.rows.size(), 2u);
+    EXPECT_EQ(asInt(maxes.rows[0], 1), kRows - 1);
+    EXPECT_GT(asInt(maxes.rows[0], 1), asInt(maxes.rows[1], 1));
+
+    groups.orderBy = OrderBy{std::string{"c2"}, false};
+    EXPECT_THROW((void)exec.execSelect(groups), std::invalid_argument);
+    EXPECT_THROW((void)exec.execSelect(ordered("nope", false, 1)), std::out_of_range);
+    Select byAggregate = selectStar("t");
+    byAggregate.orderBy = OrderBy{Aggregate{AggregateFunc::Count, std::nullopt}, false};
+    EXPECT_THROW((void)exec.openSelect(byAggregate), std::invalid_argument);
+}
+
+TEST(StatementExecutor, Join_PushesFiltersDownAndChecksTheRest) {
+    Database db;
+    db.createTable("o", Schema{{{"id", ColumnType::Int},
+                                {"cid", ColumnType::Int},
+                                {"status", ColumnType::Str, ColumnEncoding::Dictionary}}});
+    db.createTable("c", Schema{{{"id", ColumnType::Int}, {"name", ColumnType::Str}}});
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> orders;
+    for (int64_t i = 0; i < 70000; ++i) // two row groups
+        orders.push_back({VInt(i), VInt(i % 1000), VStr(i % 2 ? "open" : "done")});
+    exec.execInsert(insertRows("o", {}, orders));
+    std::vector<std::vector<RowValue>> customers;
+    for (int64_t i = 0; i < 500; ++i) // customers 500..999 have no row, so their orders drop out
+        customers.push_back({VInt(i), VStr("n" + std::to_string(i))});
+    exec.execInsert(insertRows("c", {}, customers));
+    exec.execCreateIndex(CreateIndex{"c_id", "c", "id"});
+
+    auto join = [](Select::Projection proj, std::optional<WhereExpr> w = std::nullopt) {
+        Select s;
+        s.table = "o";
+        s.join = Join{"c", "c.id", "o.cid"}; // either order
+        s.projection = std::move(proj);
+        s.where = std::move(w);
+        return s;
+    };
+    for (int64_t threads : {1, 3}) {
+        exec.execSet(Set{"threads", threads});
+
+        auto all = exec.execSelect(join(Select::Star{}));
+        EXPECT_EQ(all.header, (std::vector<std::string>{"o.id", "o.cid", "o.status", "c.id",
+                                                        "c.name"}));
+        ASSERT_EQ(all.rows.size(), 35000u);
+        for (const Row& r : all.rows) {
+            ASSERT_EQ(asInt(r, 1), asInt(r, 3));
+            ASSERT_EQ(asStr(r, 4), "n" + std::to_string(asInt(r, 1)));
+        }
+
+        // c.id = 7 goes to the customers scan (through its index), status to the orders scan;
+        // the OR spans both tables and is checked per pair
+        auto some = exec.execSelect(
+            join(std::vector<std::string>{"o.id", "name"},
+                 WAnd(W(Cmp("c.id", CompareOp::Eq, VInt(7))),
+                      WAnd(W(Cmp("status", CompareOp::Eq, VStr("open"))),
+                           WOr(W(Cmp("o.id", CompareOp::Lt, VInt(3000))),
+                               W(Cmp("name", CompareOp::Eq, VStr("nobody"))))))));
+        EXPECT_EQ(some.header, (std::vector<std::string>{"o.id", "name"}));
+        std::vector<int64_t> ids;
+        for (const Row& r : some.rows) {
+            ids.push_back(asInt(r, 0));
+            EXPECT_EQ(asStr(r, 1), "n7");
+        }
+        std::sort(ids.begin(), ids.end());
+        EXPECT_EQ(ids, (std::vector<int64_t>{7, 1007, 2007}));
+    }
+
+    // ORDER BY / LIMIT apply to the joined rows
+    Select top = join(std::vector<std::string>{"o.id", "c.name"});
+    top.orderBy = OrderBy{std::string{"o.id"}, true};
+    top.limit = 2;
+    auto last = exec.execSelect(top);
+    ASSERT_EQ(last.rows.size(), 2u);
+    EXPECT_EQ(asInt(last.rows[0], 0), 69499);
+    EXPECT_EQ(asStr(last.rows[1], 1), "n498");
+
+    EXPECT_THROW((void)exec.execSelect(join(std::vector<std::string>{"id"})),
+                 std::invalid_argument); // ambiguous
+    EXPECT_THROW((void)exec.execSelect(join(std::vector<std::string>{"x.id"})), std::out_of_range);
+    EXPECT_THROW(
+        (void)exec.execSelect(join(Select::Star{}, W(Cmp("name", CompareOp::Eq, VInt(1))))),
+        std::invalid_argument);
+    EXPECT_THROW((void)exec.execSelect(join(Select::Star{},
+                                            WOr(W(Cmp("o.id", CompareOp::Eq, VInt(1))),
+                                                W(Cmp("name", CompareOp::Lt, VStr("a")))))),
+                 std::invalid_argument);
+    Select wrongOn = join(Select::Star{});
+    wrongOn.join->left = "c.name"; // Str = Int
+    EXPECT_THROW((void)exec.execSelect(wrongOn), std::invalid_argument);
+    wrongOn.join->right = "c.id"; // both columns of c
+    EXPECT_THROW((void)exec.execSelect(wrongOn), std::invalid_argument);
+    EXPECT_THROW((void)exec.openSelect(join(Select::Star{})), std::invalid_argument);
+}
+
+TEST(StatementExecutor, Explain_ShowsTheChosenPlan) {
+    Database db;
+    initTable(db);
+    db.createTable("u", Schema{{{"id", ColumnType::Int}, {"c1", ColumnType::Str}}});
+    StatementExecutor exec{db};
+    exec.execInsert(insertRows("t", {}, {{VStr("a"), VInt(1)}, {VStr("b"), VInt(2)}}));
+    exec.execInsert(insertRows("u", {}, {{VInt(2), VStr("a")}}));
+    exec.execCreateIndex(CreateIndex{"t_c1", "t", "c1"});
+    exec.execCreateIndex(CreateIndex{"t_c2", "t", "c2", IndexKind::BTree});
+
+    const auto explain = [&](auto st) {
+        auto out = exec.execute(Explain{std::make_unique<Statement>(std::move(st))});
+        EXPECT_EQ(out->header, (std::vector<std::string>{"plan"}));
+        std::vector<std::string> lines;
+        for (const Row& r : out->rows)
+            lines.push_back(asStr(r, 0));
+        return lines;
+    };
+
+    // the hash index answers c1 = "a"; the filter re-checks the whole WHERE
+    Select s = selectCols("t", {"c1"},
+                          WAnd(W(Cmp("c1", CompareOp::Eq, VStr("a"))),
+                               W(Cmp("c2", CompareOp::Gt, VInt(0)))));
+    s.orderBy = OrderBy{std::string{"c2"}, true};
+    s.limit = 5;
+    s.offset = 1;
+    EXPECT_EQ(explain(std::move(s)),
+              (std::vector<std::string>{"Project c1", "  -> Limit 5 OFFSET 1",
+                                        "    -> Sort c2 DESC (top-k heap)",
+                                        "      -> Filter c1 = \"a\" AND c2 > 0",
+                                        "        -> IndexLookup t using t_c1 (hash): c1 = \"a\""}));
+
+    // range bounds intersect on the B-tree; no usable index means a scan
+    EXPECT_EQ(explain(selectStar("t", WAnd(W(Cmp("c2", CompareOp::Ge, VInt(1))),
+                                           W(Cmp("c2", CompareOp::Lt, VInt(9)))))),
+              (std::vector<std::string>{"Project *", "  -> Filter c2 >= 1 AND c2 < 9",
+                                        "    -> IndexLookup t using t_c2 (btree): c2 BETWEEN 1 "
+                                        "AND 8"}));
+    EXPECT_EQ(explain(selectStar("t", WOr(W(Cmp("c1", CompareOp::Eq, VStr("a"))),
+                                          W(Cmp("c2", CompareOp::Eq, VInt(2)))))),
+              (std::vector<std::string>{"Project *", "  -> Filter c1 = \"a\" OR c2 = 2",
+                                        "    -> Scan t"}));
+
+    Select grouped = selectCols("t", {}, W(Cmp("c1", CompareOp::Neq, VStr("z"))));
+    grouped.projection =
+        std::vector<SelectItem>{std::string{"c1"}, Aggregate{AggregateFunc::Count, std::nullopt}};
+    grouped.groupBy = {"c1"};
+    EXPECT_EQ(explain(std::move(grouped)),
+              (std::vector<std::string>{"Aggregate COUNT(*) GROUP BY c1",
+                                        "  -> Filter c1 != \"z\"", "    -> Scan t"}));
+    Select count = selectCols("t", {});
+    count.projection = std::vector<SelectItem>{Aggregate{AggregateFunc::Count, std::nullopt}};
+    EXPECT_EQ(explain(std::move(count)),
+              (std::vector<std::string>{"Aggregate COUNT(*) from the row count"}));
+
+    // single-table conjuncts go below the join, the rest above it; u is smaller, so it is built
+    Select join = selectStar("t", WAnd(W(Cmp("t.c1", CompareOp::Eq, VStr("b"))),
+                                       WOr(W(Cmp("u.c1", CompareOp::Eq, VStr("a"))),
+                                           W(Cmp("c2", CompareOp::Eq, VInt(1))))));
+    join.join = Join{"u", "id", "c2"};
+    EXPECT_EQ(explain(std::move(join)),
+              (std::vector<std::string>{
+                  "Project *", "  -> Filter u.c1 = \"a\" OR c2 = 1",
+                  "    -> Join t.c2 = u.id, build u", "      -> Filter c1 = \"b\"",
+                  "        -> IndexLookup t using t_c1 (hash): c1 = \"b\"", "      -> Scan u"}));
+
+    EXPECT_EQ(explain(updateSet("t", {{"c2", VInt(3), std::nullopt}},
+                                W(Cmp("c2", CompareOp::Eq, VInt(2))))),
+              (std::vector<std::string>{"Update t SET c2 = 3", "  -> Filter c2 = 2",
+                                        "    -> IndexLookup t using t_c2 (btree): c2 = 2"}));
+    EXPECT_EQ(explain(deleteFrom("t")), (std::vector<std::string>{"Delete t (all rows)"}));
+    EXPECT_EQ(explain(insertRows("u", {}, {{VInt(3), VStr("c")}})),
+              (std::vector<std::string>{"Insert u (1 row)"}));
+
+    // nothing ran, and plans are validated like the statements themselves
+    EXPECT_EQ(exec.execSelect(selectStar("t")).rows.size(), 2u);
+    EXPECT_EQ(exec.execSelect(selectStar("u")).rows.size(), 1u);
+    EXPECT_THROW((void)explain(selectStar("t", W(Cmp("c2", CompareOp::Eq, VStr("x"))))),
+                 std::invalid_argument);
+    EXPECT_THROW((void)explain(selectCols("t", {"nope"})), std::out_of_range);
+    EXPECT_THROW((void)explain(Set{"threads", 2}), std::invalid_argument);
+}
+
+TEST(StatementExecutor, ExplainAnalyze_RunsAndCountsEveryOperator) {
+    Database db;
+    initTable(db);
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < 70000; ++i) // two row groups
+        rows.push_back({VStr(i % 10 == 0 ? "x" : "y"), VInt(i)});
+    exec.execInsert(insertRows("t", {}, rows));
+
+    const auto analyze = [&](auto st) {
+        auto out = exec.execute(Explain{std::make_unique<Statement>(std::move(st)), true});
+        std::vector<std::string> lines;
+        for (const Row& r : out->rows)
+            lines.push_back(asStr(r, 0));
+        return lines;
+    };
+    // "Op detail (in=.. out=.. batches=.. time=.. ms bytes=..)" without the time and bytes
+    const auto counts = [](const std::string& line) {
+        const auto open = line.rfind(" (in=");
+        return line.substr(0, line.find(" time=", open));
+    };
+
+    Select s = selectCols("t", {"c2"},
+                          WAnd(W(Cmp("c1", CompareOp::Eq, VStr("x"))),
+                               W(Cmp("c2", CompareOp::Ge, VInt(35000)))));
+    s.orderBy = OrderBy{std::string{"c2"}, true};
+    s.limit = 10;
+    s.offset = 5;
+    auto lines = analyze(std::move(s));
+    ASSERT_EQ(lines.size(), 7u);
+    EXPECT_EQ(counts(lines[0]), "Project c2 (in=10 out=10 batches=1");
+    EXPECT_EQ(counts(lines[1]), "  -> Limit 10 OFFSET 5 (in=15 out=10 batches=1");
+    EXPECT_EQ(counts(lines[2]), "    -> Sort c2 DESC (top-k heap) (in=3500 out=15 batches=1");
+    EXPECT_EQ(counts(lines[3]), "      -> Filter c1 = \"x\" AND c2 >= 35000 (in=70000 out=3500 "
+                                "batches=2");
+    EXPECT_EQ(lines[4], "           conjunct c1 = \"x\": 7000 of 70000 rows (10.0%)");
+    EXPECT_EQ(lines[5], "           conjunct c2 >= 35000: 35000 of 70000 rows (50.0%)");
+    EXPECT_EQ(counts(lines[6]), "        -> Scan t (in=70000 out=70000 batches=2");
+    EXPECT_NE(lines[0].find(" ms bytes="), std::string::npos);
+
+    // a LIMIT without ORDER BY stops the scan after the first row group
+    Select first = selectStar("t");
+    first.limit = 3;
+    lines = analyze(std::move(first));
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_EQ(counts(lines[1]), "  -> Limit 3 (in=3 out=3 batches=1");
+    EXPECT_EQ(counts(lines[2]), "    -> Scan t (in=65536 out=65536 batches=1");
+
+    // the index lookup feeds the filter its candidates
+    exec.execCreateIndex(CreateIndex{"t_c2", "t", "c2"});
+    Select grouped = selectCols("t", {}, W(Cmp("c2", CompareOp::Eq, VInt(40))));
+    grouped.projection =
+        std::vector<SelectItem>{std::string{"c1"}, Aggregate{AggregateFunc::Sum, "c2"}};
+    grouped.groupBy = {"c1"};
+    lines = analyze(std::move(grouped));
+    ASSERT_EQ(lines.size(), 4u);
+    EXPECT_EQ(counts(lines[0]), "Aggregate SUM(c2) GROUP BY c1 (in=1 out=1 batches=2");
+    EXPECT_EQ(counts(lines[1]), "  -> Filter c2 = 40 (in=1 out=1 batches=2");
+    EXPECT_EQ(counts(lines[3]), "    -> IndexLookup t using t_c2 (hash): c2 = 40 (in=1 out=1 "
+                                "batches=1");
+
+    // ANALYZE runs writes for real
+    lines = analyze(deleteFrom("t", W(Cmp("c1", CompareOp::Eq, VStr("x")))));
+    EXPECT_EQ(counts(lines[0]), "Delete t (in=7000 out=7000 batches=2");
+    EXPECT_EQ(exec.execSelect(selectStar("t")).rows.size(), 63000u);
+}
+
+TEST(StatementExecutor, AnalyzeStats_DriveIndexAndJoinChoices) {
+    Database db;
+    initTable(db);
+    db.createTable("u", Schema{{{"id", ColumnType::Int}, {"c1", ColumnType::Str}}});
+    StatementExecutor exec{db};
+    std::vector<std::vector<RowValue>> rows;
+    for (int64_t i = 0; i < 1000; ++i)
+        rows.push_back({VStr(i % 10 == 0 ? "x" : "y"), VInt(i)});
+    exec.execInsert(insertRows("t", {}, rows));
+    rows.clear();
+    for (int64_t i = 0; i < 100; ++i)
+        rows.push_back({VInt(i), VStr("u" + std::to_string(i))});
+    exec.execInsert(insertRows("u", {}, rows));
+    exec.execCreateIndex(CreateIndex{"t_c1", "t", "c1"});
+    exec.execCreateIndex(CreateIndex{"t_c2", "t", "c2", IndexKind::BTree});
+
+    const auto explain = [&](auto st) {
+        auto out = exec.execute(Explain{std::make_unique<Statement>(std::move(st))});
+        std::vector<std::string> lines;
+        for (const Row& r : out->rows)
+            lines.push_back(asStr(r, 0));
+        return lines;
+    };
+    Select join = selectStar("t", W(Cmp("c2", CompareOp::Lt, VInt(10))));
+    join.join = Join{"u", "id", "c2"};
+    const auto joinPlan = [&] {
+        Select copy = selectStar("t", W(Cmp("c2", CompareOp::Lt, VInt(10))));
+        copy.join = join.join;
+        return explain(std::move(copy))[1];
+    };
+
+    // without statistics every index is used and the join builds the smaller table
+    EXPECT_THROW((void)exec.execute(ShowStats{"t"}), std::invalid_argument);
+    EXPECT_EQ(explain(selectStar("t", W(Cmp("c1", CompareOp::Eq, VStr("y"))))),
+              (std::vector<std::string>{"Project *", "  -> Filter c1 = \"y\"",
+                                        "    -> IndexLookup t using t_c1 (hash): c1 = \"y\""}));
+    EXPECT_EQ(joinPlan(), "  -> Join t.c2 = u.id, build u");
+
+    EXPECT_FALSE(exec.execute(Analyze{"t"}));
+    EXPECT_FALSE(exec.execute(Analyze{"u"}));
+    EXPECT_THROW((void)exec.execute(Analyze{"nope"}), std::out_of_range);
+
+    auto stats = exec.execute(ShowStats{"t"});
+    EXPECT_EQ(stats->header, (std::vector<std::string>{"column", "rows", "distinct", "min", "max",
+                                                       "histogram"}));
+    ASSERT_EQ(stats->rows.size(), 2u);
+    EXPECT_EQ(asStr(stats->rows[0], 0), "c1");
+    EXPECT_EQ(asInt(stats->rows[0], 1), 1000);
+    EXPECT_EQ(asInt(stats->rows[0], 2), 2);
+    EXPECT_EQ(asStr(stats->rows[0], 3), "x");
+    EXPECT_EQ(asStr(stats->rows[0], 4), "y");
+    EXPECT_EQ(asStr(stats->rows[0], 5), "NULL");
+    EXPECT_EQ(asInt(stats->rows[1], 3), 0);
+    EXPECT_EQ(asInt(stats->rows[1], 4), 999);
+    EXPECT_EQ(asStr(stats->rows[1], 5).rfind("32 buckets of ~31 rows, up to 31 63 ", 0), 0u);
+
+    // half the table through the hash index: a scan is cheaper; 10% through the B-tree is not
+    EXPECT_EQ(explain(selectStar("t", W(Cmp("c1", CompareOp::Eq, VStr("y"))))),
+              (std::vector<std::string>{"Project *",
+                                        "  -> Filter c1 = \"y\" (estimated 500 rows)",
+                                        "    -> Scan t"}));
+    EXPECT_EQ(explain(selectStar("t", W(Cmp("c2", CompareOp::Lt, VInt(100))))),
+              (std::vector<std::string>{"Project *", "  -> Filter c2 < 100 (estimated 100 rows)",
+                                        "    -> IndexLookup t using t_c2 (btree): c2 <= 99"}));
+    EXPECT_EQ(explain(selectStar("t", W(Cmp("c2", CompareOp::Ge, VInt(300)))))[2],
+              "    -> Scan t");
+    // the filtered t is expected to be smaller than u now
+    EXPECT_EQ(joinPlan(), "  -> Join t.c2 = u.id, build t");
+    const auto joined = exec.execSelect(join);
+    ASSERT_EQ(joined.rows.size(), 10u);
+    for (const Row& r : joined.rows)
+        EXPECT_EQ(asInt(r, 1), asInt(r, 2));
+
+    // results do not depend on the plan
+    EXPECT_EQ(exec.execSelect(selectStar("t", W(Cmp("c1", CompareOp::Eq, VStr("y"))))).rows.size(),
+              900u);
+    exec.execInsert(insertRows("t", {}, {{VStr("z"), VInt(5000)}}));
+    stats = exec.execute(ShowStats{"t"});
+    EXPECT_EQ(asInt(stats->rows[0], 1), 1001);
+    EXPECT_EQ(asStr(stats->rows[0], 4), "z");
+    EXPECT_EQ(asInt(stats->rows[1], 4), 5000);
+}
+
+TEST(StatementExecutor, Prepared_RebindsParametersOnTheCachedPlan) {
+    Database db;
+    db.createTable("p", Schema{{{"id", ColumnType::Int},
+                                {"city", ColumnType::Str, ColumnEncoding::Dictionary},
+                                {"name", ColumnType::Str}}});
+    db.createTable("o", Schema{{{"pid", ColumnType::Int}, {"amount", ColumnType::Int}}});
+    StatementExecutor exec{db};
+    Parser parser;
+    const auto run = [&](const std::string& sql) {
+        return exec.execute(parser.prepareStatement(sql));
+    };
+    const char* cities[] = {"Paris", "Rome", "Oslo"};
+    for (int64_t i = 0; i < 300; ++i) {
+        const std::string name = "n" + std::to_string(i);
+        exec.execInsert(insertRows("p", {}, {{VInt(i), VStr(cities[i % 3]), VStr(name)}}));
+        exec.execInsert(insertRows("o", {}, {{VInt(i % 50), VInt(i)}}));
+    }
+
+    // SQL: PREPARE once, EXECUTE with new values; results match the literal statement
+    EXPECT_FALSE(run("PREPARE byCity AS SELECT id FROM p WHERE city = ? AND id >= ? AND id < 30"));
+    for (const auto& [city, from] : std::vector<std::pair<std::string, int64_t>>{
+             {"Rome", 0}, {"Oslo", 10}, {"Paris", 29}, {"Bern", 0}}) {
+        const auto got = run("EXECUTE byCity('" + city + "', " + std::to_string(from) + ")");
+        const auto want = run("SELECT id FROM p WHERE city = '" + city + "' AND id >= " +
+                              std::to_string(from) + " AND id < 30");
+        ASSERT_TRUE(got && want);
+        EXPECT_EQ(got->header, want->header);
+        ASSERT_EQ(got->rows.size(), want->rows.size()) << city;
+        for (std::size_t r = 0; r < got->rows.size(); ++r)
+            EXPECT_EQ(asInt(got->rows[r], 0), asInt(want->rows[r], 0));
+    }
+    EXPECT_EQ(run("EXECUTE byCity('Rome', 0)")->rows.size(), 10u);
+
+    // a literal on a dictionary column is looked up again at every execution
+    EXPECT_FALSE(run("PREPARE bern AS SELECT * FROM p WHERE city = 'Bern' OR name = ?"));
+    EXPECT_EQ(run("EXECUTE bern('n1')")->rows.size(), 1u);
+    EXPECT_FALSE(run("INSERT INTO p VALUES (1000, 'Bern', 'b')"));
+    EXPECT_EQ(run("EXECUTE bern('n1')")->rows.size(), 2u);
+
+    // writes; an index created after PREPARE is used once it exists
+    EXPECT_FALSE(run("PREPARE add AS INSERT INTO o (amount, pid) VALUES (?, ?), (?, 7)"));
+    EXPECT_FALSE(run("EXECUTE add(-1, 7, -2)"));
+    EXPECT_FALSE(run("PREPARE bump AS UPDATE o SET amount = ? WHERE pid = ? AND amount < 0"));
+    EXPECT_FALSE(run("PREPARE drop AS DELETE FROM o WHERE amount = ?"));
+    EXPECT_FALSE(run("PREPARE count AS SELECT COUNT(*) FROM o WHERE pid = ?"));
+    EXPECT_EQ(asInt(run("EXECUTE count(7)")->rows[0], 0), 8);
+    EXPECT_FALSE(run("CREATE INDEX o_pid ON o(pid)"));
+    EXPECT_FALSE(run("EXECUTE bump(-5, 7)"));
+    EXPECT_EQ(run("SELECT * FROM o WHERE amount = -5")->rows.size(), 2u);
+    EXPECT_FALSE(run("EXECUTE drop(-5)"));
+    EXPECT_EQ(asInt(run("EXECUTE count(7)")->rows[0], 0), 6);
+    EXPECT_EQ(asInt(run("EXECUTE count(8)")->rows[0], 0), 6);
+
+    // a JOIN, with parameters on each table and on both
+    EXPECT_FALSE(run("PREPARE orders AS SELECT id, amount FROM p JOIN o ON p.id = o.pid "
+                     "WHERE city = ? AND amount > ? AND (id = ? OR amount < 0)"));
+    const auto joined = run("EXECUTE orders('Paris', 100, 3)");
+    ASSERT_EQ(joined->rows.size(), 4u); // amounts 103, 153, 203, 253
+    for (const Row& r : joined->rows) {
+        EXPECT_EQ(asInt(r, 0), 3);
+        EXPECT_GT(asInt(r, 1), 100);
+    }
+    EXPECT_TRUE(run("EXECUTE orders('Rome', 100, 3)")->rows.empty());
+
+    // the C++ API
+    auto prepared = exec.prepare(parser.prepareParameterized("SELECT name FROM p WHERE id = ?"));
+    EXPECT_EQ(prepared.parameterCount(), 1u);
+    EXPECT_EQ(asStr(exec.execute(prepared, {VInt(42)})->rows.at(0), 0), "n42");
+    EXPECT_EQ(asStr(exec.execute(prepared, {VInt(1000)})->rows.at(0), 0), "b");
+
+    // errors
+    EXPECT_THROW((void)exec.execute(prepared, {}), std::invalid_argument);
+    EXPECT_THROW((void)exec.execute(prepared, {VStr("42")}), std::invalid_argument);
+    EXPECT_THROW((void)run("EXECUTE byCity(1, 2)"), std::invalid_argument);
+    EXPECT_THROW((void)run("EXECUTE nope"), std::out_of_range);
+    EXPECT_THROW((void)run("PREPARE byCity AS SELECT * FROM p"), std::invalid_argument);
+    EXPECT_THROW((void)run("PREPARE bad AS SELECT * FROM p WHERE nope = ?"), std::out_of_range);
+    EXPECT_THROW((void)run("PREPARE bad AS SELECT * FROM p WHERE city < ?"),
+                 std::invalid_argument);
+    EXPECT_THROW((void)run("PREPARE bad AS INSERT INTO o VALUES (?)"), std::invalid_argument);
+    EXPECT_THROW((void)run("PREPARE bad AS CREATE TABLE x (a int)"), std::invalid_argument);
+    EXPECT_THROW((void)run("EXECUTE bad"), std::out_of_range);
+    EXPECT_FALSE(run("DEALLOCATE byCity"));
+    EXPECT_THROW((void)run("EXECUTE byCity('Rome', 0)"), std::out_of_range);
+    EXPECT_THROW((void)run("DEALLOCATE byCity"), std::out_of_range);
+}
+
+TEST(StatementExecutor, Prepared_JoinBuildsTheSideSmallerAtEachRun) {
+    Database db;
+    StatementExecutor exec{db};
+    const auto run = [&](const std::string& sql) { return exec.executeSql(sql); };
+    EXPECT_FALSE(run("CREATE TABLE a (id int)"));
+    EXPECT_FALSE(run("CREATE TABLE b (id int)"));
+    for (int64_t i = 0; i < 5; ++i) {
+        if (i < 3) {
+            EXPECT_FALSE(run("INSERT INTO a VALUES (" + std::to_string(i) + ")"));
+        }
+        EXPECT_FALSE(run("INSERT INTO b VALUES (" + std::to_string(i) + ")"));
+    }
+
+    auto prepared = exec.prepare(
+        Parser{}.prepareParameterized("SELECT * FROM a JOIN b ON a.id = b.id WHERE a.id >= ?"));
+    EXPECT_EQ(exec.execute(prepared, {VInt(0)})->rows.size(), 3u);
+    EXPECT_EQ(prepared.explain().at(1), "  -> Join a.id = b.id, build a");
+
+    // a outgrows b after planning: the next run builds b instead
+    for (int64_t i = 3; i < 10; ++i)
+        EXPECT_FALSE(run("INSERT INTO a VALUES (" + std::to_string(i) + ")"));
+    EXPECT_EQ(exec.execute(prepared, {VInt(1)})->rows.size(), 4u);
+    EXPECT_EQ(prepared.explain().at(1), "  -> Join a.id = b.id, build b");
+}
+
+TEST(StatementExecutor, PlanCache_ReusesPlansOfTheSameShape) {
+    Database db;
+    StatementExecutor exec{db};
+    const auto run = [&](const std::string& sql) { return exec.executeSql(sql); };
+    EXPECT_FALSE(run("CREATE TABLE p (id int, city str dict, name str)"));
+    EXPECT_FALSE(run("CREATE TABLE o (pid int, amount int)"));
+    const char* cities[] = {"Paris", "Rome", "Oslo"};
+    for (int64_t i = 0; i < 300; ++i) {
+        EXPECT_FALSE(run("INSERT INTO p VALUES (" + std::to_string(i) + ", '" + cities[i % 3] +
+                         "', 'n" + std::to_string(i) + "')"));
+        EXPECT_FALSE(run("INSERT INTO o VALUES (" + std::to_string(i % 50) + ", " +
+                         std::to_string(i) + ")"));
+    }
+    // INSERT, CREATE and the like do not go through the cache
+    EXPECT_EQ(exec.planCacheStats().misses, 0u);
+
+    // the same shape with other literals and spacing is planned once, and answers as planned
+    const auto byCity = [&](const std::string& city, int64_t below) {
+        return run("SELECT id FROM p WHERE city = '" + city + "' AND id < " +
+                   std::to_string(below));
+    };
+    EXPECT_EQ(byCity("Rome", 30)->rows.size(), 10u);
+    EXPECT_EQ(byCity("Oslo", 3)->rows.size(), 1u);
+    EXPECT_EQ(byCity("Bern", 300)->rows.size(), 0u);
+    EXPECT_EQ(run("SELECT id FROM p WHERE city='Paris' AND id < 9;")->rows.size(), 3u);
+    auto stats = exec.planCacheStats();
+    EXPECT_EQ(stats.misses, 2u); // the last one is spaced differently
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.entries, 2u);
+
+    // a dictionary value added after planning is found
+    EXPECT_FALSE(run("INSERT INTO p VALUES (1000, 'Bern', 'b')"));
+    EXPECT_EQ(byCity("Bern", 2000)->rows.size(), 1u);
+
+    // writes and JOINs are cached too
+    for (int64_t pid = 0; pid < 5; ++pid)
+        EXPECT_FALSE(run("UPDATE o SET amount = -1 WHERE pid = " + std::to_string(pid)));
+    EXPECT_EQ(run("SELECT COUNT(*) FROM o WHERE amount = -1")->rows[0].at(0).asInt(), 30);
+    EXPECT_FALSE(run("DELETE FROM o WHERE amount = -1"));
+    EXPECT_FALSE(run("DELETE FROM o WHERE amount = -2"));
+    EXPECT_EQ(run("SELECT COUNT(*) FROM o WHERE amount = -1")->rows[0].at(0).asInt(), 0);
+    const auto joined = run("SELECT id, amount FROM p JOIN o ON p.id = o.pid "
+                            "WHERE city = 'Paris' AND amount > 100 AND id = 6");
+    EXPECT_EQ(joined->rows.size(), 4u); // amounts 106, 156, 206, 256
+    EXPECT_EQ(run("SELECT id, amount FROM p JOIN o ON p.id = o.pid "
+                  "WHERE city = 'Rome' AND amount > 100 AND id = 6")
+                  ->rows.size(),
+              0u);
+    stats = exec.planCacheStats();
+    EXPECT_EQ(stats.misses, 6u);
+    EXPECT_EQ(stats.hits, 3u + 4u + 1u + 1u + 1u);
+
+    // a new index or statistics drop the table's plans; they are made again when next used
+    EXPECT_FALSE(run("CREATE INDEX p_id ON p (id)"));
+    EXPECT_EQ(byCity("Rome", 30)->rows.size(), 10u);
+    EXPECT_FALSE(run("ANALYZE o"));
+    EXPECT_EQ(byCity("Rome", 31)->rows.size(), 10u);
+    EXPECT_EQ(run("SELECT COUNT(*) FROM o WHERE amount = 7")->rows[0].at(0).asInt(), 1);
+    stats = exec.planCacheStats();
+    EXPECT_EQ(stats.invalidations, 2u);
+    EXPECT_EQ(stats.misses, 8u);
+
+    // a plain SELECT can be streamed, from the cache or not
+    std::size_t streamed = 0;
+    const auto count = [&streamed](Cursor& cursor) {
+        streamed += cursor.drain([](const std::vector<Row>&) {});
+    };
+    EXPECT_FALSE(exec.executeSql("SELECT * FROM p WHERE city = 'Oslo'", count));
+    EXPECT_FALSE(exec.executeSql("SELECT * FROM p WHERE city = 'Rome' LIMIT 4", count));
+    EXPECT_EQ(streamed, 104u);
+    EXPECT_TRUE(exec.executeSql("SELECT COUNT(*) FROM p", count));
+
+    // errors are those of the statement as written, and nothing bad is cached
+    EXPECT_THROW((void)run("SELECT * FROM p WHERE id = 'x'"), std::invalid_argument);
+    EXPECT_EQ(byCity("Oslo", 3)->rows.size(), 1u);
+    EXPECT_THROW((void)run("SELECT * FROM p WHERE city = 5"), std::invalid_argument);
+    EXPECT_THROW((void)run("SELECT * FROM p WHERE nope = 5"), std::out_of_range);
+    EXPECT_THROW((void)run("SELECT * FROM nope WHERE id = 5"), std::out_of_range);
+    EXPECT_THROW((void)run("SELECT * FROM p WHERE id = ?"), ParseError);
+    EXPECT_THROW((void)run("SELECT * FROM p WHERE id ="), ParseError);
+
+    // the least recently used plans make room; LIMIT counts are part of the shape
+    for (std::size_t k = 1; k <= StatementExecutor::kPlanCacheEntries; ++k)
+        (void)run("SELECT id FROM p WHERE id < 5 LIMIT " + std::to_string(k));
+    stats = exec.planCacheStats();
+    EXPECT_EQ(stats.entries, StatementExecutor::kPlanCacheEntries);
+    EXPECT_GE(stats.evictions, 10u);
+    const uint64_t hits = stats.hits;
+    EXPECT_EQ(run("SELECT id FROM p WHERE id < 1 LIMIT 1")->rows.size(), 1u);
+    EXPECT_EQ(exec.planCacheStats().hits, hits + 1);
+}
+
+TEST(StatementExecutor, StreamedInsert_StoresBatchesWhileReading) {
+    Database db;
+    StatementExecutor exec{db};
+    EXPECT_FALSE(exec.executeSql("CREATE TABLE t (id int, name str)"));
+
+    std::string script = "-- load\nINSERT INTO t (name, id) VALUES\n";
+    for (int64_t i = 0; i < 10000; ++i)
+        script += (i ? ",\n" : "") + ("('n;" + std::to_string(i) + "', " + std::to_string(i) + ")");
+    script += "; /* done */ SELECT COUNT(*) FROM t;\nINSERT INTO t VALUES (-1, 'x'), ('y', 2);";
+    std::istringstream in{script};
+    StatementReader reader{in};
+
+    const auto streamInsert = [&] {
+        BulkInsert writer{exec};
+        InsertStream insert{[&writer](Insert&& batch) { writer.add(std::move(batch)); }, 1000};
+        if (!reader.streamStatement("INSERT INTO ",
+                                    [&insert](std::string_view text) { insert.feed(text); }))
+            return std::size_t{0};
+        insert.finish();
+        return writer.finish();
+    };
+    EXPECT_EQ(streamInsert(), 10000u);
+    EXPECT_EQ(exec.executeSql("SELECT name FROM t WHERE id = 1234")->rows[0].at(0).str(), "n;1234");
+
+    // another statement is left to next()
+    EXPECT_EQ(streamInsert(), 0u);
+    EXPECT_EQ(reader.next(), "SELECT COUNT(*) FROM t");
+
+    // a bad batch stops the insert; the batches stored before it stay
+    const auto streamInOnes = [&] {
+        BulkInsert writer{exec};
+        InsertStream insert{[&writer](Insert&& batch) { writer.add(std::move(batch)); }, 1};
+        (void)reader.streamStatement("INSERT INTO ",
+                                     [&insert](std::string_view text) { insert.feed(text); });
+        insert.finish();
+        (void)writer.finish();
+    };
+    EXPECT_THROW(streamInOnes(), std::invalid_argument);
+    EXPECT_EQ(db.getTable("t").rowCount(), 10001u);
+    EXPECT_FALSE(reader.next());
+}
@@ -2,8 +2,11 @@
 // Created by Ilya Nyrkov on 22.08.25.
 //
 
+#include "memoria/FilterProgram.h"
 #include "memoria/Predicate.h"
+#include "memoria/ThreadPool.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <gtest/gtest.h>
 #include <memoria/Row.h>
@@ -22,14 +25,14 @@ static Schema schemaStrInt() {
 static Row rowSI(std::string s, int64_t i) {
     std::vector<RowValue> v;
     v.emplace_back(std::move(s));
-    v.emplace_back(std::in_place_type<int64_t>, i);
+    v.emplace_back(i);
     return Row{std::move(v)};
 }
 static int64_t asInt(const Row& r, size_t i) {
-    return std::get<int64_t>(r.at(i));
+    return r.at(i).asInt();
 }
 static std::string asStr(const Row& r, size_t i) {
-    return std::get<std::string>(r.at(i));
+    return r.at(i).str();
 }
 
 TEST(Table, InsertAndRowCount) {
@@ -43,7 +46,7 @@ TEST(Table, InsertAndRowCount) {
 TEST(Table, InsertRejectsWrongArity) {
     Table t{schemaStrInt()};
     std::vector<RowValue> v;
-    v.emplace_back(std::in_place_type<std::string>, "only");
+    v.emplace_back("only");
 
     try {
         t.insertRow(Row{v});
@@ -61,8 +64,8 @@ TEST(Table, InsertRejectsTypeMismatch) {
     Table t{schemaStrInt()};
     // (int, str) vs schema (str, int)
     std::vector<RowValue> v;
-    v.emplace_back(std::in_place_type<int64_t>, 7);
-    v.emplace_back(std::in_place_type<std::string>, "x");
+    v.emplace_back(7);
+    v.emplace_back("x");
 
     try {
         t.insertRow(Row{v});
@@ -82,7 +85,7 @@ TEST(Table, SelectWhere_FullRows) {
     t.insertRow(rowSI("b", 2));
     t.insertRow(rowSI("b", 3));
 
-    auto rows = t.getRowsWhere([](const Row& r) { return std::get<std::string>(r.at(0)) == "b"; });
+    auto rows = t.getRowsWhere([](const Row& r) { return r.at(0).str() == "b"; });
     ASSERT_EQ(rows.size(), 2u);
     EXPECT_EQ(asStr(rows.at(0), 0), "b");
     EXPECT_EQ(asInt(rows.at(0), 1), 2);
@@ -109,6 +112,48 @@ TEST(Table, GetRowsWhere_InvalidProjectionIndexThrows) {
     }
 }
 
+TEST(Table, ViewRowsWhere_ReadsInPlaceUntilMutated) {
+    Table t{schemaStrInt()};
+    t.insertRow(rowSI("a", 1));
+    t.insertRow(rowSI("a string too long to be stored inline", 2));
+    t.insertRow(rowSI("c", 3));
+
+    auto refs = t.viewColumnRowsWhere({1, 0}, [](const RowView& r) { return r.intAt(1) >= 2; });
+    ASSERT_EQ(refs.size(), 2u);
+    EXPECT_EQ(refs.rowIds(), (std::vector<RowId>{makeRowId(0, 1), makeRowId(0, 2)}));
+    ASSERT_EQ(refs[0].size(), 2u);
+    EXPECT_TRUE(refs[0].isInt(0));
+    EXPECT_EQ(refs[0].intAt(0), 2);
+    EXPECT_EQ(refs[0].strAt(1), "a string too long to be stored inline");
+    EXPECT_EQ(asStr(refs[1].materialize(), 1), "c");
+    EXPECT_EQ(refs.materialize().size(), 2u);
+
+    auto all = t.viewRowsWhere([](const Row&) { return true; });
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all[2].size(), 2u);
+    EXPECT_EQ(all[2].strAt(0), "c");
+    EXPECT_THROW((void)all[3], std::out_of_range);
+    EXPECT_THROW((void)t.viewColumnRowsWhere({2}, [](const Row&) { return true; }),
+                 std::out_of_range);
+
+    // reads do not invalidate, every mutation does
+    const uint64_t v = t.version();
+    (void)t.getRowsWhere([](const Row&) { return true; });
+    EXPECT_EQ(t.version(), v);
+    EXPECT_EQ(t.deleteWhere([](const Row&) { return false; }), 0u);
+    EXPECT_TRUE(refs.valid());
+
+    t.insertRow(rowSI("d", 4));
+    EXPECT_FALSE(refs.valid());
+    EXPECT_THROW((void)refs[0], std::logic_error);
+    EXPECT_THROW((void)all.materialize(), std::logic_error);
+
+    auto fresh = t.viewRowsWhere([](const Row&) { return true; });
+    EXPECT_EQ(fresh.size(), 4u);
+    t.updateWhere([](const Row&) { return true; }, {{1, RowValue{int64_t{0}}}});
+    EXPECT_FALSE(fresh.valid());
+}
+
 TEST(Table, DeleteWhere_RemovesAndCounts) {
     Table t{schemaStrInt()};
     t.insertRow(rowSI("a", 1));
@@ -135,7 +180,7 @@ TEST(Table, UpdateWhere_Assignments) {
     // set c1 = "new" where c2 < 3
     std::vector<std::pair<size_t, RowValue>> assigns;
 
-    assigns.emplace_back(0, RowValue{std::in_place_type<std::string>, "new"});
+    assigns.emplace_back(0, RowValue{"new"});
 
     size_t updated = t.updateWhere([](const Row& r) { return asInt(r, 1) < 3; }, assigns);
     EXPECT_EQ(updated, 2u);
@@ -196,3 +241,196 @@ TEST(Table, DeleteAllRows) {
     t.deleteAllRows();
     EXPECT_EQ(t.rowCount(), 0u);
 }
+
+TEST(Table, RowGroups_StableAcrossGrowth) {
+    Table t{schemaStrInt()};
+    for (size_t i = 0; i < kRowGroupSize; ++i)
+        t.insertRow(rowSI("r", static_cast<int64_t>(i)));
+    ASSERT_EQ(t.rowGroupCount(), 1u);
+    const RowGroup* first = &t.rowGroup(0);
+    const int64_t* firstInts = std::get<IntColumn>(first->columns().at(1)).data();
+
+    for (size_t i = 0; i < 10; ++i)
+        t.insertRow(rowSI("s", static_cast<int64_t>(kRowGroupSize + i)));
+    ASSERT_EQ(t.rowGroupCount(), 2u);
+    EXPECT_EQ(&t.rowGroup(0), first);
+    EXPECT_EQ(std::get<IntColumn>(t.rowGroup(0).columns().at(1)).data(), firstInts);
+    EXPECT_EQ(t.rowGroup(1).size(), 10u);
+    EXPECT_EQ(t.rowCount(), kRowGroupSize + 10);
+
+    // scans see rows across group boundaries in insertion order
+    auto tail = t.getRowsWhere([](const Row& r) { return asInt(r, 1) >= 65530; });
+    ASSERT_EQ(tail.size(), kRowGroupSize + 10 - 65530);
+    EXPECT_EQ(asInt(tail.front(), 1), 65530);
+    EXPECT_EQ(asStr(tail.back(), 0), "s");
+}
+
+TEST(Table, RowGroups_DeleteRepacksSparseGroups) {
+    Table t{schemaStrInt()};
+    const size_t n = 2 * kRowGroupSize + 5;
+    for (size_t i = 0; i < n; ++i)
+        t.insertRow(rowSI("r", static_cast<int64_t>(i)));
+    ASSERT_EQ(t.rowGroupCount(), 3u);
+
+    // keep every 100th row: three sparse groups collapse into one
+    size_t removed = t.deleteWhere([](const Row& r) { return asInt(r, 1) % 100 != 0; });
+    EXPECT_EQ(t.rowCount(), n - removed);
+    EXPECT_EQ(t.rowGroupCount(), 1u);
+
+    auto rows = t.getRowsWhere([](const Row&) { return true; });
+    ASSERT_EQ(rows.size(), t.rowCount());
+    for (size_t i = 0; i < rows.size(); ++i)
+        EXPECT_EQ(asInt(rows[i], 1), static_cast<int64_t>(i * 100));
+
+    // UPDATE spans groups too
+    t.insertRow(rowSI("tail", 1));
+    EXPECT_EQ(t.updateWhere([](const Row&) { return true; },
+                            {{0, RowValue{std::string{"all"}}}}),
+              t.rowCount());
+}
+
+TEST(Table, InsertRows_BulkAcrossGroups) {
+    Table t{Schema{{{"c1", ColumnType::Str},
+                    {"c2", ColumnType::Int},
+                    {"c3", ColumnType::Str, ColumnEncoding::Dictionary}}}};
+    t.createIndex("by_c2", 1);
+    const auto batch = [](std::size_t from, std::size_t n) {
+        std::vector<Row> rows;
+        for (std::size_t i = from; i < from + n; ++i)
+            rows.push_back(Row{{RowValue{std::string(i % 3 == 0 ? 20 : 1, 'x')},
+                                RowValue{static_cast<int64_t>(i)},
+                                RowValue{i % 2 ? "odd" : "even"}}});
+        return rows;
+    };
+    t.insertRows(batch(0, 100));
+    for (std::size_t k = 0; k < 300; ++k) // many small batches into the growing first group
+        t.insertRows(batch(100 + k * 3, 3));
+    t.insertRows(batch(1000, kRowGroupSize + 500)); // fills group 0, then spills into two more
+    t.insertRows({});
+    EXPECT_EQ(t.rowCount(), kRowGroupSize + 1500);
+    ASSERT_EQ(t.rowGroupCount(), 2u);
+    EXPECT_TRUE(t.rowGroup(0).full());
+
+    const auto all = t.getRowsWhere([](const Row&) { return true; });
+    ASSERT_EQ(all.size(), t.rowCount());
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(asInt(all[i], 1), static_cast<int64_t>(i));
+        ASSERT_EQ(asStr(all[i], 0).size(), i % 3 == 0 ? 20u : 1u);
+        ASSERT_EQ(asStr(all[i], 2), i % 2 ? "odd" : "even");
+    }
+    const auto* ids = t.hashIndex(1)->find(RowValue{int64_t{kRowGroupSize + 7}});
+    ASSERT_NE(ids, nullptr);
+    EXPECT_EQ(*ids, std::vector<RowId>{makeRowId(1, 7)});
+
+    // a bad row anywhere in the batch leaves the table unchanged
+    auto bad = batch(0, 10);
+    bad[9].at(1) = RowValue{"x"};
+    EXPECT_THROW(t.insertRows(std::move(bad)), std::invalid_argument);
+    auto shortRow = batch(0, 10);
+    shortRow[3] = Row{{RowValue{"x"}}};
+    EXPECT_THROW(t.insertRows(std::move(shortRow)), std::invalid_argument);
+    EXPECT_EQ(t.rowCount(), kRowGroupSize + 1500);
+    EXPECT_EQ(t.rowGroup(1).size(), 1500u);
+}
+
+TEST(Table, HashIndex_MaintainedAcrossMutations) {
+    Table t{schemaStrInt()};
+    for (size_t i = 0; i < kRowGroupSize + 100; ++i)
+        t.insertRow(rowSI(i % 2 ? "odd" : "even", static_cast<int64_t>(i)));
+    t.createIndex("by_c2", 1);
+    t.createIndex("by_c1", 0);
+    EXPECT_THROW(t.createIndex("by_c2", 0), std::invalid_argument);
+
+    const HashIndex* byC2 = t.hashIndex(1);
+    ASSERT_NE(byC2, nullptr);
+    auto lookup = [&](int64_t key) {
+        const auto* ids = byC2->find(RowValue{key});
+        return ids ? *ids : std::vector<RowId>{};
+    };
+    const int64_t late = static_cast<int64_t>(kRowGroupSize + 50);
+    ASSERT_EQ(lookup(late).size(), 1u);
+    EXPECT_EQ(lookup(late)[0], makeRowId(1, 50));
+
+    // delete from group 0 shifts its rows; entries must follow
+    EXPECT_EQ(t.deleteWhere([](const Row& r) { return asInt(r, 1) < 10; }), 10u);
+    EXPECT_TRUE(lookup(5).empty());
+    ASSERT_EQ(lookup(20).size(), 1u);
+    EXPECT_EQ(lookup(20)[0], makeRowId(0, 10));
+    EXPECT_EQ(lookup(late)[0], makeRowId(1, 50));
+
+    // candidates restrict what the scan tests
+    std::vector<RowId> cand = lookup(20);
+    auto rows = t.getRowsWhere([](const Row&) { return true; }, &cand);
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(asInt(rows[0], 1), 20);
+
+    // updating the indexed column moves entries to the new key
+    std::vector<std::pair<size_t, RowValue>> assigns;
+    assigns.emplace_back(1, RowValue{int64_t{-1}});
+    EXPECT_EQ(t.updateWhere([](const Row& r) { return asInt(r, 1) == 20; }, assigns, &cand), 1u);
+    EXPECT_TRUE(lookup(20).empty());
+    EXPECT_EQ(lookup(-1).size(), 1u);
+    // group 0 was re-added under group 1: lists stay in storage order
+    const auto* odd = t.hashIndex(0)->find(RowValue{"odd"});
+    ASSERT_NE(odd, nullptr);
+    EXPECT_TRUE(std::is_sorted(odd->begin(), odd->end()));
+    EXPECT_EQ(odd->size(), (kRowGroupSize + 100) / 2 - 5);
+
+    // dropping a whole group renumbers the rest
+    t.deleteWhere([](const Row& r) { return asInt(r, 1) < static_cast<int64_t>(kRowGroupSize); });
+    EXPECT_EQ(t.rowGroupCount(), 1u);
+    ASSERT_EQ(lookup(late).size(), 1u);
+    EXPECT_EQ(lookup(late)[0], makeRowId(0, 50));
+    EXPECT_EQ(t.hashIndex(0)->find(RowValue{"odd"})->size(), 50u);
+
+    t.deleteAllRows();
+    EXPECT_TRUE(lookup(late).empty());
+}
+
+TEST(Table, ParallelScans_MatchSerial) {
+    // four row groups, the last one partial
+    auto fill = [](Table& t) {
+        for (int64_t i = 0; i < 3 * static_cast<int64_t>(kRowGroupSize) + 1000; ++i)
+            t.insertRow(rowSI(i % 2 ? "odd" : "even", i));
+    };
+    Table serial{schemaStrInt()};
+    Table par{schemaStrInt()};
+    fill(serial);
+    fill(par);
+    ThreadPool pool{3};
+
+    // c2 >= 1000 AND c2 < 200000: partial first and last group
+    FilterProgram band;
+    const uint32_t upper = band.emit(FilterOp::IntLt, 1, 200000, FilterProgram::kAccept,
+                                     FilterProgram::kReject);
+    band.finish(band.emit(FilterOp::IntGe, 1, 1000, upper, FilterProgram::kReject));
+
+    EXPECT_EQ(par.getRowIdsWhere(band, nullptr, &pool), serial.getRowIdsWhere(band));
+    const auto rows = par.getColumnRowsWhere({1}, band, nullptr, &pool);
+    ASSERT_EQ(rows.size(), par.rowCount() - 1000);
+    for (std::size_t i = 0; i < rows.size(); ++i)
+        ASSERT_EQ(asInt(rows[i], 0), static_cast<int64_t>(i) + 1000);
+
+    // candidates spanning groups are refined per group
+    std::vector<RowId> candidates;
+    for (std::size_t g = 0; g < 4; ++g)
+        candidates.push_back(makeRowId(g, 500));
+    // offset 500 of group 0 is below the band, the others (up to 197108) are in it
+    EXPECT_EQ(par.getRowsWhere(band, &candidates, &pool).size(), 3u);
+    EXPECT_EQ(par.viewRowsWhere(band, &candidates, &pool).rowIds(),
+              serial.getRowIdsWhere(band, &candidates));
+
+    // the WHERE phase of UPDATE / DELETE
+    EXPECT_EQ(par.updateWhere(band, {{0, RowValue{"band"}}}, nullptr, &pool),
+              serial.updateWhere(band, {{0, RowValue{"band"}}}));
+    EXPECT_EQ(par.deleteWhere(band, nullptr, &pool), serial.deleteWhere(band));
+    EXPECT_EQ(par.rowCount(), serial.rowCount());
+    const auto all = [](const Row&) { return true; };
+    const auto a = par.getRowsWhere(all);
+    const auto b = serial.getRowsWhere(all);
+    ASSERT_EQ(a.size(), b.size());
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        ASSERT_EQ(asInt(a[i], 1), asInt(b[i], 1));
+        ASSERT_EQ(asStr(a[i], 0), asStr(b[i], 0));
+    }
+}
@@ -0,0 +1,49 @@
+//
+// Created by Ilya Nyrkov on 20.09.25.
+//
+
+#include <atomic>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <memoria/ThreadPool.h>
+#include <stdexcept>
+#include <vector>
+
+using namespace memoria;
+
+TEST(ThreadPool, RunsEveryIndexOnce) {
+    for (std::size_t threads : {1u, 2u, 4u}) {
+        ThreadPool pool{threads};
+        EXPECT_EQ(pool.size(), threads);
+        for (std::size_t n : {0u, 1u, 3u, 100u}) {
+            std::vector<std::atomic<int>> hits(n);
+            pool.parallelFor(n, [&](std::size_t i) { hits[i].fetch_add(1); });
+            for (std::size_t i = 0; i < n; ++i)
+                ASSERT_EQ(hits[i].load(), 1) << threads << " threads, index " << i;
+        }
+    }
+    EXPECT_THROW(ThreadPool{0}, std::invalid_argument);
+}
+
+TEST(ThreadPool, RethrowsFirstErrorAndStaysUsable) {
+    ThreadPool pool{4};
+    EXPECT_THROW(pool.parallelFor(64,
+                                  [](std::size_t i) {
+                                      if (i % 7 == 3)
+                                          throw std::runtime_error("morsel failed");
+                                  }),
+                 std::runtime_error);
+
+    std::atomic<std::size_t> sum{0};
+    pool.parallelFor(10, [&](std::size_t i) { sum += i; });
+    EXPECT_EQ(sum.load(), 45u);
+}
+
+TEST(ThreadPool, NestedParallelForDoesNotDeadlock) {
+    ThreadPool pool{3};
+    std::atomic<std::size_t> count{0};
+    pool.parallelFor(8, [&](std::size_t) {
+        pool.parallelFor(8, [&](std::size_t) { count.fetch_add(1); });
+    });
+    EXPECT_EQ(count.load(), 64u);
+}